@@ -44,12 +44,12 @@ VKBP_ENABLE_WARNINGS()
 namespace vkb
 {
 template <typename T>
-inline void read(std::istringstream &is, T &value)
+inline void read(std::istream &is, T &value)
 {
 	is.read(reinterpret_cast<char *>(&value), sizeof(T));
 }
 
-inline void read(std::istringstream &is, std::string &value)
+inline void read(std::istream &is, std::string &value)
 {
 	std::size_t size;
 	read(is, size);
@@ -58,7 +58,7 @@ inline void read(std::istringstream &is, std::string &value)
 }
 
 template <class T>
-inline void read(std::istringstream &is, std::set<T> &value)
+inline void read(std::istream &is, std::set<T> &value)
 {
 	std::size_t size;
 	read(is, size);
@@ -71,7 +71,7 @@ inline void read(std::istringstream &is, std::set<T> &value)
 }
 
 template <class T>
-inline void read(std::istringstream &is, std::vector<T> &value)
+inline void read(std::istream &is, std::vector<T> &value)
 {
 	std::size_t size;
 	read(is, size);
@@ -80,7 +80,7 @@ inline void read(std::istringstream &is, std::vector<T> &value)
 }
 
 template <class T, class S>
-inline void read(std::istringstream &is, std::map<T, S> &value)
+inline void read(std::istream &is, std::map<T, S> &value)
 {
 	std::size_t size;
 	read(is, size);
@@ -96,13 +96,13 @@ inline void read(std::istringstream &is, std::map<T, S> &value)
 }
 
 template <class T, uint32_t N>
-inline void read(std::istringstream &is, std::array<T, N> &value)
+inline void read(std::istream &is, std::array<T, N> &value)
 {
 	is.read(reinterpret_cast<char *>(value.data()), N * sizeof(T));
 }
 
 template <typename T, typename... Args>
-inline void read(std::istringstream &is, T &first_arg, Args &... args)
+inline void read(std::istream &is, T &first_arg, Args &... args)
 {
 	read(is, first_arg);
 
@@ -164,6 +164,28 @@ inline void write(std::ostringstream &os, const T &first_arg, const Args &... ar
 	write(os, args...);
 }
 
+/**
+ * @brief 64-bit FNV-1a hash of a block of memory. Unlike std::hash
+ *        the result is stable across runs and platforms, so it can be
+ *        used to key or validate data persisted to disk.
+ * @param data Pointer to the data to hash
+ * @param size Size of the data in bytes
+ * @param seed The hash to continue from, to combine several blocks
+ * @return The updated hash
+ */
+inline uint64_t fnv1a_64(const void *data, size_t size, uint64_t seed = 0xcbf29ce484222325ULL)
+{
+	auto bytes = static_cast<const uint8_t *>(data);
+
+	for (size_t i = 0; i < size; ++i)
+	{
+		seed ^= bytes[i];
+		seed *= 0x100000001b3ULL;
+	}
+
+	return seed;
+}
+
 /**
  * @brief Helper function to combine a given hash
  *        with a generated hash for the input param.
@@ -214,4 +236,51 @@ inline std::vector<uint8_t> to_bytes(const T &value)
 	                            reinterpret_cast<const uint8_t *>(&value) + sizeof(T)};
 }
 
+/**
+ * @brief Sorts items by their 64-bit key member, one byte per pass starting from the least significant.
+ *        Items with equal keys keep their order.
+ * @param scratch Buffer reused across calls, the sorted items may end up swapped into it
+ */
+template <class T>
+inline void radix_sort(std::vector<T> &items, std::vector<T> &scratch)
+{
+	if (items.size() < 2)
+	{
+		return;
+	}
+
+	scratch.resize(items.size());
+
+	for (uint32_t shift = 0; shift < 64; shift += 8)
+	{
+		std::array<size_t, 256> offsets{};
+
+		for (auto &item : items)
+		{
+			++offsets[(item.key >> shift) & 0xff];
+		}
+
+		// Bytes that every key shares, like the unused low bits, would not move anything
+		if (offsets[(items[0].key >> shift) & 0xff] == items.size())
+		{
+			continue;
+		}
+
+		size_t offset = 0;
+		for (auto &count : offsets)
+		{
+			auto bucket_size = count;
+			count            = offset;
+			offset += bucket_size;
+		}
+
+		for (auto &item : items)
+		{
+			scratch[offsets[(item.key >> shift) & 0xff]++] = item;
+		}
+
+		std::swap(items, scratch);
+	}
+}
+
 }        // namespace vkb
@@ -17,6 +17,8 @@
 
 #pragma once
 
+#include <type_traits>
+
 #include "core/descriptor_pool.h"
 #include "core/descriptor_set.h"
 #include "core/descriptor_set_layout.h"
@@ -76,7 +78,7 @@ struct hash<vkb::DescriptorSetLayout>
 	{
 		std::size_t result = 0;
 
-		vkb::hash_combine(result, descriptor_set_layout.get_handle());
+		vkb::hash_combine(result, descriptor_set_layout.get_id());
 
 		return result;
 	}
@@ -102,7 +104,7 @@ struct hash<vkb::PipelineLayout>
 	{
 		std::size_t result = 0;
 
-		vkb::hash_combine(result, pipeline_layout.get_handle());
+		vkb::hash_combine(result, pipeline_layout.get_id());
 
 		return result;
 	}
@@ -115,7 +117,7 @@ struct hash<vkb::RenderPass>
 	{
 		std::size_t result = 0;
 
-		vkb::hash_combine(result, render_pass.get_handle());
+		vkb::hash_combine(result, render_pass.get_id());
 
 		return result;
 	}
@@ -188,7 +190,7 @@ struct hash<vkb::SpecializationConstantState>
 	{
 		std::size_t result = 0;
 
-		for (auto constants : specialization_constant_state.get_specialization_constant_state())
+		for (const auto &constants : specialization_constant_state.get_specialization_constant_state())
 		{
 			vkb::hash_combine(result, constants.first);
 			for (const auto data : constants.second)
@@ -436,16 +438,20 @@ struct hash<vkb::ColorBlendAttachmentState>
 };
 
 template <>
-struct hash<vkb::RenderTarget>
+struct hash<vkb::VertexInputState>
 {
-	std::size_t operator()(const vkb::RenderTarget &render_target) const
+	std::size_t operator()(const vkb::VertexInputState &vertex_input_state) const
 	{
 		std::size_t result = 0;
 
-		for (auto &view : render_target.get_views())
+		for (auto &attribute : vertex_input_state.attributes)
 		{
-			vkb::hash_combine(result, view.get_handle());
-			vkb::hash_combine(result, view.get_image().get_handle());
+			vkb::hash_combine(result, attribute);
+		}
+
+		for (auto &binding : vertex_input_state.bindings)
+		{
+			vkb::hash_combine(result, binding);
 		}
 
 		return result;
@@ -453,201 +459,610 @@ struct hash<vkb::RenderTarget>
 };
 
 template <>
-struct hash<vkb::PipelineState>
+struct hash<vkb::InputAssemblyState>
 {
-	std::size_t operator()(const vkb::PipelineState &pipeline_state) const
+	std::size_t operator()(const vkb::InputAssemblyState &input_assembly_state) const
 	{
 		std::size_t result = 0;
 
-		vkb::hash_combine(result, pipeline_state.get_pipeline_layout().get_handle());
+		vkb::hash_combine(result, input_assembly_state.primitive_restart_enable);
+		vkb::hash_combine(result, static_cast<std::underlying_type<VkPrimitiveTopology>::type>(input_assembly_state.topology));
 
-		// For graphics only
-		if (auto render_pass = pipeline_state.get_render_pass())
-		{
-			vkb::hash_combine(result, render_pass->get_handle());
-		}
+		return result;
+	}
+};
+
+template <>
+struct hash<vkb::ViewportState>
+{
+	std::size_t operator()(const vkb::ViewportState &viewport_state) const
+	{
+		std::size_t result = 0;
 
-		vkb::hash_combine(result, pipeline_state.get_specialization_constant_state());
+		vkb::hash_combine(result, viewport_state.viewport_count);
+		vkb::hash_combine(result, viewport_state.scissor_count);
 
-		vkb::hash_combine(result, pipeline_state.get_subpass_index());
+		return result;
+	}
+};
 
-		for (auto shader_module : pipeline_state.get_pipeline_layout().get_shader_modules())
-		{
-			vkb::hash_combine(result, shader_module->get_id());
-		}
+template <>
+struct hash<vkb::RasterizationState>
+{
+	std::size_t operator()(const vkb::RasterizationState &rasterization_state) const
+	{
+		std::size_t result = 0;
 
-		// VkPipelineVertexInputStateCreateInfo
-		for (auto &attribute : pipeline_state.get_vertex_input_state().attributes)
-		{
-			vkb::hash_combine(result, attribute);
-		}
+		vkb::hash_combine(result, rasterization_state.cull_mode);
+		vkb::hash_combine(result, rasterization_state.depth_bias_enable);
+		vkb::hash_combine(result, rasterization_state.depth_clamp_enable);
+		vkb::hash_combine(result, static_cast<std::underlying_type<VkFrontFace>::type>(rasterization_state.front_face));
+		vkb::hash_combine(result, static_cast<std::underlying_type<VkPolygonMode>::type>(rasterization_state.polygon_mode));
+		vkb::hash_combine(result, rasterization_state.rasterizer_discard_enable);
+
+		return result;
+	}
+};
+
+template <>
+struct hash<vkb::MultisampleState>
+{
+	std::size_t operator()(const vkb::MultisampleState &multisample_state) const
+	{
+		std::size_t result = 0;
+
+		vkb::hash_combine(result, multisample_state.alpha_to_coverage_enable);
+		vkb::hash_combine(result, multisample_state.alpha_to_one_enable);
+		vkb::hash_combine(result, multisample_state.min_sample_shading);
+		vkb::hash_combine(result, static_cast<std::underlying_type<VkSampleCountFlagBits>::type>(multisample_state.rasterization_samples));
+		vkb::hash_combine(result, multisample_state.sample_shading_enable);
+		vkb::hash_combine(result, multisample_state.sample_mask);
+
+		return result;
+	}
+};
+
+template <>
+struct hash<vkb::DepthStencilState>
+{
+	std::size_t operator()(const vkb::DepthStencilState &depth_stencil_state) const
+	{
+		std::size_t result = 0;
+
+		vkb::hash_combine(result, depth_stencil_state.back);
+		vkb::hash_combine(result, depth_stencil_state.depth_bounds_test_enable);
+		vkb::hash_combine(result, static_cast<std::underlying_type<VkCompareOp>::type>(depth_stencil_state.depth_compare_op));
+		vkb::hash_combine(result, depth_stencil_state.depth_test_enable);
+		vkb::hash_combine(result, depth_stencil_state.depth_write_enable);
+		vkb::hash_combine(result, depth_stencil_state.front);
+		vkb::hash_combine(result, depth_stencil_state.stencil_test_enable);
+
+		return result;
+	}
+};
+
+template <>
+struct hash<vkb::ColorBlendState>
+{
+	std::size_t operator()(const vkb::ColorBlendState &color_blend_state) const
+	{
+		std::size_t result = 0;
+
+		vkb::hash_combine(result, static_cast<std::underlying_type<VkLogicOp>::type>(color_blend_state.logic_op));
+		vkb::hash_combine(result, color_blend_state.logic_op_enable);
 
-		for (auto &binding : pipeline_state.get_vertex_input_state().bindings)
+		for (auto &attachment : color_blend_state.attachments)
 		{
-			vkb::hash_combine(result, binding);
+			vkb::hash_combine(result, attachment);
 		}
 
-		// VkPipelineInputAssemblyStateCreateInfo
-		vkb::hash_combine(result, pipeline_state.get_input_assembly_state().primitive_restart_enable);
-		vkb::hash_combine(result, static_cast<std::underlying_type<VkPrimitiveTopology>::type>(pipeline_state.get_input_assembly_state().topology));
-
-		//VkPipelineViewportStateCreateInfo
-		vkb::hash_combine(result, pipeline_state.get_viewport_state().viewport_count);
-		vkb::hash_combine(result, pipeline_state.get_viewport_state().scissor_count);
-
-		// VkPipelineRasterizationStateCreateInfo
-		vkb::hash_combine(result, pipeline_state.get_rasterization_state().cull_mode);
-		vkb::hash_combine(result, pipeline_state.get_rasterization_state().depth_bias_enable);
-		vkb::hash_combine(result, pipeline_state.get_rasterization_state().depth_clamp_enable);
-		vkb::hash_combine(result, static_cast<std::underlying_type<VkFrontFace>::type>(pipeline_state.get_rasterization_state().front_face));
-		vkb::hash_combine(result, static_cast<std::underlying_type<VkPolygonMode>::type>(pipeline_state.get_rasterization_state().polygon_mode));
-		vkb::hash_combine(result, pipeline_state.get_rasterization_state().rasterizer_discard_enable);
-
-		// VkPipelineMultisampleStateCreateInfo
-		vkb::hash_combine(result, pipeline_state.get_multisample_state().alpha_to_coverage_enable);
-		vkb::hash_combine(result, pipeline_state.get_multisample_state().alpha_to_one_enable);
-		vkb::hash_combine(result, pipeline_state.get_multisample_state().min_sample_shading);
-		vkb::hash_combine(result, static_cast<std::underlying_type<VkSampleCountFlagBits>::type>(pipeline_state.get_multisample_state().rasterization_samples));
-		vkb::hash_combine(result, pipeline_state.get_multisample_state().sample_shading_enable);
-		vkb::hash_combine(result, pipeline_state.get_multisample_state().sample_mask);
-
-		// VkPipelineDepthStencilStateCreateInfo
-		vkb::hash_combine(result, pipeline_state.get_depth_stencil_state().back);
-		vkb::hash_combine(result, pipeline_state.get_depth_stencil_state().depth_bounds_test_enable);
-		vkb::hash_combine(result, static_cast<std::underlying_type<VkCompareOp>::type>(pipeline_state.get_depth_stencil_state().depth_compare_op));
-		vkb::hash_combine(result, pipeline_state.get_depth_stencil_state().depth_test_enable);
-		vkb::hash_combine(result, pipeline_state.get_depth_stencil_state().depth_write_enable);
-		vkb::hash_combine(result, pipeline_state.get_depth_stencil_state().front);
-		vkb::hash_combine(result, pipeline_state.get_depth_stencil_state().stencil_test_enable);
-
-		// VkPipelineColorBlendStateCreateInfo
-		vkb::hash_combine(result, static_cast<std::underlying_type<VkLogicOp>::type>(pipeline_state.get_color_blend_state().logic_op));
-		vkb::hash_combine(result, pipeline_state.get_color_blend_state().logic_op_enable);
-
-		for (auto &attachment : pipeline_state.get_color_blend_state().attachments)
+		return result;
+	}
+};
+
+template <>
+struct hash<vkb::RenderTarget>
+{
+	std::size_t operator()(const vkb::RenderTarget &render_target) const
+	{
+		std::size_t result = 0;
+
+		for (auto &view : render_target.get_views())
 		{
-			vkb::hash_combine(result, attachment);
+			vkb::hash_combine(result, view.get_handle());
+			vkb::hash_combine(result, view.get_image().get_handle());
 		}
 
 		return result;
 	}
 };
+
+template <>
+struct hash<vkb::PipelineState>
+{
+	std::size_t operator()(const vkb::PipelineState &pipeline_state) const
+	{
+		return static_cast<std::size_t>(pipeline_state.get_hash());
+	}
+};
 }        // namespace std
 
 namespace vkb
 {
 namespace
 {
+/**
+ * @brief Continues a 64-bit FNV-1a hash with a scalar, like an integer, an enum or a handle.
+ *        Structures are hashed field by field by the specializations below, so that the
+ *        result does not depend on padding, pointers to owned data or the standard library.
+ */
 template <typename T>
-inline void hash_param(size_t &seed, const T &value)
+inline void hash_param(uint64_t &seed, const T &value)
 {
-	hash_combine(seed, value);
+	static_assert(std::is_scalar<T>::value, "Structures need a hash_param specialization");
+
+	// The pipeline cache does not change the pipelines built with it. Where handles are not
+	// pointers, it is a uint64_t like the ids and cannot be told apart, so it is hashed.
+	if (std::is_pointer<VkPipelineCache>::value && std::is_same<T, VkPipelineCache>::value)
+	{
+		return;
+	}
+
+	seed = fnv1a_64(&value, sizeof(T), seed);
 }
 
 template <>
-inline void hash_param(size_t & /*seed*/, const VkPipelineCache & /*value*/)
+inline void hash_param<std::string>(
+    uint64_t &         seed,
+    const std::string &value)
 {
+	uint64_t size = value.size();
+
+	seed = fnv1a_64(&size, sizeof(size), seed);
+	seed = fnv1a_64(value.data(), value.size(), seed);
 }
 
 template <>
 inline void hash_param<std::vector<uint8_t>>(
-    size_t &                    seed,
+    uint64_t &                  seed,
     const std::vector<uint8_t> &value)
 {
-	hash_combine(seed, std::string{value.begin(), value.end()});
+	uint64_t size = value.size();
+
+	seed = fnv1a_64(&size, sizeof(size), seed);
+	seed = fnv1a_64(value.data(), value.size(), seed);
+}
+
+template <>
+inline void hash_param<std::vector<uint32_t>>(
+    uint64_t &                   seed,
+    const std::vector<uint32_t> &value)
+{
+	uint64_t size = value.size();
+
+	seed = fnv1a_64(&size, sizeof(size), seed);
+	seed = fnv1a_64(value.data(), value.size() * sizeof(uint32_t), seed);
+}
+
+template <>
+inline void hash_param<ShaderSource>(
+    uint64_t &          seed,
+    const ShaderSource &value)
+{
+	hash_param(seed, value.get_id());
+}
+
+template <>
+inline void hash_param<ShaderVariant>(
+    uint64_t &           seed,
+    const ShaderVariant &value)
+{
+	hash_param(seed, value.get_id());
+}
+
+template <>
+inline void hash_param<std::vector<ShaderModule *>>(
+    uint64_t &                         seed,
+    const std::vector<ShaderModule *> &value)
+{
+	for (auto &shader_module : value)
+	{
+		hash_param(seed, shader_module->get_id());
+	}
+}
+
+template <>
+inline void hash_param<ShaderResource>(
+    uint64_t &            seed,
+    const ShaderResource &value)
+{
+	// Only resources bound through descriptor sets change the layout
+	if (value.type == ShaderResourceType::Input ||
+	    value.type == ShaderResourceType::Output ||
+	    value.type == ShaderResourceType::PushConstant ||
+	    value.type == ShaderResourceType::SpecializationConstant)
+	{
+		return;
+	}
+
+	hash_param(seed, value.set);
+	hash_param(seed, value.binding);
+	hash_param(seed, value.type);
+	hash_param(seed, value.mode);
+}
+
+template <>
+inline void hash_param<std::vector<ShaderResource>>(
+    uint64_t &                         seed,
+    const std::vector<ShaderResource> &value)
+{
+	for (auto &resource : value)
+	{
+		hash_param(seed, resource);
+	}
+}
+
+template <>
+inline void hash_param<DescriptorSetLayout>(
+    uint64_t &                 seed,
+    const DescriptorSetLayout &value)
+{
+	hash_param(seed, value.get_id());
+}
+
+template <>
+inline void hash_param<DescriptorPool>(
+    uint64_t &            seed,
+    const DescriptorPool &value)
+{
+	hash_param(seed, value.get_descriptor_set_layout());
+}
+
+template <>
+inline void hash_param<Attachment>(
+    uint64_t &        seed,
+    const Attachment &value)
+{
+	hash_param(seed, value.format);
+	hash_param(seed, value.samples);
+	hash_param(seed, value.usage);
+	hash_param(seed, value.initial_layout);
 }
 
 template <>
 inline void hash_param<std::vector<Attachment>>(
-    size_t &                       seed,
+    uint64_t &                     seed,
     const std::vector<Attachment> &value)
 {
 	for (auto &attachment : value)
 	{
-		hash_combine(seed, attachment);
+		hash_param(seed, attachment);
 	}
 }
 
+template <>
+inline void hash_param<LoadStoreInfo>(
+    uint64_t &           seed,
+    const LoadStoreInfo &value)
+{
+	hash_param(seed, value.load_op);
+	hash_param(seed, value.store_op);
+}
+
 template <>
 inline void hash_param<std::vector<LoadStoreInfo>>(
-    size_t &                          seed,
+    uint64_t &                        seed,
     const std::vector<LoadStoreInfo> &value)
 {
 	for (auto &load_store_info : value)
 	{
-		hash_combine(seed, load_store_info);
+		hash_param(seed, load_store_info);
 	}
 }
 
+template <>
+inline void hash_param<SubpassInfo>(
+    uint64_t &         seed,
+    const SubpassInfo &value)
+{
+	hash_param(seed, value.output_attachments);
+	hash_param(seed, value.input_attachments);
+	hash_param(seed, value.color_resolve_attachments);
+	hash_param(seed, value.disable_depth_stencil_attachment);
+	hash_param(seed, value.depth_stencil_resolve_attachment);
+	hash_param(seed, value.depth_stencil_resolve_mode);
+}
+
 template <>
 inline void hash_param<std::vector<SubpassInfo>>(
-    size_t &                        seed,
+    uint64_t &                      seed,
     const std::vector<SubpassInfo> &value)
 {
 	for (auto &subpass_info : value)
 	{
-		hash_combine(seed, subpass_info);
+		hash_param(seed, subpass_info);
 	}
 }
 
 template <>
-inline void hash_param<std::vector<ShaderModule *>>(
-    size_t &                           seed,
-    const std::vector<ShaderModule *> &value)
+inline void hash_param<RenderPass>(
+    uint64_t &        seed,
+    const RenderPass &value)
 {
-	for (auto &shader_module : value)
+	hash_param(seed, value.get_id());
+}
+
+template <>
+inline void hash_param<RenderTarget>(
+    uint64_t &          seed,
+    const RenderTarget &value)
+{
+	for (auto &view : value.get_views())
 	{
-		hash_combine(seed, shader_module->get_id());
+		hash_param(seed, view.get_handle());
+		hash_param(seed, view.get_image().get_handle());
 	}
 }
 
 template <>
-inline void hash_param<std::vector<ShaderResource>>(
-    size_t &                           seed,
-    const std::vector<ShaderResource> &value)
+inline void hash_param<SpecializationConstantState>(
+    uint64_t &                         seed,
+    const SpecializationConstantState &value)
 {
-	for (auto &resource : value)
+	for (auto &constant : value.get_specialization_constant_state())
+	{
+		hash_param(seed, constant.first);
+		hash_param(seed, constant.second);
+	}
+}
+
+template <>
+inline void hash_param<VkVertexInputAttributeDescription>(
+    uint64_t &                               seed,
+    const VkVertexInputAttributeDescription &value)
+{
+	hash_param(seed, value.location);
+	hash_param(seed, value.binding);
+	hash_param(seed, value.format);
+	hash_param(seed, value.offset);
+}
+
+template <>
+inline void hash_param<VkVertexInputBindingDescription>(
+    uint64_t &                             seed,
+    const VkVertexInputBindingDescription &value)
+{
+	hash_param(seed, value.binding);
+	hash_param(seed, value.stride);
+	hash_param(seed, value.inputRate);
+}
+
+template <>
+inline void hash_param<VertexInputState>(
+    uint64_t &              seed,
+    const VertexInputState &value)
+{
+	for (auto &attribute : value.attributes)
+	{
+		hash_param(seed, attribute);
+	}
+
+	for (auto &binding : value.bindings)
+	{
+		hash_param(seed, binding);
+	}
+}
+
+template <>
+inline void hash_param<InputAssemblyState>(
+    uint64_t &                seed,
+    const InputAssemblyState &value)
+{
+	hash_param(seed, value.topology);
+	hash_param(seed, value.primitive_restart_enable);
+}
+
+template <>
+inline void hash_param<RasterizationState>(
+    uint64_t &                seed,
+    const RasterizationState &value)
+{
+	hash_param(seed, value.depth_clamp_enable);
+	hash_param(seed, value.rasterizer_discard_enable);
+	hash_param(seed, value.polygon_mode);
+	hash_param(seed, value.cull_mode);
+	hash_param(seed, value.front_face);
+	hash_param(seed, value.depth_bias_enable);
+}
+
+template <>
+inline void hash_param<ViewportState>(
+    uint64_t &           seed,
+    const ViewportState &value)
+{
+	hash_param(seed, value.viewport_count);
+	hash_param(seed, value.scissor_count);
+}
+
+template <>
+inline void hash_param<MultisampleState>(
+    uint64_t &              seed,
+    const MultisampleState &value)
+{
+	hash_param(seed, value.rasterization_samples);
+	hash_param(seed, value.sample_shading_enable);
+	hash_param(seed, value.min_sample_shading);
+	hash_param(seed, value.sample_mask);
+	hash_param(seed, value.alpha_to_coverage_enable);
+	hash_param(seed, value.alpha_to_one_enable);
+}
+
+template <>
+inline void hash_param<StencilOpState>(
+    uint64_t &            seed,
+    const StencilOpState &value)
+{
+	hash_param(seed, value.fail_op);
+	hash_param(seed, value.pass_op);
+	hash_param(seed, value.depth_fail_op);
+	hash_param(seed, value.compare_op);
+}
+
+template <>
+inline void hash_param<DepthStencilState>(
+    uint64_t &               seed,
+    const DepthStencilState &value)
+{
+	hash_param(seed, value.depth_test_enable);
+	hash_param(seed, value.depth_write_enable);
+	hash_param(seed, value.depth_compare_op);
+	hash_param(seed, value.depth_bounds_test_enable);
+	hash_param(seed, value.stencil_test_enable);
+	hash_param(seed, value.front);
+	hash_param(seed, value.back);
+}
+
+template <>
+inline void hash_param<ColorBlendAttachmentState>(
+    uint64_t &                       seed,
+    const ColorBlendAttachmentState &value)
+{
+	hash_param(seed, value.blend_enable);
+	hash_param(seed, value.src_color_blend_factor);
+	hash_param(seed, value.dst_color_blend_factor);
+	hash_param(seed, value.color_blend_op);
+	hash_param(seed, value.src_alpha_blend_factor);
+	hash_param(seed, value.dst_alpha_blend_factor);
+	hash_param(seed, value.alpha_blend_op);
+	hash_param(seed, value.color_write_mask);
+}
+
+template <>
+inline void hash_param<ColorBlendState>(
+    uint64_t &             seed,
+    const ColorBlendState &value)
+{
+	hash_param(seed, value.logic_op_enable);
+	hash_param(seed, value.logic_op);
+
+	for (auto &attachment : value.attachments)
 	{
-		hash_combine(seed, resource);
+		hash_param(seed, attachment);
 	}
 }
 
+template <>
+inline void hash_param<PipelineState>(
+    uint64_t &           seed,
+    const PipelineState &value)
+{
+	hash_param(seed, value.get_hash());
+}
+
+template <>
+inline void hash_param<VkDescriptorBufferInfo>(
+    uint64_t &                    seed,
+    const VkDescriptorBufferInfo &value)
+{
+	hash_param(seed, value.buffer);
+	hash_param(seed, value.offset);
+	hash_param(seed, value.range);
+}
+
+template <>
+inline void hash_param<VkDescriptorImageInfo>(
+    uint64_t &                   seed,
+    const VkDescriptorImageInfo &value)
+{
+	hash_param(seed, value.sampler);
+	hash_param(seed, value.imageView);
+	hash_param(seed, value.imageLayout);
+}
+
 template <>
 inline void hash_param<std::map<uint32_t, std::map<uint32_t, VkDescriptorBufferInfo>>>(
-    size_t &                                                              seed,
+    uint64_t &                                                            seed,
     const std::map<uint32_t, std::map<uint32_t, VkDescriptorBufferInfo>> &value)
 {
 	for (auto &binding_set : value)
 	{
-		hash_combine(seed, binding_set.first);
+		hash_param(seed, binding_set.first);
 
 		for (auto &binding_element : binding_set.second)
 		{
-			hash_combine(seed, binding_element.first);
-			hash_combine(seed, binding_element.second);
+			hash_param(seed, binding_element.first);
+			hash_param(seed, binding_element.second);
 		}
 	}
 }
 
 template <>
 inline void hash_param<std::map<uint32_t, std::map<uint32_t, VkDescriptorImageInfo>>>(
-    size_t &                                                             seed,
+    uint64_t &                                                           seed,
     const std::map<uint32_t, std::map<uint32_t, VkDescriptorImageInfo>> &value)
 {
 	for (auto &binding_set : value)
 	{
-		hash_combine(seed, binding_set.first);
+		hash_param(seed, binding_set.first);
 
 		for (auto &binding_element : binding_set.second)
 		{
-			hash_combine(seed, binding_element.first);
-			hash_combine(seed, binding_element.second);
+			hash_param(seed, binding_element.first);
+			hash_param(seed, binding_element.second);
 		}
 	}
 }
 
+template <>
+inline void hash_param<VkWriteDescriptorSet>(
+    uint64_t &                  seed,
+    const VkWriteDescriptorSet &value)
+{
+	hash_param(seed, value.dstSet);
+	hash_param(seed, value.dstBinding);
+	hash_param(seed, value.dstArrayElement);
+	hash_param(seed, value.descriptorCount);
+	hash_param(seed, value.descriptorType);
+
+	switch (value.descriptorType)
+	{
+		case VK_DESCRIPTOR_TYPE_SAMPLER:
+		case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+		case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+		case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+		case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+			for (uint32_t i = 0; i < value.descriptorCount; i++)
+			{
+				hash_param(seed, value.pImageInfo[i]);
+			}
+			break;
+
+		case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+		case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+			for (uint32_t i = 0; i < value.descriptorCount; i++)
+			{
+				hash_param(seed, value.pTexelBufferView[i]);
+			}
+			break;
+
+		case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+		case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+		case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+		case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
+			for (uint32_t i = 0; i < value.descriptorCount; i++)
+			{
+				hash_param(seed, value.pBufferInfo[i]);
+			}
+			break;
+
+		default:
+			// Not implemented
+			break;
+	}
+}
+
 template <typename T, typename... Args>
-inline void hash_param(size_t &seed, const T &first_arg, const Args &... args)
+inline void hash_param(uint64_t &seed, const T &first_arg, const Args &... args)
 {
 	hash_param(seed, first_arg);
 
@@ -709,6 +1124,20 @@ struct RecordHelper<RenderPass, A...>
 	}
 };
 
+template <class... A>
+struct RecordHelper<DescriptorSetLayout, A...>
+{
+	size_t record(ResourceRecord &recorder, A &... args)
+	{
+		return recorder.register_descriptor_set_layout(args...);
+	}
+
+	void index(ResourceRecord &recorder, size_t index, DescriptorSetLayout &descriptor_set_layout)
+	{
+		recorder.set_descriptor_set_layout(index, descriptor_set_layout);
+	}
+};
+
 template <class... A>
 struct RecordHelper<GraphicsPipeline, A...>
 {
@@ -722,14 +1151,28 @@ struct RecordHelper<GraphicsPipeline, A...>
 		recorder.set_graphics_pipeline(index, graphics_pipeline);
 	}
 };
+
+template <class... A>
+struct RecordHelper<ComputePipeline, A...>
+{
+	size_t record(ResourceRecord &recorder, A &... args)
+	{
+		return recorder.register_compute_pipeline(args...);
+	}
+
+	void index(ResourceRecord &recorder, size_t index, ComputePipeline &compute_pipeline)
+	{
+		recorder.set_compute_pipeline(index, compute_pipeline);
+	}
+};
 }        // namespace
 
 template <class T, class... A>
-T &request_resource(Device &device, ResourceRecord *recorder, std::unordered_map<std::size_t, T> &resources, A &... args)
+T &request_resource(Device &device, ResourceRecord *recorder, std::unordered_map<uint64_t, T> &resources, A &... args)
 {
 	RecordHelper<T, A...> record_helper;
 
-	std::size_t hash{0U};
+	uint64_t hash = fnv1a_64(nullptr, 0);
 	hash_param(hash, args...);
 
 	auto res_it = resources.find(hash);
@@ -777,4 +1220,155 @@ T &request_resource(Device &device, ResourceRecord *recorder, std::unordered_map
 
 	return res_it->second;
 }
+
+/**
+ * @brief Drops the descriptor sets of a per-frame cache that were not requested for more than max_age frames.
+ *
+ * Per-frame pools are not created with VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT, so dropped
+ * sets stay allocated until their pool is reset. A pool is reset once more than half of its sets are
+ * no longer cached, and the sets still using it are dropped with it, to be allocated again when next
+ * requested. Pools left without any cached set are destroyed.
+ * @param sets Cached descriptor sets, each with the pool it was allocated from
+ * @param pools Cached descriptor pools
+ * @param last_used Frame in which every cached set was last requested
+ * @param frame Current frame
+ * @param max_age Number of frames a set can go unused before it is dropped
+ * @return Number of descriptor sets dropped
+ */
+template <class Set, class Pool>
+size_t evict_descriptor_sets(std::unordered_map<uint64_t, Set> &        sets,
+                             std::unordered_map<uint64_t, Pool> &       pools,
+                             std::unordered_map<const Set *, uint64_t> &last_used,
+                             uint64_t                                   frame,
+                             uint64_t                                   max_age)
+{
+	size_t evicted_count{0};
+
+	// Number of sets still cached for every pool
+	std::unordered_map<const Pool *, size_t> cached_set_counts;
+
+	for (auto it = sets.begin(); it != sets.end();)
+	{
+		auto last_used_it = last_used.find(&it->second);
+
+		if (last_used_it == last_used.end() || frame - last_used_it->second > max_age)
+		{
+			if (last_used_it != last_used.end())
+			{
+				last_used.erase(last_used_it);
+			}
+
+			it = sets.erase(it);
+			++evicted_count;
+		}
+		else
+		{
+			++cached_set_counts[&it->second.get_descriptor_pool()];
+			++it;
+		}
+	}
+
+	std::unordered_set<const Pool *> reset_pools;
+
+	for (auto it = pools.begin(); it != pools.end();)
+	{
+		size_t cached_count = cached_set_counts[&it->second];
+
+		if (cached_count == 0)
+		{
+			it = pools.erase(it);
+			continue;
+		}
+
+		if (cached_count * 2 < it->second.get_set_count())
+		{
+			reset_pools.insert(&it->second);
+		}
+
+		++it;
+	}
+
+	if (reset_pools.empty())
+	{
+		return evicted_count;
+	}
+
+	for (auto it = sets.begin(); it != sets.end();)
+	{
+		if (reset_pools.count(&it->second.get_descriptor_pool()) != 0)
+		{
+			last_used.erase(&it->second);
+
+			it = sets.erase(it);
+			++evicted_count;
+		}
+		else
+		{
+			++it;
+		}
+	}
+
+	for (auto &it : pools)
+	{
+		if (reset_pools.count(&it.second) != 0)
+		{
+			it.second.reset();
+		}
+	}
+
+	return evicted_count;
+}
+
+/**
+ * @return Whether a descriptor set refers to any of the given image views
+ */
+template <class Set>
+bool refers_to_image_views(Set &descriptor_set, const std::unordered_set<VkImageView> &image_views)
+{
+	for (auto &binding_it : descriptor_set.get_image_infos())
+	{
+		for (auto &element_it : binding_it.second)
+		{
+			if (image_views.count(element_it.second.imageView) != 0)
+			{
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+/**
+ * @brief Drops the descriptor sets of a per-frame cache that refer to any of the given image views,
+ *        before the views are destroyed. Like evicted sets, they stay allocated until their pool is reset.
+ * @param sets Cached descriptor sets
+ * @param last_used Frame in which every cached set was last requested
+ * @param image_views Views about to be destroyed, no submitted work may use them anymore
+ * @return Number of descriptor sets dropped
+ */
+template <class Set>
+size_t release_descriptor_sets(std::unordered_map<uint64_t, Set> &        sets,
+                               std::unordered_map<const Set *, uint64_t> &last_used,
+                               const std::unordered_set<VkImageView> &    image_views)
+{
+	size_t released_count{0};
+
+	for (auto it = sets.begin(); it != sets.end();)
+	{
+		if (refers_to_image_views(it->second, image_views))
+		{
+			last_used.erase(&it->second);
+
+			it = sets.erase(it);
+			++released_count;
+		}
+		else
+		{
+			++it;
+		}
+	}
+
+	return released_count;
+}
 }        // namespace vkb
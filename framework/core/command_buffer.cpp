@@ -113,6 +113,7 @@ VkResult CommandBuffer::begin(VkCommandBufferUsageFlags flags, const RenderPass
 	resource_binding_state.reset();
 	descriptor_set_layout_binding_state.clear();
 	stored_push_constants.clear();
+	reset_bound_buffers();
 
 	VkCommandBufferBeginInfo       begin_info{VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
 	VkCommandBufferInheritanceInfo inheritance = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO};
@@ -233,6 +234,9 @@ void CommandBuffer::next_subpass()
 void CommandBuffer::execute_commands(CommandBuffer &secondary_command_buffer)
 {
 	vkCmdExecuteCommands(get_handle(), 1, &secondary_command_buffer.get_handle());
+
+	// Bindings are undefined after executing secondary command buffers
+	reset_bound_buffers();
 }
 
 void CommandBuffer::execute_commands(std::vector<CommandBuffer *> &secondary_command_buffers)
@@ -241,6 +245,8 @@ void CommandBuffer::execute_commands(std::vector<CommandBuffer *> &secondary_com
 	std::transform(secondary_command_buffers.begin(), secondary_command_buffers.end(), sec_cmd_buf_handles.begin(),
 	               [](const vkb::CommandBuffer *sec_cmd_buf) { return sec_cmd_buf->get_handle(); });
 	vkCmdExecuteCommands(get_handle(), to_u32(sec_cmd_buf_handles.size()), sec_cmd_buf_handles.data());
+
+	reset_bound_buffers();
 }
 
 void CommandBuffer::end_render_pass()
@@ -298,14 +304,54 @@ void CommandBuffer::bind_vertex_buffers(uint32_t first_binding, const std::vecto
 	std::vector<VkBuffer> buffer_handles(buffers.size(), VK_NULL_HANDLE);
 	std::transform(buffers.begin(), buffers.end(), buffer_handles.begin(),
 	               [](const core::Buffer &buffer) { return buffer.get_handle(); });
-	vkCmdBindVertexBuffers(get_handle(), first_binding, to_u32(buffer_handles.size()), buffer_handles.data(), offsets.data());
+
+	if (bound_vertex_buffers.size() < first_binding + buffer_handles.size())
+	{
+		bound_vertex_buffers.resize(first_binding + buffer_handles.size(), {VK_NULL_HANDLE, 0});
+	}
+
+	// Skip the bind if all the buffers are already bound, as with scenes sharing geometry buffers
+	bool redundant = true;
+
+	for (size_t i = 0; i < buffer_handles.size(); ++i)
+	{
+		auto binding = std::make_pair(buffer_handles[i], offsets[i]);
+
+		if (bound_vertex_buffers[first_binding + i] != binding)
+		{
+			bound_vertex_buffers[first_binding + i] = binding;
+			redundant                               = false;
+		}
+	}
+
+	if (!redundant)
+	{
+		vkCmdBindVertexBuffers(get_handle(), first_binding, to_u32(buffer_handles.size()), buffer_handles.data(), offsets.data());
+	}
 }
 
 void CommandBuffer::bind_index_buffer(const core::Buffer &buffer, VkDeviceSize offset, VkIndexType index_type)
 {
+	if (bound_index_buffer == buffer.get_handle() && bound_index_offset == offset && bound_index_type == index_type)
+	{
+		return;
+	}
+
+	bound_index_buffer = buffer.get_handle();
+	bound_index_offset = offset;
+	bound_index_type   = index_type;
+
 	vkCmdBindIndexBuffer(get_handle(), buffer.get_handle(), offset, index_type);
 }
 
+void CommandBuffer::reset_bound_buffers()
+{
+	bound_vertex_buffers.clear();
+	bound_index_buffer = VK_NULL_HANDLE;
+	bound_index_offset = 0;
+	bound_index_type   = VK_INDEX_TYPE_MAX_ENUM;
+}
+
 void CommandBuffer::bind_lighting(LightingState &lighting_state, uint32_t set, uint32_t binding)
 {
 	bind_buffer(lighting_state.light_buffer.get_buffer(), lighting_state.light_buffer.get_offset(), lighting_state.light_buffer.get_size(), set, binding, 0);
@@ -350,6 +396,13 @@ void CommandBuffer::set_color_blend_state(const ColorBlendState &state_info)
 	pipeline_state.set_color_blend_state(state_info);
 }
 
+bool CommandBuffer::is_graphics_pipeline_ready()
+{
+	pipeline_state.set_render_pass(*current_render_pass.render_pass);
+
+	return get_device().get_resource_cache().request_graphics_pipeline_async(pipeline_state) != nullptr;
+}
+
 void CommandBuffer::set_viewport(uint32_t first_viewport, const std::vector<VkViewport> &viewports)
 {
 	vkCmdSetViewport(get_handle(), first_viewport, to_u32(viewports.size()), viewports.data());
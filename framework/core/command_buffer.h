@@ -193,6 +193,12 @@ class CommandBuffer
 
 	void set_color_blend_state(const ColorBlendState &state_info);
 
+	/**
+	 * @brief Checks whether the graphics pipeline for the current state is already built.
+	 *        If not, it is queued for compilation on a background thread.
+	 */
+	bool is_graphics_pipeline_ready();
+
 	void set_viewport(uint32_t first_viewport, const std::vector<VkViewport> &viewports);
 
 	void set_scissor(uint32_t first_scissor, const std::vector<VkRect2D> &scissors);
@@ -282,6 +288,17 @@ class CommandBuffer
 
 	std::unordered_map<uint32_t, DescriptorSetLayout *> descriptor_set_layout_binding_state;
 
+	// Buffer and offset bound to each vertex input binding, so that redundant binds are skipped
+	std::vector<std::pair<VkBuffer, VkDeviceSize>> bound_vertex_buffers;
+
+	VkBuffer bound_index_buffer{VK_NULL_HANDLE};
+
+	VkDeviceSize bound_index_offset{0};
+
+	VkIndexType bound_index_type{VK_INDEX_TYPE_MAX_ENUM};
+
+	void reset_bound_buffers();
+
 	const RenderPassBinding &get_current_render_pass() const;
 
 	const uint32_t get_current_subpass_index() const;
@@ -23,11 +23,13 @@
 
 namespace vkb
 {
-DescriptorPool::DescriptorPool(Device &                   device,
-                               const DescriptorSetLayout &descriptor_set_layout,
-                               uint32_t                   pool_size) :
+DescriptorPool::DescriptorPool(Device &                    device,
+                               const DescriptorSetLayout & descriptor_set_layout,
+                               uint32_t                    pool_size,
+                               VkDescriptorPoolCreateFlags flags) :
     device{device},
-    descriptor_set_layout{&descriptor_set_layout}
+    descriptor_set_layout{&descriptor_set_layout},
+    flags{flags}
 {
 	const auto &bindings = descriptor_set_layout.get_bindings();
 
@@ -128,6 +130,12 @@ VkDescriptorSet DescriptorPool::allocate()
 
 VkResult DescriptorPool::free(VkDescriptorSet descriptor_set)
 {
+	if (!(flags & VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT))
+	{
+		assert(false && "Descriptor pool was not created to free individual descriptor sets");
+		return VK_ERROR_FEATURE_NOT_PRESENT;
+	}
+
 	// Get the pool index of the descriptor set
 	auto it = set_pool_mapping.find(descriptor_set);
 
@@ -153,6 +161,11 @@ VkResult DescriptorPool::free(VkDescriptorSet descriptor_set)
 	return VK_SUCCESS;
 }
 
+size_t DescriptorPool::get_set_count() const
+{
+	return set_pool_mapping.size();
+}
+
 std::uint32_t DescriptorPool::find_available_pool(std::uint32_t search_index)
 {
 	// Create a new pool
@@ -164,8 +177,7 @@ std::uint32_t DescriptorPool::find_available_pool(std::uint32_t search_index)
 		create_info.pPoolSizes    = pool_sizes.data();
 		create_info.maxSets       = pool_max_sets;
 
-		// We do not set FREE_DESCRIPTOR_SET_BIT as we do not need to free individual descriptor sets
-		create_info.flags = 0;
+		create_info.flags = flags;
 
 		// Check descriptor set layout and enable the required flags
 		auto &binding_flags = descriptor_set_layout->get_binding_flags();
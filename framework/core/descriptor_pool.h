@@ -35,9 +35,15 @@ class DescriptorPool
   public:
 	static const uint32_t MAX_SETS_PER_POOL = 16;
 
-	DescriptorPool(Device &                   device,
-	               const DescriptorSetLayout &descriptor_set_layout,
-	               uint32_t                   pool_size = MAX_SETS_PER_POOL);
+	/**
+	 * @param pool_size Number of sets each VkDescriptorPool can allocate
+	 * @param flags Create flags of the pools, VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT is
+	 *        needed for free(), pools that are only reset as a whole should not set it
+	 */
+	DescriptorPool(Device &                    device,
+	               const DescriptorSetLayout & descriptor_set_layout,
+	               uint32_t                    pool_size = MAX_SETS_PER_POOL,
+	               VkDescriptorPoolCreateFlags flags     = 0);
 
 	DescriptorPool(const DescriptorPool &) = delete;
 
@@ -57,8 +63,16 @@ class DescriptorPool
 
 	VkDescriptorSet allocate();
 
+	/**
+	 * @brief Returns a descriptor set to its pool, only for pools created with VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT
+	 */
 	VkResult free(VkDescriptorSet descriptor_set);
 
+	/**
+	 * @return Number of descriptor sets allocated and not yet freed or reset
+	 */
+	size_t get_set_count() const;
+
   private:
 	Device &device;
 
@@ -70,6 +84,9 @@ class DescriptorPool
 	// Number of sets to allocate for each pool
 	uint32_t pool_max_sets{0};
 
+	// Create flags of each pool
+	VkDescriptorPoolCreateFlags flags{0};
+
 	// Total descriptor pools created
 	std::vector<VkDescriptorPool> pools;
 
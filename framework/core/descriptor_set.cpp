@@ -152,7 +152,7 @@ void DescriptorSet::prepare()
 void DescriptorSet::update(const std::vector<uint32_t> &bindings_to_update)
 {
 	std::vector<VkWriteDescriptorSet> write_operations;
-	std::vector<size_t>               write_operation_hashes;
+	std::vector<uint64_t>             write_operation_hashes;
 
 	// If the 'bindings_to_update' vector is empty, we want to write to all the bindings
 	// (but skipping all to-update bindings that haven't been written yet)
@@ -162,7 +162,7 @@ void DescriptorSet::update(const std::vector<uint32_t> &bindings_to_update)
 		{
 			const auto &write_operation = write_descriptor_sets[i];
 
-			size_t write_operation_hash = 0;
+			uint64_t write_operation_hash = fnv1a_64(nullptr, 0);
 			hash_param(write_operation_hash, write_operation);
 
 			auto update_pair_it = updated_bindings.find(write_operation.dstBinding);
@@ -183,7 +183,7 @@ void DescriptorSet::update(const std::vector<uint32_t> &bindings_to_update)
 
 			if (std::find(bindings_to_update.begin(), bindings_to_update.end(), write_operation.dstBinding) != bindings_to_update.end())
 			{
-				size_t write_operation_hash = 0;
+				uint64_t write_operation_hash = fnv1a_64(nullptr, 0);
 				hash_param(write_operation_hash, write_operation);
 
 				auto update_pair_it = updated_bindings.find(write_operation.dstBinding);
@@ -237,6 +237,11 @@ const DescriptorSetLayout &DescriptorSet::get_layout() const
 	return descriptor_set_layout;
 }
 
+DescriptorPool &DescriptorSet::get_descriptor_pool() const
+{
+	return descriptor_pool;
+}
+
 BindingMap<VkDescriptorBufferInfo> &DescriptorSet::get_buffer_infos()
 {
 	return buffer_infos;
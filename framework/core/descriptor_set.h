@@ -80,6 +80,8 @@ class DescriptorSet
 
 	VkDescriptorSet get_handle() const;
 
+	DescriptorPool &get_descriptor_pool() const;
+
 	BindingMap<VkDescriptorBufferInfo> &get_buffer_infos();
 
 	BindingMap<VkDescriptorImageInfo> &get_image_infos();
@@ -109,6 +111,6 @@ class DescriptorSet
 
 	// The bindings of the write descriptors that have had vkUpdateDescriptorSets since the last call to update().
 	// Each binding number is mapped to a hash of the binding description that it will be updated to.
-	std::unordered_map<uint32_t, size_t> updated_bindings;
+	std::unordered_map<uint32_t, uint64_t> updated_bindings;
 };
 }        // namespace vkb
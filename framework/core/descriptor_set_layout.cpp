@@ -17,6 +17,7 @@
 
 #include "descriptor_set_layout.h"
 
+#include "common/resource_caching.h"
 #include "device.h"
 #include "physical_device.h"
 #include "shader_module.h"
@@ -106,6 +107,9 @@ DescriptorSetLayout::DescriptorSetLayout(Device &                           devi
 	//        This way, different pipelines (with different shaders / shader variants) will get
 	//        different descriptor set layouts (incl. appropriate name -> binding lookups)
 
+	id = fnv1a_64(nullptr, 0);
+	hash_param(id, set_index, shader_modules, resource_set);
+
 	for (auto &resource : resource_set)
 	{
 		// Skip shader resources whitout a binding point
@@ -192,6 +196,7 @@ DescriptorSetLayout::DescriptorSetLayout(DescriptorSetLayout &&other) :
     device{other.device},
     shader_modules{other.shader_modules},
     handle{other.handle},
+    id{other.id},
     set_index{other.set_index},
     bindings{std::move(other.bindings)},
     binding_flags{std::move(other.binding_flags)},
@@ -216,6 +221,11 @@ VkDescriptorSetLayout DescriptorSetLayout::get_handle() const
 	return handle;
 }
 
+uint64_t DescriptorSetLayout::get_id() const
+{
+	return id;
+}
+
 const uint32_t DescriptorSetLayout::get_index() const
 {
 	return set_index;
@@ -59,6 +59,11 @@ class DescriptorSetLayout
 
 	VkDescriptorSetLayout get_handle() const;
 
+	/**
+	 * @return A 64-bit hash of the creation parameters, stable across runs and platforms unlike the handle
+	 */
+	uint64_t get_id() const;
+
 	const uint32_t get_index() const;
 
 	const std::vector<VkDescriptorSetLayoutBinding> &get_bindings() const;
@@ -78,6 +83,8 @@ class DescriptorSetLayout
 
 	VkDescriptorSetLayout handle{VK_NULL_HANDLE};
 
+	uint64_t id{0};
+
 	const uint32_t set_index;
 
 	std::vector<VkDescriptorSetLayoutBinding> bindings;
@@ -17,6 +17,7 @@
 
 #include "pipeline_layout.h"
 
+#include "common/resource_caching.h"
 #include "descriptor_set_layout.h"
 #include "device.h"
 #include "pipeline.h"
@@ -84,6 +85,17 @@ PipelineLayout::PipelineLayout(Device &device, const std::vector<ShaderModule *>
 		descriptor_set_layouts.emplace_back(&device.get_resource_cache().request_descriptor_set_layout(shader_set_it.first, shader_modules, shader_set_it.second));
 	}
 
+	id = fnv1a_64(nullptr, 0);
+	hash_param(id, shader_modules);
+
+	for (auto *descriptor_set_layout : descriptor_set_layouts)
+	{
+		if (descriptor_set_layout)
+		{
+			hash_param(id, descriptor_set_layout->get_id());
+		}
+	}
+
 	// Collect all the descriptor set layout handles, maintaining set order
 	std::vector<VkDescriptorSetLayout> descriptor_set_layout_handles;
 	for (uint32_t i = 0; i < descriptor_set_layouts.size(); ++i)
@@ -124,6 +136,7 @@ PipelineLayout::PipelineLayout(Device &device, const std::vector<ShaderModule *>
 PipelineLayout::PipelineLayout(PipelineLayout &&other) :
     device{other.device},
     handle{other.handle},
+    id{other.id},
     shader_modules{std::move(other.shader_modules)},
     shader_resources{std::move(other.shader_resources)},
     shader_sets{std::move(other.shader_sets)},
@@ -146,6 +159,11 @@ VkPipelineLayout PipelineLayout::get_handle() const
 	return handle;
 }
 
+uint64_t PipelineLayout::get_id() const
+{
+	return id;
+}
+
 const std::vector<ShaderModule *> &PipelineLayout::get_shader_modules() const
 {
 	return shader_modules;
@@ -45,6 +45,11 @@ class PipelineLayout
 
 	VkPipelineLayout get_handle() const;
 
+	/**
+	 * @return A 64-bit hash of the shader modules and descriptor set layouts, stable across runs and platforms unlike the handle
+	 */
+	uint64_t get_id() const;
+
 	const std::vector<ShaderModule *> &get_shader_modules() const;
 
 	const std::vector<ShaderResource> get_resources(const ShaderResourceType &type = ShaderResourceType::All, VkShaderStageFlagBits stage = VK_SHADER_STAGE_ALL) const;
@@ -62,6 +67,8 @@ class PipelineLayout
 
 	VkPipelineLayout handle{VK_NULL_HANDLE};
 
+	uint64_t id{0};
+
 	// The shader modules that this pipeline layout uses
 	std::vector<ShaderModule *> shader_modules;
 
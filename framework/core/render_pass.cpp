@@ -19,6 +19,7 @@
 
 #include <numeric>
 
+#include "common/resource_caching.h"
 #include "device.h"
 #include "rendering/render_target.h"
 
@@ -29,6 +30,11 @@ VkRenderPass RenderPass::get_handle() const
 	return handle;
 }
 
+uint64_t RenderPass::get_id() const
+{
+	return id;
+}
+
 namespace
 {
 inline void set_structure_type(VkAttachmentDescription &attachment)
@@ -454,6 +460,9 @@ RenderPass::RenderPass(Device &device, const std::vector<Attachment> &attachment
     subpass_count{std::max<size_t>(1, subpasses.size())},        // At least 1 subpass
     color_output_count{}
 {
+	id = fnv1a_64(nullptr, 0);
+	hash_param(id, attachments, load_store_infos, subpasses);
+
 	if (device.is_enabled(VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME))
 	{
 		create_renderpass<VkSubpassDescription2KHR, VkAttachmentDescription2KHR, VkAttachmentReference2KHR, VkSubpassDependency2KHR, VkRenderPassCreateInfo2KHR>(attachments, load_store_infos, subpasses);
@@ -467,6 +476,7 @@ RenderPass::RenderPass(Device &device, const std::vector<Attachment> &attachment
 RenderPass::RenderPass(RenderPass &&other) :
     device{other.device},
     handle{other.handle},
+    id{other.id},
     subpass_count{other.subpass_count},
     color_output_count{other.color_output_count}
 {
@@ -45,6 +45,11 @@ class RenderPass
   public:
 	VkRenderPass get_handle() const;
 
+	/**
+	 * @return A 64-bit hash of the attachments, load/store operations and subpasses, stable across runs and platforms unlike the handle
+	 */
+	uint64_t get_id() const;
+
 	RenderPass(Device &                          device,
 	           const std::vector<Attachment> &   attachments,
 	           const std::vector<LoadStoreInfo> &load_store_infos,
@@ -69,6 +74,8 @@ class RenderPass
 
 	VkRenderPass handle{VK_NULL_HANDLE};
 
+	uint64_t id{0};
+
 	size_t subpass_count;
 
 	template <typename T_SubpassDescription, typename T_AttachmentDescription, typename T_AttachmentReference, typename T_SubpassDependency, typename T_RenderPassCreateInfo>
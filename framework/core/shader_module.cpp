@@ -117,10 +117,8 @@ ShaderModule::ShaderModule(Device &device, VkShaderStageFlagBits stage, const Sh
 		throw VulkanException{VK_ERROR_INITIALIZATION_FAILED};
 	}
 
-	// Generate a unique id, determined by source and variant
-	std::hash<std::string> hasher{};
-	id = hasher(std::string{reinterpret_cast<const char *>(spirv.data()),
-	                        reinterpret_cast<const char *>(spirv.data() + spirv.size())});
+	// Generate a unique id, determined by source and variant, which is stable across runs
+	id = fnv1a_64(spirv.data(), spirv.size() * sizeof(uint32_t));
 }
 
 ShaderModule::ShaderModule(ShaderModule &&other) :
@@ -135,7 +133,7 @@ ShaderModule::ShaderModule(ShaderModule &&other) :
 	other.stage = {};
 }
 
-size_t ShaderModule::get_id() const
+uint64_t ShaderModule::get_id() const
 {
 	return id;
 }
@@ -200,7 +198,7 @@ ShaderVariant::ShaderVariant(std::string &&preamble, std::vector<std::string> &&
 	update_id();
 }
 
-size_t ShaderVariant::get_id() const
+uint64_t ShaderVariant::get_id() const
 {
 	return id;
 }
@@ -282,19 +280,17 @@ void ShaderVariant::clear()
 
 void ShaderVariant::update_id()
 {
-	std::hash<std::string> hasher{};
-	id = hasher(preamble);
+	id = fnv1a_64(preamble.data(), preamble.size());
 }
 
 ShaderSource::ShaderSource(const std::string &filename) :
     filename{filename},
     source{fs::read_shader(filename)}
 {
-	std::hash<std::string> hasher{};
-	id = hasher(std::string{this->source.cbegin(), this->source.cend()});
+	id = fnv1a_64(this->source.data(), this->source.size());
 }
 
-size_t ShaderSource::get_id() const
+uint64_t ShaderSource::get_id() const
 {
 	return id;
 }
@@ -307,8 +303,7 @@ const std::string &ShaderSource::get_filename() const
 void ShaderSource::set_source(const std::string &source_)
 {
 	source = source_;
-	std::hash<std::string> hasher{};
-	id = hasher(std::string{this->source.cbegin(), this->source.cend()});
+	id = fnv1a_64(this->source.data(), this->source.size());
 }
 
 const std::string &ShaderSource::get_source() const
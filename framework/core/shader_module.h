@@ -106,7 +106,7 @@ class ShaderVariant
 
 	ShaderVariant(std::string &&preamble, std::vector<std::string> &&processes);
 
-	size_t get_id() const;
+	uint64_t get_id() const;
 
 	/**
 	 * @brief Add definitions to shader variant
@@ -145,7 +145,7 @@ class ShaderVariant
 	void clear();
 
   private:
-	size_t id;
+	uint64_t id;
 
 	std::string preamble;
 
@@ -163,7 +163,7 @@ class ShaderSource
 
 	ShaderSource(const std::string &filename);
 
-	size_t get_id() const;
+	uint64_t get_id() const;
 
 	const std::string &get_filename() const;
 
@@ -172,7 +172,7 @@ class ShaderSource
 	const std::string &get_source() const;
 
   private:
-	size_t id;
+	uint64_t id;
 
 	std::string filename;
 
@@ -205,7 +205,7 @@ class ShaderModule
 
 	ShaderModule &operator=(ShaderModule &&) = delete;
 
-	size_t get_id() const;
+	uint64_t get_id() const;
 
 	VkShaderStageFlagBits get_stage() const;
 
@@ -228,7 +228,7 @@ class ShaderModule
 	Device &device;
 
 	/// Shader unique id
-	size_t id;
+	uint64_t id;
 
 	/// Stage of the shader (vertex, fragment, etc)
 	VkShaderStageFlagBits stage{};
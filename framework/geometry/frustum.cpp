@@ -17,8 +17,47 @@
 
 #include "frustum.h"
 
+#include <algorithm>
+#include <limits>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#	include <xmmintrin.h>
+#	define FRUSTUM_SSE
+#elif defined(__ARM_NEON)
+#	include <arm_neon.h>
+#	define FRUSTUM_NEON
+#endif
+
 namespace vkb
 {
+void AABBBatch::resize(size_t size)
+{
+	center_x.resize(size);
+	center_y.resize(size);
+	center_z.resize(size);
+	extent_x.resize(size);
+	extent_y.resize(size);
+	extent_z.resize(size);
+}
+
+size_t AABBBatch::size() const
+{
+	return center_x.size();
+}
+
+void AABBBatch::set(size_t index, const glm::vec3 &min, const glm::vec3 &max)
+{
+	auto center = (min + max) * 0.5f;
+	auto extent = (max - min) * 0.5f;
+
+	center_x[index] = center.x;
+	center_y[index] = center.y;
+	center_z[index] = center.z;
+	extent_x[index] = extent.x;
+	extent_y[index] = extent.y;
+	extent_z[index] = extent.z;
+}
+
 void Frustum::update(const glm::mat4 &matrix)
 {
 	planes[LEFT].x = matrix[0].w + matrix[0].x;
@@ -69,6 +108,115 @@ bool Frustum::check_sphere(glm::vec3 pos, float radius)
 	}
 	return true;
 }
+
+bool Frustum::check_aabb(const glm::vec3 &min, const glm::vec3 &max) const
+{
+	auto center = (min + max) * 0.5f;
+	auto extent = (max - min) * 0.5f;
+
+	// A box is outside if even its corner furthest along the normal of a plane is behind it
+	for (auto &plane : planes)
+	{
+		if (glm::dot(glm::vec3(plane), center) + glm::dot(glm::abs(glm::vec3(plane)), extent) + plane.w <= 0.0f)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void Frustum::check_aabbs(const AABBBatch &boxes, size_t begin, size_t end, uint8_t *visible) const
+{
+	size_t i = begin;
+
+#if defined(FRUSTUM_SSE)
+	const __m128 zero = _mm_setzero_ps();
+
+	for (; i + 4 <= end; i += 4)
+	{
+		__m128 center_x = _mm_loadu_ps(&boxes.center_x[i]);
+		__m128 center_y = _mm_loadu_ps(&boxes.center_y[i]);
+		__m128 center_z = _mm_loadu_ps(&boxes.center_z[i]);
+		__m128 extent_x = _mm_loadu_ps(&boxes.extent_x[i]);
+		__m128 extent_y = _mm_loadu_ps(&boxes.extent_y[i]);
+		__m128 extent_z = _mm_loadu_ps(&boxes.extent_z[i]);
+
+		// Smallest signed distance of the furthest corners over all planes
+		__m128 distance = _mm_set1_ps(std::numeric_limits<float>::max());
+
+		for (auto &plane : planes)
+		{
+			__m128 d = _mm_set1_ps(plane.w);
+			d        = _mm_add_ps(d, _mm_mul_ps(center_x, _mm_set1_ps(plane.x)));
+			d        = _mm_add_ps(d, _mm_mul_ps(center_y, _mm_set1_ps(plane.y)));
+			d        = _mm_add_ps(d, _mm_mul_ps(center_z, _mm_set1_ps(plane.z)));
+			d        = _mm_add_ps(d, _mm_mul_ps(extent_x, _mm_set1_ps(std::abs(plane.x))));
+			d        = _mm_add_ps(d, _mm_mul_ps(extent_y, _mm_set1_ps(std::abs(plane.y))));
+			d        = _mm_add_ps(d, _mm_mul_ps(extent_z, _mm_set1_ps(std::abs(plane.z))));
+			distance = _mm_min_ps(distance, d);
+		}
+
+		int mask = _mm_movemask_ps(_mm_cmpgt_ps(distance, zero));
+
+		visible[i]     = static_cast<uint8_t>(mask & 1);
+		visible[i + 1] = static_cast<uint8_t>((mask >> 1) & 1);
+		visible[i + 2] = static_cast<uint8_t>((mask >> 2) & 1);
+		visible[i + 3] = static_cast<uint8_t>((mask >> 3) & 1);
+	}
+#elif defined(FRUSTUM_NEON)
+	const float32x4_t zero = vdupq_n_f32(0.0f);
+
+	for (; i + 4 <= end; i += 4)
+	{
+		float32x4_t center_x = vld1q_f32(&boxes.center_x[i]);
+		float32x4_t center_y = vld1q_f32(&boxes.center_y[i]);
+		float32x4_t center_z = vld1q_f32(&boxes.center_z[i]);
+		float32x4_t extent_x = vld1q_f32(&boxes.extent_x[i]);
+		float32x4_t extent_y = vld1q_f32(&boxes.extent_y[i]);
+		float32x4_t extent_z = vld1q_f32(&boxes.extent_z[i]);
+
+		// Smallest signed distance of the furthest corners over all planes
+		float32x4_t distance = vdupq_n_f32(std::numeric_limits<float>::max());
+
+		for (auto &plane : planes)
+		{
+			float32x4_t d = vdupq_n_f32(plane.w);
+			d             = vmlaq_n_f32(d, center_x, plane.x);
+			d             = vmlaq_n_f32(d, center_y, plane.y);
+			d             = vmlaq_n_f32(d, center_z, plane.z);
+			d             = vmlaq_n_f32(d, extent_x, std::abs(plane.x));
+			d             = vmlaq_n_f32(d, extent_y, std::abs(plane.y));
+			d             = vmlaq_n_f32(d, extent_z, std::abs(plane.z));
+			distance      = vminq_f32(distance, d);
+		}
+
+		uint32x4_t inside = vcgtq_f32(distance, zero);
+
+		visible[i]     = static_cast<uint8_t>(vgetq_lane_u32(inside, 0) & 1);
+		visible[i + 1] = static_cast<uint8_t>(vgetq_lane_u32(inside, 1) & 1);
+		visible[i + 2] = static_cast<uint8_t>(vgetq_lane_u32(inside, 2) & 1);
+		visible[i + 3] = static_cast<uint8_t>(vgetq_lane_u32(inside, 3) & 1);
+	}
+#endif
+
+	for (; i < end; ++i)
+	{
+		float distance = std::numeric_limits<float>::max();
+
+		for (auto &plane : planes)
+		{
+			float d = plane.w +
+			          boxes.center_x[i] * plane.x + boxes.center_y[i] * plane.y + boxes.center_z[i] * plane.z +
+			          boxes.extent_x[i] * std::abs(plane.x) + boxes.extent_y[i] * std::abs(plane.y) + boxes.extent_z[i] * std::abs(plane.z);
+
+			distance = std::min(distance, d);
+		}
+
+		visible[i] = distance > 0.0f ? 1 : 0;
+	}
+}
+
 const std::array<glm::vec4, 6> &Frustum::get_planes() const
 {
 	return planes;
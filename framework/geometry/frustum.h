@@ -16,6 +16,8 @@
  */
 
 #include <array>
+#include <cstdint>
+#include <vector>
 
 #include "common/error.h"
 
@@ -35,6 +37,30 @@ enum Side
 	FRONT  = 5
 };
 
+/**
+ * @brief Axis aligned bounding boxes stored as arrays of centers and half extents, so that
+ *        several of them can be tested against a frustum at once
+ */
+struct AABBBatch
+{
+	std::vector<float> center_x;
+	std::vector<float> center_y;
+	std::vector<float> center_z;
+
+	std::vector<float> extent_x;
+	std::vector<float> extent_y;
+	std::vector<float> extent_z;
+
+	void resize(size_t size);
+
+	size_t size() const;
+
+	/**
+	 * @brief Stores a box given by its corners
+	 */
+	void set(size_t index, const glm::vec3 &min, const glm::vec3 &max);
+};
+
 /**
  * @brief Represents a matrix by extracting its planes. Responsible for doing 
  * intersection tests
@@ -55,6 +81,23 @@ class Frustum
 	 */
 	bool check_sphere(glm::vec3 pos, float radius);
 
+	/**
+	 * @brief Checks if an axis aligned box is at least partly inside the Frustum
+	 * @param min The minimum corner of the box
+	 * @param max The maximum corner of the box
+	 */
+	bool check_aabb(const glm::vec3 &min, const glm::vec3 &max) const;
+
+	/**
+	 * @brief Checks a range of boxes, four at a time with SIMD instructions where available
+	 * @param boxes The boxes to check
+	 * @param begin Index of the first box to check
+	 * @param end Index past the last box to check
+	 * @param visible Receives 1 for every box at least partly inside the Frustum and 0 for the others,
+	 *        indexed like the boxes
+	 */
+	void check_aabbs(const AABBBatch &boxes, size_t begin, size_t end, uint8_t *visible) const;
+
 	const std::array<glm::vec4, 6> &get_planes() const;
 
   private:
@@ -0,0 +1,931 @@
+/* Copyright (c) 2021, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mesh_optimizer.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
+
+#include "common/helpers.h"
+
+VKBP_DISABLE_WARNINGS()
+#include <glm/gtc/type_ptr.hpp>
+VKBP_ENABLE_WARNINGS()
+
+namespace vkb
+{
+namespace
+{
+/// Size of the LRU cache modelled by optimize_vertex_cache, larger than any real cache
+constexpr uint32_t forsyth_cache_size{32};
+
+constexpr float forsyth_cache_decay_power{1.5f};
+constexpr float forsyth_last_triangle_score{0.75f};
+constexpr float forsyth_valence_boost_scale{2.0f};
+constexpr float forsyth_valence_boost_power{0.5f};
+
+/// Cache size used to find where the cache is cold, matching analyze_vertex_cache
+constexpr uint32_t overdraw_cache_size{16};
+
+float get_forsyth_vertex_score(int32_t cache_position, uint32_t remaining_triangles)
+{
+	if (remaining_triangles == 0)
+	{
+		// The vertex has no triangles left to emit
+		return -1.0f;
+	}
+
+	float score = 0.0f;
+
+	if (cache_position >= 0)
+	{
+		if (cache_position < 3)
+		{
+			// The vertices of the last triangle get a fixed score, so that strips are not favoured
+			score = forsyth_last_triangle_score;
+		}
+		else
+		{
+			const float scaler = 1.0f / (forsyth_cache_size - 3);
+
+			score = std::pow(1.0f - (cache_position - 3) * scaler, forsyth_cache_decay_power);
+		}
+	}
+
+	// Boost vertices with few triangles left, to get rid of them before they fall out of the cache
+	score += forsyth_valence_boost_scale * std::pow(static_cast<float>(remaining_triangles), -forsyth_valence_boost_power);
+
+	return score;
+}
+
+glm::vec3 get_position(const VertexStream &positions, uint32_t vertex)
+{
+	glm::vec3 position;
+	std::memcpy(glm::value_ptr(position), positions.data + static_cast<size_t>(vertex) * positions.stride, sizeof(position));
+
+	return position;
+}
+
+/// Weight of the planes through open borders, which keep borders in place when the mesh is simplified
+constexpr float border_plane_weight{10.0f};
+
+/// Smallest cosine between the normal of a triangle after an edge collapse and its normals before the
+/// collapse and in the input, which keeps rotations from adding up over several collapses
+constexpr float max_collapse_flip{0.5f};
+
+/**
+ * @brief Sum of the squared distances to a set of planes, weighted by area
+ */
+struct Quadric
+{
+	double a00{0.0}, a11{0.0}, a22{0.0}, a01{0.0}, a02{0.0}, a12{0.0};
+
+	double b0{0.0}, b1{0.0}, b2{0.0};
+
+	double c{0.0};
+
+	double weight{0.0};
+
+	/**
+	 * @brief Adds the plane of points p where dot(normal, p) + distance is 0
+	 * @param normal Normalized plane normal
+	 */
+	void add_plane(const glm::vec3 &normal, float distance, float plane_weight)
+	{
+		double x = normal.x, y = normal.y, z = normal.z, d = distance, w = plane_weight;
+
+		a00 += w * x * x;
+		a11 += w * y * y;
+		a22 += w * z * z;
+		a01 += w * x * y;
+		a02 += w * x * z;
+		a12 += w * y * z;
+		b0 += w * x * d;
+		b1 += w * y * d;
+		b2 += w * z * d;
+		c += w * d * d;
+		weight += w;
+	}
+
+	Quadric &operator+=(const Quadric &other)
+	{
+		a00 += other.a00;
+		a11 += other.a11;
+		a22 += other.a22;
+		a01 += other.a01;
+		a02 += other.a02;
+		a12 += other.a12;
+		b0 += other.b0;
+		b1 += other.b1;
+		b2 += other.b2;
+		c += other.c;
+		weight += other.weight;
+
+		return *this;
+	}
+
+	/**
+	 * @return Mean squared distance of a point to the planes
+	 */
+	float evaluate(const glm::vec3 &point) const
+	{
+		if (weight <= 0.0)
+		{
+			return 0.0f;
+		}
+
+		double x = point.x, y = point.y, z = point.z;
+
+		double error = a00 * x * x + a11 * y * y + a22 * z * z +
+		               2.0 * (a01 * x * y + a02 * x * z + a12 * y * z) +
+		               2.0 * (b0 * x + b1 * y + b2 * z) + c;
+
+		return static_cast<float>(std::max(error, 0.0) / weight);
+	}
+};
+
+inline uint64_t get_edge_key(uint32_t a, uint32_t b)
+{
+	return a < b ? (static_cast<uint64_t>(a) << 32) | b : (static_cast<uint64_t>(b) << 32) | a;
+}
+
+struct EdgeCollapse
+{
+	uint32_t source;
+
+	uint32_t target;
+
+	float error;
+};
+
+struct VertexHash
+{
+	const std::vector<VertexStream> &streams;
+
+	size_t operator()(uint32_t vertex) const
+	{
+		uint64_t hash = fnv1a_64(nullptr, 0);
+
+		for (auto &stream : streams)
+		{
+			hash = fnv1a_64(stream.data + static_cast<size_t>(vertex) * stream.stride, stream.stride, hash);
+		}
+
+		return static_cast<size_t>(hash);
+	}
+};
+
+struct VertexEqual
+{
+	const std::vector<VertexStream> &streams;
+
+	bool operator()(uint32_t lhs, uint32_t rhs) const
+	{
+		for (auto &stream : streams)
+		{
+			if (std::memcmp(stream.data + static_cast<size_t>(lhs) * stream.stride, stream.data + static_cast<size_t>(rhs) * stream.stride, stream.stride) != 0)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+};
+}        // namespace
+
+float VertexCacheStats::get_acmr() const
+{
+	return triangle_count == 0 ? 0.0f : static_cast<float>(transformed_vertex_count) / triangle_count;
+}
+
+float VertexCacheStats::get_atvr() const
+{
+	return vertex_count == 0 ? 0.0f : static_cast<float>(transformed_vertex_count) / vertex_count;
+}
+
+VertexCacheStats &VertexCacheStats::operator+=(const VertexCacheStats &other)
+{
+	triangle_count += other.triangle_count;
+	vertex_count += other.vertex_count;
+	transformed_vertex_count += other.transformed_vertex_count;
+
+	return *this;
+}
+
+VertexCacheStats analyze_vertex_cache(const std::vector<uint32_t> &indices, size_t vertex_count, uint32_t cache_size)
+{
+	VertexCacheStats stats;
+
+	stats.triangle_count = to_u32(indices.size() / 3);
+
+	// A vertex is in the cache if fewer than cache_size vertices were transformed since it was
+	std::vector<uint32_t> timestamps(vertex_count, 0);
+	uint32_t              timestamp = cache_size + 1;
+
+	std::vector<bool> referenced(vertex_count, false);
+
+	for (auto index : indices)
+	{
+		assert(index < vertex_count);
+
+		if (timestamp - timestamps[index] > cache_size)
+		{
+			timestamps[index] = timestamp++;
+			stats.transformed_vertex_count++;
+		}
+
+		if (!referenced[index])
+		{
+			referenced[index] = true;
+			stats.vertex_count++;
+		}
+	}
+
+	return stats;
+}
+
+void optimize_vertex_cache(std::vector<uint32_t> &indices, size_t vertex_count)
+{
+	const size_t triangle_count = indices.size() / 3;
+
+	if (triangle_count < 2)
+	{
+		return;
+	}
+
+	// Triangles adjacent to each vertex. The first remaining_triangles[vertex] entries of a
+	// vertex are the triangles that were not emitted yet.
+	std::vector<uint32_t> remaining_triangles(vertex_count, 0);
+	for (auto index : indices)
+	{
+		remaining_triangles[index]++;
+	}
+
+	std::vector<uint32_t> adjacency_offsets(vertex_count, 0);
+	std::partial_sum(remaining_triangles.begin(), remaining_triangles.end() - 1, adjacency_offsets.begin() + 1);
+
+	std::vector<uint32_t> adjacency(indices.size());
+	{
+		std::vector<uint32_t> fill_counts(vertex_count, 0);
+
+		for (size_t triangle = 0; triangle < triangle_count; ++triangle)
+		{
+			for (size_t corner = 0; corner < 3; ++corner)
+			{
+				auto vertex = indices[triangle * 3 + corner];
+
+				adjacency[adjacency_offsets[vertex] + fill_counts[vertex]++] = to_u32(triangle);
+			}
+		}
+	}
+
+	std::vector<int32_t> cache_positions(vertex_count, -1);
+
+	std::vector<float> vertex_scores(vertex_count);
+	for (size_t vertex = 0; vertex < vertex_count; ++vertex)
+	{
+		vertex_scores[vertex] = get_forsyth_vertex_score(-1, remaining_triangles[vertex]);
+	}
+
+	std::vector<float> triangle_scores(triangle_count);
+	for (size_t triangle = 0; triangle < triangle_count; ++triangle)
+	{
+		triangle_scores[triangle] = vertex_scores[indices[triangle * 3]] + vertex_scores[indices[triangle * 3 + 1]] + vertex_scores[indices[triangle * 3 + 2]];
+	}
+
+	std::vector<bool> emitted(triangle_count, false);
+
+	std::vector<uint32_t> cache;
+	std::vector<uint32_t> new_cache;
+	cache.reserve(forsyth_cache_size + 3);
+	new_cache.reserve(forsyth_cache_size + 3);
+
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+
+	auto best_triangle = static_cast<uint32_t>(std::max_element(triangle_scores.begin(), triangle_scores.end()) - triangle_scores.begin());
+
+	size_t input_cursor = 0;
+
+	for (size_t emitted_count = 0; emitted_count < triangle_count; ++emitted_count)
+	{
+		if (best_triangle == ~0U)
+		{
+			// No triangle uses a cached vertex, continue with the next triangle in input order
+			while (emitted[input_cursor])
+			{
+				input_cursor++;
+			}
+
+			best_triangle = to_u32(input_cursor);
+		}
+
+		emitted[best_triangle] = true;
+
+		const uint32_t *triangle_vertices = &indices[best_triangle * 3];
+
+		result.insert(result.end(), triangle_vertices, triangle_vertices + 3);
+
+		// Remove the triangle from the remaining triangles of its vertices
+		for (size_t corner = 0; corner < 3; ++corner)
+		{
+			auto vertex = triangle_vertices[corner];
+
+			auto begin = adjacency.begin() + adjacency_offsets[vertex];
+			auto end   = begin + remaining_triangles[vertex];
+			auto it    = std::find(begin, end, best_triangle);
+
+			assert(it != end);
+
+			std::iter_swap(it, end - 1);
+			remaining_triangles[vertex]--;
+		}
+
+		// Move the vertices of the triangle to the front of the cache
+		new_cache.assign(triangle_vertices, triangle_vertices + 3);
+
+		for (auto vertex : cache)
+		{
+			if (vertex != triangle_vertices[0] && vertex != triangle_vertices[1] && vertex != triangle_vertices[2])
+			{
+				new_cache.push_back(vertex);
+			}
+		}
+
+		// Update the scores of all vertices that were or are in the cache, including the evicted ones
+		for (size_t position = 0; position < new_cache.size(); ++position)
+		{
+			auto vertex = new_cache[position];
+
+			cache_positions[vertex] = position < forsyth_cache_size ? static_cast<int32_t>(position) : -1;
+
+			float score = get_forsyth_vertex_score(cache_positions[vertex], remaining_triangles[vertex]);
+			float delta = score - vertex_scores[vertex];
+
+			vertex_scores[vertex] = score;
+
+			for (uint32_t i = 0; i < remaining_triangles[vertex]; ++i)
+			{
+				triangle_scores[adjacency[adjacency_offsets[vertex] + i]] += delta;
+			}
+		}
+
+		if (new_cache.size() > forsyth_cache_size)
+		{
+			new_cache.resize(forsyth_cache_size);
+		}
+
+		std::swap(cache, new_cache);
+
+		// The next triangle is the best one using a cached vertex
+		best_triangle    = ~0U;
+		float best_score = -std::numeric_limits<float>::max();
+
+		for (auto vertex : cache)
+		{
+			for (uint32_t i = 0; i < remaining_triangles[vertex]; ++i)
+			{
+				auto triangle = adjacency[adjacency_offsets[vertex] + i];
+
+				if (triangle_scores[triangle] > best_score)
+				{
+					best_score    = triangle_scores[triangle];
+					best_triangle = triangle;
+				}
+			}
+		}
+	}
+
+	indices = std::move(result);
+}
+
+void optimize_overdraw(std::vector<uint32_t> &indices, const VertexStream &positions, size_t vertex_count)
+{
+	const size_t triangle_count = indices.size() / 3;
+
+	if (triangle_count < 2)
+	{
+		return;
+	}
+
+	// A cluster starts at every triangle whose vertices all miss the cache. Drawing clusters in
+	// any order then costs about the same number of vertex transforms.
+	std::vector<uint32_t> cluster_starts;
+	{
+		std::vector<uint32_t> timestamps(vertex_count, 0);
+		uint32_t              timestamp = overdraw_cache_size + 1;
+
+		for (size_t triangle = 0; triangle < triangle_count; ++triangle)
+		{
+			uint32_t misses = 0;
+
+			for (size_t corner = 0; corner < 3; ++corner)
+			{
+				auto vertex = indices[triangle * 3 + corner];
+
+				if (timestamp - timestamps[vertex] > overdraw_cache_size)
+				{
+					timestamps[vertex] = timestamp++;
+					misses++;
+				}
+			}
+
+			if (triangle == 0 || misses == 3)
+			{
+				cluster_starts.push_back(to_u32(triangle));
+			}
+		}
+	}
+
+	if (cluster_starts.size() < 2)
+	{
+		return;
+	}
+
+	cluster_starts.push_back(to_u32(triangle_count));
+
+	const size_t cluster_count = cluster_starts.size() - 1;
+
+	// Area weighted centroid and normal of every cluster
+	std::vector<glm::vec3> cluster_centroids(cluster_count, glm::vec3(0.0f));
+	std::vector<glm::vec3> cluster_normals(cluster_count, glm::vec3(0.0f));
+
+	glm::vec3 mesh_centroid(0.0f);
+	float     mesh_area = 0.0f;
+
+	for (size_t cluster = 0; cluster < cluster_count; ++cluster)
+	{
+		float cluster_area = 0.0f;
+
+		for (uint32_t triangle = cluster_starts[cluster]; triangle < cluster_starts[cluster + 1]; ++triangle)
+		{
+			auto p0 = get_position(positions, indices[triangle * 3]);
+			auto p1 = get_position(positions, indices[triangle * 3 + 1]);
+			auto p2 = get_position(positions, indices[triangle * 3 + 2]);
+
+			auto normal = glm::cross(p1 - p0, p2 - p0);
+			auto area   = glm::length(normal);
+
+			cluster_centroids[cluster] += (p0 + p1 + p2) * (area / 3.0f);
+			cluster_normals[cluster] += normal;
+			cluster_area += area;
+		}
+
+		mesh_centroid += cluster_centroids[cluster];
+		mesh_area += cluster_area;
+
+		if (cluster_area > 0.0f)
+		{
+			cluster_centroids[cluster] /= cluster_area;
+		}
+	}
+
+	if (mesh_area > 0.0f)
+	{
+		mesh_centroid /= mesh_area;
+	}
+
+	// Clusters facing away from the middle of the mesh are likely to occlude the others
+	std::vector<float> sort_keys(cluster_count, 0.0f);
+	for (size_t cluster = 0; cluster < cluster_count; ++cluster)
+	{
+		auto normal_length = glm::length(cluster_normals[cluster]);
+
+		if (normal_length > 0.0f)
+		{
+			sort_keys[cluster] = glm::dot(cluster_centroids[cluster] - mesh_centroid, cluster_normals[cluster] / normal_length);
+		}
+	}
+
+	std::vector<uint32_t> cluster_order(cluster_count);
+	std::iota(cluster_order.begin(), cluster_order.end(), 0);
+
+	std::stable_sort(cluster_order.begin(), cluster_order.end(), [&sort_keys](uint32_t lhs, uint32_t rhs) {
+		return sort_keys[lhs] > sort_keys[rhs];
+	});
+
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+
+	for (auto cluster : cluster_order)
+	{
+		result.insert(result.end(), indices.begin() + cluster_starts[cluster] * 3, indices.begin() + cluster_starts[cluster + 1] * 3);
+	}
+
+	indices = std::move(result);
+}
+
+std::vector<uint32_t> simplify(const std::vector<uint32_t> &indices, const VertexStream &positions, size_t vertex_count,
+                               size_t target_index_count, float max_error, float *result_error)
+{
+	std::vector<uint32_t> result = indices;
+
+	float collapse_error = 0.0f;
+
+	if (result_error)
+	{
+		*result_error = 0.0f;
+	}
+
+	if (result.size() <= target_index_count)
+	{
+		return result;
+	}
+
+	std::vector<glm::vec3> vertex_positions(vertex_count);
+	for (uint32_t vertex = 0; vertex < vertex_count; ++vertex)
+	{
+		vertex_positions[vertex] = get_position(positions, vertex);
+	}
+
+	// The error limit is relative to the extent of the mesh
+	glm::vec3 min_position(std::numeric_limits<float>::max());
+	glm::vec3 max_position(-std::numeric_limits<float>::max());
+
+	std::vector<bool> referenced(vertex_count, false);
+
+	for (auto index : indices)
+	{
+		min_position = glm::min(min_position, vertex_positions[index]);
+		max_position = glm::max(max_position, vertex_positions[index]);
+
+		referenced[index] = true;
+	}
+
+	auto  extent       = max_position - min_position;
+	float max_error_sq = max_error * std::max(extent.x, std::max(extent.y, extent.z));
+	max_error_sq       = max_error_sq * max_error_sq;
+
+	// Vertices sharing their position with another vertex are on an attribute seam, and moving
+	// them would tear the seam open
+	std::vector<bool> locked(vertex_count, false);
+	{
+		std::vector<VertexStream> position_streams{{reinterpret_cast<const uint8_t *>(vertex_positions.data()), sizeof(glm::vec3)}};
+
+		std::unordered_map<uint32_t, uint32_t, VertexHash, VertexEqual> unique_positions(vertex_count,
+		                                                                                 VertexHash{position_streams},
+		                                                                                 VertexEqual{position_streams});
+
+		for (uint32_t vertex = 0; vertex < vertex_count; ++vertex)
+		{
+			if (!referenced[vertex])
+			{
+				continue;
+			}
+
+			auto it = unique_positions.emplace(vertex, vertex);
+
+			if (!it.second)
+			{
+				locked[vertex]           = true;
+				locked[it.first->second] = true;
+			}
+		}
+	}
+
+	std::vector<Quadric> quadrics(vertex_count);
+
+	// Unit normal every triangle had in the input, zero for degenerate ones. Kept in the order of the
+	// triangles of the result.
+	std::vector<glm::vec3> input_normals(indices.size() / 3, glm::vec3{0.0f});
+
+	for (size_t triangle = 0; triangle < indices.size() / 3; ++triangle)
+	{
+		auto p0 = vertex_positions[indices[triangle * 3]];
+		auto p1 = vertex_positions[indices[triangle * 3 + 1]];
+		auto p2 = vertex_positions[indices[triangle * 3 + 2]];
+
+		auto  normal = glm::cross(p1 - p0, p2 - p0);
+		float area   = glm::length(normal);
+
+		if (area == 0.0f)
+		{
+			continue;
+		}
+
+		normal /= area;
+
+		input_normals[triangle] = normal;
+
+		for (size_t corner = 0; corner < 3; ++corner)
+		{
+			quadrics[indices[triangle * 3 + corner]].add_plane(normal, -glm::dot(normal, p0), area);
+		}
+	}
+
+	std::unordered_map<uint64_t, uint32_t> edge_counts;
+
+	std::vector<uint32_t> triangle_counts(vertex_count);
+	std::vector<uint32_t> triangle_offsets(vertex_count);
+	std::vector<uint32_t> adjacency;
+
+	std::vector<EdgeCollapse> collapses;
+	std::vector<uint32_t>     remap(vertex_count);
+	std::vector<bool>         touched(vertex_count);
+
+	bool border_planes_added = false;
+
+	while (result.size() > target_index_count)
+	{
+		const size_t triangle_count = result.size() / 3;
+
+		// Edges used by a single triangle are on an open border
+		edge_counts.clear();
+		for (size_t i = 0; i < result.size(); ++i)
+		{
+			edge_counts[get_edge_key(result[i], result[i - i % 3 + (i + 1) % 3])]++;
+		}
+
+		if (!border_planes_added)
+		{
+			// Planes perpendicular to the mesh through border edges keep borders from shrinking
+			for (size_t i = 0; i < result.size(); ++i)
+			{
+				auto a = result[i];
+				auto b = result[i - i % 3 + (i + 1) % 3];
+				auto c = result[i - i % 3 + (i + 2) % 3];
+
+				if (edge_counts[get_edge_key(a, b)] != 1)
+				{
+					continue;
+				}
+
+				auto pa = vertex_positions[a];
+				auto pb = vertex_positions[b];
+				auto pc = vertex_positions[c];
+
+				auto edge   = pb - pa;
+				auto normal = glm::cross(edge, glm::cross(edge, pc - pa));
+				auto length = glm::length(normal);
+
+				if (length == 0.0f)
+				{
+					continue;
+				}
+
+				normal /= length;
+
+				float weight = glm::dot(edge, edge) * border_plane_weight;
+
+				quadrics[a].add_plane(normal, -glm::dot(normal, pa), weight);
+				quadrics[b].add_plane(normal, -glm::dot(normal, pa), weight);
+			}
+
+			border_planes_added = true;
+		}
+
+		std::vector<bool> border(vertex_count, false);
+		for (auto &edge : edge_counts)
+		{
+			if (edge.second == 1)
+			{
+				border[static_cast<uint32_t>(edge.first >> 32)]          = true;
+				border[static_cast<uint32_t>(edge.first & 0xFFFFFFFFU)] = true;
+			}
+		}
+
+		// Triangles adjacent to each vertex
+		std::fill(triangle_counts.begin(), triangle_counts.end(), 0);
+		for (auto index : result)
+		{
+			triangle_counts[index]++;
+		}
+
+		std::partial_sum(triangle_counts.begin(), triangle_counts.end() - 1, triangle_offsets.begin() + 1);
+		triangle_offsets[0] = 0;
+
+		adjacency.resize(result.size());
+		std::fill(triangle_counts.begin(), triangle_counts.end(), 0);
+		for (size_t i = 0; i < result.size(); ++i)
+		{
+			adjacency[triangle_offsets[result[i]] + triangle_counts[result[i]]++] = to_u32(i / 3);
+		}
+
+		// Every edge can collapse either way, unless that moves a locked vertex or pulls a border
+		// vertex off the border
+		collapses.clear();
+		for (size_t i = 0; i < result.size(); ++i)
+		{
+			auto a = result[i];
+			auto b = result[i - i % 3 + (i + 1) % 3];
+
+			bool border_edge = edge_counts[get_edge_key(a, b)] == 1;
+
+			for (auto edge : {std::make_pair(a, b), std::make_pair(b, a)})
+			{
+				auto source = edge.first;
+				auto target = edge.second;
+
+				if (source == target || locked[source] || (border[source] && !border_edge))
+				{
+					continue;
+				}
+
+				Quadric quadric = quadrics[source];
+				quadric += quadrics[target];
+
+				collapses.push_back({source, target, quadric.evaluate(vertex_positions[target])});
+			}
+		}
+
+		std::sort(collapses.begin(), collapses.end(), [](const EdgeCollapse &lhs, const EdgeCollapse &rhs) {
+			return lhs.error < rhs.error;
+		});
+
+		std::iota(remap.begin(), remap.end(), 0U);
+		std::fill(touched.begin(), touched.end(), false);
+
+		// Each collapse removes about two triangles
+		size_t collapse_goal  = (triangle_count - target_index_count / 3) / 2 + 1;
+		size_t collapse_count = 0;
+
+		for (auto &collapse : collapses)
+		{
+			if (collapse.error > max_error_sq || collapse_count >= collapse_goal)
+			{
+				break;
+			}
+
+			if (touched[collapse.source] || touched[collapse.target])
+			{
+				continue;
+			}
+
+			// Reject collapses that flip a triangle around the source vertex
+			auto target_position = vertex_positions[collapse.target];
+
+			bool flips = false;
+
+			for (uint32_t i = 0; i < triangle_counts[collapse.source] && !flips; ++i)
+			{
+				uint32_t        triangle_index = adjacency[triangle_offsets[collapse.source] + i];
+				const uint32_t *triangle       = &result[triangle_index * 3];
+
+				if (triangle[0] == collapse.target || triangle[1] == collapse.target || triangle[2] == collapse.target)
+				{
+					// This triangle collapses
+					continue;
+				}
+
+				glm::vec3 before[3];
+				glm::vec3 after[3];
+				for (size_t corner = 0; corner < 3; ++corner)
+				{
+					before[corner] = vertex_positions[triangle[corner]];
+					after[corner]  = triangle[corner] == collapse.source ? target_position : before[corner];
+				}
+
+				auto normal_before = glm::cross(before[1] - before[0], before[2] - before[0]);
+				auto normal_after  = glm::cross(after[1] - after[0], after[2] - after[0]);
+
+				auto &input_normal = input_normals[triangle_index];
+
+				float length_after = glm::length(normal_after);
+				float length       = glm::length(normal_before) * length_after;
+
+				flips = length == 0.0f || glm::dot(normal_before, normal_after) < max_collapse_flip * length ||
+				        glm::dot(input_normal, normal_after) < max_collapse_flip * length_after * glm::length(input_normal);
+			}
+
+			if (flips)
+			{
+				continue;
+			}
+
+			remap[collapse.source] = collapse.target;
+			quadrics[collapse.target] += quadrics[collapse.source];
+
+			// Triangles around the source change shape, so their other vertices wait for the next pass
+			for (uint32_t i = 0; i < triangle_counts[collapse.source]; ++i)
+			{
+				const uint32_t *triangle = &result[adjacency[triangle_offsets[collapse.source] + i] * 3];
+
+				touched[triangle[0]] = true;
+				touched[triangle[1]] = true;
+				touched[triangle[2]] = true;
+			}
+
+			collapse_error = std::max(collapse_error, collapse.error);
+			collapse_count++;
+		}
+
+		if (collapse_count == 0)
+		{
+			break;
+		}
+
+		// Remove the triangles that collapsed
+		size_t write_index = 0;
+		for (size_t triangle = 0; triangle < triangle_count; ++triangle)
+		{
+			auto a = remap[result[triangle * 3]];
+			auto b = remap[result[triangle * 3 + 1]];
+			auto c = remap[result[triangle * 3 + 2]];
+
+			if (a != b && b != c && a != c)
+			{
+				input_normals[write_index / 3] = input_normals[triangle];
+
+				result[write_index++] = a;
+				result[write_index++] = b;
+				result[write_index++] = c;
+			}
+		}
+
+		result.resize(write_index);
+	}
+
+	if (result_error)
+	{
+		*result_error = std::sqrt(collapse_error);
+	}
+
+	return result;
+}
+
+uint32_t generate_vertex_remap(std::vector<uint32_t> &remap, const std::vector<VertexStream> &streams, size_t vertex_count)
+{
+	std::unordered_map<uint32_t, uint32_t, VertexHash, VertexEqual> unique_vertices(vertex_count, VertexHash{streams}, VertexEqual{streams});
+
+	remap.resize(vertex_count);
+
+	uint32_t unique_count = 0;
+
+	for (size_t vertex = 0; vertex < vertex_count; ++vertex)
+	{
+		auto it = unique_vertices.emplace(to_u32(vertex), unique_count);
+
+		if (it.second)
+		{
+			unique_count++;
+		}
+
+		remap[vertex] = it.first->second;
+	}
+
+	return unique_count;
+}
+
+uint32_t generate_vertex_fetch_remap(std::vector<uint32_t> &remap, const std::vector<uint32_t> &indices, size_t vertex_count)
+{
+	remap.assign(vertex_count, unused_vertex);
+
+	uint32_t next_vertex = 0;
+
+	for (auto index : indices)
+	{
+		if (remap[index] == unused_vertex)
+		{
+			remap[index] = next_vertex++;
+		}
+	}
+
+	return next_vertex;
+}
+
+void remap_indices(std::vector<uint32_t> &indices, const std::vector<uint32_t> &remap)
+{
+	for (auto &index : indices)
+	{
+		index = remap[index];
+	}
+}
+
+void remap_vertices(std::vector<uint8_t> &data, uint32_t stride, const std::vector<uint32_t> &remap, size_t new_vertex_count)
+{
+	assert(data.size() >= remap.size() * stride);
+
+	std::vector<uint8_t> result(new_vertex_count * stride);
+
+	for (size_t vertex = 0; vertex < remap.size(); ++vertex)
+	{
+		if (remap[vertex] != unused_vertex)
+		{
+			std::memcpy(result.data() + static_cast<size_t>(remap[vertex]) * stride, data.data() + vertex * stride, stride);
+		}
+	}
+
+	data = std::move(result);
+}
+}        // namespace vkb
@@ -0,0 +1,144 @@
+/* Copyright (c) 2021, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "common/error.h"
+
+VKBP_DISABLE_WARNINGS()
+#include "common/glm_common.h"
+VKBP_ENABLE_WARNINGS()
+
+namespace vkb
+{
+/// Marks vertices that a remap table drops, because no index references them
+constexpr uint32_t unused_vertex{~0U};
+
+/**
+ * @brief A vertex attribute, stored as an array of elements that are stride bytes apart
+ */
+struct VertexStream
+{
+	const uint8_t *data{nullptr};
+
+	uint32_t stride{0};
+};
+
+/**
+ * @brief Post-transform vertex cache efficiency of a triangle list
+ */
+struct VertexCacheStats
+{
+	uint32_t triangle_count{0};
+
+	/// Vertices referenced by the triangles
+	uint32_t vertex_count{0};
+
+	/// Vertices the vertex shader runs for, that is cache misses
+	uint32_t transformed_vertex_count{0};
+
+	/**
+	 * @return Average cache miss ratio, transformed vertices per triangle. Ranges from 3 down to about 0.5.
+	 */
+	float get_acmr() const;
+
+	/**
+	 * @return Average transformed vertex ratio, transformed vertices per vertex. 1 is optimal.
+	 */
+	float get_atvr() const;
+
+	VertexCacheStats &operator+=(const VertexCacheStats &other);
+};
+
+/**
+ * @brief Simulates a FIFO post-transform vertex cache over a triangle list
+ * @param indices The triangle list
+ * @param vertex_count Number of vertices the indices address
+ * @param cache_size Number of entries in the simulated cache
+ */
+VertexCacheStats analyze_vertex_cache(const std::vector<uint32_t> &indices, size_t vertex_count, uint32_t cache_size = 16);
+
+/**
+ * @brief Reorders triangles to reuse recently transformed vertices, using Tom Forsyth's
+ *        linear-speed vertex cache optimisation
+ * @param indices The triangle list to reorder
+ * @param vertex_count Number of vertices the indices address
+ */
+void optimize_vertex_cache(std::vector<uint32_t> &indices, size_t vertex_count);
+
+/**
+ * @brief Reorders clusters of triangles so that outward facing ones are drawn first, which
+ *        reduces overdraw from any view. Clusters start where the vertex cache is cold, so the
+ *        vertex cache efficiency of an optimize_vertex_cache order is kept.
+ * @param indices The triangle list to reorder, already optimized for the vertex cache
+ * @param positions A stream of three float positions
+ * @param vertex_count Number of vertices the indices address
+ */
+void optimize_overdraw(std::vector<uint32_t> &indices, const VertexStream &positions, size_t vertex_count);
+
+/**
+ * @brief Simplifies a triangle list by collapsing edges in order of quadric error, keeping the
+ *        original vertices. Open borders only collapse along themselves, and vertices sharing
+ *        their position with others, like those on texture seams, are kept.
+ * @param indices The triangle list to simplify
+ * @param positions A stream of three float positions
+ * @param vertex_count Number of vertices the indices address
+ * @param target_index_count Number of indices to stop at
+ * @param max_error Largest error allowed, relative to the size of the mesh
+ * @param result_error If not null, receives the error of the result in the units of the positions
+ * @return The simplified triangle list, which may have more indices than the target if
+ *         reaching it would exceed the error
+ */
+std::vector<uint32_t> simplify(const std::vector<uint32_t> &indices, const VertexStream &positions, size_t vertex_count,
+                               size_t target_index_count, float max_error, float *result_error = nullptr);
+
+/**
+ * @brief Builds a remap table that merges vertices whose data is identical in every stream
+ * @param remap Receives the new index of every vertex
+ * @param streams The vertex attributes
+ * @param vertex_count Number of vertices in each stream
+ * @return Number of unique vertices
+ */
+uint32_t generate_vertex_remap(std::vector<uint32_t> &remap, const std::vector<VertexStream> &streams, size_t vertex_count);
+
+/**
+ * @brief Builds a remap table that orders vertices by first use in the triangle list, so that
+ *        vertex fetches walk through memory. Unreferenced vertices are dropped.
+ * @param remap Receives the new index of every vertex, or unused_vertex
+ * @param indices The triangle list
+ * @param vertex_count Number of vertices the indices address
+ * @return Number of referenced vertices
+ */
+uint32_t generate_vertex_fetch_remap(std::vector<uint32_t> &remap, const std::vector<uint32_t> &indices, size_t vertex_count);
+
+/**
+ * @brief Replaces every index by its entry in a remap table
+ */
+void remap_indices(std::vector<uint32_t> &indices, const std::vector<uint32_t> &remap);
+
+/**
+ * @brief Moves every vertex of an attribute to its entry in a remap table
+ * @param data The attribute data, holding remap.size() elements that are stride bytes apart
+ * @param stride Size in bytes of an element
+ * @param remap The new index of every vertex, or unused_vertex to drop it
+ * @param new_vertex_count Number of vertices after remapping
+ */
+void remap_vertices(std::vector<uint8_t> &data, uint32_t stride, const std::vector<uint32_t> &remap, size_t new_vertex_count);
+}        // namespace vkb
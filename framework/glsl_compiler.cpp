@@ -17,6 +17,13 @@
 
 #include "glsl_compiler.h"
 
+#include <cstdio>
+#include <iomanip>
+#include <thread>
+
+#include "common/logging.h"
+#include "platform/filesystem.h"
+
 VKBP_DISABLE_WARNINGS()
 #include <SPIRV/GLSL.std.450.h>
 #include <SPIRV/GlslangToSpv.h>
@@ -73,11 +80,136 @@ inline EShLanguage FindShaderLanguage(VkShaderStageFlagBits stage)
 			return EShLangVertex;
 	}
 }
+
+/// Identifies SPIR-V cache files, bump the version when the file layout changes
+constexpr uint32_t spirv_cache_magic{0x43565053};
+constexpr uint32_t spirv_cache_version{1};
+
+/// First word of every valid SPIR-V module
+constexpr uint32_t spirv_magic_number{0x07230203};
+
+inline void hash_fnv1a(uint64_t &hash, const std::string &value)
+{
+	uint64_t size = value.size();
+	hash          = fnv1a_64(&size, sizeof(size), hash);
+	hash          = fnv1a_64(value.data(), value.size(), hash);
+}
+
+inline std::string get_spirv_cache_filename(VkShaderStageFlagBits              stage,
+                                            const std::vector<uint8_t> &       glsl_source,
+                                            const std::string &                entry_point,
+                                            const ShaderVariant &              shader_variant,
+                                            glslang::EShTargetLanguage        target_language,
+                                            glslang::EShTargetLanguageVersion target_language_version)
+{
+	uint64_t hash = fnv1a_64(nullptr, 0);
+
+	hash_fnv1a(hash, std::string{glsl_source.begin(), glsl_source.end()});
+	hash_fnv1a(hash, entry_point);
+	hash_fnv1a(hash, shader_variant.get_preamble());
+
+	for (auto &process : shader_variant.get_processes())
+	{
+		hash_fnv1a(hash, process);
+	}
+
+	auto stage_value    = static_cast<uint32_t>(stage);
+	auto language_value = static_cast<uint32_t>(target_language);
+	auto version_value  = static_cast<uint32_t>(target_language_version);
+
+	hash = fnv1a_64(&stage_value, sizeof(stage_value), hash);
+	hash = fnv1a_64(&language_value, sizeof(language_value), hash);
+	hash = fnv1a_64(&version_value, sizeof(version_value), hash);
+
+	// Another glslang may generate other code from the same source, so its modules go in other files
+	int generator_version = glslang::GetSpirvGeneratorVersion();
+
+	hash_fnv1a(hash, glslang::GetGlslVersionString());
+	hash = fnv1a_64(&generator_version, sizeof(generator_version), hash);
+
+	std::stringstream filename;
+	filename << std::hex << std::setw(16) << std::setfill('0') << hash << ".spv";
+
+	return filename.str();
+}
+
+inline bool load_spirv_cache(const std::string &filename, std::vector<std::uint32_t> &spirv)
+{
+	std::ifstream file{fs::path::get(fs::path::Type::ShaderCache, filename), std::ios::in | std::ios::binary};
+
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	uint32_t magic{0};
+	uint32_t version{0};
+	uint64_t word_count{0};
+
+	file.read(reinterpret_cast<char *>(&magic), sizeof(magic));
+	file.read(reinterpret_cast<char *>(&version), sizeof(version));
+	file.read(reinterpret_cast<char *>(&word_count), sizeof(word_count));
+
+	if (!file || magic != spirv_cache_magic || version != spirv_cache_version || word_count == 0)
+	{
+		return false;
+	}
+
+	std::vector<std::uint32_t> cached(static_cast<size_t>(word_count));
+	file.read(reinterpret_cast<char *>(cached.data()), cached.size() * sizeof(std::uint32_t));
+
+	// Reject truncated files, for example from a run that was killed mid-write
+	if (!file || cached[0] != spirv_magic_number)
+	{
+		LOGW("Ignoring invalid SPIR-V cache file {}", filename);
+		return false;
+	}
+
+	spirv = std::move(cached);
+
+	return true;
+}
+
+inline void store_spirv_cache(const std::string &filename, const std::vector<std::uint32_t> &spirv)
+{
+	auto path = fs::path::get(fs::path::Type::ShaderCache, filename);
+
+	// Write to a per-thread file first, so that concurrent readers never see a partial module
+	std::stringstream temp_path;
+	temp_path << path << "." << std::this_thread::get_id() << ".tmp";
+
+	{
+		std::ofstream file{temp_path.str(), std::ios::out | std::ios::binary | std::ios::trunc};
+
+		if (!file.is_open())
+		{
+			LOGW("Failed to write SPIR-V cache file {}", filename);
+			return;
+		}
+
+		uint64_t word_count = spirv.size();
+
+		file.write(reinterpret_cast<const char *>(&spirv_cache_magic), sizeof(spirv_cache_magic));
+		file.write(reinterpret_cast<const char *>(&spirv_cache_version), sizeof(spirv_cache_version));
+		file.write(reinterpret_cast<const char *>(&word_count), sizeof(word_count));
+		file.write(reinterpret_cast<const char *>(spirv.data()), spirv.size() * sizeof(std::uint32_t));
+	}
+
+	if (std::rename(temp_path.str().c_str(), path.c_str()) != 0)
+	{
+		// Another thread or process already cached the same module
+		std::remove(temp_path.str().c_str());
+	}
+}
 }        // namespace
 
 glslang::EShTargetLanguage        GLSLCompiler::env_target_language         = glslang::EShTargetLanguage::EShTargetNone;
 glslang::EShTargetLanguageVersion GLSLCompiler::env_target_language_version = (glslang::EShTargetLanguageVersion) 0;
 
+std::atomic<bool>   GLSLCompiler::spirv_cache_enabled{true};
+std::atomic<size_t> GLSLCompiler::spirv_cache_hits{0};
+std::atomic<size_t> GLSLCompiler::spirv_cache_misses{0};
+
 void GLSLCompiler::set_target_environment(glslang::EShTargetLanguage target_language, glslang::EShTargetLanguageVersion target_language_version)
 {
 	GLSLCompiler::env_target_language         = target_language;
@@ -90,6 +222,27 @@ void GLSLCompiler::reset_target_environment()
 	GLSLCompiler::env_target_language_version = (glslang::EShTargetLanguageVersion) 0;
 }
 
+void GLSLCompiler::set_spirv_cache_enabled(bool enabled)
+{
+	GLSLCompiler::spirv_cache_enabled = enabled;
+}
+
+SPIRVCacheStats GLSLCompiler::get_spirv_cache_stats()
+{
+	SPIRVCacheStats stats;
+
+	stats.hits   = GLSLCompiler::spirv_cache_hits;
+	stats.misses = GLSLCompiler::spirv_cache_misses;
+
+	return stats;
+}
+
+void GLSLCompiler::reset_spirv_cache_stats()
+{
+	GLSLCompiler::spirv_cache_hits   = 0;
+	GLSLCompiler::spirv_cache_misses = 0;
+}
+
 bool GLSLCompiler::compile_to_spirv(VkShaderStageFlagBits       stage,
                                     const std::vector<uint8_t> &glsl_source,
                                     const std::string &         entry_point,
@@ -97,6 +250,22 @@ bool GLSLCompiler::compile_to_spirv(VkShaderStageFlagBits       stage,
                                     std::vector<std::uint32_t> &spirv,
                                     std::string &               info_log)
 {
+	std::string cache_filename;
+
+	if (GLSLCompiler::spirv_cache_enabled)
+	{
+		cache_filename = get_spirv_cache_filename(stage, glsl_source, entry_point, shader_variant,
+		                                          GLSLCompiler::env_target_language, GLSLCompiler::env_target_language_version);
+
+		if (load_spirv_cache(cache_filename, spirv))
+		{
+			++GLSLCompiler::spirv_cache_hits;
+			return true;
+		}
+
+		++GLSLCompiler::spirv_cache_misses;
+	}
+
 	// Initialize glslang library.
 	glslang::InitializeProcess();
 
@@ -165,6 +334,11 @@ bool GLSLCompiler::compile_to_spirv(VkShaderStageFlagBits       stage,
 	// Shutdown glslang library.
 	glslang::FinalizeProcess();
 
+	if (!cache_filename.empty())
+	{
+		store_spirv_cache(cache_filename, spirv);
+	}
+
 	return true;
 }
 }        // namespace vkb
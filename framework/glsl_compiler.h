@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <string>
 #include <vector>
 
@@ -31,14 +32,28 @@ VKBP_ENABLE_WARNINGS()
 
 namespace vkb
 {
+/// Number of SPIR-V cache lookups that skipped or required a glslang compile
+struct SPIRVCacheStats
+{
+	size_t hits{0};
+
+	size_t misses{0};
+};
+
 /// Helper class to generate SPIRV code from GLSL source
 /// A very simple version of the glslValidator application
+/// Compiled SPIR-V is cached on disk, keyed by the expanded source, the shader variant,
+/// the target environment and the glslang version, so that warm runs skip glslang entirely
 class GLSLCompiler
 {
   private:
 	static glslang::EShTargetLanguage        env_target_language;
 	static glslang::EShTargetLanguageVersion env_target_language_version;
 
+	static std::atomic<bool>   spirv_cache_enabled;
+	static std::atomic<size_t> spirv_cache_hits;
+	static std::atomic<size_t> spirv_cache_misses;
+
   public:
 	/**
 	 * @brief Set the glslang target environment to translate to when generating code
@@ -53,6 +68,22 @@ class GLSLCompiler
 	 */
 	static void reset_target_environment();
 
+	/**
+	 * @brief Enable or disable the on-disk SPIR-V cache, it is enabled by default
+	 * @param enabled Whether compile results are looked up and stored in the cache
+	 */
+	static void set_spirv_cache_enabled(bool enabled);
+
+	/**
+	 * @return The cache hits and misses since the start of the application or the last reset
+	 */
+	static SPIRVCacheStats get_spirv_cache_stats();
+
+	/**
+	 * @brief Reset the SPIR-V cache hit and miss counters
+	 */
+	static void reset_spirv_cache_stats();
+
 	/**
 	 * @brief Compiles GLSL to SPIRV code
 	 * @param stage The Vulkan shader stage flag
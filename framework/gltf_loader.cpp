@@ -19,7 +19,13 @@
 #define TINYGLTF_IMPLEMENTATION
 #include "gltf_loader.h"
 
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <iomanip>
 #include <limits>
+#include <map>
+#include <numeric>
 #include <queue>
 
 #include "common/error.h"
@@ -30,6 +36,7 @@ VKBP_DISABLE_WARNINGS()
 VKBP_ENABLE_WARNINGS()
 
 #include "api_vulkan_sample.h"
+#include "common/helpers.h"
 #include "common/logging.h"
 #include "common/utils.h"
 #include "common/vk_common.h"
@@ -39,6 +46,7 @@ VKBP_ENABLE_WARNINGS()
 #include "scene_graph/components/camera.h"
 #include "scene_graph/components/image.h"
 #include "scene_graph/components/image/astc.h"
+#include "scene_graph/components/image/bcn.h"
 #include "scene_graph/components/light.h"
 #include "scene_graph/components/mesh.h"
 #include "scene_graph/components/pbr_material.h"
@@ -129,6 +137,86 @@ inline std::vector<uint8_t> get_attribute_data(const tinygltf::Model *model, uin
 	return {buffer.data.begin() + startByte, buffer.data.begin() + endByte};
 };
 
+/// Widens index data of either index type to 32 bit indices
+inline std::vector<uint32_t> unpack_indices(const std::vector<uint8_t> &index_data, VkIndexType index_type)
+{
+	std::vector<uint32_t> indices;
+
+	if (index_type == VK_INDEX_TYPE_UINT16)
+	{
+		auto data = reinterpret_cast<const uint16_t *>(index_data.data());
+		indices.assign(data, data + index_data.size() / 2);
+	}
+	else
+	{
+		indices.resize(index_data.size() / 4);
+		std::memcpy(indices.data(), index_data.data(), indices.size() * 4);
+	}
+
+	return indices;
+}
+
+inline std::vector<uint8_t> pack_indices(const std::vector<uint32_t> &indices, VkIndexType index_type)
+{
+	std::vector<uint8_t> index_data;
+
+	if (index_type == VK_INDEX_TYPE_UINT16)
+	{
+		index_data.resize(indices.size() * 2);
+
+		auto data = reinterpret_cast<uint16_t *>(index_data.data());
+		std::transform(indices.begin(), indices.end(), data, TypeCast<uint32_t, uint16_t>{});
+	}
+	else
+	{
+		index_data.resize(indices.size() * 4);
+		std::memcpy(index_data.data(), indices.data(), index_data.size());
+	}
+
+	return index_data;
+}
+
+/// Projects a direction onto the octahedron and unfolds the lower half, giving a point of the [-1, 1] square
+inline glm::vec2 encode_octahedral(const glm::vec3 &direction)
+{
+	float length = std::abs(direction.x) + std::abs(direction.y) + std::abs(direction.z);
+
+	if (length == 0.0f)
+	{
+		return glm::vec2{0.0f};
+	}
+
+	glm::vec3 octahedron = direction / length;
+
+	if (octahedron.z >= 0.0f)
+	{
+		return glm::vec2{octahedron.x, octahedron.y};
+	}
+
+	return glm::vec2{(1.0f - std::abs(octahedron.y)) * (octahedron.x >= 0.0f ? 1.0f : -1.0f),
+	                 (1.0f - std::abs(octahedron.x)) * (octahedron.y >= 0.0f ? 1.0f : -1.0f)};
+}
+
+/// Whether a material samples the image as a color, whose values are sRGB encoded per the glTF specification
+inline bool is_color_image(const tinygltf::Model &model, const tinygltf::Image &gltf_image)
+{
+	auto is_image = [&](const tinygltf::ParameterMap &parameters, const std::string &name) {
+		auto parameter = parameters.find(name);
+		if (parameter == parameters.end())
+		{
+			return false;
+		}
+
+		auto texture_index = parameter->second.TextureIndex();
+		return texture_index >= 0 && texture_index < static_cast<int>(model.textures.size()) &&
+		       model.textures[texture_index].source == static_cast<int>(&gltf_image - model.images.data());
+	};
+
+	return std::any_of(model.materials.begin(), model.materials.end(), [&](const tinygltf::Material &gltf_material) {
+		return is_image(gltf_material.values, "baseColorTexture") || is_image(gltf_material.additionalValues, "emissiveTexture");
+	});
+}
+
 inline size_t get_attribute_size(const tinygltf::Model *model, uint32_t accessorId)
 {
 	return model->accessors.at(accessorId).count;
@@ -277,10 +365,48 @@ inline std::vector<uint8_t> convert_underlying_data_stride(const std::vector<uin
 	return result;
 }
 
-inline void upload_image_to_gpu(CommandBuffer &command_buffer, core::Buffer &staging_buffer, sg::Image &image)
+/**
+ * @brief Finds the finest mip level of an image that is small enough to upload at load time
+ * @return 0 if the image can't be streamed, as its levels are not stored one after the other
+ */
+inline uint32_t get_resident_mip_level(const sg::Image &image, uint32_t resident_size)
+{
+	auto &mipmaps = image.get_mipmaps();
+
+	if (image.get_layers() != 1 || image.get_extent().depth != 1 || mipmaps.size() < 2)
+	{
+		return 0;
+	}
+
+	for (size_t i = 1; i < mipmaps.size(); ++i)
+	{
+		if (mipmaps[i].offset <= mipmaps[i - 1].offset)
+		{
+			return 0;
+		}
+	}
+
+	uint32_t level = 0;
+
+	while (level + 1 < mipmaps.size() && std::max(mipmaps[level].extent.width, mipmaps[level].extent.height) > resident_size)
+	{
+		++level;
+	}
+
+	return level;
+}
+
+/**
+ * @brief Uploads the mip levels of an image from first_level on, leaving the finer levels in the transfer
+ *        destination layout for streaming. The staging buffer holds the data from the offset of first_level.
+ */
+inline void upload_image_to_gpu(CommandBuffer &command_buffer, core::Buffer &staging_buffer, sg::Image &image, uint32_t first_level = 0)
 {
 	// Clean up the image data, as they are copied in the staging buffer
-	image.clear_data();
+	if (first_level == 0)
+	{
+		image.clear_data();
+	}
 
 	{
 		ImageMemoryBarrier memory_barrier{};
@@ -297,14 +423,14 @@ inline void upload_image_to_gpu(CommandBuffer &command_buffer, core::Buffer &sta
 	// Create a buffer image copy for every mip level
 	auto &mipmaps = image.get_mipmaps();
 
-	std::vector<VkBufferImageCopy> buffer_copy_regions(mipmaps.size());
+	std::vector<VkBufferImageCopy> buffer_copy_regions(mipmaps.size() - first_level);
 
-	for (size_t i = 0; i < mipmaps.size(); ++i)
+	for (size_t i = first_level; i < mipmaps.size(); ++i)
 	{
 		auto &mipmap      = mipmaps[i];
-		auto &copy_region = buffer_copy_regions[i];
+		auto &copy_region = buffer_copy_regions[i - first_level];
 
-		copy_region.bufferOffset     = mipmap.offset;
+		copy_region.bufferOffset     = mipmap.offset - mipmaps[first_level].offset;
 		copy_region.imageSubresource = image.get_vk_image_view().get_subresource_layers();
 		// Update miplevel
 		copy_region.imageSubresource.mipLevel = mipmap.level;
@@ -313,6 +439,12 @@ inline void upload_image_to_gpu(CommandBuffer &command_buffer, core::Buffer &sta
 
 	command_buffer.copy_buffer_to_image(staging_buffer, image.get_vk_image(), buffer_copy_regions);
 
+	if (first_level > 0)
+	{
+		// The view is not bound anywhere yet, so the previous one can go straight away
+		image.set_base_mip_level(first_level);
+	}
+
 	{
 		ImageMemoryBarrier memory_barrier{};
 		memory_barrier.old_layout      = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
@@ -325,512 +457,1917 @@ inline void upload_image_to_gpu(CommandBuffer &command_buffer, core::Buffer &sta
 		command_buffer.image_memory_barrier(image.get_vk_image_view(), memory_barrier);
 	}
 }
-}        // namespace
 
-std::unordered_map<std::string, bool> GLTFLoader::supported_extensions = {
-    {KHR_LIGHTS_PUNCTUAL_EXTENSION, false}};
-
-GLTFLoader::GLTFLoader(Device &device) :
-    device{device}
+/**
+ * @brief Parses a glTF file straight from a memory mapping, so that the JSON is not read into memory first
+ */
+bool load_gltf_model(tinygltf::Model &model, std::string &err, std::string &warn, const std::string &gltf_file)
 {
-}
+	// External buffers are still read by tinygltf, whose file callbacks fill vectors it owns
+	tinygltf::TinyGLTF gltf_loader;
 
-std::unique_ptr<sg::Scene> GLTFLoader::read_scene_from_file(const std::string &file_name, int scene_index)
-{
-	std::string err;
-	std::string warn;
+	std::unique_ptr<vkb::fs::MappedFile> file;
 
-	tinygltf::TinyGLTF gltf_loader;
+	try
+	{
+		file = std::make_unique<vkb::fs::MappedFile>(gltf_file);
+	}
+	catch (const std::exception &e)
+	{
+		err = e.what();
+		return false;
+	}
 
-	std::string gltf_file = vkb::fs::path::get(vkb::fs::path::Type::Assets) + file_name;
+	auto base_dir = gltf_file.substr(0, gltf_file.find_last_of("/\\") + 1);
 
-	bool importResult = gltf_loader.LoadASCIIFromFile(&model, &err, &warn, gltf_file.c_str());
+	return gltf_loader.LoadASCIIFromString(&model, &err, &warn, reinterpret_cast<const char *>(file->data()), to_u32(file->size()), base_dir);
+}
 
-	if (!importResult)
-	{
-		LOGE("Failed to load gltf file {}.", gltf_file.c_str());
+/// Identifies baked scene files, bump the version when the file layout or the primitive conversion changes
+constexpr uint32_t baked_scene_magic{0x454e4353};
+constexpr uint32_t baked_scene_version{4};
 
-		return nullptr;
-	}
+constexpr size_t baked_scene_header_size{sizeof(uint32_t) + sizeof(uint32_t) + sizeof(uint64_t)};
 
-	if (!err.empty())
+/// Streams a baked scene out of memory, and hands out pointers into it for bulk data
+class MemoryStreamBuffer : public std::streambuf
+{
+  public:
+	void set(const uint8_t *data, size_t size)
 	{
-		LOGE("Error loading gltf model: {}.", err.c_str());
-
-		return nullptr;
+		auto begin = const_cast<char *>(reinterpret_cast<const char *>(data));
+		setg(begin, begin, begin + size);
 	}
 
-	if (!warn.empty())
+	/**
+	 * @brief Skips over the next bytes of the stream
+	 * @return A pointer to the skipped bytes, or nullptr if fewer are left
+	 */
+	const uint8_t *consume(size_t size)
 	{
-		LOGI("{}", warn.c_str());
+		if (static_cast<size_t>(egptr() - gptr()) < size)
+		{
+			return nullptr;
+		}
+
+		auto data = gptr();
+		setg(eback(), data + size, egptr());
+
+		return reinterpret_cast<const uint8_t *>(data);
 	}
+};
 
-	size_t pos = file_name.find_last_of('/');
+inline std::string get_baked_scene_filename(const std::string &file_name)
+{
+	std::stringstream filename;
+	filename << std::hex << std::setw(16) << std::setfill('0') << fnv1a_64(file_name.data(), file_name.size()) << ".scene";
 
-	model_path = file_name.substr(0, pos);
+	return filename.str();
+}
 
-	if (pos == std::string::npos)
+/// Size and modification time of a file, a baked scene is out of date when these change for any of its sources
+inline bool get_file_stamp(const std::string &path, uint64_t &size, int64_t &modification_time)
+{
+	struct stat info;
+	if (stat(path.c_str(), &info) != 0)
 	{
-		model_path.clear();
+		return false;
 	}
 
-	return std::make_unique<sg::Scene>(load_scene(scene_index));
+	size              = static_cast<uint64_t>(info.st_size);
+	modification_time = static_cast<int64_t>(info.st_mtime);
+
+	return true;
 }
 
-std::unique_ptr<sg::SubMesh> GLTFLoader::read_model_from_file(const std::string &file_name, uint32_t index)
+enum class BakedValueType : uint8_t
 {
-	std::string err;
-	std::string warn;
+	Null,
+	Bool,
+	Int,
+	Number,
+	String,
+	Binary,
+	Array,
+	Object
+};
 
-	tinygltf::TinyGLTF gltf_loader;
+inline void write_strings(std::ostringstream &os, const std::vector<std::string> &value)
+{
+	write(os, value.size());
 
-	std::string gltf_file = vkb::fs::path::get(vkb::fs::path::Type::Assets) + file_name;
+	for (auto &item : value)
+	{
+		write(os, item);
+	}
+}
 
-	bool importResult = gltf_loader.LoadASCIIFromFile(&model, &err, &warn, gltf_file.c_str());
+inline void read_strings(std::istream &is, std::vector<std::string> &value)
+{
+	std::size_t size;
+	read(is, size);
 
-	if (!importResult)
-	{
-		LOGE("Failed to load gltf file {}.", gltf_file.c_str());
+	value.resize(size);
 
-		return nullptr;
+	for (auto &item : value)
+	{
+		read(is, item);
 	}
+}
 
-	if (!err.empty())
+void write_value(std::ostringstream &os, const tinygltf::Value &value)
+{
+	if (value.IsBool())
 	{
-		LOGE("Error loading gltf model: {}.", err.c_str());
-
-		return nullptr;
+		write(os, BakedValueType::Bool, value.Get<bool>());
 	}
-
-	if (!warn.empty())
+	else if (value.IsInt())
 	{
-		LOGI("{}", warn.c_str());
+		write(os, BakedValueType::Int, value.Get<int>());
 	}
+	else if (value.IsNumber())
+	{
+		write(os, BakedValueType::Number, value.Get<double>());
+	}
+	else if (value.IsString())
+	{
+		write(os, BakedValueType::String, value.Get<std::string>());
+	}
+	else if (value.IsBinary())
+	{
+		write(os, BakedValueType::Binary, value.Get<std::vector<unsigned char>>());
+	}
+	else if (value.IsArray())
+	{
+		write(os, BakedValueType::Array, value.ArrayLen());
 
-	size_t pos = file_name.find_last_of('/');
+		for (size_t index = 0; index < value.ArrayLen(); ++index)
+		{
+			write_value(os, value.Get(static_cast<int>(index)));
+		}
+	}
+	else if (value.IsObject())
+	{
+		auto keys = value.Keys();
 
-	model_path = file_name.substr(0, pos);
+		write(os, BakedValueType::Object, keys.size());
 
-	if (pos == std::string::npos)
+		for (auto &key : keys)
+		{
+			write(os, key);
+			write_value(os, value.Get(key));
+		}
+	}
+	else
 	{
-		model_path.clear();
+		write(os, BakedValueType::Null);
 	}
-
-	return std::move(load_model(index));
 }
 
-sg::Scene GLTFLoader::load_scene(int scene_index)
+void read_value(std::istream &is, tinygltf::Value &value)
 {
-	auto scene = sg::Scene();
-
-	scene.set_name("gltf_scene");
+	BakedValueType type;
+	read(is, type);
 
-	// Check extensions
-	for (auto &used_extension : model.extensionsUsed)
+	switch (type)
 	{
-		auto it = supported_extensions.find(used_extension);
-
-		// Check if extension isn't supported by the GLTFLoader
-		if (it == supported_extensions.end())
+		case BakedValueType::Bool:
 		{
-			// If extension is required then we shouldn't allow the scene to be loaded
-			if (std::find(model.extensionsRequired.begin(), model.extensionsRequired.end(), used_extension) != model.extensionsRequired.end())
-			{
-				throw std::runtime_error("Cannot load glTF file. Contains a required unsupported extension: " + used_extension);
-			}
-			else
+			bool item;
+			read(is, item);
+			value = tinygltf::Value(item);
+			break;
+		}
+		case BakedValueType::Int:
+		{
+			int item;
+			read(is, item);
+			value = tinygltf::Value(item);
+			break;
+		}
+		case BakedValueType::Number:
+		{
+			double item;
+			read(is, item);
+			value = tinygltf::Value(item);
+			break;
+		}
+		case BakedValueType::String:
+		{
+			std::string item;
+			read(is, item);
+			value = tinygltf::Value(item);
+			break;
+		}
+		case BakedValueType::Binary:
+		{
+			std::vector<unsigned char> item;
+			read(is, item);
+			value = tinygltf::Value(item.data(), item.size());
+			break;
+		}
+		case BakedValueType::Array:
+		{
+			std::size_t size;
+			read(is, size);
+
+			tinygltf::Value::Array array(size);
+			for (auto &item : array)
 			{
-				// Otherwise, if extension isn't required (but is in the file) then print a warning to the user
-				LOGW("glTF file contains an unsupported extension, unexpected results may occur: {}", used_extension);
+				read_value(is, item);
 			}
+
+			value = tinygltf::Value(array);
+			break;
 		}
-		else
+		case BakedValueType::Object:
 		{
-			// Extension is supported, so enable it
-			LOGI("glTF file contains extension: {}", used_extension);
-			it->second = true;
+			std::size_t size;
+			read(is, size);
+
+			tinygltf::Value::Object object;
+			for (size_t index = 0; index < size; ++index)
+			{
+				std::string key;
+				read(is, key);
+				read_value(is, object[key]);
+			}
+
+			value = tinygltf::Value(object);
+			break;
 		}
+		default:
+			value = tinygltf::Value();
+			break;
 	}
+}
 
-	// Load lights
-	std::vector<std::unique_ptr<sg::Light>> light_components = parse_khr_lights_punctual();
+inline void write_extensions(std::ostringstream &os, const tinygltf::ExtensionMap &extensions)
+{
+	write(os, extensions.size());
 
-	scene.set_components(std::move(light_components));
+	for (auto &extension : extensions)
+	{
+		write(os, extension.first);
+		write_value(os, extension.second);
+	}
+}
 
-	// Load samplers
-	std::vector<std::unique_ptr<sg::Sampler>>
-	    sampler_components(model.samplers.size());
+inline void read_extensions(std::istream &is, tinygltf::ExtensionMap &extensions)
+{
+	std::size_t size;
+	read(is, size);
 
-	for (size_t sampler_index = 0; sampler_index < model.samplers.size(); sampler_index++)
+	for (size_t index = 0; index < size; ++index)
 	{
-		auto sampler                      = parse_sampler(model.samplers.at(sampler_index));
-		sampler_components[sampler_index] = std::move(sampler);
+		std::string name;
+		read(is, name);
+		read_value(is, extensions[name]);
 	}
+}
 
-	scene.set_components(std::move(sampler_components));
-
-	Timer timer;
-	timer.start();
+inline void write_parameters(std::ostringstream &os, const tinygltf::ParameterMap &parameters)
+{
+	write(os, parameters.size());
 
-	// Load images
-	auto thread_count = std::thread::hardware_concurrency();
-	thread_count      = thread_count == 0 ? 1 : thread_count;
-	ctpl::thread_pool thread_pool(thread_count);
+	for (auto &parameter : parameters)
+	{
+		write(os, parameter.first, parameter.second.bool_value, parameter.second.string_value, parameter.second.number_array, parameter.second.json_double_value, parameter.second.number_value);
+	}
+}
 
-	auto image_count = to_u32(model.images.size());
+inline void read_parameters(std::istream &is, tinygltf::ParameterMap &parameters)
+{
+	std::size_t size;
+	read(is, size);
 
-	std::vector<std::future<std::unique_ptr<sg::Image>>> image_component_futures;
-	for (size_t image_index = 0; image_index < image_count; image_index++)
+	for (size_t index = 0; index < size; ++index)
 	{
-		auto fut = thread_pool.push(
-		    [this, image_index](size_t) {
-			    auto image = parse_image(model.images.at(image_index));
+		std::string name;
+		read(is, name);
 
-			    LOGI("Loaded gltf image #{} ({})", image_index, model.images.at(image_index).uri.c_str());
+		auto &parameter = parameters[name];
+		read(is, parameter.bool_value, parameter.string_value, parameter.number_array, parameter.json_double_value, parameter.number_value);
+	}
+}
 
-			    return image;
-		    });
+/// Writes the parts of a model that GLTFLoader::load_scene reads, except for the geometry
+void write_model(std::ostringstream &os, const tinygltf::Model &model)
+{
+	write_strings(os, model.extensionsUsed);
+	write_strings(os, model.extensionsRequired);
+	write_extensions(os, model.extensions);
 
-		image_component_futures.push_back(std::move(fut));
+	write(os, model.samplers.size());
+	for (auto &sampler : model.samplers)
+	{
+		write(os, sampler.name, sampler.minFilter, sampler.magFilter, sampler.wrapS, sampler.wrapT, sampler.wrapR);
 	}
 
-	std::vector<std::unique_ptr<sg::Image>> image_components;
-	for (auto &fut : image_component_futures)
+	write(os, model.images.size());
+	for (auto &image : model.images)
 	{
-		image_components.push_back(fut.get());
+		write(os, image.name, image.uri);
 	}
 
-	// Upload images to GPU
-	std::vector<core::Buffer> transient_buffers;
+	write(os, model.textures.size());
+	for (auto &texture : model.textures)
+	{
+		write(os, texture.name, texture.sampler, texture.source);
+	}
 
-	auto &command_buffer = device.request_command_buffer();
+	write(os, model.materials.size());
+	for (auto &material : model.materials)
+	{
+		write(os, material.name);
+		write_parameters(os, material.values);
+		write_parameters(os, material.additionalValues);
+	}
+
+	write(os, model.meshes.size());
+	for (auto &mesh : model.meshes)
+	{
+		write(os, mesh.name, mesh.primitives.size());
+
+		for (auto &primitive : mesh.primitives)
+		{
+			write(os, primitive.material);
+		}
+	}
+
+	write(os, model.cameras.size());
+	for (auto &camera : model.cameras)
+	{
+		write(os, camera.name, camera.type);
+		write(os, camera.perspective.aspectRatio, camera.perspective.yfov, camera.perspective.znear, camera.perspective.zfar);
+	}
+
+	write(os, model.nodes.size());
+	for (auto &node : model.nodes)
+	{
+		write(os, node.name, node.camera, node.mesh, node.children);
+		write(os, node.translation, node.rotation, node.scale, node.matrix);
+		write_extensions(os, node.extensions);
+	}
+
+	write(os, model.scenes.size());
+	for (auto &scene : model.scenes)
+	{
+		write(os, scene.name, scene.nodes);
+	}
+
+	write(os, model.defaultScene);
+}
+
+void read_model(std::istream &is, tinygltf::Model &model)
+{
+	model = {};
+
+	read_strings(is, model.extensionsUsed);
+	read_strings(is, model.extensionsRequired);
+	read_extensions(is, model.extensions);
+
+	std::size_t size;
+
+	read(is, size);
+	model.samplers.resize(size);
+	for (auto &sampler : model.samplers)
+	{
+		read(is, sampler.name, sampler.minFilter, sampler.magFilter, sampler.wrapS, sampler.wrapT, sampler.wrapR);
+	}
+
+	read(is, size);
+	model.images.resize(size);
+	for (auto &image : model.images)
+	{
+		read(is, image.name, image.uri);
+	}
+
+	read(is, size);
+	model.textures.resize(size);
+	for (auto &texture : model.textures)
+	{
+		read(is, texture.name, texture.sampler, texture.source);
+	}
+
+	read(is, size);
+	model.materials.resize(size);
+	for (auto &material : model.materials)
+	{
+		read(is, material.name);
+		read_parameters(is, material.values);
+		read_parameters(is, material.additionalValues);
+	}
+
+	read(is, size);
+	model.meshes.resize(size);
+	for (auto &mesh : model.meshes)
+	{
+		read(is, mesh.name, size);
+
+		mesh.primitives.resize(size);
+		for (auto &primitive : mesh.primitives)
+		{
+			read(is, primitive.material);
+		}
+	}
+
+	read(is, size);
+	model.cameras.resize(size);
+	for (auto &camera : model.cameras)
+	{
+		read(is, camera.name, camera.type);
+		read(is, camera.perspective.aspectRatio, camera.perspective.yfov, camera.perspective.znear, camera.perspective.zfar);
+	}
+
+	read(is, size);
+	model.nodes.resize(size);
+	for (auto &node : model.nodes)
+	{
+		read(is, node.name, node.camera, node.mesh, node.children);
+		read(is, node.translation, node.rotation, node.scale, node.matrix);
+		read_extensions(is, node.extensions);
+	}
+
+	read(is, size);
+	model.scenes.resize(size);
+	for (auto &scene : model.scenes)
+	{
+		read(is, scene.name, scene.nodes);
+	}
+
+	read(is, model.defaultScene);
+}
+}        // namespace
+
+std::unordered_map<std::string, bool> GLTFLoader::supported_extensions = {
+    {KHR_LIGHTS_PUNCTUAL_EXTENSION, false}};
+
+GLTFLoader::GLTFLoader(Device &device) :
+    device{device}
+{
+}
+
+std::unique_ptr<sg::Scene> GLTFLoader::read_scene_from_file(const std::string &file_name, int scene_index)
+{
+	std::string err;
+	std::string warn;
+
+	std::string gltf_file = vkb::fs::path::get(vkb::fs::path::Type::Assets) + file_name;
+
+	size_t pos = file_name.find_last_of('/');
+
+	model_path = file_name.substr(0, pos);
+
+	if (pos == std::string::npos)
+	{
+		model_path.clear();
+	}
+
+	bake_file.clear();
+	bake_sources.clear();
+
+	if (scene_cache)
+	{
+		auto baked_file = vkb::fs::path::get(vkb::fs::path::Type::SceneCache, get_baked_scene_filename(file_name));
+
+		if (load_baked_scene(baked_file))
+		{
+			LOGI("Loaded baked scene for {}", file_name);
+
+			return std::make_unique<sg::Scene>(load_scene(scene_index));
+		}
+
+		bake_file = baked_file;
+	}
+
+	bool importResult = load_gltf_model(model, err, warn, gltf_file);
+
+	if (!importResult)
+	{
+		LOGE("Failed to load gltf file {}.", gltf_file.c_str());
+
+		return nullptr;
+	}
+
+	if (!err.empty())
+	{
+		LOGE("Error loading gltf model: {}.", err.c_str());
+
+		return nullptr;
+	}
+
+	if (!warn.empty())
+	{
+		LOGI("{}", warn.c_str());
+	}
+
+	if (!bake_file.empty())
+	{
+		bake_sources.push_back(gltf_file);
+
+		for (auto &buffer : model.buffers)
+		{
+			// Buffers embedded as data URIs are covered by the glTF file itself
+			if (!buffer.uri.empty() && buffer.uri.compare(0, 5, "data:") != 0)
+			{
+				bake_sources.push_back(vkb::fs::path::get(vkb::fs::path::Type::Assets) + (model_path.empty() ? "" : model_path + "/") + buffer.uri);
+			}
+		}
+	}
+
+	return std::make_unique<sg::Scene>(load_scene(scene_index));
+}
+
+void GLTFLoader::set_shared_geometry_buffers(bool enable)
+{
+	shared_geometry_buffers = enable;
+}
+
+void GLTFLoader::set_scene_cache(bool enable)
+{
+	scene_cache = enable;
+}
+
+void GLTFLoader::set_mesh_optimization(bool enable, bool deduplicate_vertices)
+{
+	mesh_optimization          = enable;
+	this->deduplicate_vertices = deduplicate_vertices;
+}
+
+const MeshOptimizationStats &GLTFLoader::get_mesh_optimization_stats() const
+{
+	return mesh_optimization_stats;
+}
+
+void GLTFLoader::set_lod_generation(uint32_t lod_count, float max_error)
+{
+	this->lod_count = lod_count;
+	lod_max_error   = max_error;
+}
+
+void GLTFLoader::set_vertex_quantization(bool enable)
+{
+	vertex_quantization = enable;
+}
+
+void GLTFLoader::set_mipmap_generation(bool enable)
+{
+	mipmap_generation = enable;
+}
+
+void GLTFLoader::set_texture_streaming(bool enable, uint32_t resident_size)
+{
+	texture_streaming               = enable;
+	texture_streaming_resident_size = resident_size;
+}
+
+std::unique_ptr<sg::SubMesh> GLTFLoader::read_model_from_file(const std::string &file_name, uint32_t index)
+{
+	std::string err;
+	std::string warn;
+
+	std::string gltf_file = vkb::fs::path::get(vkb::fs::path::Type::Assets) + file_name;
+
+	bool importResult = load_gltf_model(model, err, warn, gltf_file);
+
+	if (!importResult)
+	{
+		LOGE("Failed to load gltf file {}.", gltf_file.c_str());
+
+		return nullptr;
+	}
+
+	if (!err.empty())
+	{
+		LOGE("Error loading gltf model: {}.", err.c_str());
+
+		return nullptr;
+	}
+
+	if (!warn.empty())
+	{
+		LOGI("{}", warn.c_str());
+	}
+
+	size_t pos = file_name.find_last_of('/');
+
+	model_path = file_name.substr(0, pos);
+
+	if (pos == std::string::npos)
+	{
+		model_path.clear();
+	}
+
+	return std::move(load_model(index));
+}
+
+sg::Scene GLTFLoader::load_scene(int scene_index)
+{
+	auto scene = sg::Scene();
+
+	scene.set_name("gltf_scene");
+
+	// Check extensions
+	for (auto &used_extension : model.extensionsUsed)
+	{
+		auto it = supported_extensions.find(used_extension);
+
+		// Check if extension isn't supported by the GLTFLoader
+		if (it == supported_extensions.end())
+		{
+			// If extension is required then we shouldn't allow the scene to be loaded
+			if (std::find(model.extensionsRequired.begin(), model.extensionsRequired.end(), used_extension) != model.extensionsRequired.end())
+			{
+				throw std::runtime_error("Cannot load glTF file. Contains a required unsupported extension: " + used_extension);
+			}
+			else
+			{
+				// Otherwise, if extension isn't required (but is in the file) then print a warning to the user
+				LOGW("glTF file contains an unsupported extension, unexpected results may occur: {}", used_extension);
+			}
+		}
+		else
+		{
+			// Extension is supported, so enable it
+			LOGI("glTF file contains extension: {}", used_extension);
+			it->second = true;
+		}
+	}
+
+	// Load lights
+	std::vector<std::unique_ptr<sg::Light>> light_components = parse_khr_lights_punctual();
+
+	scene.set_components(std::move(light_components));
+
+	// Load samplers
+	std::vector<std::unique_ptr<sg::Sampler>>
+	    sampler_components(model.samplers.size());
+
+	for (size_t sampler_index = 0; sampler_index < model.samplers.size(); sampler_index++)
+	{
+		auto sampler                      = parse_sampler(model.samplers.at(sampler_index));
+		sampler_components[sampler_index] = std::move(sampler);
+	}
+
+	scene.set_components(std::move(sampler_components));
+
+	Timer timer;
+	timer.start();
+
+	// Images are decoded and primitives converted on the same pool, so that both overlap
+	auto thread_count = std::thread::hardware_concurrency();
+	thread_count      = thread_count == 0 ? 1 : thread_count;
+	ctpl::thread_pool thread_pool(thread_count);
+
+	auto image_count = to_u32(model.images.size());
+
+	std::vector<std::future<std::unique_ptr<sg::Image>>> image_component_futures;
+	for (size_t image_index = 0; image_index < image_count; image_index++)
+	{
+		auto fut = thread_pool.push(
+		    [this, image_index](size_t) {
+			    auto image = parse_image(model.images.at(image_index));
+
+			    LOGI("Loaded gltf image #{} ({})", image_index, model.images.at(image_index).uri.c_str());
+
+			    return image;
+		    });
+
+		image_component_futures.push_back(std::move(fut));
+	}
+
+	// Primitives of a baked scene are already converted, the others keep their data if they are
+	// going to be quantized, packed or baked
+	std::vector<std::future<PrimitiveData>> primitive_futures;
+	if (baked_primitives.empty())
+	{
+		bool create_buffers = !shared_geometry_buffers && bake_file.empty() && !vertex_quantization;
+
+		for (auto &gltf_mesh : model.meshes)
+		{
+			for (auto &gltf_primitive : gltf_mesh.primitives)
+			{
+				auto fut = thread_pool.push(
+				    [this, &gltf_primitive, create_buffers](size_t) {
+					    return load_primitive(gltf_primitive, create_buffers);
+				    });
+
+				primitive_futures.push_back(std::move(fut));
+			}
+		}
+	}
+
+	// Upload images as they finish decoding, in batches of bounded staging memory. Each batch
+	// is submitted with its own fence and its staging buffers are released once that fence
+	// signals, so only a few batches worth of staging memory are alive at any time.
+	const VkDeviceSize max_batch_size        = 64 * 1024 * 1024;
+	const size_t       max_batches_in_flight = 2;
+
+	struct UploadBatch
+	{
+		VkFence fence{VK_NULL_HANDLE};
+
+		std::vector<core::Buffer> staging_buffers;
+	};
+
+	std::deque<UploadBatch> batches_in_flight;
+	UploadBatch             batch;
+	VkDeviceSize            batch_size{0};
+	CommandBuffer *         command_buffer{nullptr};
+
+	auto &queue = device.get_queue_by_flags(VK_QUEUE_GRAPHICS_BIT, 0);
+
+	auto submit_batch = [&]() {
+		command_buffer->end();
+
+		batch.fence = device.request_fence();
+		queue.submit(*command_buffer, batch.fence);
+
+		batches_in_flight.push_back(std::move(batch));
+		batch          = {};
+		batch_size     = 0;
+		command_buffer = nullptr;
+
+		if (batches_in_flight.size() > max_batches_in_flight)
+		{
+			VkFence oldest_fence = batches_in_flight.front().fence;
+			VK_CHECK(vkWaitForFences(device.get_handle(), 1, &oldest_fence, VK_TRUE, std::numeric_limits<uint64_t>::max()));
+
+			batches_in_flight.pop_front();
+		}
+	};
+
+	std::vector<std::unique_ptr<sg::Image>> image_components;
+	for (auto &fut : image_component_futures)
+	{
+		auto image = fut.get();
+
+		if (!command_buffer)
+		{
+			command_buffer = &device.request_command_buffer();
+			command_buffer->begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, 0);
+		}
+
+		// Streamed images only upload their coarsest levels now
+		uint32_t first_level = texture_streaming ? get_resident_mip_level(*image, texture_streaming_resident_size) : 0;
+		auto     data_offset = image->get_mipmaps()[first_level].offset;
+
+		core::Buffer stage_buffer{device,
+		                          image->get_data().size() - data_offset,
+		                          VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		                          VMA_MEMORY_USAGE_CPU_ONLY};
+
+		stage_buffer.update(image->get_data().data() + data_offset, image->get_data().size() - data_offset);
+
+		upload_image_to_gpu(*command_buffer, stage_buffer, *image, first_level);
+
+		batch_size += stage_buffer.get_size();
+		batch.staging_buffers.push_back(std::move(stage_buffer));
+
+		image_components.push_back(std::move(image));
+
+		if (batch_size >= max_batch_size)
+		{
+			submit_batch();
+		}
+	}
+
+	if (command_buffer)
+	{
+		submit_batch();
+	}
+
+	device.get_fence_pool().wait();
+	device.get_fence_pool().reset();
+	device.get_command_pool().reset_pool();
+
+	batches_in_flight.clear();
+
+	scene.set_components(std::move(image_components));
+
+	auto elapsed_time = timer.stop();
+
+	LOGI("Time spent loading images: {} seconds across {} threads.", vkb::to_string(elapsed_time), thread_count);
+
+	// Load textures
+	auto images          = scene.get_components<sg::Image>();
+	auto samplers        = scene.get_components<sg::Sampler>();
+	auto default_sampler = create_default_sampler();
+
+	for (auto &gltf_texture : model.textures)
+	{
+		auto texture = parse_texture(gltf_texture);
+
+		texture->set_image(*images.at(gltf_texture.source));
+
+		if (gltf_texture.sampler >= 0 && gltf_texture.sampler < static_cast<int>(samplers.size()))
+		{
+			texture->set_sampler(*samplers.at(gltf_texture.sampler));
+		}
+		else
+		{
+			if (gltf_texture.name.empty())
+			{
+				gltf_texture.name = images.at(gltf_texture.source)->get_name();
+			}
+
+			texture->set_sampler(*default_sampler);
+		}
+
+		scene.add_component(std::move(texture));
+	}
+
+	scene.add_component(std::move(default_sampler));
+
+	// Load materials
+	bool                            has_textures = scene.has_component<sg::Texture>();
+	std::vector<vkb::sg::Texture *> textures;
+	if (has_textures)
+	{
+		textures = scene.get_components<sg::Texture>();
+	}
+
+	for (auto &gltf_material : model.materials)
+	{
+		auto material = parse_material(gltf_material);
+
+		for (auto &gltf_value : gltf_material.values)
+		{
+			if (gltf_value.first.find("Texture") != std::string::npos)
+			{
+				std::string tex_name = to_snake_case(gltf_value.first);
+
+				material->textures[tex_name] = textures.at(gltf_value.second.TextureIndex());
+			}
+		}
+
+		for (auto &gltf_value : gltf_material.additionalValues)
+		{
+			if (gltf_value.first.find("Texture") != std::string::npos)
+			{
+				std::string tex_name = to_snake_case(gltf_value.first);
+
+				material->textures[tex_name] = textures.at(gltf_value.second.TextureIndex());
+			}
+		}
+
+		scene.add_component(std::move(material));
+	}
+
+	auto default_material = create_default_material();
+
+	// Load meshes
+	auto materials = scene.get_components<sg::PBRMaterial>();
+
+	std::vector<PrimitiveData> primitives = std::move(baked_primitives);
+	baked_primitives.clear();
+
+	for (auto &fut : primitive_futures)
+	{
+		primitives.push_back(fut.get());
+	}
+
+	mesh_optimization_stats = {};
+
+	for (auto &primitive : primitives)
+	{
+		mesh_optimization_stats.original += primitive.original_stats;
+		mesh_optimization_stats.optimized += primitive.optimized_stats;
+	}
+
+	if (mesh_optimization_stats.original.triangle_count > 0)
+	{
+		LOGI("Optimized {} triangles: ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}",
+		     mesh_optimization_stats.original.triangle_count,
+		     mesh_optimization_stats.original.get_acmr(),
+		     mesh_optimization_stats.optimized.get_acmr(),
+		     mesh_optimization_stats.original.get_atvr(),
+		     mesh_optimization_stats.optimized.get_atvr());
+	}
+
+	// Positions are quantized relative to the bounds of their mesh, so that all submeshes of a
+	// node decode them with the same offset and scale
+	if (vertex_quantization && !primitive_futures.empty())
+	{
+		size_t original_size{0};
+		size_t quantized_size{0};
+
+		auto primitive_it = primitives.begin();
+
+		for (auto &gltf_mesh : model.meshes)
+		{
+			auto mesh_primitives_end = primitive_it + gltf_mesh.primitives.size();
+
+			glm::vec3 min_position{std::numeric_limits<float>::max()};
+			glm::vec3 max_position{std::numeric_limits<float>::lowest()};
+
+			for (auto it = primitive_it; it != mesh_primitives_end; ++it)
+			{
+				min_position = glm::min(min_position, it->min_position);
+				max_position = glm::max(max_position, it->max_position);
+			}
+
+			for (; primitive_it != mesh_primitives_end; ++primitive_it)
+			{
+				for (auto &it : primitive_it->vertex_data)
+				{
+					original_size += it.second.size();
+				}
+
+				quantize_primitive(*primitive_it, min_position, max_position);
+
+				for (auto &it : primitive_it->vertex_data)
+				{
+					quantized_size += it.second.size();
+				}
+			}
+		}
+
+		LOGI("Quantized vertex data from {} to {} bytes", original_size, quantized_size);
+	}
+
+	if (!bake_file.empty())
+	{
+		bake_scene(bake_file, primitives);
+		bake_file.clear();
+	}
+
+	if (shared_geometry_buffers)
+	{
+		create_shared_geometry_buffers(primitives);
+	}
+	else
+	{
+		// Primitives that already got their buffers have no data left, so this only uploads the kept ones
+		for (auto &primitive : primitives)
+		{
+			create_geometry_buffers(primitive);
+		}
+	}
+
+	auto primitive_it = primitives.begin();
+
+	for (auto &gltf_mesh : model.meshes)
+	{
+		auto mesh = parse_mesh(gltf_mesh);
+
+		glm::vec3 min_position{std::numeric_limits<float>::max()};
+		glm::vec3 max_position{std::numeric_limits<float>::lowest()};
+
+		for (auto &gltf_primitive : gltf_mesh.primitives)
+		{
+			min_position = glm::min(min_position, primitive_it->min_position);
+			max_position = glm::max(max_position, primitive_it->max_position);
+
+			auto submesh = std::move((primitive_it++)->submesh);
+
+			auto material_index = gltf_primitive.material;
+
+			if (material_index < 0)
+			{
+				submesh->set_material(*default_material);
+			}
+			else
+			{
+				submesh->set_material(*materials.at(material_index));
+			}
+
+			mesh->add_submesh(*submesh);
+
+			scene.add_component(std::move(submesh));
+		}
+
+		if (glm::all(glm::lessThanEqual(min_position, max_position)))
+		{
+			mesh->update_bounds({min_position, max_position});
+		}
+
+		scene.add_component(std::move(mesh));
+	}
+
+	scene.add_component(std::move(default_material));
+
+	// Load cameras
+	for (auto &gltf_camera : model.cameras)
+	{
+		auto camera = parse_camera(gltf_camera);
+		scene.add_component(std::move(camera));
+	}
+
+	// Load nodes
+	auto meshes = scene.get_components<sg::Mesh>();
+
+	std::vector<std::unique_ptr<sg::Node>> nodes;
+
+	for (size_t node_index = 0; node_index < model.nodes.size(); ++node_index)
+	{
+		auto gltf_node = model.nodes[node_index];
+		auto node      = parse_node(gltf_node, node_index);
+
+		if (gltf_node.mesh >= 0)
+		{
+			auto mesh = meshes.at(gltf_node.mesh);
+
+			node->set_component(*mesh);
+
+			mesh->add_node(*node);
+		}
+
+		if (gltf_node.camera >= 0)
+		{
+			auto cameras = scene.get_components<sg::Camera>();
+			auto camera  = cameras.at(gltf_node.camera);
+
+			node->set_component(*camera);
+
+			camera->set_node(*node);
+		}
+
+		if (auto extension = get_extension(gltf_node.extensions, KHR_LIGHTS_PUNCTUAL_EXTENSION))
+		{
+			auto lights = scene.get_components<sg::Light>();
+			auto light  = lights.at(static_cast<size_t>(extension->Get("light").Get<int>()));
+
+			node->set_component(*light);
+
+			light->set_node(*node);
+		}
+
+		nodes.push_back(std::move(node));
+	}
+
+	// Load scenes
+	std::queue<std::pair<sg::Node &, int>> traverse_nodes;
+
+	tinygltf::Scene *gltf_scene{nullptr};
+
+	if (scene_index >= 0 && scene_index < static_cast<int>(model.scenes.size()))
+	{
+		gltf_scene = &model.scenes[scene_index];
+	}
+	else if (model.defaultScene >= 0 && model.defaultScene < static_cast<int>(model.scenes.size()))
+	{
+		gltf_scene = &model.scenes[model.defaultScene];
+	}
+	else if (model.scenes.size() > 0)
+	{
+		gltf_scene = &model.scenes[0];
+	}
+
+	if (!gltf_scene)
+	{
+		throw std::runtime_error("Couldn't determine which scene to load!");
+	}
+
+	auto root_node = std::make_unique<sg::Node>(0, gltf_scene->name);
+
+	for (auto node_index : gltf_scene->nodes)
+	{
+		traverse_nodes.push(std::make_pair(std::ref(*root_node), node_index));
+	}
+
+	while (!traverse_nodes.empty())
+	{
+		auto node_it = traverse_nodes.front();
+		traverse_nodes.pop();
+
+		auto &current_node       = *nodes.at(node_it.second);
+		auto &traverse_root_node = node_it.first;
+
+		current_node.set_parent(traverse_root_node);
+		traverse_root_node.add_child(current_node);
+
+		for (auto child_node_index : model.nodes[node_it.second].children)
+		{
+			traverse_nodes.push(std::make_pair(std::ref(current_node), child_node_index));
+		}
+	}
+
+	scene.set_root_node(*root_node);
+	nodes.push_back(std::move(root_node));
+
+	// Store nodes into the scene
+	scene.set_nodes(std::move(nodes));
+
+	// Create node for the default camera
+	auto camera_node = std::make_unique<sg::Node>(-1, "default_camera");
+
+	auto default_camera = create_default_camera();
+	default_camera->set_node(*camera_node);
+	camera_node->set_component(*default_camera);
+	scene.add_component(std::move(default_camera));
+
+	scene.get_root_node().add_child(*camera_node);
+	scene.add_node(std::move(camera_node));
+
+	if (!scene.has_component<vkb::sg::Light>())
+	{
+		// Add a default light if none are present
+		vkb::add_directional_light(scene, glm::quat({glm::radians(-90.0f), 0.0f, glm::radians(30.0f)}));
+	}
+
+	return scene;
+}
+
+GLTFLoader::PrimitiveData GLTFLoader::load_primitive(const tinygltf::Primitive &gltf_primitive, bool create_buffers) const
+{
+	PrimitiveData primitive;
+	primitive.submesh = std::make_unique<sg::SubMesh>();
+
+	auto &submesh = primitive.submesh;
+
+	for (auto &attribute : gltf_primitive.attributes)
+	{
+		std::string attrib_name = attribute.first;
+		std::transform(attrib_name.begin(), attrib_name.end(), attrib_name.begin(), ::tolower);
+
+		auto vertex_data = get_attribute_data(&model, attribute.second);
+
+		if (attrib_name == "position")
+		{
+			submesh->vertices_count = to_u32(model.accessors.at(attribute.second).count);
+		}
+
+		sg::VertexAttribute attrib;
+		attrib.format = get_attribute_format(&model, attribute.second);
+		attrib.stride = to_u32(get_attribute_stride(&model, attribute.second));
+
+		submesh->set_attribute(attrib_name, attrib);
+
+		primitive.vertex_data[attrib_name] = std::move(vertex_data);
+	}
+
+	if (gltf_primitive.indices >= 0)
+	{
+		submesh->vertex_indices = to_u32(get_attribute_size(&model, gltf_primitive.indices));
+
+		auto format = get_attribute_format(&model, gltf_primitive.indices);
+
+		auto index_data = get_attribute_data(&model, gltf_primitive.indices);
+
+		switch (format)
+		{
+			case VK_FORMAT_R8_UINT:
+				// Converts uint8 data into uint16 data, still represented by a uint8 vector
+				index_data          = convert_underlying_data_stride(index_data, 1, 2);
+				submesh->index_type = VK_INDEX_TYPE_UINT16;
+				break;
+			case VK_FORMAT_R16_UINT:
+				submesh->index_type = VK_INDEX_TYPE_UINT16;
+				break;
+			case VK_FORMAT_R32_UINT:
+				submesh->index_type = VK_INDEX_TYPE_UINT32;
+				break;
+			default:
+				LOGE("gltf primitive has invalid format type");
+				break;
+		}
+
+		primitive.index_data = std::move(index_data);
+	}
+	else
+	{
+		submesh->vertices_count = to_u32(get_attribute_size(&model, gltf_primitive.attributes.at("POSITION")));
+	}
+
+	if (mesh_optimization && gltf_primitive.mode == TINYGLTF_MODE_TRIANGLES)
+	{
+		optimize_primitive(primitive);
+	}
+
+	if (lod_count > 0 && gltf_primitive.mode == TINYGLTF_MODE_TRIANGLES)
+	{
+		generate_lods(primitive);
+	}
+
+	sg::VertexAttribute position_attribute;
+	auto                position_data = primitive.vertex_data.find("position");
+
+	if (position_data != primitive.vertex_data.end() && submesh->get_attribute("position", position_attribute) &&
+	    (position_attribute.format == VK_FORMAT_R32G32B32_SFLOAT || position_attribute.format == VK_FORMAT_R32G32B32A32_SFLOAT) &&
+	    position_data->second.size() >= static_cast<size_t>(submesh->vertices_count) * position_attribute.stride)
+	{
+		for (size_t vertex = 0; vertex < submesh->vertices_count; ++vertex)
+		{
+			glm::vec3 position;
+			std::memcpy(&position, position_data->second.data() + vertex * position_attribute.stride, sizeof(position));
+
+			primitive.min_position = glm::min(primitive.min_position, position);
+			primitive.max_position = glm::max(primitive.max_position, position);
+		}
+	}
+
+	if (create_buffers)
+	{
+		create_geometry_buffers(primitive);
+	}
+
+	return primitive;
+}
+
+void GLTFLoader::optimize_primitive(PrimitiveData &primitive) const
+{
+	auto &submesh = *primitive.submesh;
+
+	size_t vertex_count = submesh.vertices_count;
+
+	// Vertices can only be moved if every attribute holds one element per vertex
+	for (auto &it : primitive.vertex_data)
+	{
+		sg::VertexAttribute attribute;
+		submesh.get_attribute(it.first, attribute);
+
+		if (attribute.stride == 0 || it.second.size() != vertex_count * attribute.stride)
+		{
+			LOGW("Not optimizing primitive, attribute {} doesn't match its vertex count", it.first);
+			return;
+		}
+	}
+
+	bool indexed = !primitive.index_data.empty();
+
+	std::vector<uint32_t> indices;
+
+	if (indexed)
+	{
+		indices = unpack_indices(primitive.index_data, submesh.index_type);
+	}
+	else if (deduplicate_vertices)
+	{
+		indices.resize(vertex_count);
+		std::iota(indices.begin(), indices.end(), 0U);
+	}
+	else
+	{
+		// Without indices there is nothing to reorder
+		return;
+	}
+
+	if (indices.size() < 3 || indices.size() % 3 != 0 || *std::max_element(indices.begin(), indices.end()) >= vertex_count)
+	{
+		LOGW("Not optimizing primitive, it isn't a valid triangle list");
+		return;
+	}
+
+	primitive.original_stats = analyze_vertex_cache(indices, vertex_count);
+
+	auto remap_all_vertices = [&](const std::vector<uint32_t> &remap, size_t new_vertex_count) {
+		remap_indices(indices, remap);
+
+		for (auto &it : primitive.vertex_data)
+		{
+			sg::VertexAttribute attribute;
+			submesh.get_attribute(it.first, attribute);
+
+			remap_vertices(it.second, attribute.stride, remap, new_vertex_count);
+		}
+
+		vertex_count = new_vertex_count;
+	};
+
+	std::vector<uint32_t> remap;
+
+	if (deduplicate_vertices)
+	{
+		std::vector<VertexStream> streams;
+		for (auto &it : primitive.vertex_data)
+		{
+			sg::VertexAttribute attribute;
+			submesh.get_attribute(it.first, attribute);
+
+			streams.push_back({it.second.data(), attribute.stride});
+		}
+
+		auto unique_vertex_count = generate_vertex_remap(remap, streams, vertex_count);
+
+		remap_all_vertices(remap, unique_vertex_count);
+	}
+
+	optimize_vertex_cache(indices, vertex_count);
+
+	sg::VertexAttribute position_attribute;
+	auto                position_data = primitive.vertex_data.find("position");
+
+	if (position_data != primitive.vertex_data.end() && submesh.get_attribute("position", position_attribute) &&
+	    (position_attribute.format == VK_FORMAT_R32G32B32_SFLOAT || position_attribute.format == VK_FORMAT_R32G32B32A32_SFLOAT))
+	{
+		optimize_overdraw(indices, {position_data->second.data(), position_attribute.stride}, vertex_count);
+	}
+
+	auto used_vertex_count = generate_vertex_fetch_remap(remap, indices, vertex_count);
+
+	remap_all_vertices(remap, used_vertex_count);
+
+	primitive.optimized_stats = analyze_vertex_cache(indices, vertex_count);
+
+	submesh.vertices_count = to_u32(vertex_count);
+	submesh.vertex_indices = to_u32(indices.size());
+
+	if (!indexed)
+	{
+		submesh.index_type = vertex_count <= std::numeric_limits<uint16_t>::max() + 1 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+	}
+
+	primitive.index_data = pack_indices(indices, submesh.index_type);
+}
+
+void GLTFLoader::generate_lods(PrimitiveData &primitive) const
+{
+	auto &submesh = *primitive.submesh;
+
+	sg::VertexAttribute position_attribute;
+	auto                position_data = primitive.vertex_data.find("position");
+
+	if (primitive.index_data.empty() || position_data == primitive.vertex_data.end() || !submesh.get_attribute("position", position_attribute) ||
+	    (position_attribute.format != VK_FORMAT_R32G32B32_SFLOAT && position_attribute.format != VK_FORMAT_R32G32B32A32_SFLOAT) ||
+	    position_data->second.size() < static_cast<size_t>(submesh.vertices_count) * position_attribute.stride)
+	{
+		return;
+	}
+
+	VertexStream positions{position_data->second.data(), position_attribute.stride};
+
+	auto indices = unpack_indices(primitive.index_data, submesh.index_type);
+
+	if (indices.size() % 3 != 0 || *std::max_element(indices.begin(), indices.end()) >= submesh.vertices_count)
+	{
+		return;
+	}
+
+	// Every level is simplified from the full detail indices, so that errors don't add up
+	auto all_indices = indices;
+
+	size_t previous_index_count = indices.size();
+
+	for (uint32_t lod = 0; lod < lod_count; ++lod)
+	{
+		size_t target_index_count = previous_index_count / 6 * 3;
+
+		float error       = 0.0f;
+		auto  lod_indices = simplify(indices, positions, submesh.vertices_count, target_index_count, lod_max_error, &error);
+
+		// Stop once the error limit keeps the mesh from getting meaningfully simpler
+		if (lod_indices.empty() || lod_indices.size() * 10 > previous_index_count * 9)
+		{
+			break;
+		}
+
+		if (mesh_optimization)
+		{
+			optimize_vertex_cache(lod_indices, submesh.vertices_count);
+		}
+
+		sg::SubMeshLod submesh_lod;
+		submesh_lod.first_index = to_u32(all_indices.size());
+		submesh_lod.index_count = to_u32(lod_indices.size());
+		submesh_lod.error       = error;
+
+		submesh.lods.push_back(submesh_lod);
+
+		all_indices.insert(all_indices.end(), lod_indices.begin(), lod_indices.end());
+
+		previous_index_count = lod_indices.size();
+	}
+
+	primitive.index_data = pack_indices(all_indices, submesh.index_type);
+}
+
+void GLTFLoader::quantize_primitive(PrimitiveData &primitive, const glm::vec3 &min_position, const glm::vec3 &max_position) const
+{
+	auto &submesh = *primitive.submesh;
+
+	size_t vertex_count = submesh.vertices_count;
+
+	// Flat axes of the bounds quantize to zero and decode to the minimum
+	glm::vec3 extent = max_position - min_position;
+	glm::vec3 inverse_extent{extent.x > 0.0f ? 1.0f / extent.x : 0.0f,
+	                         extent.y > 0.0f ? 1.0f / extent.y : 0.0f,
+	                         extent.z > 0.0f ? 1.0f / extent.z : 0.0f};
+
+	for (auto &it : primitive.vertex_data)
+	{
+		auto &name = it.first;
+
+		sg::VertexAttribute attribute;
+		submesh.get_attribute(name, attribute);
+
+		if (attribute.stride == 0 || it.second.size() < vertex_count * attribute.stride)
+		{
+			continue;
+		}
+
+		auto source = [&](size_t vertex) {
+			return it.second.data() + vertex * attribute.stride;
+		};
+
+		std::vector<uint32_t> packed;
+
+		if (name == "position" && (attribute.format == VK_FORMAT_R32G32B32_SFLOAT || attribute.format == VK_FORMAT_R32G32B32A32_SFLOAT))
+		{
+			attribute.format = VK_FORMAT_R16G16B16A16_UNORM;
+			attribute.stride = 8;
+
+			packed.resize(vertex_count * 2);
+
+			for (size_t vertex = 0; vertex < vertex_count; ++vertex)
+			{
+				glm::vec3 position;
+				std::memcpy(&position, source(vertex), sizeof(position));
+
+				glm::vec3 normalized = glm::clamp((position - min_position) * inverse_extent, 0.0f, 1.0f);
+
+				packed[vertex * 2]     = glm::packUnorm2x16(glm::vec2{normalized.x, normalized.y});
+				packed[vertex * 2 + 1] = glm::packUnorm2x16(glm::vec2{normalized.z, 0.0f});
+			}
+		}
+		else if (name == "normal" && attribute.format == VK_FORMAT_R32G32B32_SFLOAT)
+		{
+			attribute.format = VK_FORMAT_R16G16_SNORM;
+			attribute.stride = 4;
+
+			packed.resize(vertex_count);
+
+			for (size_t vertex = 0; vertex < vertex_count; ++vertex)
+			{
+				glm::vec3 normal;
+				std::memcpy(&normal, source(vertex), sizeof(normal));
+
+				packed[vertex] = glm::packSnorm2x16(encode_octahedral(normal));
+			}
+		}
+		else if (name == "tangent" && attribute.format == VK_FORMAT_R32G32B32A32_SFLOAT)
+		{
+			attribute.format = VK_FORMAT_R16G16B16A16_SNORM;
+			attribute.stride = 8;
+
+			packed.resize(vertex_count * 2);
+
+			for (size_t vertex = 0; vertex < vertex_count; ++vertex)
+			{
+				glm::vec4 tangent;
+				std::memcpy(&tangent, source(vertex), sizeof(tangent));
+
+				packed[vertex * 2]     = glm::packSnorm2x16(glm::vec2{tangent.x, tangent.y});
+				packed[vertex * 2 + 1] = glm::packSnorm2x16(glm::vec2{tangent.z, tangent.w});
+			}
+		}
+		else if (name.compare(0, 9, "texcoord_") == 0 && attribute.format == VK_FORMAT_R32G32_SFLOAT)
+		{
+			// Coordinates that stay within the texture get the uniform precision of unorm16,
+			// repeating ones need the range of half floats
+			bool normalized = true;
+
+			for (size_t vertex = 0; vertex < vertex_count && normalized; ++vertex)
+			{
+				glm::vec2 texcoord;
+				std::memcpy(&texcoord, source(vertex), sizeof(texcoord));
+
+				normalized = glm::all(glm::greaterThanEqual(texcoord, glm::vec2{0.0f})) && glm::all(glm::lessThanEqual(texcoord, glm::vec2{1.0f}));
+			}
+
+			attribute.format = normalized ? VK_FORMAT_R16G16_UNORM : VK_FORMAT_R16G16_SFLOAT;
+			attribute.stride = 4;
+
+			packed.resize(vertex_count);
+
+			for (size_t vertex = 0; vertex < vertex_count; ++vertex)
+			{
+				glm::vec2 texcoord;
+				std::memcpy(&texcoord, source(vertex), sizeof(texcoord));
+
+				packed[vertex] = normalized ? glm::packUnorm2x16(texcoord) : glm::packHalf2x16(texcoord);
+			}
+		}
+		else
+		{
+			continue;
+		}
 
-	command_buffer.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, 0);
+		attribute.offset = 0;
 
-	for (size_t image_index = 0; image_index < image_count; image_index++)
-	{
-		auto &image = image_components.at(image_index);
+		submesh.set_attribute(name, attribute);
 
-		core::Buffer stage_buffer{device,
-		                          image->get_data().size(),
-		                          VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		                          VMA_MEMORY_USAGE_CPU_ONLY};
+		it.second.resize(packed.size() * sizeof(uint32_t));
+		std::memcpy(it.second.data(), packed.data(), it.second.size());
+	}
+}
 
-		stage_buffer.update(image->get_data());
+uint64_t GLTFLoader::get_primitive_options() const
+{
+	uint32_t flags = (mesh_optimization ? 1U : 0U) | (mesh_optimization && deduplicate_vertices ? 2U : 0U) | (vertex_quantization ? 4U : 0U);
 
-		upload_image_to_gpu(command_buffer, stage_buffer, *image);
+	uint64_t hash = fnv1a_64(&flags, sizeof(flags));
+	hash          = fnv1a_64(&lod_count, sizeof(lod_count), hash);
 
-		transient_buffers.push_back(std::move(stage_buffer));
+	if (lod_count > 0)
+	{
+		hash = fnv1a_64(&lod_max_error, sizeof(lod_max_error), hash);
 	}
 
-	command_buffer.end();
+	return hash;
+}
 
-	auto &queue = device.get_queue_by_flags(VK_QUEUE_GRAPHICS_BIT, 0);
+void GLTFLoader::create_shared_geometry_buffers(std::vector<PrimitiveData> &primitives) const
+{
+	// Each primitive gets the same base vertex in every vertex buffer, so that a single draw
+	// offset addresses all its attributes. Primitives are grouped by the attributes they have,
+	// and every group packs its vertices into buffers of its own, keyed by attribute name and
+	// stride. An attribute that only some primitives have then takes no space for the others.
+	using AttributeKey = std::pair<std::string, uint32_t>;
 
-	queue.submit(command_buffer, device.request_fence());
+	struct VertexGroup
+	{
+		uint32_t vertex_count{0};
 
-	device.get_fence_pool().wait();
-	device.get_fence_pool().reset();
-	device.get_command_pool().reset_pool();
-	device.wait_idle();
+		std::map<AttributeKey, VkDeviceSize> buffer_sizes;
 
-	transient_buffers.clear();
+		std::map<AttributeKey, std::shared_ptr<core::Buffer>> buffers;
+	};
 
-	scene.set_components(std::move(image_components));
+	std::map<std::vector<AttributeKey>, VertexGroup> vertex_groups;
+	std::vector<VertexGroup *>                       primitive_groups;
+	std::map<VkIndexType, VkDeviceSize>              index_buffer_sizes;
 
-	auto elapsed_time = timer.stop();
+	for (auto &primitive : primitives)
+	{
+		auto &submesh = *primitive.submesh;
 
-	LOGI("Time spent loading images: {} seconds across {} threads.", vkb::to_string(elapsed_time), thread_count);
+		std::vector<AttributeKey> attributes;
 
-	// Load textures
-	auto images          = scene.get_components<sg::Image>();
-	auto samplers        = scene.get_components<sg::Sampler>();
-	auto default_sampler = create_default_sampler();
+		for (auto &it : primitive.vertex_data)
+		{
+			sg::VertexAttribute attribute;
+			submesh.get_attribute(it.first, attribute);
 
-	for (auto &gltf_texture : model.textures)
-	{
-		auto texture = parse_texture(gltf_texture);
+			attributes.emplace_back(it.first, attribute.stride);
+		}
 
-		texture->set_image(*images.at(gltf_texture.source));
+		std::sort(attributes.begin(), attributes.end());
 
-		if (gltf_texture.sampler >= 0 && gltf_texture.sampler < static_cast<int>(samplers.size()))
+		auto &group = vertex_groups[attributes];
+		primitive_groups.push_back(&group);
+
+		submesh.base_vertex = static_cast<int32_t>(group.vertex_count);
+
+		for (auto &it : primitive.vertex_data)
 		{
-			texture->set_sampler(*samplers.at(gltf_texture.sampler));
+			sg::VertexAttribute attribute;
+			submesh.get_attribute(it.first, attribute);
+
+			auto &size = group.buffer_sizes[std::make_pair(it.first, attribute.stride)];
+			size       = std::max(size, VkDeviceSize{group.vertex_count} * attribute.stride + static_cast<VkDeviceSize>(it.second.size()));
 		}
-		else
+
+		if (!primitive.index_data.empty())
 		{
-			if (gltf_texture.name.empty())
-			{
-				gltf_texture.name = images.at(gltf_texture.source)->get_name();
-			}
+			auto &size = index_buffer_sizes[submesh.index_type];
 
-			texture->set_sampler(*default_sampler);
+			submesh.first_index = to_u32(size / (submesh.index_type == VK_INDEX_TYPE_UINT16 ? 2 : 4));
+
+			size += primitive.index_data.size();
 		}
 
-		scene.add_component(std::move(texture));
+		group.vertex_count += submesh.vertices_count;
 	}
 
-	scene.add_component(std::move(default_sampler));
+	size_t vertex_buffer_count = 0;
 
-	// Load materials
-	bool                            has_textures = scene.has_component<sg::Texture>();
-	std::vector<vkb::sg::Texture *> textures;
-	if (has_textures)
+	for (auto &group_it : vertex_groups)
 	{
-		textures = scene.get_components<sg::Texture>();
+		for (auto &it : group_it.second.buffer_sizes)
+		{
+			group_it.second.buffers[it.first] = std::make_shared<core::Buffer>(device, it.second, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_TO_CPU);
+		}
+
+		vertex_buffer_count += group_it.second.buffers.size();
 	}
 
-	for (auto &gltf_material : model.materials)
+	std::map<VkIndexType, std::shared_ptr<core::Buffer>> index_buffers;
+	for (auto &it : index_buffer_sizes)
 	{
-		auto material = parse_material(gltf_material);
+		index_buffers[it.first] = std::make_shared<core::Buffer>(device, it.second, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_TO_CPU);
+	}
 
-		for (auto &gltf_value : gltf_material.values)
+	for (size_t i = 0; i < primitives.size(); ++i)
+	{
+		auto &primitive = primitives[i];
+		auto &submesh   = *primitive.submesh;
+
+		for (auto &it : primitive.vertex_data)
 		{
-			if (gltf_value.first.find("Texture") != std::string::npos)
-			{
-				std::string tex_name = to_snake_case(gltf_value.first);
+			sg::VertexAttribute attribute;
+			submesh.get_attribute(it.first, attribute);
 
-				material->textures[tex_name] = textures.at(gltf_value.second.TextureIndex());
-			}
+			auto &buffer = primitive_groups[i]->buffers.at(std::make_pair(it.first, attribute.stride));
+			buffer->update(it.second, static_cast<size_t>(submesh.base_vertex) * attribute.stride);
+
+			submesh.shared_vertex_buffers[it.first] = buffer;
 		}
 
-		for (auto &gltf_value : gltf_material.additionalValues)
+		if (!primitive.index_data.empty())
 		{
-			if (gltf_value.first.find("Texture") != std::string::npos)
-			{
-				std::string tex_name = to_snake_case(gltf_value.first);
+			auto &buffer = index_buffers.at(submesh.index_type);
+			buffer->update(primitive.index_data, submesh.first_index * (submesh.index_type == VK_INDEX_TYPE_UINT16 ? 2 : 4));
 
-				material->textures[tex_name] = textures.at(gltf_value.second.TextureIndex());
-			}
+			submesh.shared_index_buffer = buffer;
 		}
 
-		scene.add_component(std::move(material));
+		primitive.vertex_data.clear();
+		primitive.index_data.clear();
 	}
 
-	auto default_material = create_default_material();
+	LOGI("Packed {} primitives into {} vertex and {} index buffers", primitives.size(), vertex_buffer_count, index_buffers.size());
+}
 
-	// Load meshes
-	auto materials = scene.get_components<sg::PBRMaterial>();
+void GLTFLoader::create_geometry_buffers(PrimitiveData &primitive) const
+{
+	auto &submesh = *primitive.submesh;
 
-	for (auto &gltf_mesh : model.meshes)
+	for (auto &it : primitive.vertex_data)
 	{
-		auto mesh = parse_mesh(gltf_mesh);
+		core::Buffer buffer{device,
+		                    it.second.size(),
+		                    VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+		                    VMA_MEMORY_USAGE_GPU_TO_CPU};
+		buffer.update(it.second);
 
-		for (auto &gltf_primitive : gltf_mesh.primitives)
-		{
-			auto submesh = std::make_unique<sg::SubMesh>();
+		submesh.vertex_buffers.insert(std::make_pair(it.first, std::move(buffer)));
+	}
 
-			for (auto &attribute : gltf_primitive.attributes)
-			{
-				std::string attrib_name = attribute.first;
-				std::transform(attrib_name.begin(), attrib_name.end(), attrib_name.begin(), ::tolower);
+	if (!primitive.index_data.empty())
+	{
+		submesh.index_buffer = std::make_unique<core::Buffer>(device,
+		                                                      primitive.index_data.size(),
+		                                                      VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+		                                                      VMA_MEMORY_USAGE_GPU_TO_CPU);
 
-				auto vertex_data = get_attribute_data(&model, attribute.second);
+		submesh.index_buffer->update(primitive.index_data);
+	}
 
-				if (attrib_name == "position")
-				{
-					submesh->vertices_count = to_u32(model.accessors.at(attribute.second).count);
-				}
+	primitive.vertex_data.clear();
+	primitive.index_data.clear();
+}
+
+bool GLTFLoader::load_baked_scene(const std::string &baked_file)
+{
+	if (!vkb::fs::is_file(baked_file))
+	{
+		return false;
+	}
 
-				core::Buffer buffer{device,
-				                    vertex_data.size(),
-				                    VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-				                    VMA_MEMORY_USAGE_GPU_TO_CPU};
-				buffer.update(vertex_data);
+	// The file is mapped, and the geometry is copied from it straight into buffers
+	std::unique_ptr<vkb::fs::MappedFile> blob;
 
-				submesh->vertex_buffers.insert(std::make_pair(attrib_name, std::move(buffer)));
+	try
+	{
+		blob = std::make_unique<vkb::fs::MappedFile>(baked_file);
+	}
+	catch (const std::exception &e)
+	{
+		LOGW("Cannot read baked scene {}: {}", baked_file, e.what());
+		return false;
+	}
 
-				sg::VertexAttribute attrib;
-				attrib.format = get_attribute_format(&model, attribute.second);
-				attrib.stride = to_u32(get_attribute_stride(&model, attribute.second));
+	MemoryStreamBuffer buffer;
+	buffer.set(blob->data(), blob->size());
 
-				submesh->set_attribute(attrib_name, attrib);
-			}
+	std::istream stream{&buffer};
 
-			if (gltf_primitive.indices >= 0)
-			{
-				submesh->vertex_indices = to_u32(get_attribute_size(&model, gltf_primitive.indices));
+	uint32_t magic{0};
+	uint32_t version{0};
+	uint64_t payload_size{0};
 
-				auto format = get_attribute_format(&model, gltf_primitive.indices);
+	read(stream, magic, version, payload_size);
 
-				auto vertex_data = get_attribute_data(&model, gltf_primitive.indices);
-				auto index_data  = get_attribute_data(&model, gltf_primitive.indices);
+	// Reject truncated files, for example from a run that was killed mid-write
+	if (!stream || magic != baked_scene_magic || version != baked_scene_version || payload_size != blob->size() - baked_scene_header_size)
+	{
+		LOGW("Ignoring invalid baked scene {}", baked_file);
+		return false;
+	}
 
-				switch (format)
-				{
-					case VK_FORMAT_R8_UINT:
-						// Converts uint8 data into uint16 data, still represented by a uint8 vector
-						index_data          = convert_underlying_data_stride(index_data, 1, 2);
-						submesh->index_type = VK_INDEX_TYPE_UINT16;
-						break;
-					case VK_FORMAT_R16_UINT:
-						submesh->index_type = VK_INDEX_TYPE_UINT16;
-						break;
-					case VK_FORMAT_R32_UINT:
-						submesh->index_type = VK_INDEX_TYPE_UINT32;
-						break;
-					default:
-						LOGE("gltf primitive has invalid format type");
-						break;
-				}
+	try
+	{
+		std::size_t source_count;
+		read(stream, source_count);
 
-				submesh->index_buffer = std::make_unique<core::Buffer>(device,
-				                                                       index_data.size(),
-				                                                       VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-				                                                       VMA_MEMORY_USAGE_GPU_TO_CPU);
+		for (size_t source_index = 0; source_index < source_count && stream; ++source_index)
+		{
+			std::string source;
+			uint64_t    size{0};
+			int64_t     modification_time{0};
 
-				submesh->index_buffer->update(index_data);
-			}
-			else
-			{
-				submesh->vertices_count = to_u32(get_attribute_size(&model, gltf_primitive.attributes.at("POSITION")));
-			}
+			read(stream, source, size, modification_time);
 
-			if (gltf_primitive.material < 0)
-			{
-				submesh->set_material(*default_material);
-			}
-			else
+			uint64_t current_size{0};
+			int64_t  current_modification_time{0};
+
+			if (!get_file_stamp(source, current_size, current_modification_time) || current_size != size || current_modification_time != modification_time)
 			{
-				submesh->set_material(*materials.at(gltf_primitive.material));
+				LOGI("Baked scene {} is out of date, {} has changed", baked_file, source);
+				return false;
 			}
-
-			mesh->add_submesh(*submesh);
-
-			scene.add_component(std::move(submesh));
 		}
 
-		scene.add_component(std::move(mesh));
-	}
+		uint64_t primitive_options;
+		read(stream, primitive_options);
 
-	device.get_fence_pool().wait();
-	device.get_fence_pool().reset();
-	device.get_command_pool().reset_pool();
+		if (primitive_options != get_primitive_options())
+		{
+			LOGI("Baked scene {} is out of date, it was baked with other mesh optimization, LOD or quantization options", baked_file);
+			return false;
+		}
 
-	transient_buffers.clear();
+		read_model(stream, model);
 
-	scene.add_component(std::move(default_material));
+		std::size_t primitive_count;
+		read(stream, primitive_count);
 
-	// Load cameras
-	for (auto &gltf_camera : model.cameras)
-	{
-		auto camera = parse_camera(gltf_camera);
-		scene.add_component(std::move(camera));
-	}
+		size_t mesh_primitive_count = 0;
+		for (auto &gltf_mesh : model.meshes)
+		{
+			mesh_primitive_count += gltf_mesh.primitives.size();
+		}
 
-	// Load nodes
-	auto meshes = scene.get_components<sg::Mesh>();
+		if (!stream || primitive_count != mesh_primitive_count)
+		{
+			throw std::runtime_error("Primitive count mismatch");
+		}
 
-	std::vector<std::unique_ptr<sg::Node>> nodes;
+		auto consume = [&](size_t size) {
+			auto data = buffer.consume(size);
+			if (!stream || !data)
+			{
+				throw std::runtime_error("Unexpected end of file");
+			}
+			return data;
+		};
 
-	for (size_t node_index = 0; node_index < model.nodes.size(); ++node_index)
-	{
-		auto gltf_node = model.nodes[node_index];
-		auto node      = parse_node(gltf_node, node_index);
+		baked_primitives.resize(primitive_count);
 
-		if (gltf_node.mesh >= 0)
+		for (auto &primitive : baked_primitives)
 		{
-			auto mesh = meshes.at(gltf_node.mesh);
+			primitive.submesh = std::make_unique<sg::SubMesh>();
 
-			node->set_component(*mesh);
+			auto &submesh = *primitive.submesh;
 
-			mesh->add_node(*node);
-		}
+			read(stream, submesh.vertices_count, submesh.vertex_indices, submesh.index_type, submesh.lods, primitive.min_position, primitive.max_position);
 
-		if (gltf_node.camera >= 0)
-		{
-			auto cameras = scene.get_components<sg::Camera>();
-			auto camera  = cameras.at(gltf_node.camera);
+			std::size_t attribute_count;
+			read(stream, attribute_count);
 
-			node->set_component(*camera);
+			for (size_t attribute_index = 0; attribute_index < attribute_count; ++attribute_index)
+			{
+				std::string         name;
+				sg::VertexAttribute attribute;
+				std::size_t         size;
 
-			camera->set_node(*node);
-		}
+				read(stream, name, attribute.format, attribute.stride, attribute.offset, size);
 
-		if (auto extension = get_extension(gltf_node.extensions, KHR_LIGHTS_PUNCTUAL_EXTENSION))
-		{
-			auto lights = scene.get_components<sg::Light>();
-			auto light  = lights.at(static_cast<size_t>(extension->Get("light").Get<int>()));
+				auto data = consume(size);
 
-			node->set_component(*light);
+				submesh.set_attribute(name, attribute);
 
-			light->set_node(*node);
-		}
+				if (shared_geometry_buffers)
+				{
+					primitive.vertex_data[name].assign(data, data + size);
+				}
+				else
+				{
+					core::Buffer vertex_buffer{device,
+					                           size,
+					                           VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+					                           VMA_MEMORY_USAGE_GPU_TO_CPU};
+					vertex_buffer.update(data, size);
 
-		nodes.push_back(std::move(node));
-	}
+					submesh.vertex_buffers.insert(std::make_pair(name, std::move(vertex_buffer)));
+				}
+			}
 
-	// Load scenes
-	std::queue<std::pair<sg::Node &, int>> traverse_nodes;
+			std::size_t index_size;
+			read(stream, index_size);
 
-	tinygltf::Scene *gltf_scene{nullptr};
+			if (index_size > 0)
+			{
+				auto data = consume(index_size);
 
-	if (scene_index >= 0 && scene_index < static_cast<int>(model.scenes.size()))
-	{
-		gltf_scene = &model.scenes[scene_index];
-	}
-	else if (model.defaultScene >= 0 && model.defaultScene < static_cast<int>(model.scenes.size()))
-	{
-		gltf_scene = &model.scenes[model.defaultScene];
+				if (shared_geometry_buffers)
+				{
+					primitive.index_data.assign(data, data + index_size);
+				}
+				else
+				{
+					submesh.index_buffer = std::make_unique<core::Buffer>(device,
+					                                                      index_size,
+					                                                      VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+					                                                      VMA_MEMORY_USAGE_GPU_TO_CPU);
+					submesh.index_buffer->update(data, index_size);
+				}
+			}
+		}
 	}
-	else if (model.scenes.size() > 0)
+	catch (const std::exception &e)
 	{
-		gltf_scene = &model.scenes[0];
+		LOGW("Ignoring invalid baked scene {}: {}", baked_file, e.what());
+
+		model = {};
+		baked_primitives.clear();
+
+		return false;
 	}
 
-	if (!gltf_scene)
+	return true;
+}
+
+void GLTFLoader::bake_scene(const std::string &baked_file, const std::vector<PrimitiveData> &primitives) const
+{
+	// Images are stored as references, so only images loaded from files can be baked
+	for (auto &gltf_image : model.images)
 	{
-		throw std::runtime_error("Couldn't determine which scene to load!");
+		if (gltf_image.uri.empty() || gltf_image.uri.compare(0, 5, "data:") == 0)
+		{
+			LOGW("Not baking scene, image {} is embedded in the glTF file", gltf_image.name);
+			return;
+		}
 	}
 
-	auto root_node = std::make_unique<sg::Node>(0, gltf_scene->name);
+	std::ostringstream payload;
 
-	for (auto node_index : gltf_scene->nodes)
+	write(payload, bake_sources.size());
+
+	for (auto &source : bake_sources)
 	{
-		traverse_nodes.push(std::make_pair(std::ref(*root_node), node_index));
+		uint64_t size{0};
+		int64_t  modification_time{0};
+
+		if (!get_file_stamp(source, size, modification_time))
+		{
+			LOGW("Not baking scene, couldn't find {}", source);
+			return;
+		}
+
+		write(payload, source, size, modification_time);
 	}
 
-	while (!traverse_nodes.empty())
+	write(payload, get_primitive_options());
+
+	write_model(payload, model);
+
+	write(payload, primitives.size());
+
+	for (auto &primitive : primitives)
 	{
-		auto node_it = traverse_nodes.front();
-		traverse_nodes.pop();
+		auto &submesh = *primitive.submesh;
 
-		auto &current_node       = *nodes.at(node_it.second);
-		auto &traverse_root_node = node_it.first;
+		write(payload, submesh.vertices_count, submesh.vertex_indices, submesh.index_type, submesh.lods, primitive.min_position, primitive.max_position);
 
-		current_node.set_parent(traverse_root_node);
-		traverse_root_node.add_child(current_node);
+		write(payload, primitive.vertex_data.size());
 
-		for (auto child_node_index : model.nodes[node_it.second].children)
+		for (auto &it : primitive.vertex_data)
 		{
-			traverse_nodes.push(std::make_pair(std::ref(current_node), child_node_index));
+			sg::VertexAttribute attribute;
+			submesh.get_attribute(it.first, attribute);
+
+			write(payload, it.first, attribute.format, attribute.stride, attribute.offset, it.second);
 		}
+
+		write(payload, primitive.index_data);
 	}
 
-	scene.set_root_node(*root_node);
-	nodes.push_back(std::move(root_node));
+	auto payload_data = payload.str();
 
-	// Store nodes into the scene
-	scene.set_nodes(std::move(nodes));
+	// Write to a per-thread file first, so that readers never see a partial scene
+	std::stringstream temp_file;
+	temp_file << baked_file << "." << std::this_thread::get_id() << ".tmp";
 
-	// Create node for the default camera
-	auto camera_node = std::make_unique<sg::Node>(-1, "default_camera");
+	{
+		std::ofstream file{temp_file.str(), std::ios::out | std::ios::binary | std::ios::trunc};
 
-	auto default_camera = create_default_camera();
-	default_camera->set_node(*camera_node);
-	camera_node->set_component(*default_camera);
-	scene.add_component(std::move(default_camera));
+		if (!file.is_open())
+		{
+			LOGW("Failed to write baked scene {}", baked_file);
+			return;
+		}
 
-	scene.get_root_node().add_child(*camera_node);
-	scene.add_node(std::move(camera_node));
+		uint64_t payload_size = payload_data.size();
 
-	if (!scene.has_component<vkb::sg::Light>())
+		file.write(reinterpret_cast<const char *>(&baked_scene_magic), sizeof(baked_scene_magic));
+		file.write(reinterpret_cast<const char *>(&baked_scene_version), sizeof(baked_scene_version));
+		file.write(reinterpret_cast<const char *>(&payload_size), sizeof(payload_size));
+		file.write(payload_data.data(), payload_data.size());
+	}
+
+	// Replace the out of date scene, if any
+	std::remove(baked_file.c_str());
+
+	if (std::rename(temp_file.str().c_str(), baked_file.c_str()) != 0)
 	{
-		// Add a default light if none are present
-		vkb::add_directional_light(scene, glm::quat({glm::radians(-90.0f), 0.0f, glm::radians(30.0f)}));
+		std::remove(temp_file.str().c_str());
+		return;
 	}
 
-	return scene;
+	LOGI("Baked scene to {}", baked_file);
 }
 
 std::unique_ptr<sg::SubMesh> GLTFLoader::load_model(uint32_t index)
@@ -1148,8 +2685,20 @@ std::unique_ptr<sg::Image> GLTFLoader::parse_image(tinygltf::Image &gltf_image)
 			LOGW("ASTC not supported: decoding {}", image->get_name());
 			image = std::make_unique<sg::Astc>(*image);
 			image->generate_mipmaps();
+
+			// Keep the image compressed on the GPU if it supports BCn, which takes 4 to 8 times less memory than RGBA8
+			if (device.is_image_format_supported(VK_FORMAT_BC1_RGB_SRGB_BLOCK) && device.is_image_format_supported(VK_FORMAT_BC3_SRGB_BLOCK) &&
+			    image->get_extent().depth == 1)
+			{
+				LOGI("Transcoding {} to BCn", image->get_name());
+				image = std::make_unique<sg::Bcn>(*image);
+			}
 		}
 	}
+	else if (mipmap_generation && image->get_mipmaps().size() == 1 && image->get_format() == VK_FORMAT_R8G8B8A8_UNORM)
+	{
+		image->generate_mipmaps(is_color_image(model, gltf_image));
+	}
 
 	image->create_vk_image(device);
 
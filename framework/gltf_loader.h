@@ -18,6 +18,7 @@
 
 #pragma once
 
+#include <limits>
 #include <memory>
 #include <mutex>
 
@@ -26,6 +27,7 @@
 #define TINYGLTF_NO_EXTERNAL_IMAGE
 #include <tiny_gltf.h>
 
+#include "geometry/mesh_optimizer.h"
 #include "timer.h"
 
 #define KHR_LIGHTS_PUNCTUAL_EXTENSION "KHR_lights_punctual"
@@ -63,6 +65,16 @@ struct TypeCast
 	}
 };
 
+/**
+ * @brief Vertex cache efficiency of the meshes of a scene, before and after mesh optimization
+ */
+struct MeshOptimizationStats
+{
+	VertexCacheStats original;
+
+	VertexCacheStats optimized;
+};
+
 /// Read a gltf file and return a scene object. Converts the gltf objects
 /// to our internal scene implementation. Mesh data is copied to vulkan buffers and
 /// images are loaded from the folder of gltf file to vulkan images.
@@ -81,6 +93,64 @@ class GLTFLoader
 	 */
 	std::unique_ptr<sg::SubMesh> read_model_from_file(const std::string &file_name, uint32_t index);
 
+	/**
+	 * @brief Sub-allocates the geometry of all submeshes from a few buffers shared by the
+	 *        whole scene, instead of creating buffers for every attribute of every submesh
+	 */
+	void set_shared_geometry_buffers(bool enable);
+
+	/**
+	 * @brief Enables the baked scene cache, off by default. A scene is baked the first time it is
+	 *        loaded, and later loads read the baked file instead of the glTF file while it is fresh.
+	 *        Baking keeps the data of every primitive until the scene is written, which raises the
+	 *        peak memory of the first load.
+	 */
+	void set_scene_cache(bool enable);
+
+	/**
+	 * @brief Enables optimizing the triangle lists of the scene before they are uploaded, off by default.
+	 *        Triangles are reordered for the post-transform vertex cache and to reduce overdraw,
+	 *        then vertices are reordered for fetch locality.
+	 * @param deduplicate_vertices Also merge identical vertices, which gives non-indexed primitives an index buffer
+	 */
+	void set_mesh_optimization(bool enable, bool deduplicate_vertices = false);
+
+	/**
+	 * @return The vertex cache efficiency of the primitives optimized while loading the last scene
+	 */
+	const MeshOptimizationStats &get_mesh_optimization_stats() const;
+
+	/**
+	 * @brief Enables generating simplified versions of every triangle list primitive, off by default.
+	 *        Each level aims for half the triangles of the previous one.
+	 * @param lod_count Largest number of levels to generate besides the full detail one
+	 * @param max_error Largest simplification error, relative to the size of the primitive
+	 */
+	void set_lod_generation(uint32_t lod_count, float max_error = 0.02f);
+
+	/**
+	 * @brief Enables storing vertex attributes in compact formats, off by default. Positions become
+	 *        16-bit values relative to the bounds of their mesh, normals octahedral snorm16 values,
+	 *        tangents snorm16 values and texture coordinates unorm16 or half floats.
+	 *        Quantized submeshes need shaders that handle the QUANTIZED_POSITION and OCTAHEDRAL_NORMAL defines.
+	 */
+	void set_vertex_quantization(bool enable);
+
+	/**
+	 * @brief Enables generating mip chains for images decoded without them, like PNG and JPEG images, off by default.
+	 *        Base color and emissive images are filtered as sRGB.
+	 */
+	void set_mipmap_generation(bool enable);
+
+	/**
+	 * @brief Enables texture streaming, off by default. Only the mip levels of an image that fit in resident_size
+	 *        texels are uploaded at load time, the image view starts at the finest of them and the image keeps
+	 *        its data, so that a TextureStreamer can upload the other levels later.
+	 * @param enable Whether images with mip chains are streamed
+	 * @param resident_size Largest width or height of the levels uploaded at load time
+	 */
+	void set_texture_streaming(bool enable, uint32_t resident_size = 128);
+
   protected:
 	virtual std::unique_ptr<sg::Node> parse_node(const tinygltf::Node &gltf_node, size_t index) const;
 
@@ -131,9 +201,110 @@ class GLTFLoader
 	/// The extensions that the GLTFLoader can load mapped to whether they should be enabled or not
 	static std::unordered_map<std::string, bool> supported_extensions;
 
+	bool shared_geometry_buffers{false};
+
+	bool scene_cache{false};
+
+	bool mesh_optimization{false};
+
+	bool deduplicate_vertices{false};
+
+	MeshOptimizationStats mesh_optimization_stats;
+
+	uint32_t lod_count{0};
+
+	float lod_max_error{0.02f};
+
+	bool vertex_quantization{false};
+
+	bool mipmap_generation{false};
+
+	bool texture_streaming{false};
+
+	uint32_t texture_streaming_resident_size{128};
+
   private:
 	sg::Scene load_scene(int scene_index = -1);
 
+	/// A primitive converted into a submesh, with the data waiting to be baked or placed in buffers
+	struct PrimitiveData
+	{
+		std::unique_ptr<sg::SubMesh> submesh;
+
+		std::unordered_map<std::string, std::vector<uint8_t>> vertex_data;
+
+		std::vector<uint8_t> index_data;
+
+		/// Bounds of the positions, in the space of the mesh
+		glm::vec3 min_position{std::numeric_limits<float>::max()};
+
+		glm::vec3 max_position{std::numeric_limits<float>::lowest()};
+
+		VertexCacheStats original_stats;
+
+		VertexCacheStats optimized_stats;
+	};
+
+	/**
+	 * @brief Converts the vertex and index data of a primitive into a submesh, without its material.
+	 *        Only reads the model, so primitives can be loaded concurrently.
+	 * @param create_buffers If true the submesh gets buffers of its own, otherwise the data
+	 *        is kept for create_shared_geometry_buffers or bake_scene
+	 */
+	PrimitiveData load_primitive(const tinygltf::Primitive &gltf_primitive, bool create_buffers) const;
+
+	/**
+	 * @brief Reorders the triangles and vertices of an unpacked triangle list primitive
+	 */
+	void optimize_primitive(PrimitiveData &primitive) const;
+
+	/**
+	 * @brief Appends simplified versions of the triangle list of an unpacked primitive to its indices
+	 */
+	void generate_lods(PrimitiveData &primitive) const;
+
+	/**
+	 * @brief Converts the float attributes of an unpacked primitive to compact formats
+	 * @param min_position Minimum of the bounds the positions are quantized relative to
+	 * @param max_position Maximum of the bounds the positions are quantized relative to
+	 */
+	void quantize_primitive(PrimitiveData &primitive, const glm::vec3 &min_position, const glm::vec3 &max_position) const;
+
+	/**
+	 * @return A hash of the options that change how primitives are converted, which a baked scene has to match
+	 */
+	uint64_t get_primitive_options() const;
+
+	/**
+	 * @brief Packs the geometry of all primitives into buffers shared by their submeshes
+	 */
+	void create_shared_geometry_buffers(std::vector<PrimitiveData> &primitives) const;
+
+	/**
+	 * @brief Moves the geometry of a primitive into buffers owned by its submesh
+	 */
+	void create_geometry_buffers(PrimitiveData &primitive) const;
+
+	/**
+	 * @brief Reads a baked scene into the model and baked_primitives
+	 * @return False if the file is missing, invalid or older than the files it was baked from
+	 */
+	bool load_baked_scene(const std::string &baked_file);
+
+	/**
+	 * @brief Writes the model and the converted primitives to a baked scene file
+	 */
+	void bake_scene(const std::string &baked_file, const std::vector<PrimitiveData> &primitives) const;
+
+	/// Primitives read from a baked scene, which load_scene uses instead of converting the model's accessors
+	std::vector<PrimitiveData> baked_primitives;
+
+	/// Where load_scene bakes the scene it loads, empty if it should not bake it
+	std::string bake_file;
+
+	/// Files the scene is loaded from, recorded in the baked scene to detect when it is out of date
+	std::vector<std::string> bake_sources;
+
 	std::unique_ptr<sg::SubMesh> load_model(uint32_t index);
 };
 }        // namespace vkb
@@ -17,6 +17,14 @@
 
 #include "platform/filesystem.h"
 
+#if defined(_WIN32)
+#	include <Windows.h>
+#else
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <unistd.h>
+#endif
+
 #include "common/error.h"
 
 VKBP_DISABLE_WARNINGS()
@@ -37,7 +45,10 @@ const std::unordered_map<Type, std::string> relative_paths = {{Type::Assets, "as
                                                               {Type::Storage, "output/"},
                                                               {Type::Screenshots, "output/images/"},
                                                               {Type::Logs, "output/logs/"},
-                                                              {Type::Graphs, "output/graphs/"}};
+                                                              {Type::Graphs, "output/graphs/"},
+                                                              {Type::ShaderCache, "output/shader_cache/"},
+                                                              {Type::SceneCache, "output/scene_cache/"},
+                                                              {Type::TextureCache, "output/texture_cache/"}};
 
 const std::string get(const Type type, const std::string &file)
 {
@@ -178,6 +189,121 @@ static void write_binary_file(const std::vector<uint8_t> &data, const std::strin
 	file.close();
 }
 
+MappedFile::MappedFile(const std::string &filename)
+{
+#if defined(_WIN32)
+	HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		throw std::runtime_error("Failed to open file: " + filename);
+	}
+
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size))
+	{
+		CloseHandle(file);
+		throw std::runtime_error("Failed to get the size of file: " + filename);
+	}
+
+	mapped_size = static_cast<size_t>(file_size.QuadPart);
+
+	// Empty files can't be mapped, and don't need to be
+	if (mapped_size > 0)
+	{
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+		// The view keeps the file mapped after its handles are closed
+		if (mapping)
+		{
+			mapped_data = static_cast<const uint8_t *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+			CloseHandle(mapping);
+		}
+
+		if (!mapped_data)
+		{
+			CloseHandle(file);
+			throw std::runtime_error("Failed to map file: " + filename);
+		}
+	}
+
+	CloseHandle(file);
+#else
+	int file = open(filename.c_str(), O_RDONLY);
+
+	if (file < 0)
+	{
+		throw std::runtime_error("Failed to open file: " + filename);
+	}
+
+	struct stat info;
+	if (fstat(file, &info) != 0)
+	{
+		close(file);
+		throw std::runtime_error("Failed to get the size of file: " + filename);
+	}
+
+	mapped_size = static_cast<size_t>(info.st_size);
+
+	// Empty files can't be mapped, and don't need to be
+	if (mapped_size > 0)
+	{
+		// The mapping keeps the file open after its descriptor is closed
+		void *mapping = mmap(nullptr, mapped_size, PROT_READ, MAP_PRIVATE, file, 0);
+
+		if (mapping == MAP_FAILED)
+		{
+			close(file);
+			throw std::runtime_error("Failed to map file: " + filename);
+		}
+
+		mapped_data = static_cast<const uint8_t *>(mapping);
+	}
+
+	close(file);
+#endif
+}
+
+MappedFile::MappedFile(MappedFile &&other) :
+    mapped_data{other.mapped_data},
+    mapped_size{other.mapped_size}
+{
+	other.mapped_data = nullptr;
+	other.mapped_size = 0;
+}
+
+MappedFile::~MappedFile()
+{
+	if (mapped_data)
+	{
+#if defined(_WIN32)
+		UnmapViewOfFile(mapped_data);
+#else
+		munmap(const_cast<uint8_t *>(mapped_data), mapped_size);
+#endif
+	}
+}
+
+const uint8_t *MappedFile::data() const
+{
+	return mapped_data;
+}
+
+size_t MappedFile::size() const
+{
+	return mapped_size;
+}
+
+MappedFile map_asset(const std::string &filename)
+{
+	return MappedFile{path::get(path::Type::Assets) + filename};
+}
+
+MappedFile map_temp(const std::string &filename)
+{
+	return MappedFile{path::get(path::Type::Temp) + filename};
+}
+
 std::vector<uint8_t> read_asset(const std::string &filename, const uint32_t count)
 {
 	return read_binary_file(path::get(path::Type::Assets) + filename, count);
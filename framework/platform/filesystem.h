@@ -42,6 +42,9 @@ enum Type
 	Screenshots,
 	Logs,
 	Graphs,
+	ShaderCache,
+	SceneCache,
+	TextureCache,
 	/* NewFolder */
 	TotalRelativePathTypes,
 
@@ -90,6 +93,59 @@ void create_directory(const std::string &path);
  */
 void create_path(const std::string &root, const std::string &path);
 
+/**
+ * @brief A read-only memory mapping of a whole file, which stays valid until the object is destroyed.
+ *        Reading through it avoids copying the file into a buffer first.
+ */
+class MappedFile
+{
+  public:
+	/**
+	 * @brief Maps a file into memory
+	 * @param filename The absolute path to the file
+	 * @throws runtime_error if the file can't be opened or mapped
+	 */
+	MappedFile(const std::string &filename);
+
+	MappedFile(const MappedFile &) = delete;
+
+	MappedFile(MappedFile &&other);
+
+	~MappedFile();
+
+	MappedFile &operator=(const MappedFile &) = delete;
+
+	MappedFile &operator=(MappedFile &&) = delete;
+
+	/**
+	 * @return The contents of the file, or nullptr if it is empty
+	 */
+	const uint8_t *data() const;
+
+	size_t size() const;
+
+  private:
+	const uint8_t *mapped_data{nullptr};
+
+	size_t mapped_size{0};
+};
+
+/**
+ * @brief Helper to map an asset file into memory
+ *
+ * @param filename The path to the file (relative to the assets directory)
+ * @return The mapping of the file
+ */
+MappedFile map_asset(const std::string &filename);
+
+/**
+ * @brief Helper to map a temporary file into memory
+ *
+ * @param filename The path to the file (relative to the temporary storage directory)
+ * @return The mapping of the file
+ */
+MappedFile map_temp(const std::string &filename);
+
 /**
  * @brief Helper to read an asset file into a byte-array
  *
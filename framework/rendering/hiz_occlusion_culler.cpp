@@ -0,0 +1,445 @@
+/* Copyright (c) 2021, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "rendering/hiz_occlusion_culler.h"
+
+#include "common/helpers.h"
+#include "common/logging.h"
+#include "core/command_buffer.h"
+#include "core/device.h"
+#include "rendering/postprocessing_computepass.h"
+#include "rendering/render_context.h"
+#include "rendering/render_target.h"
+#include "rendering/subpass.h"
+#include "scene_graph/components/camera.h"
+#include "scene_graph/components/mesh.h"
+#include "scene_graph/components/sub_mesh.h"
+#include "scene_graph/node.h"
+#include "scene_graph/scene.h"
+
+namespace vkb
+{
+namespace
+{
+/// Matches the DrawCommand of the culling shader
+constexpr VkDeviceSize draw_command_size{sizeof(VkDrawIndexedIndirectCommand)};
+
+struct CullRegisters
+{
+	glm::mat4 view_proj;
+
+	glm::uvec2 pyramid_resolution;
+
+	uint32_t level_count;
+
+	uint32_t draw_count;
+};
+
+struct ReduceRegisters
+{
+	glm::uvec2 resolution;
+
+	glm::uvec2 input_resolution;
+};
+}        // namespace
+
+const RenderTarget::CreateFunc HiZOcclusionCuller::CREATE_RENDER_TARGET_FUNC = [](core::Image &&swapchain_image) -> std::unique_ptr<RenderTarget> {
+	auto &device = swapchain_image.get_device();
+
+	// The depth is read back after the render pass, so it can be neither transient nor have a stencil aspect
+	VkFormat depth_format = get_suitable_depth_format(device.get_gpu().get_handle(), true);
+
+	core::Image depth_image{device, swapchain_image.get_extent(),
+	                        depth_format,
+	                        VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+	                        VMA_MEMORY_USAGE_GPU_ONLY};
+
+	std::vector<core::Image> images;
+	images.push_back(std::move(swapchain_image));
+	images.push_back(std::move(depth_image));
+
+	return std::make_unique<RenderTarget>(std::move(images));
+};
+
+HiZOcclusionCuller::HiZOcclusionCuller(RenderContext &render_context, sg::Scene &scene, sg::Camera &camera, uint32_t depth_attachment) :
+    render_context{render_context},
+    scene{scene},
+    camera{camera},
+    depth_attachment{depth_attachment},
+    cull_shader{"hiz_occlusion/occlusion_cull.comp"}
+{
+	// Levels are read texel by texel, the sampler only has to reach all of them
+	VkSamplerCreateInfo sampler_info{VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO};
+	sampler_info.minFilter    = VK_FILTER_NEAREST;
+	sampler_info.magFilter    = VK_FILTER_NEAREST;
+	sampler_info.mipmapMode   = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	sampler_info.minLod       = 0.0f;
+	sampler_info.maxLod       = VK_LOD_CLAMP_NONE;
+
+	pyramid_sampler = std::make_unique<core::Sampler>(render_context.get_device(), sampler_info);
+}
+
+void HiZOcclusionCuller::cull(CommandBuffer &command_buffer)
+{
+	culling_active = false;
+	node_slots.clear();
+
+	if (!supported || !pyramid_valid)
+	{
+		return;
+	}
+
+	auto &bvh = scene.get_bvh();
+
+	size_t slot_count = 0;
+
+	for (uint32_t i = 0; i < to_u32(bvh.size()); ++i)
+	{
+		slot_count += bvh.get_instance(i).second->get_submeshes().size();
+	}
+
+	if (slot_count == 0)
+	{
+		return;
+	}
+
+	if (frame_resources.size() < render_context.get_render_frames().size())
+	{
+		frame_resources.resize(render_context.get_render_frames().size());
+	}
+
+	auto &frame  = frame_resources[render_context.get_active_frame_index()];
+	auto &device = render_context.get_device();
+
+	if (frame.capacity < slot_count)
+	{
+		// Leave room for the scene to grow a little before the buffers are created again
+		frame.capacity = slot_count + slot_count / 2;
+
+		frame.bounds_buffer = std::make_unique<core::Buffer>(device,
+		                                                     frame.capacity * 2 * sizeof(glm::vec4),
+		                                                     VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		                                                     VMA_MEMORY_USAGE_CPU_TO_GPU);
+
+		frame.draw_buffer = std::make_unique<core::Buffer>(device,
+		                                                   frame.capacity * draw_command_size,
+		                                                   VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+		                                                   VMA_MEMORY_USAGE_CPU_TO_GPU);
+	}
+
+	auto &bounds = frame.bounds;
+	auto &draws  = frame.draws;
+
+	bounds.clear();
+	draws.clear();
+
+	for (uint32_t i = 0; i < to_u32(bvh.size()); ++i)
+	{
+		auto &instance = bvh.get_instance(i);
+
+		node_slots.emplace(instance.first, std::make_pair(to_u32(draws.size()), instance.second));
+
+		// Meshes without bounds are flagged in the w component, the shader lets them through
+		const auto &mesh_bounds = instance.second->get_bounds();
+		float       unbounded   = glm::any(glm::greaterThan(mesh_bounds.get_min(), mesh_bounds.get_max())) ? 1.0f : 0.0f;
+
+		for (auto sub_mesh : instance.second->get_submeshes())
+		{
+			bounds.emplace_back(bvh.get_min(i), unbounded);
+			bounds.emplace_back(bvh.get_max(i), 0.0f);
+
+			draws.push_back({sub_mesh->vertex_indices, 1, sub_mesh->first_index, sub_mesh->base_vertex, 0});
+		}
+	}
+
+	// Both are uploaded once the draws have completed the commands, before the frame is submitted
+	auto bounds_size = bounds.size() * sizeof(glm::vec4);
+	auto draws_size  = draws.size() * draw_command_size;
+
+	auto &resource_cache  = device.get_resource_cache();
+	auto &shader_module   = resource_cache.request_shader_module(VK_SHADER_STAGE_COMPUTE_BIT, cull_shader);
+	auto &pipeline_layout = resource_cache.request_pipeline_layout({&shader_module});
+
+	command_buffer.bind_pipeline_layout(pipeline_layout);
+
+	command_buffer.bind_buffer(*frame.bounds_buffer, 0, bounds_size, 0, 0, 0);
+	command_buffer.bind_buffer(*frame.draw_buffer, 0, draws_size, 0, 1, 0);
+	command_buffer.bind_image(*pyramid_view, *pyramid_sampler, 0, 2, 0);
+
+	const auto &extent = depth_pyramid->get_extent();
+
+	CullRegisters registers{};
+	registers.view_proj          = pyramid_view_proj;
+	registers.pyramid_resolution = {extent.width, extent.height};
+	registers.level_count        = level_count;
+	registers.draw_count         = to_u32(draws.size());
+
+	command_buffer.push_constants(registers);
+
+	command_buffer.dispatch((registers.draw_count + 63) / 64, 1, 1);
+
+	BufferMemoryBarrier barrier{};
+	barrier.src_stage_mask  = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+	barrier.dst_stage_mask  = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT;
+	barrier.src_access_mask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dst_access_mask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+
+	command_buffer.buffer_memory_barrier(*frame.draw_buffer, 0, draws_size, barrier);
+
+	culling_active = true;
+}
+
+void HiZOcclusionCuller::build_depth_pyramid(CommandBuffer &command_buffer, RenderTarget &render_target, const std::vector<LoadStoreInfo> &load_store)
+{
+	if (culling_active)
+	{
+		// The culling shader sets the instance counts once the frame is submitted, after these writes
+		auto &frame = frame_resources[render_context.get_active_frame_index()];
+
+		frame.bounds_buffer->update(reinterpret_cast<const uint8_t *>(frame.bounds.data()), frame.bounds.size() * sizeof(glm::vec4));
+		frame.draw_buffer->update(reinterpret_cast<const uint8_t *>(frame.draws.data()), frame.draws.size() * draw_command_size);
+	}
+
+	supported = check_support(render_target, load_store);
+
+	if (!supported)
+	{
+		pyramid_valid = false;
+		return;
+	}
+
+	auto &depth_view  = render_target.get_views().at(depth_attachment);
+	auto &depth_image = depth_view.get_image();
+
+	const auto &extent = depth_image.get_extent();
+
+	if (!depth_pyramid || depth_pyramid->get_extent().width != extent.width || depth_pyramid->get_extent().height != extent.height)
+	{
+		create_depth_pyramid(extent);
+	}
+
+	{
+		ImageMemoryBarrier memory_barrier{};
+		memory_barrier.old_layout      = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+		memory_barrier.new_layout      = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		memory_barrier.src_access_mask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		memory_barrier.dst_access_mask = VK_ACCESS_SHADER_READ_BIT;
+		memory_barrier.src_stage_mask  = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		memory_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+		command_buffer.image_memory_barrier(depth_view, memory_barrier);
+		render_target.set_layout(depth_attachment, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	}
+
+	{
+		// Every level is written again, so the previous contents can be dropped once culling has read them
+		ImageMemoryBarrier memory_barrier{};
+		memory_barrier.old_layout      = VK_IMAGE_LAYOUT_UNDEFINED;
+		memory_barrier.new_layout      = VK_IMAGE_LAYOUT_GENERAL;
+		memory_barrier.src_access_mask = 0;
+		memory_barrier.dst_access_mask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		memory_barrier.src_stage_mask  = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+		memory_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+		command_buffer.image_memory_barrier(*pyramid_view, memory_barrier);
+	}
+
+	recording_command_buffer = &command_buffer;
+	pyramid_pipeline->draw(command_buffer, render_target);
+	recording_command_buffer = nullptr;
+
+	{
+		ImageMemoryBarrier memory_barrier{};
+		memory_barrier.old_layout      = VK_IMAGE_LAYOUT_GENERAL;
+		memory_barrier.new_layout      = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		memory_barrier.src_access_mask = VK_ACCESS_SHADER_WRITE_BIT;
+		memory_barrier.dst_access_mask = VK_ACCESS_SHADER_READ_BIT;
+		memory_barrier.src_stage_mask  = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+		memory_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+		command_buffer.image_memory_barrier(*pyramid_view, memory_barrier);
+	}
+
+	pyramid_view_proj = camera.get_pre_rotation() * vulkan_style_projection(camera.get_projection()) * camera.get_view();
+	pyramid_valid     = true;
+}
+
+uint32_t HiZOcclusionCuller::find_slot(const sg::Node &node, const sg::SubMesh &sub_mesh) const
+{
+	if (!culling_active)
+	{
+		return no_slot;
+	}
+
+	auto it = node_slots.find(&node);
+
+	if (it == node_slots.end())
+	{
+		return no_slot;
+	}
+
+	// Submeshes of a node take consecutive slots, in the order of its mesh
+	auto &sub_meshes = it->second.second->get_submeshes();
+
+	for (size_t i = 0; i < sub_meshes.size(); ++i)
+	{
+		if (sub_meshes[i] == &sub_mesh)
+		{
+			return it->second.first + to_u32(i);
+		}
+	}
+
+	return no_slot;
+}
+
+void HiZOcclusionCuller::draw(CommandBuffer &command_buffer, uint32_t slot, uint32_t index_count, uint32_t first_index, int32_t vertex_offset)
+{
+	auto &frame = frame_resources[render_context.get_active_frame_index()];
+
+	// The level of detail is only picked while drawing, the instance count belongs to the culling shader
+	auto &draw        = frame.draws.at(slot);
+	draw.indexCount   = index_count;
+	draw.firstIndex   = first_index;
+	draw.vertexOffset = vertex_offset;
+
+	command_buffer.draw_indexed_indirect(*frame.draw_buffer, slot * draw_command_size, 1, to_u32(draw_command_size));
+}
+
+bool HiZOcclusionCuller::check_support(const RenderTarget &render_target, const std::vector<LoadStoreInfo> &load_store)
+{
+	const char *reason{nullptr};
+
+	auto &views = render_target.get_views();
+
+	if (depth_attachment >= views.size())
+	{
+		reason = "the render target has no depth attachment";
+	}
+	else
+	{
+		auto &depth_image = views[depth_attachment].get_image();
+
+		if (!is_depth_only_format(depth_image.get_format()))
+		{
+			reason = "the depth attachment is not a depth only format";
+		}
+		else if (!(depth_image.get_usage() & VK_IMAGE_USAGE_SAMPLED_BIT))
+		{
+			reason = "the depth attachment was not created with VK_IMAGE_USAGE_SAMPLED_BIT";
+		}
+		else if (depth_image.get_usage() & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT)
+		{
+			reason = "the depth attachment is transient";
+		}
+		else if (depth_attachment >= load_store.size() || load_store[depth_attachment].store_op != VK_ATTACHMENT_STORE_OP_STORE)
+		{
+			reason = "the depth attachment is not stored at the end of the render pass";
+		}
+	}
+
+	if (reason == nullptr)
+	{
+		return true;
+	}
+
+	if (!reported_unsupported)
+	{
+		LOGW("Occlusion culling stays off, {}. See HiZOcclusionCuller::CREATE_RENDER_TARGET_FUNC.", reason);
+		reported_unsupported = true;
+	}
+
+	return false;
+}
+
+void HiZOcclusionCuller::create_depth_pyramid(const VkExtent3D &extent)
+{
+	auto &device = render_context.get_device();
+
+	// Frames in flight may still read the previous pyramid
+	device.wait_idle();
+
+	pyramid_pipeline.reset();
+	level_views.clear();
+	pyramid_view.reset();
+
+	// Levels are halved and rounded up, down to a single texel
+	std::vector<glm::uvec2> level_sizes{{extent.width, extent.height}};
+
+	while (level_sizes.back().x > 1 || level_sizes.back().y > 1)
+	{
+		auto size = level_sizes.back();
+		level_sizes.emplace_back((size.x + 1) / 2, (size.y + 1) / 2);
+	}
+
+	level_count = to_u32(level_sizes.size());
+
+	depth_pyramid = std::make_unique<core::Image>(device,
+	                                              VkExtent3D{extent.width, extent.height, 1},
+	                                              VK_FORMAT_R32_SFLOAT,
+	                                              VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+	                                              VMA_MEMORY_USAGE_GPU_ONLY,
+	                                              VK_SAMPLE_COUNT_1_BIT,
+	                                              level_count);
+
+	for (uint32_t level = 0; level < level_count; ++level)
+	{
+		level_views.push_back(std::make_unique<core::ImageView>(*depth_pyramid, VK_IMAGE_VIEW_TYPE_2D, VK_FORMAT_R32_SFLOAT, level, 0, 1, 1));
+	}
+
+	pyramid_view = std::make_unique<core::ImageView>(*depth_pyramid, VK_IMAGE_VIEW_TYPE_2D, VK_FORMAT_R32_SFLOAT, 0, 0, level_count, 1);
+
+	pyramid_pipeline = std::make_unique<PostProcessingPipeline>(render_context, ShaderSource{"postprocessing/postprocessing.vert"});
+
+	// The depth is taken from the render target the pipeline is drawn with
+	auto &copy_pass = pyramid_pipeline->add_pass<PostProcessingComputePass>(ShaderSource{"hiz_occlusion/depth_copy.comp"});
+	copy_pass.bind_sampled_image("depth", core::SampledImage{depth_attachment});
+	copy_pass.bind_storage_image("out_depth", core::SampledImage{*level_views[0]});
+	copy_pass.set_push_constants(level_sizes[0]);
+	copy_pass.set_dispatch_size({(level_sizes[0].x + 7) / 8, (level_sizes[0].y + 7) / 8, 1});
+
+	for (uint32_t level = 1; level < level_count; ++level)
+	{
+		auto &input_view = *level_views[level - 1];
+
+		ReduceRegisters registers{level_sizes[level], level_sizes[level - 1]};
+
+		auto &reduce_pass = pyramid_pipeline->add_pass<PostProcessingComputePass>(ShaderSource{"hiz_occlusion/depth_reduce.comp"});
+		reduce_pass.bind_storage_image("in_depth", core::SampledImage{input_view});
+		reduce_pass.bind_storage_image("out_depth", core::SampledImage{*level_views[level]});
+		reduce_pass.set_push_constants(registers);
+		reduce_pass.set_dispatch_size({(level_sizes[level].x + 7) / 8, (level_sizes[level].y + 7) / 8, 1});
+
+		// Compute passes do not synchronize images that are not attachments, so wait for the previous level here
+		reduce_pass.set_pre_draw_func([this, &input_view]() {
+			ImageMemoryBarrier memory_barrier{};
+			memory_barrier.old_layout      = VK_IMAGE_LAYOUT_GENERAL;
+			memory_barrier.new_layout      = VK_IMAGE_LAYOUT_GENERAL;
+			memory_barrier.src_access_mask = VK_ACCESS_SHADER_WRITE_BIT;
+			memory_barrier.dst_access_mask = VK_ACCESS_SHADER_READ_BIT;
+			memory_barrier.src_stage_mask  = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+			memory_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+			recording_command_buffer->image_memory_barrier(input_view, memory_barrier);
+		});
+	}
+
+	pyramid_valid = false;
+}
+}        // namespace vkb
@@ -0,0 +1,201 @@
+/* Copyright (c) 2021, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "common/error.h"
+
+VKBP_DISABLE_WARNINGS()
+#include "common/glm_common.h"
+VKBP_ENABLE_WARNINGS()
+
+#include "common/vk_common.h"
+#include "core/buffer.h"
+#include "core/image.h"
+#include "core/image_view.h"
+#include "core/sampler.h"
+#include "core/shader_module.h"
+#include "rendering/postprocessing_pipeline.h"
+#include "rendering/render_target.h"
+
+namespace vkb
+{
+class CommandBuffer;
+class RenderContext;
+
+namespace sg
+{
+class Camera;
+class Mesh;
+class Node;
+class Scene;
+class SubMesh;
+}        // namespace sg
+
+/**
+ * @brief Skips draws hidden behind what was drawn in the previous frame, on the GPU.
+ *
+ * Before the render pass of a frame, a compute shader tests the bounds of every submesh against a
+ * depth pyramid of the previous frame, projected with the camera of that frame, and writes whether
+ * it is visible into the instance count of an indirect draw. After the render pass, the pyramid is
+ * rebuilt from the depth of the frame with a PostProcessingComputePass per level, keeping the
+ * farthest depth of every block.
+ *
+ * This is the single phase variant of hierarchical-Z culling. The two phase scheme draws what was
+ * visible in the previous frame, builds the pyramid from that, then tests the rest again and draws
+ * what became visible, all within one frame. The second test needs the render pass to be split
+ * around a compute dispatch, which RenderPipeline does not do. Here, objects revealed by a camera
+ * move or a moving occluder show up one frame late instead.
+ *
+ * Subpasses draw submeshes through draw_indexed_indirect with the commands of their slots. The
+ * commands of a frame are uploaded at once, when the pyramid is built.
+ *
+ * The depth attachment must be a depth only format created with VK_IMAGE_USAGE_SAMPLED_BIT and
+ * without VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT, and be stored at the end of the render pass.
+ * CREATE_RENDER_TARGET_FUNC creates such a render target. Otherwise culling stays off, and a
+ * warning is logged once. The depth range is expected to be reversed, as set up by the framework
+ * cameras.
+ */
+class HiZOcclusionCuller
+{
+  public:
+	/// Slot of submeshes that are not culled
+	static constexpr uint32_t no_slot{~0u};
+
+	/// Creates render targets whose depth attachment can be culled against
+	static const RenderTarget::CreateFunc CREATE_RENDER_TARGET_FUNC;
+
+	/**
+	 * @param scene Scene whose meshes are culled
+	 * @param camera Camera the scene is drawn with
+	 * @param depth_attachment Index of the depth attachment in the render targets
+	 */
+	HiZOcclusionCuller(RenderContext &render_context, sg::Scene &scene, sg::Camera &camera, uint32_t depth_attachment = 1);
+
+	HiZOcclusionCuller(const HiZOcclusionCuller &) = delete;
+
+	HiZOcclusionCuller(HiZOcclusionCuller &&) = delete;
+
+	~HiZOcclusionCuller() = default;
+
+	HiZOcclusionCuller &operator=(const HiZOcclusionCuller &) = delete;
+
+	HiZOcclusionCuller &operator=(HiZOcclusionCuller &&) = delete;
+
+	/**
+	 * @brief Tests every submesh against the depth pyramid, outside of any render pass
+	 */
+	void cull(CommandBuffer &command_buffer);
+
+	/**
+	 * @brief Uploads the draw commands of the frame, and rebuilds the depth pyramid from its depth
+	 *        after its render pass has ended
+	 * @param load_store Load and store operations the render pass used for every attachment
+	 */
+	void build_depth_pyramid(CommandBuffer &command_buffer, RenderTarget &render_target, const std::vector<LoadStoreInfo> &load_store);
+
+	/**
+	 * @return The slot of a submesh drawn by a node in the current frame, or no_slot if it was not culled
+	 */
+	uint32_t find_slot(const sg::Node &node, const sg::SubMesh &sub_mesh) const;
+
+	/**
+	 * @brief Records the indirect draw of a slot, for the given range of indices of the bound index buffer.
+	 *        The range is written to the command of the slot, which is uploaded by build_depth_pyramid.
+	 */
+	void draw(CommandBuffer &command_buffer, uint32_t slot, uint32_t index_count, uint32_t first_index, int32_t vertex_offset);
+
+  private:
+	/**
+	 * @brief Buffers written by the CPU for a frame, reused once the frame comes around again
+	 */
+	struct FrameResources
+	{
+		std::unique_ptr<core::Buffer> bounds_buffer;
+
+		std::unique_ptr<core::Buffer> draw_buffer;
+
+		/// Number of slots the buffers were created for
+		size_t capacity{0};
+
+		/// Minimum and maximum of the bounds of every slot, the minimum flags unbounded meshes in w
+		std::vector<glm::vec4> bounds;
+
+		/// Indirect commands of every slot, completed while drawing
+		std::vector<VkDrawIndexedIndirectCommand> draws;
+	};
+
+	/**
+	 * @return Whether the depth attachment of a render target can be culled against, logs why not once
+	 */
+	bool check_support(const RenderTarget &render_target, const std::vector<LoadStoreInfo> &load_store);
+
+	/**
+	 * @brief Recreates the pyramid and the passes that build it for a new depth extent
+	 */
+	void create_depth_pyramid(const VkExtent3D &extent);
+
+	RenderContext &render_context;
+
+	sg::Scene &scene;
+
+	sg::Camera &camera;
+
+	uint32_t depth_attachment;
+
+	/// Whether the depth attachment could be culled against when the pyramid was last built
+	bool supported{true};
+
+	bool reported_unsupported{false};
+
+	ShaderSource cull_shader;
+
+	std::vector<FrameResources> frame_resources;
+
+	/// First slot of the submeshes of every node in the current frame, with the mesh they belong to
+	std::unordered_map<const sg::Node *, std::pair<uint32_t, const sg::Mesh *>> node_slots;
+
+	std::unique_ptr<core::Image> depth_pyramid;
+
+	uint32_t level_count{0};
+
+	/// One view per level to write it, and one over every level to sample it
+	std::vector<std::unique_ptr<core::ImageView>> level_views;
+
+	std::unique_ptr<core::ImageView> pyramid_view;
+
+	std::unique_ptr<core::Sampler> pyramid_sampler;
+
+	std::unique_ptr<PostProcessingPipeline> pyramid_pipeline;
+
+	/// Command buffer the pyramid is being built in, for the barriers between levels
+	CommandBuffer *recording_command_buffer{nullptr};
+
+	/// Whether the pyramid holds the depth of a frame that can be tested against
+	bool pyramid_valid{false};
+
+	/// Camera matrix of the frame the pyramid was built from
+	glm::mat4 pyramid_view_proj{1.0f};
+
+	/// Whether draws in the current frame go through the slots
+	bool culling_active{false};
+};
+}        // namespace vkb
@@ -17,6 +17,8 @@
 
 #include "pipeline_state.h"
 
+#include "common/resource_caching.h"
+
 bool operator==(const VkVertexInputAttributeDescription &lhs, const VkVertexInputAttributeDescription &rhs)
 {
 	return std::tie(lhs.binding, lhs.format, lhs.location, lhs.offset) == std::tie(rhs.binding, rhs.format, rhs.location, rhs.offset);
@@ -84,6 +86,8 @@ bool operator!=(const vkb::ColorBlendState &lhs, const vkb::ColorBlendState &rhs
 
 namespace vkb
 {
+std::atomic<bool> PipelineState::incremental_hashing{true};
+
 void SpecializationConstantState::reset()
 {
 	if (dirty)
@@ -132,6 +136,10 @@ void PipelineState::reset()
 {
 	clear_dirty();
 
+	hash_dirty = true;
+
+	dirty_sub_states = ~0U;
+
 	pipeline_layout = nullptr;
 
 	render_pass = nullptr;
@@ -161,14 +169,16 @@ void PipelineState::set_pipeline_layout(PipelineLayout &new_pipeline_layout)
 		{
 			pipeline_layout = &new_pipeline_layout;
 
-			dirty = true;
+			dirty      = true;
+			hash_dirty = true;
 		}
 	}
 	else
 	{
 		pipeline_layout = &new_pipeline_layout;
 
-		dirty = true;
+		dirty      = true;
+		hash_dirty = true;
 	}
 }
 
@@ -180,14 +190,16 @@ void PipelineState::set_render_pass(const RenderPass &new_render_pass)
 		{
 			render_pass = &new_render_pass;
 
-			dirty = true;
+			dirty      = true;
+			hash_dirty = true;
 		}
 	}
 	else
 	{
 		render_pass = &new_render_pass;
 
-		dirty = true;
+		dirty      = true;
+		hash_dirty = true;
 	}
 }
 
@@ -198,6 +210,8 @@ void PipelineState::set_specialization_constant(uint32_t constant_id, const std:
 	if (specialization_constant_state.is_dirty())
 	{
 		dirty = true;
+
+		invalidate_hash(SpecializationConstants);
 	}
 }
 
@@ -208,6 +222,8 @@ void PipelineState::set_vertex_input_state(const VertexInputState &new_vertex_in
 		vertex_input_sate = new_vertex_input_sate;
 
 		dirty = true;
+
+		invalidate_hash(VertexInput);
 	}
 }
 
@@ -218,6 +234,8 @@ void PipelineState::set_input_assembly_state(const InputAssemblyState &new_input
 		input_assembly_state = new_input_assembly_state;
 
 		dirty = true;
+
+		invalidate_hash(InputAssembly);
 	}
 }
 
@@ -228,6 +246,8 @@ void PipelineState::set_rasterization_state(const RasterizationState &new_raster
 		rasterization_state = new_rasterization_state;
 
 		dirty = true;
+
+		invalidate_hash(Rasterization);
 	}
 }
 
@@ -238,6 +258,8 @@ void PipelineState::set_viewport_state(const ViewportState &new_viewport_state)
 		viewport_state = new_viewport_state;
 
 		dirty = true;
+
+		invalidate_hash(Viewport);
 	}
 }
 
@@ -248,6 +270,8 @@ void PipelineState::set_multisample_state(const MultisampleState &new_multisampl
 		multisample_state = new_multisample_state;
 
 		dirty = true;
+
+		invalidate_hash(Multisample);
 	}
 }
 
@@ -258,6 +282,8 @@ void PipelineState::set_depth_stencil_state(const DepthStencilState &new_depth_s
 		depth_stencil_state = new_depth_stencil_state;
 
 		dirty = true;
+
+		invalidate_hash(DepthStencil);
 	}
 }
 
@@ -268,6 +294,8 @@ void PipelineState::set_color_blend_state(const ColorBlendState &new_color_blend
 		color_blend_state = new_color_blend_state;
 
 		dirty = true;
+
+		invalidate_hash(ColorBlend);
 	}
 }
 
@@ -277,7 +305,8 @@ void PipelineState::set_subpass_index(uint32_t new_subpass_index)
 	{
 		subpass_index = new_subpass_index;
 
-		dirty = true;
+		dirty      = true;
+		hash_dirty = true;
 	}
 }
 
@@ -347,4 +376,101 @@ void PipelineState::clear_dirty()
 	dirty = false;
 	specialization_constant_state.clear_dirty();
 }
+
+uint64_t PipelineState::get_hash() const
+{
+	if (!hash_dirty)
+	{
+		return hash;
+	}
+
+	if (!incremental_hashing.load(std::memory_order_relaxed))
+	{
+		dirty_sub_states = ~0U;
+	}
+
+	// Only rehash the sub-states that changed since the last call
+	if (dirty_sub_states & (1U << SpecializationConstants))
+	{
+		sub_state_hashes[SpecializationConstants] = fnv1a_64(nullptr, 0);
+		hash_param(sub_state_hashes[SpecializationConstants], specialization_constant_state);
+	}
+
+	if (dirty_sub_states & (1U << VertexInput))
+	{
+		sub_state_hashes[VertexInput] = fnv1a_64(nullptr, 0);
+		hash_param(sub_state_hashes[VertexInput], vertex_input_sate);
+	}
+
+	if (dirty_sub_states & (1U << InputAssembly))
+	{
+		sub_state_hashes[InputAssembly] = fnv1a_64(nullptr, 0);
+		hash_param(sub_state_hashes[InputAssembly], input_assembly_state);
+	}
+
+	if (dirty_sub_states & (1U << Rasterization))
+	{
+		sub_state_hashes[Rasterization] = fnv1a_64(nullptr, 0);
+		hash_param(sub_state_hashes[Rasterization], rasterization_state);
+	}
+
+	if (dirty_sub_states & (1U << Viewport))
+	{
+		sub_state_hashes[Viewport] = fnv1a_64(nullptr, 0);
+		hash_param(sub_state_hashes[Viewport], viewport_state);
+	}
+
+	if (dirty_sub_states & (1U << Multisample))
+	{
+		sub_state_hashes[Multisample] = fnv1a_64(nullptr, 0);
+		hash_param(sub_state_hashes[Multisample], multisample_state);
+	}
+
+	if (dirty_sub_states & (1U << DepthStencil))
+	{
+		sub_state_hashes[DepthStencil] = fnv1a_64(nullptr, 0);
+		hash_param(sub_state_hashes[DepthStencil], depth_stencil_state);
+	}
+
+	if (dirty_sub_states & (1U << ColorBlend))
+	{
+		sub_state_hashes[ColorBlend] = fnv1a_64(nullptr, 0);
+		hash_param(sub_state_hashes[ColorBlend], color_blend_state);
+	}
+
+	dirty_sub_states = 0;
+
+	hash = fnv1a_64(nullptr, 0);
+
+	hash_param(hash, pipeline_layout->get_id());
+
+	// For graphics only
+	if (render_pass)
+	{
+		hash_param(hash, render_pass->get_id());
+	}
+
+	hash_param(hash, subpass_index);
+
+	for (auto sub_state_hash : sub_state_hashes)
+	{
+		hash_param(hash, sub_state_hash);
+	}
+
+	hash_dirty = false;
+
+	return hash;
+}
+
+void PipelineState::set_incremental_hashing(bool enable)
+{
+	incremental_hashing.store(enable, std::memory_order_relaxed);
+}
+
+void PipelineState::invalidate_hash(SubState sub_state)
+{
+	hash_dirty = true;
+
+	dirty_sub_states |= 1U << sub_state;
+}
 }        // namespace vkb
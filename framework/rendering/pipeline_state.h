@@ -17,6 +17,8 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <vector>
 
 #include "common/vk_common.h"
@@ -223,9 +225,52 @@ class PipelineState
 
 	void clear_dirty();
 
+	/**
+	 * @brief Hashes the state from its content rather than from Vulkan handles, so the
+	 *        result is stable across runs. The 64-bit FNV-1a hash does not depend on the
+	 *        standard library either. Each sub-state keeps its own hash, which is only
+	 *        recomputed after that sub-state changes, and the combined key is cached
+	 *        until any part of the state changes.
+	 */
+	uint64_t get_hash() const;
+
+	/**
+	 * @brief Sets whether sub-state hashes are kept until their sub-state changes, on by default.
+	 *        When off, every sub-state is rehashed whenever any part of the state changes, as
+	 *        before sub-state hashes were cached. Only meant to measure what caching them saves.
+	 */
+	static void set_incremental_hashing(bool enable);
+
   private:
+	/// Sub-states whose hashes are cached individually
+	enum SubState : uint32_t
+	{
+		SpecializationConstants,
+		VertexInput,
+		InputAssembly,
+		Rasterization,
+		Viewport,
+		Multisample,
+		DepthStencil,
+		ColorBlend,
+		SubStateCount
+	};
+
+	void invalidate_hash(SubState sub_state);
+
+	static std::atomic<bool> incremental_hashing;
+
 	bool dirty{false};
 
+	mutable bool hash_dirty{true};
+
+	mutable uint64_t hash{0};
+
+	/// Bit mask of sub-states whose cached hash is out of date
+	mutable uint32_t dirty_sub_states{~0U};
+
+	mutable std::array<uint64_t, SubStateCount> sub_state_hashes{};
+
 	PipelineLayout *pipeline_layout{nullptr};
 
 	const RenderPass *render_pass{nullptr};
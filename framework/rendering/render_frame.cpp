@@ -47,8 +47,9 @@ RenderFrame::RenderFrame(Device &device, std::unique_ptr<RenderTarget> &&render_
 
 	for (size_t i = 0; i < thread_count; ++i)
 	{
-		descriptor_pools.push_back(std::make_unique<std::unordered_map<std::size_t, DescriptorPool>>());
-		descriptor_sets.push_back(std::make_unique<std::unordered_map<std::size_t, DescriptorSet>>());
+		descriptor_pools.push_back(std::make_unique<std::unordered_map<uint64_t, DescriptorPool>>());
+		descriptor_sets.push_back(std::make_unique<std::unordered_map<uint64_t, DescriptorSet>>());
+		descriptor_set_last_used.push_back(std::make_unique<std::unordered_map<const DescriptorSet *, uint64_t>>());
 	}
 }
 
@@ -86,6 +87,17 @@ void RenderFrame::reset()
 	}
 
 	semaphore_pool.reset();
+
+	++frame_count;
+
+	// The frame fence was waited on, so none of the frame descriptor sets is in use anymore
+	if (descriptor_set_max_age != 0)
+	{
+		for (size_t i = 0; i < thread_count; ++i)
+		{
+			evict_descriptor_sets(*descriptor_sets[i], *descriptor_pools[i], *descriptor_set_last_used[i], frame_count, descriptor_set_max_age);
+		}
+	}
 }
 
 std::vector<std::unique_ptr<CommandPool>> &RenderFrame::get_command_pools(const Queue &queue, CommandBuffer::ResetMode reset_mode)
@@ -181,7 +193,11 @@ DescriptorSet &RenderFrame::request_descriptor_set(DescriptorSetLayout &descript
 	assert(thread_index < thread_count && "Thread index is out of bounds");
 
 	auto &descriptor_pool = request_resource(device, nullptr, *descriptor_pools.at(thread_index), descriptor_set_layout);
-	return request_resource(device, nullptr, *descriptor_sets.at(thread_index), descriptor_set_layout, descriptor_pool, buffer_infos, image_infos);
+	auto &descriptor_set  = request_resource(device, nullptr, *descriptor_sets.at(thread_index), descriptor_set_layout, descriptor_pool, buffer_infos, image_infos);
+
+	(*descriptor_set_last_used.at(thread_index))[&descriptor_set] = frame_count;
+
+	return descriptor_set;
 }
 
 void RenderFrame::update_descriptor_sets(size_t thread_index)
@@ -200,6 +216,11 @@ void RenderFrame::clear_descriptors()
 		desc_sets_per_thread->clear();
 	}
 
+	for (auto &last_used_per_thread : descriptor_set_last_used)
+	{
+		last_used_per_thread->clear();
+	}
+
 	for (auto &desc_pools_per_thread : descriptor_pools)
 	{
 		for (auto &desc_pool : *desc_pools_per_thread)
@@ -209,6 +230,19 @@ void RenderFrame::clear_descriptors()
 	}
 }
 
+void RenderFrame::release_descriptor_sets(const std::unordered_set<VkImageView> &image_views)
+{
+	for (size_t i = 0; i < thread_count; ++i)
+	{
+		vkb::release_descriptor_sets(*descriptor_sets[i], *descriptor_set_last_used[i], image_views);
+	}
+}
+
+void RenderFrame::set_descriptor_set_max_age(uint32_t max_age)
+{
+	descriptor_set_max_age = max_age;
+}
+
 void RenderFrame::set_buffer_allocation_strategy(BufferAllocationStrategy new_strategy)
 {
 	buffer_allocation_strategy = new_strategy;
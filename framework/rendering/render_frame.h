@@ -61,6 +61,11 @@ class RenderFrame
 	 */
 	static constexpr uint32_t BUFFER_POOL_BLOCK_SIZE = 256;
 
+	/**
+	 * @brief Number of times a frame can be reset without requesting a descriptor set before the set is dropped
+	 */
+	static constexpr uint32_t DESCRIPTOR_SET_MAX_AGE = 16;
+
 	// A map of the supported usages to a multiplier for the BUFFER_POOL_BLOCK_SIZE
 	const std::unordered_map<VkBufferUsageFlags, uint32_t> supported_usage_map = {
 	    {VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, 1},
@@ -124,6 +129,18 @@ class RenderFrame
 
 	void clear_descriptors();
 
+	/**
+	 * @brief Drops the descriptor sets of every thread that refer to any of the given image views
+	 * @param image_views Views about to be destroyed, no submitted work may use them anymore
+	 */
+	void release_descriptor_sets(const std::unordered_set<VkImageView> &image_views);
+
+	/**
+	 * @brief Sets how many times the frame can be reset without requesting a descriptor set before it is dropped
+	 * @param max_age Number of frames, 0 keeps descriptor sets until clear_descriptors()
+	 */
+	void set_descriptor_set_max_age(uint32_t max_age);
+
 	/**
 	 * @brief Sets a new buffer allocation strategy
 	 * @param new_strategy The new buffer allocation strategy
@@ -159,10 +176,18 @@ class RenderFrame
 	std::map<uint32_t, std::vector<std::unique_ptr<CommandPool>>> command_pools;
 
 	/// Descriptor pools for the frame
-	std::vector<std::unique_ptr<std::unordered_map<std::size_t, DescriptorPool>>> descriptor_pools;
+	std::vector<std::unique_ptr<std::unordered_map<uint64_t, DescriptorPool>>> descriptor_pools;
 
 	/// Descriptor sets for the frame
-	std::vector<std::unique_ptr<std::unordered_map<std::size_t, DescriptorSet>>> descriptor_sets;
+	std::vector<std::unique_ptr<std::unordered_map<uint64_t, DescriptorSet>>> descriptor_sets;
+
+	/// Frame in which each descriptor set was last requested
+	std::vector<std::unique_ptr<std::unordered_map<const DescriptorSet *, uint64_t>>> descriptor_set_last_used;
+
+	/// Number of times the frame was reset
+	uint64_t frame_count{0};
+
+	uint32_t descriptor_set_max_age{DESCRIPTOR_SET_MAX_AGE};
 
 	FencePool fence_pool;
 
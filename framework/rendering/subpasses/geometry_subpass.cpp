@@ -16,8 +16,17 @@
  */
 
 #include "rendering/subpasses/geometry_subpass.h"
+
+#include <cstring>
+#include <limits>
+
+VKBP_DISABLE_WARNINGS()
+#include <ctpl_stl.h>
+VKBP_ENABLE_WARNINGS()
+
 #include "common/utils.h"
 #include "common/vk_common.h"
+#include "rendering/hiz_occlusion_culler.h"
 #include "rendering/render_context.h"
 #include "scene_graph/components/camera.h"
 #include "scene_graph/components/image.h"
@@ -27,9 +36,58 @@
 #include "scene_graph/components/texture.h"
 #include "scene_graph/node.h"
 #include "scene_graph/scene.h"
+#include "stats/culling_stats_provider.h"
 
 namespace vkb
 {
+namespace
+{
+constexpr uint64_t transparent_bit{uint64_t{1} << 63};
+
+constexpr uint32_t pipeline_bits{12};
+constexpr uint32_t material_bits{16};
+constexpr uint32_t depth_bits{24};
+
+/**
+ * @brief Maps a non-negative distance to an integer with the same ordering, without needing the depth range.
+ *        The bits of a positive float order like the float itself, so the highest ones are kept.
+ */
+uint64_t quantize_depth(float distance)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &distance, sizeof(bits));
+
+	// The sign bit is always clear
+	return bits >> (31 - depth_bits);
+}
+
+/**
+ * @brief Packs the sort key of a draw. Opaque draws order by pipeline, material, then front to back,
+ *        while transparent draws need back to front first and only use the other fields to break ties.
+ *        Identifiers beyond the bits of their field share a group with smaller ones, which only costs state changes.
+ */
+uint64_t make_draw_key(bool transparent, uint32_t pipeline_id, uint32_t material_id, float distance)
+{
+	uint64_t pipeline = pipeline_id & ((1u << pipeline_bits) - 1);
+	uint64_t material = material_id & ((1u << material_bits) - 1);
+	uint64_t depth    = quantize_depth(distance);
+
+	if (!transparent)
+	{
+		return (pipeline << (63 - pipeline_bits)) |
+		       (material << (63 - pipeline_bits - material_bits)) |
+		       (depth << (63 - pipeline_bits - material_bits - depth_bits));
+	}
+
+	uint64_t inverted_depth = ~depth & ((uint64_t{1} << depth_bits) - 1);
+
+	return transparent_bit |
+	       (inverted_depth << (63 - depth_bits)) |
+	       (material << (63 - depth_bits - material_bits)) |
+	       (pipeline << (63 - depth_bits - material_bits - pipeline_bits));
+}
+}        // namespace
+
 GeometrySubpass::GeometrySubpass(RenderContext &render_context, ShaderSource &&vertex_source, ShaderSource &&fragment_source, sg::Scene &scene_, sg::Camera &camera) :
     Subpass{render_context, std::move(vertex_source), std::move(fragment_source)},
     meshes{scene_.get_components<sg::Mesh>()},
@@ -51,58 +109,213 @@ void GeometrySubpass::prepare()
 			auto &frag_module = device.get_resource_cache().request_shader_module(VK_SHADER_STAGE_FRAGMENT_BIT, get_fragment_shader(), variant);
 		}
 	}
+
+	// The fallback is drawn while other pipelines compile, so it must never wait on compilation itself
+	if (fallback_variant)
+	{
+		device.get_resource_cache().request_shader_module(VK_SHADER_STAGE_VERTEX_BIT, get_vertex_shader(), *fallback_variant);
+		device.get_resource_cache().request_shader_module(VK_SHADER_STAGE_FRAGMENT_BIT, get_fragment_shader(), *fallback_variant);
+	}
 }
 
-void GeometrySubpass::get_sorted_nodes(std::multimap<float, std::pair<sg::Node *, sg::SubMesh *>> &opaque_nodes, std::multimap<float, std::pair<sg::Node *, sg::SubMesh *>> &transparent_nodes)
+void GeometrySubpass::cull_instances(const Frustum &frustum, size_t begin, size_t end)
 {
+	for (size_t i = begin; i < end; ++i)
+	{
+		auto &node = *instances[i].first;
+		auto &mesh = *instances[i].second;
+
+		const sg::AABB &mesh_bounds = mesh.get_bounds();
+
+		// Meshes without bounds are never culled
+		if (glm::any(glm::greaterThan(mesh_bounds.get_min(), mesh_bounds.get_max())))
+		{
+			instance_bounds.set(i, glm::vec3{-std::numeric_limits<float>::max() / 4}, glm::vec3{std::numeric_limits<float>::max() / 4});
+			continue;
+		}
+
+		auto world_matrix = node.get_transform().get_world_matrix();
+
+		sg::AABB world_bounds{mesh_bounds.get_min(), mesh_bounds.get_max()};
+		world_bounds.transform(world_matrix);
+
+		instance_bounds.set(i, world_bounds.get_min(), world_bounds.get_max());
+	}
+
+	if (frustum_culling)
+	{
+		frustum.check_aabbs(instance_bounds, begin, end, instance_visibility.data());
+	}
+	else
+	{
+		std::fill(instance_visibility.begin() + begin, instance_visibility.begin() + end, uint8_t{1});
+	}
+}
+
+size_t GeometrySubpass::sort_draws()
+{
+	// World matrices are read from several threads below, so they must be up to date first
+	scene.update_transforms();
+
 	auto camera_transform = camera.get_node()->get_transform().get_world_matrix();
 
-	for (auto &mesh : meshes)
+	Frustum frustum;
+	frustum.update(camera.get_pre_rotation() * vkb::vulkan_style_projection(camera.get_projection()) * camera.get_view());
+
+	instances.clear();
+
+	size_t instance_count = 0;
+
+	if (frustum_culling && bvh_culling)
 	{
-		for (auto &node : mesh->get_nodes())
+		// Only the instances in the parts of the scene that the frustum reaches are visited
+		auto &bvh = scene.get_bvh();
+
+		visible_instances.clear();
+		bvh.query_frustum(frustum, visible_instances);
+
+		instance_count = bvh.size();
+
+		instance_bounds.resize(visible_instances.size());
+		instance_visibility.assign(visible_instances.size(), 1);
+
+		for (size_t i = 0; i < visible_instances.size(); ++i)
+		{
+			auto instance = visible_instances[i];
+
+			instances.push_back(bvh.get_instance(instance));
+			instance_bounds.set(i, bvh.get_min(instance), bvh.get_max(instance));
+		}
+	}
+	else
+	{
+		for (auto &mesh : meshes)
+		{
+			for (auto &node : mesh->get_nodes())
+			{
+				instances.emplace_back(node, mesh);
+			}
+		}
+
+		instance_count = instances.size();
+
+		instance_bounds.resize(instances.size());
+		instance_visibility.resize(instances.size());
+
+		// Instances are independent, so large scenes are split into one range per thread
+		constexpr size_t parallel_instance_count{4096};
+
+		if (culling_thread_pool && culling_thread_pool->size() > 1 && instances.size() >= parallel_instance_count)
 		{
-			auto node_transform = node->get_transform().get_world_matrix();
+			auto chunk_count = static_cast<size_t>(culling_thread_pool->size());
+			auto chunk_size  = (instances.size() + chunk_count - 1) / chunk_count;
+
+			// Keep ranges aligned to the SIMD width of the frustum checks
+			chunk_size = (chunk_size + 3) & ~size_t{3};
 
-			const sg::AABB &mesh_bounds = mesh->get_bounds();
+			std::vector<std::future<void>> futures;
 
-			sg::AABB world_bounds{mesh_bounds.get_min(), mesh_bounds.get_max()};
-			world_bounds.transform(node_transform);
+			for (size_t begin = 0; begin < instances.size(); begin += chunk_size)
+			{
+				auto end = std::min(begin + chunk_size, instances.size());
 
-			float distance = glm::length(glm::vec3(camera_transform[3]) - world_bounds.get_center());
+				futures.push_back(culling_thread_pool->push([this, &frustum, begin, end](size_t) {
+					cull_instances(frustum, begin, end);
+				}));
+			}
 
-			for (auto &sub_mesh : mesh->get_submeshes())
+			for (auto &future : futures)
 			{
-				if (sub_mesh->get_material()->alpha_mode == sg::AlphaMode::Blend)
-				{
-					transparent_nodes.emplace(distance, std::make_pair(node, sub_mesh));
-				}
-				else
-				{
-					opaque_nodes.emplace(distance, std::make_pair(node, sub_mesh));
-				}
+				future.get();
 			}
 		}
+		else
+		{
+			cull_instances(frustum, 0, instances.size());
+		}
 	}
+
+	uint64_t visible_count = 0;
+
+	draws.clear();
+
+	size_t opaque_count = 0;
+
+	// Identifiers only need to tell apart what is drawn in this frame, so they stay within the bits of the key
+	pipeline_ids.clear();
+	material_ids.clear();
+
+	for (size_t i = 0; i < instances.size(); ++i)
+	{
+		if (!instance_visibility[i])
+		{
+			continue;
+		}
+
+		++visible_count;
+
+		auto node = instances[i].first;
+		auto mesh = instances[i].second;
+
+		glm::vec3 center{instance_bounds.center_x[i], instance_bounds.center_y[i], instance_bounds.center_z[i]};
+
+		float distance = glm::length(glm::vec3(camera_transform[3]) - center);
+
+		// Invert the front face if the mesh was flipped
+		const auto &scale   = node->get_transform().get_scale();
+		bool        flipped = scale.x * scale.y * scale.z < 0;
+
+		for (auto &sub_mesh : mesh->get_submeshes())
+		{
+			auto material = sub_mesh->get_material();
+
+			bool transparent = material->alpha_mode == sg::AlphaMode::Blend;
+
+			VkFrontFace front_face = flipped && !transparent ? VK_FRONT_FACE_CLOCKWISE : VK_FRONT_FACE_COUNTER_CLOCKWISE;
+
+			// Double sided materials disable culling in the pipeline state, and the front face is part of it
+			size_t pipeline_hash = static_cast<size_t>(sub_mesh->get_shader_variant().get_id());
+			hash_combine(pipeline_hash, material->double_sided);
+			hash_combine(pipeline_hash, static_cast<uint32_t>(front_face));
+
+			auto pipeline_id = pipeline_ids.emplace(pipeline_hash, to_u32(pipeline_ids.size())).first->second;
+			auto material_id = material_ids.emplace(material, to_u32(material_ids.size())).first->second;
+
+			if (!transparent)
+			{
+				++opaque_count;
+			}
+
+			draws.push_back({make_draw_key(transparent, pipeline_id, material_id, distance), node, sub_mesh, distance, front_face});
+		}
+	}
+
+	radix_sort(draws, sorted_draws);
+
+	if (culling_stats)
+	{
+		culling_stats->record(visible_count, instance_count - visible_count);
+	}
+
+	return opaque_count;
 }
 
 void GeometrySubpass::draw(CommandBuffer &command_buffer)
 {
-	std::multimap<float, std::pair<sg::Node *, sg::SubMesh *>> opaque_nodes;
-	std::multimap<float, std::pair<sg::Node *, sg::SubMesh *>> transparent_nodes;
-
-	get_sorted_nodes(opaque_nodes, transparent_nodes);
+	auto opaque_count = sort_draws();
 
-	// Draw opaque objects in front-to-back order
-	for (auto node_it = opaque_nodes.begin(); node_it != opaque_nodes.end(); node_it++)
+	// Draw opaque objects grouped by state, in front-to-back order within a group
+	for (size_t i = 0; i < opaque_count; ++i)
 	{
-		update_uniform(command_buffer, *node_it->second.first, thread_index);
+		auto &draw = draws[i];
 
-		// Invert the front face if the mesh was flipped
-		const auto &scale      = node_it->second.first->get_transform().get_scale();
-		bool        flipped    = scale.x * scale.y * scale.z < 0;
-		VkFrontFace front_face = flipped ? VK_FRONT_FACE_CLOCKWISE : VK_FRONT_FACE_COUNTER_CLOCKWISE;
+		update_uniform(command_buffer, *draw.node, thread_index);
+
+		SubMeshDrawInfo draw_info;
+		draw_info.lod            = select_lod(*draw.sub_mesh, *draw.node, draw.distance);
+		draw_info.occlusion_slot = occlusion_culler ? occlusion_culler->find_slot(*draw.node, *draw.sub_mesh) : HiZOcclusionCuller::no_slot;
 
-		draw_submesh(command_buffer, *node_it->second.second, front_face);
+		draw_submesh(command_buffer, *draw.sub_mesh, draw.front_face, draw_info);
 	}
 
 	// Enable alpha blending
@@ -123,11 +336,17 @@ void GeometrySubpass::draw(CommandBuffer &command_buffer)
 	command_buffer.set_depth_stencil_state(get_depth_stencil_state());
 
 	// Draw transparent objects in back-to-front order
-	for (auto node_it = transparent_nodes.rbegin(); node_it != transparent_nodes.rend(); node_it++)
+	for (size_t i = opaque_count; i < draws.size(); ++i)
 	{
-		update_uniform(command_buffer, *node_it->second.first, thread_index);
+		auto &draw = draws[i];
 
-		draw_submesh(command_buffer, *node_it->second.second);
+		update_uniform(command_buffer, *draw.node, thread_index);
+
+		SubMeshDrawInfo draw_info;
+		draw_info.lod            = select_lod(*draw.sub_mesh, *draw.node, draw.distance);
+		draw_info.occlusion_slot = occlusion_culler ? occlusion_culler->find_slot(*draw.node, *draw.sub_mesh) : HiZOcclusionCuller::no_slot;
+
+		draw_submesh(command_buffer, *draw.sub_mesh, draw.front_face, draw_info);
 	}
 }
 
@@ -147,12 +366,102 @@ void GeometrySubpass::update_uniform(CommandBuffer &command_buffer, sg::Node &no
 
 	global_uniform.camera_position = glm::vec3(glm::inverse(camera.get_view())[3]);
 
+	if (node.has_component<sg::Mesh>())
+	{
+		auto &bounds = node.get_component<sg::Mesh>().get_bounds();
+
+		global_uniform.position_offset = bounds.get_min();
+		global_uniform.position_scale  = bounds.get_max() - bounds.get_min();
+	}
+
 	allocation.update(global_uniform);
 
 	command_buffer.bind_buffer(allocation.get_buffer(), allocation.get_offset(), allocation.get_size(), 0, 1, 0);
 }
 
-void GeometrySubpass::draw_submesh(CommandBuffer &command_buffer, sg::SubMesh &sub_mesh, VkFrontFace front_face)
+void GeometrySubpass::set_async_pipelines(bool enable, const ShaderVariant *new_fallback_variant)
+{
+	async_pipelines = enable;
+
+	fallback_variant = new_fallback_variant ? std::make_unique<ShaderVariant>(*new_fallback_variant) : nullptr;
+}
+
+void GeometrySubpass::set_lod_threshold(float threshold)
+{
+	lod_threshold = threshold;
+}
+
+void GeometrySubpass::set_frustum_culling(bool enable)
+{
+	frustum_culling = enable;
+}
+
+void GeometrySubpass::set_culling_stats(CullingStatsProvider *new_culling_stats)
+{
+	culling_stats = new_culling_stats;
+}
+
+void GeometrySubpass::set_culling_thread_pool(ctpl::thread_pool *thread_pool)
+{
+	culling_thread_pool = thread_pool;
+}
+
+void GeometrySubpass::set_bvh_culling(bool enable)
+{
+	bvh_culling = enable;
+}
+
+void GeometrySubpass::set_occlusion_culler(HiZOcclusionCuller *new_occlusion_culler)
+{
+	occlusion_culler = new_occlusion_culler;
+}
+
+uint32_t GeometrySubpass::select_lod(const sg::SubMesh &sub_mesh, sg::Node &node, float distance) const
+{
+	if (sub_mesh.lods.empty() || lod_threshold <= 0.0f)
+	{
+		return 0;
+	}
+
+	// Errors are in object space, so scale them by the largest scale of the node
+	auto world_matrix = node.get_transform().get_world_matrix();
+
+	float scale = std::max(glm::length(glm::vec3(world_matrix[0])), std::max(glm::length(glm::vec3(world_matrix[1])), glm::length(glm::vec3(world_matrix[2]))));
+
+	// Pixels covered by a unit length at this distance, facing the camera
+	float pixels_per_unit = std::abs(camera.get_projection()[1][1]) * render_context.get_surface_extent().height / (2.0f * std::max(distance, 0.001f));
+
+	for (auto level = static_cast<uint32_t>(sub_mesh.lods.size()); level > 0; --level)
+	{
+		if (sub_mesh.lods[level - 1].error * scale * pixels_per_unit <= lod_threshold)
+		{
+			return level;
+		}
+	}
+
+	return 0;
+}
+
+void GeometrySubpass::draw_submesh(CommandBuffer &command_buffer, sg::SubMesh &sub_mesh, VkFrontFace front_face, const SubMeshDrawInfo &draw_info)
+{
+	bind_submesh(command_buffer, sub_mesh, front_face, sub_mesh.get_shader_variant());
+
+	if (async_pipelines && !command_buffer.is_graphics_pipeline_ready())
+	{
+		if (!fallback_variant)
+		{
+			return;
+		}
+
+		// Draw with the fallback variant until the pipeline for this material is compiled.
+		// The fallback pipeline is not queued, the draw builds it in place the first time it is needed.
+		bind_submesh(command_buffer, sub_mesh, front_face, *fallback_variant);
+	}
+
+	draw_submesh_command(command_buffer, sub_mesh, draw_info);
+}
+
+void GeometrySubpass::bind_submesh(CommandBuffer &command_buffer, sg::SubMesh &sub_mesh, VkFrontFace front_face, const ShaderVariant &shader_variant)
 {
 	auto &device = command_buffer.get_device();
 
@@ -162,8 +471,8 @@ void GeometrySubpass::draw_submesh(CommandBuffer &command_buffer, sg::SubMesh &s
 	multisample_state.rasterization_samples = sample_count;
 	command_buffer.set_multisample_state(multisample_state);
 
-	auto &vert_shader_module = device.get_resource_cache().request_shader_module(VK_SHADER_STAGE_VERTEX_BIT, get_vertex_shader(), sub_mesh.get_shader_variant());
-	auto &frag_shader_module = device.get_resource_cache().request_shader_module(VK_SHADER_STAGE_FRAGMENT_BIT, get_fragment_shader(), sub_mesh.get_shader_variant());
+	auto &vert_shader_module = device.get_resource_cache().request_shader_module(VK_SHADER_STAGE_VERTEX_BIT, get_vertex_shader(), shader_variant);
+	auto &frag_shader_module = device.get_resource_cache().request_shader_module(VK_SHADER_STAGE_FRAGMENT_BIT, get_fragment_shader(), shader_variant);
 
 	std::vector<ShaderModule *> shader_modules{&vert_shader_module, &frag_shader_module};
 
@@ -221,19 +530,15 @@ void GeometrySubpass::draw_submesh(CommandBuffer &command_buffer, sg::SubMesh &s
 	// Find submesh vertex buffers matching the shader input attribute names
 	for (auto &input_resource : vertex_input_resources)
 	{
-		const auto &buffer_iter = sub_mesh.vertex_buffers.find(input_resource.name);
-
-		if (buffer_iter != sub_mesh.vertex_buffers.end())
+		if (auto buffer = sub_mesh.get_vertex_buffer(input_resource.name))
 		{
 			std::vector<std::reference_wrapper<const core::Buffer>> buffers;
-			buffers.emplace_back(std::ref(buffer_iter->second));
+			buffers.emplace_back(std::ref(*buffer));
 
 			// Bind vertex buffers only for the attribute locations defined
 			command_buffer.bind_vertex_buffers(input_resource.location, std::move(buffers), {0});
 		}
 	}
-
-	draw_submesh_command(command_buffer, sub_mesh);
 }
 
 void GeometrySubpass::prepare_pipeline_state(CommandBuffer &command_buffer, VkFrontFace front_face, bool double_sided_material)
@@ -284,21 +589,40 @@ void GeometrySubpass::prepare_push_constants(CommandBuffer &command_buffer, sg::
 	}
 }
 
-void GeometrySubpass::draw_submesh_command(CommandBuffer &command_buffer, sg::SubMesh &sub_mesh)
+void GeometrySubpass::draw_submesh_command(CommandBuffer &command_buffer, sg::SubMesh &sub_mesh, const SubMeshDrawInfo &draw_info)
 {
 	// Draw submesh indexed if indices exists
 	if (sub_mesh.vertex_indices != 0)
 	{
 		// Bind index buffer of submesh
-		command_buffer.bind_index_buffer(*sub_mesh.index_buffer, sub_mesh.index_offset, sub_mesh.index_type);
+		command_buffer.bind_index_buffer(*sub_mesh.get_index_buffer(), sub_mesh.index_offset, sub_mesh.index_type);
+
+		// Draw submesh using indexed data, with the range of the selected level of detail
+		uint32_t index_count = sub_mesh.vertex_indices;
+		uint32_t first_index = sub_mesh.first_index;
+
+		if (draw_info.lod > 0 && draw_info.lod <= sub_mesh.lods.size())
+		{
+			auto &sub_mesh_lod = sub_mesh.lods[draw_info.lod - 1];
+
+			index_count = sub_mesh_lod.index_count;
+			first_index += sub_mesh_lod.first_index;
+		}
 
-		// Draw submesh using indexed data
-		command_buffer.draw_indexed(sub_mesh.vertex_indices, 1, 0, 0, 0);
+		// The occlusion culler sets the instance count to 0 on the GPU if the submesh was hidden
+		if (occlusion_culler && draw_info.occlusion_slot != HiZOcclusionCuller::no_slot)
+		{
+			occlusion_culler->draw(command_buffer, draw_info.occlusion_slot, index_count, first_index, sub_mesh.base_vertex);
+		}
+		else
+		{
+			command_buffer.draw_indexed(index_count, 1, first_index, sub_mesh.base_vertex, 0);
+		}
 	}
 	else
 	{
 		// Draw submesh using vertices only
-		command_buffer.draw(sub_mesh.vertices_count, 1, 0, 0);
+		command_buffer.draw(sub_mesh.vertices_count, 1, static_cast<uint32_t>(sub_mesh.base_vertex), 0);
 	}
 }
 
@@ -23,10 +23,19 @@ VKBP_DISABLE_WARNINGS()
 #include "common/glm_common.h"
 VKBP_ENABLE_WARNINGS()
 
+#include "geometry/frustum.h"
 #include "rendering/subpass.h"
 
+namespace ctpl
+{
+class thread_pool;
+}
+
 namespace vkb
 {
+class CullingStatsProvider;
+class HiZOcclusionCuller;
+
 namespace sg
 {
 class Scene;
@@ -34,6 +43,7 @@ class Node;
 class Mesh;
 class SubMesh;
 class Camera;
+class Material;
 }        // namespace sg
 
 /**
@@ -46,6 +56,11 @@ struct alignas(16) GlobalUniform
 	glm::mat4 camera_view_proj;
 
 	glm::vec3 camera_position;
+
+	/// Offset and scale that decode quantized positions of the mesh, see GLTFLoader::set_vertex_quantization
+	alignas(16) glm::vec3 position_offset;
+
+	alignas(16) glm::vec3 position_scale;
 };
 
 /**
@@ -90,10 +105,76 @@ class GeometrySubpass : public Subpass
 	 */
 	void set_thread_index(uint32_t index);
 
+	/**
+	 * @brief Compiles the pipelines of new materials on background threads instead of
+	 *        stalling the recording thread
+	 * @param enable Whether pipelines are compiled asynchronously
+	 * @param fallback_variant If set, submeshes whose pipeline is not ready yet are drawn
+	 *        with this shader variant instead of being skipped. Its pipelines are built on the
+	 *        recording thread, so it should be a simple variant that many materials share.
+	 */
+	void set_async_pipelines(bool enable, const ShaderVariant *fallback_variant = nullptr);
+
+	/**
+	 * @brief Sets how far in pixels the simplified versions of a submesh may stray from it on screen.
+	 *        Submeshes are drawn with their least detailed version within the threshold.
+	 * @param threshold Screen space error in pixels, 0 always draws the full detail
+	 */
+	void set_lod_threshold(float threshold);
+
+	/**
+	 * @brief Skips nodes whose world bounds are outside the view of the camera, on by default
+	 */
+	void set_frustum_culling(bool enable);
+
+	/**
+	 * @brief Reports the numbers of visible and culled nodes as the visible_objects and culled_objects stats
+	 * @param culling_stats Provider of the sample stats, see Stats::get_culling_stats_provider,
+	 *        or nullptr to stop reporting
+	 */
+	void set_culling_stats(CullingStatsProvider *culling_stats);
+
+	/**
+	 * @brief Splits the culling of large scenes across threads
+	 * @param thread_pool Threads to use, or nullptr to cull on the recording thread
+	 */
+	void set_culling_thread_pool(ctpl::thread_pool *thread_pool);
+
+	/**
+	 * @brief Culls through the bounding volume hierarchy of the scene instead of testing every node,
+	 *        which scales better with large scenes that are mostly out of view. Off by default.
+	 */
+	void set_bvh_culling(bool enable);
+
+	/**
+	 * @brief Draws indexed submeshes through the indirect commands of an occlusion culler,
+	 *        so that the ones hidden in the previous frame are skipped on the GPU
+	 * @param occlusion_culler Culler to draw through, or nullptr to draw everything
+	 */
+	void set_occlusion_culler(HiZOcclusionCuller *occlusion_culler);
+
   protected:
+	/**
+	 * @brief What the subpass chose for one draw of a submesh
+	 */
+	struct SubMeshDrawInfo
+	{
+		/// Level of detail to draw, as returned by select_lod
+		uint32_t lod{0};
+
+		/// Occlusion culler slot to draw through, or ~0u to draw directly
+		uint32_t occlusion_slot{~0u};
+	};
+
 	virtual void update_uniform(CommandBuffer &command_buffer, sg::Node &node, size_t thread_index = 0);
 
-	void draw_submesh(CommandBuffer &command_buffer, sg::SubMesh &sub_mesh, VkFrontFace front_face = VK_FRONT_FACE_COUNTER_CLOCKWISE);
+	void draw_submesh(CommandBuffer &command_buffer, sg::SubMesh &sub_mesh, VkFrontFace front_face = VK_FRONT_FACE_COUNTER_CLOCKWISE, const SubMeshDrawInfo &draw_info = {});
+
+	/**
+	 * @brief Sets up the pipeline state and binds the resources needed to draw a submesh
+	 * @param shader_variant Variant of the subpass shaders to draw the submesh with
+	 */
+	void bind_submesh(CommandBuffer &command_buffer, sg::SubMesh &sub_mesh, VkFrontFace front_face, const ShaderVariant &shader_variant);
 
 	virtual void prepare_pipeline_state(CommandBuffer &command_buffer, VkFrontFace front_face, bool double_sided_material);
 
@@ -101,14 +182,46 @@ class GeometrySubpass : public Subpass
 
 	virtual void prepare_push_constants(CommandBuffer &command_buffer, sg::SubMesh &sub_mesh);
 
-	virtual void draw_submesh_command(CommandBuffer &command_buffer, sg::SubMesh &sub_mesh);
+	virtual void draw_submesh_command(CommandBuffer &command_buffer, sg::SubMesh &sub_mesh, const SubMeshDrawInfo &draw_info);
+
+	/**
+	 * @brief Picks the version of a submesh to draw from its projected error
+	 * @param distance Distance from the camera to the node
+	 * @return Index of the level in SubMesh::lods plus one, or 0 for the full detail
+	 */
+	uint32_t select_lod(const sg::SubMesh &sub_mesh, sg::Node &node, float distance) const;
+
+	/**
+	 * @brief Computes the world bounds of the instances in a range, and tests them against the frustum
+	 */
+	void cull_instances(const Frustum &frustum, size_t begin, size_t end);
+
+	/**
+	 * @brief A submesh to draw, with the key that orders it among the others
+	 */
+	struct DrawCommand
+	{
+		/// Packed transparency, pipeline, material and depth, see sort_draws
+		uint64_t key;
+
+		sg::Node *node;
+
+		sg::SubMesh *sub_mesh;
+
+		/// Distance from the camera to the bounds of the node
+		float distance;
+
+		/// Front face of the submesh, clockwise for opaque submeshes of flipped nodes
+		VkFrontFace front_face;
+	};
 
 	/**
-	 * @brief Sorts objects based on distance from camera and classifies them
-	 *        into opaque and transparent in the arrays provided
+	 * @brief Culls objects outside the view and fills draws with a command for every submesh of the others,
+	 *        radix sorted by key. Opaque submeshes come first, grouped by pipeline then material to limit
+	 *        state changes and front to back within a group. Transparent submeshes follow, back to front.
+	 * @return Number of opaque draws at the start of draws
 	 */
-	void get_sorted_nodes(std::multimap<float, std::pair<sg::Node *, sg::SubMesh *>> &opaque_nodes,
-	                      std::multimap<float, std::pair<sg::Node *, sg::SubMesh *>> &transparent_nodes);
+	size_t sort_draws();
 
 	sg::Camera &camera;
 
@@ -119,6 +232,42 @@ class GeometrySubpass : public Subpass
 	uint32_t thread_index{0};
 
 	vkb::RasterizationState base_rasterization_state{};
+
+	bool async_pipelines{false};
+
+	std::unique_ptr<ShaderVariant> fallback_variant;
+
+	float lod_threshold{1.0f};
+
+	HiZOcclusionCuller *occlusion_culler{nullptr};
+
+	bool frustum_culling{true};
+
+	CullingStatsProvider *culling_stats{nullptr};
+
+	ctpl::thread_pool *culling_thread_pool{nullptr};
+
+	bool bvh_culling{false};
+
+	/// Instances of the scene hierarchy found by the last frustum query
+	std::vector<uint32_t> visible_instances;
+
+	/// Draws of the current frame as filled by sort_draws, kept across frames with the arrays below
+	std::vector<DrawCommand> draws;
+
+	std::vector<DrawCommand> sorted_draws;
+
+	/// Small identifiers for the pipelines and materials in the keys, given in the order they are first drawn in a frame
+	std::unordered_map<size_t, uint32_t> pipeline_ids;
+
+	std::unordered_map<const sg::Material *, uint32_t> material_ids;
+
+	/// Node and mesh of every instance in the scene, kept across frames with the arrays below
+	std::vector<std::pair<sg::Node *, sg::Mesh *>> instances;
+
+	AABBBatch instance_bounds;
+
+	std::vector<uint8_t> instance_visibility;
 };
 
 }        // namespace vkb
@@ -0,0 +1,181 @@
+/* Copyright (c) 2021, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "rendering/texture_streamer.h"
+
+#include "core/command_buffer.h"
+#include "core/device.h"
+#include "rendering/render_context.h"
+#include "scene_graph/components/image.h"
+#include "scene_graph/scene.h"
+
+namespace vkb
+{
+TextureStreamer::TextureStreamer(RenderContext &render_context, VkDeviceSize frame_budget) :
+    render_context{render_context},
+    frame_budget{frame_budget}
+{
+}
+
+void TextureStreamer::set_frame_budget(VkDeviceSize frame_budget)
+{
+	this->frame_budget = frame_budget;
+}
+
+void TextureStreamer::add_image(sg::Image &image)
+{
+	auto base_mip_level = image.get_base_mip_level();
+
+	if (base_mip_level == 0)
+	{
+		return;
+	}
+
+	assert(!image.get_data().empty() && "Image data was cleared before streaming");
+
+	auto &mipmaps = image.get_mipmaps();
+
+	pending_size += mipmaps[base_mip_level].offset - mipmaps[0].offset;
+	pending_images.push_back(&image);
+}
+
+void TextureStreamer::add_scene(sg::Scene &scene)
+{
+	if (!scene.has_component<sg::Image>())
+	{
+		return;
+	}
+
+	for (auto image : scene.get_components<sg::Image>())
+	{
+		add_image(*image);
+	}
+}
+
+void TextureStreamer::update(CommandBuffer &command_buffer)
+{
+	auto frame_index = render_context.get_active_frame_index();
+
+	if (retired_resources.size() < render_context.get_render_frames().size())
+	{
+		retired_resources.resize(render_context.get_render_frames().size());
+	}
+
+	auto &device = render_context.get_device();
+
+	// The active frame has waited for its previous submission, and everything submitted before it
+	auto &retired = retired_resources[frame_index];
+
+	if (!retired.image_views.empty())
+	{
+		std::unordered_set<VkImageView> old_views;
+
+		for (auto &image_view : retired.image_views)
+		{
+			old_views.insert(image_view->get_handle());
+		}
+
+		// Descriptor sets are looked up by view, so those of the old views are never requested again
+		for (auto &render_frame : render_context.get_render_frames())
+		{
+			render_frame->release_descriptor_sets(old_views);
+		}
+
+		device.get_resource_cache().release_descriptor_sets(old_views);
+	}
+
+	retired.staging_buffers.clear();
+	retired.image_views.clear();
+
+	VkDeviceSize uploaded_size{0};
+
+	// Each image gets at most one level per frame, so that all of them sharpen at the same pace
+	for (size_t i = pending_images.size(); i > 0; --i)
+	{
+		auto &image   = *pending_images.front();
+		auto &mipmaps = image.get_mipmaps();
+		auto  level   = image.get_base_mip_level() - 1;
+
+		VkDeviceSize offset = mipmaps[level].offset;
+		VkDeviceSize size   = mipmaps[level + 1].offset - offset;
+
+		// A level larger than the whole budget still goes through on its own, so that streaming always progresses
+		if (uploaded_size > 0 && uploaded_size + size > frame_budget)
+		{
+			break;
+		}
+
+		pending_images.pop_front();
+
+		core::Buffer staging_buffer{device,
+		                            size,
+		                            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		                            VMA_MEMORY_USAGE_CPU_ONLY};
+
+		staging_buffer.update(image.get_data().data() + offset, size);
+
+		VkBufferImageCopy copy_region{};
+		copy_region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1};
+		copy_region.imageExtent      = mipmaps[level].extent;
+
+		command_buffer.copy_buffer_to_image(staging_buffer, image.get_vk_image(), {copy_region});
+
+		// Only the new level changes layout, the coarser ones are already being sampled
+		VkImageMemoryBarrier image_memory_barrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+		image_memory_barrier.oldLayout           = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		image_memory_barrier.newLayout           = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		image_memory_barrier.srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+		image_memory_barrier.dstAccessMask       = VK_ACCESS_SHADER_READ_BIT;
+		image_memory_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		image_memory_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		image_memory_barrier.image               = image.get_vk_image().get_handle();
+		image_memory_barrier.subresourceRange    = {VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1};
+
+		vkCmdPipelineBarrier(command_buffer.get_handle(),
+		                     VK_PIPELINE_STAGE_TRANSFER_BIT,
+		                     VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+		                     0, 0, nullptr, 0, nullptr, 1, &image_memory_barrier);
+
+		retired.staging_buffers.push_back(std::move(staging_buffer));
+
+		// Sets created with the new view replace those of the old one, which frames in flight may still use
+		retired.image_views.push_back(image.set_base_mip_level(level));
+
+		uploaded_size += size;
+		pending_size -= size;
+
+		if (level > 0)
+		{
+			pending_images.push_back(&image);
+		}
+		else
+		{
+			image.clear_data();
+		}
+	}
+}
+
+bool TextureStreamer::is_complete() const
+{
+	return pending_images.empty();
+}
+
+VkDeviceSize TextureStreamer::get_pending_size() const
+{
+	return pending_size;
+}
+}        // namespace vkb
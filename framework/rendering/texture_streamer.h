@@ -0,0 +1,120 @@
+/* Copyright (c) 2021, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "common/helpers.h"
+#include "common/vk_common.h"
+#include "core/buffer.h"
+#include "core/image_view.h"
+
+namespace vkb
+{
+class CommandBuffer;
+class RenderContext;
+
+namespace sg
+{
+class Image;
+class Scene;
+}        // namespace sg
+
+/**
+ * @brief Uploads the finer mip levels of images whose coarse levels are already resident, one level
+ *        per image at a time and within a byte budget per frame. The view of an image is replaced
+ *        by one that covers the new level as soon as it is uploaded, so that scenes can be rendered
+ *        with blurry textures straight after loading and sharpen over the following frames.
+ *
+ * Images are expected to come from a GLTFLoader with texture streaming enabled: they keep their
+ * data, their view starts at the finest uploaded level and the levels above it are in the
+ * transfer destination layout.
+ */
+class TextureStreamer
+{
+  public:
+	/**
+	 * @param render_context The context whose frames the uploads are recorded in
+	 * @param frame_budget Number of bytes to upload per frame
+	 */
+	TextureStreamer(RenderContext &render_context, VkDeviceSize frame_budget = 8 * 1024 * 1024);
+
+	TextureStreamer(const TextureStreamer &) = delete;
+
+	TextureStreamer(TextureStreamer &&) = delete;
+
+	~TextureStreamer() = default;
+
+	TextureStreamer &operator=(const TextureStreamer &) = delete;
+
+	TextureStreamer &operator=(TextureStreamer &&) = delete;
+
+	void set_frame_budget(VkDeviceSize frame_budget);
+
+	/**
+	 * @brief Queues the levels of an image finer than its base mip level
+	 */
+	void add_image(sg::Image &image);
+
+	/**
+	 * @brief Queues every image of a scene that has levels left to upload
+	 */
+	void add_scene(sg::Scene &scene);
+
+	/**
+	 * @brief Records the uploads of the next levels, in a command buffer of the active frame that
+	 *        is submitted before anything samples the images
+	 */
+	void update(CommandBuffer &command_buffer);
+
+	/**
+	 * @return Whether every queued level has been uploaded
+	 */
+	bool is_complete() const;
+
+	/**
+	 * @return Number of bytes left to upload
+	 */
+	VkDeviceSize get_pending_size() const;
+
+  private:
+	/**
+	 * @brief Resources that frames in flight may still use, released once their frame comes around again
+	 */
+	struct RetiredResources
+	{
+		std::vector<core::Buffer> staging_buffers;
+
+		/// Replaced views, the descriptor sets that refer to them are released with them
+		std::vector<std::unique_ptr<core::ImageView>> image_views;
+	};
+
+	RenderContext &render_context;
+
+	VkDeviceSize frame_budget;
+
+	/// Images with levels left to upload, served round robin
+	std::deque<sg::Image *> pending_images;
+
+	VkDeviceSize pending_size{0};
+
+	std::vector<RetiredResources> retired_resources;
+};
+}        // namespace vkb
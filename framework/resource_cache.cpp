@@ -17,6 +17,8 @@
 
 #include "resource_cache.h"
 
+#include <ctpl_stl.h>
+
 #include "common/resource_caching.h"
 #include "core/device.h"
 
@@ -25,14 +27,65 @@ namespace vkb
 namespace
 {
 template <class T, class... A>
-T &request_resource(Device &device, ResourceRecord &recorder, std::mutex &resource_mutex, std::unordered_map<std::size_t, T> &resources, A &... args)
+T &request_resource(Device &device, ResourceRecord &recorder, std::mutex &resource_mutex, ResourceIndex<T> &index, std::unordered_map<uint64_t, T> &resources, A &... args)
 {
+	uint64_t hash = fnv1a_64(nullptr, 0);
+	hash_param(hash, args...);
+
+	// Fast path, cache hits do not need to synchronize with other threads
+	if (T *resource = index.find(hash))
+	{
+		return *resource;
+	}
+
 	std::lock_guard<std::mutex> guard(resource_mutex);
 
 	auto &res = request_resource(device, &recorder, resources, args...);
 
+	index.insert(hash, res);
+
 	return res;
 }
+
+/**
+ * @brief Variant of request_resource for objects that are expensive to build and can be
+ * created concurrently, like shader modules and pipelines. On a miss the object is built
+ * without holding the resource mutex, so that misses on several threads build in parallel.
+ * If two threads race to build the same object, the copy that loses is discarded.
+ */
+template <class T, class... A>
+T &request_resource_concurrent(Device &device, ResourceRecord &recorder, std::mutex &resource_mutex, ResourceIndex<T> &index, std::unordered_map<uint64_t, T> &resources, A &... args)
+{
+	uint64_t hash = fnv1a_64(nullptr, 0);
+	hash_param(hash, args...);
+
+	if (T *resource = index.find(hash))
+	{
+		return *resource;
+	}
+
+	LOGD("Building cache object ({})", typeid(T).name());
+
+	T resource(device, args...);
+
+	std::lock_guard<std::mutex> guard(resource_mutex);
+
+	auto res_it = resources.find(hash);
+
+	if (res_it == resources.end())
+	{
+		res_it = resources.emplace(hash, std::move(resource)).first;
+
+		RecordHelper<T, A...> record_helper;
+
+		size_t record_index = record_helper.record(recorder, args...);
+		record_helper.index(recorder, record_index, res_it->second);
+	}
+
+	index.insert(hash, res_it->second);
+
+	return res_it->second;
+}
 }        // namespace
 
 ResourceCache::ResourceCache(Device &device) :
@@ -40,11 +93,20 @@ ResourceCache::ResourceCache(Device &device) :
 {
 }
 
+ResourceCache::~ResourceCache()
+{
+	wait_for_pipelines();
+}
+
 void ResourceCache::warmup(const std::vector<uint8_t> &data)
 {
-	recorder.set_data(data);
+	warmup(data.data(), data.size());
+}
 
-	replayer.play(*this, recorder);
+void ResourceCache::warmup(const uint8_t *data, size_t size)
+{
+	// Replayed objects are recorded again as they are created
+	replayer.play(*this, data, size);
 }
 
 std::vector<uint8_t> ResourceCache::serialize()
@@ -60,58 +122,148 @@ void ResourceCache::set_pipeline_cache(VkPipelineCache new_pipeline_cache)
 ShaderModule &ResourceCache::request_shader_module(VkShaderStageFlagBits stage, const ShaderSource &glsl_source, const ShaderVariant &shader_variant)
 {
 	std::string entry_point{"main"};
-	return request_resource(device, recorder, shader_module_mutex, state.shader_modules, stage, glsl_source, entry_point, shader_variant);
+	return request_resource_concurrent(device, recorder, shader_module_mutex, shader_module_index, state.shader_modules, stage, glsl_source, entry_point, shader_variant);
 }
 
 PipelineLayout &ResourceCache::request_pipeline_layout(const std::vector<ShaderModule *> &shader_modules)
 {
-	return request_resource(device, recorder, pipeline_layout_mutex, state.pipeline_layouts, shader_modules);
+	return request_resource(device, recorder, pipeline_layout_mutex, pipeline_layout_index, state.pipeline_layouts, shader_modules);
 }
 
 DescriptorSetLayout &ResourceCache::request_descriptor_set_layout(const uint32_t                     set_index,
                                                                   const std::vector<ShaderModule *> &shader_modules,
                                                                   const std::vector<ShaderResource> &set_resources)
 {
-	return request_resource(device, recorder, descriptor_set_layout_mutex, state.descriptor_set_layouts, set_index, shader_modules, set_resources);
+	return request_resource(device, recorder, descriptor_set_layout_mutex, descriptor_set_layout_index, state.descriptor_set_layouts, set_index, shader_modules, set_resources);
 }
 
 GraphicsPipeline &ResourceCache::request_graphics_pipeline(PipelineState &pipeline_state)
 {
-	return request_resource(device, recorder, graphics_pipeline_mutex, state.graphics_pipelines, pipeline_cache, pipeline_state);
+	return request_resource_concurrent(device, recorder, graphics_pipeline_mutex, graphics_pipeline_index, state.graphics_pipelines, pipeline_cache, pipeline_state);
+}
+
+GraphicsPipeline *ResourceCache::request_graphics_pipeline_async(PipelineState &pipeline_state)
+{
+	uint64_t hash = fnv1a_64(nullptr, 0);
+	hash_param(hash, pipeline_cache, pipeline_state);
+
+	if (GraphicsPipeline *pipeline = graphics_pipeline_index.find(hash))
+	{
+		return pipeline;
+	}
+
+	std::lock_guard<std::mutex> guard(pending_pipeline_mutex);
+
+	if (pending_graphics_pipelines.find(hash) != pending_graphics_pipelines.end() ||
+	    failed_graphics_pipelines.find(hash) != failed_graphics_pipelines.end())
+	{
+		return nullptr;
+	}
+
+	if (!pipeline_thread_pool)
+	{
+		// Leave cores for the threads recording command buffers
+		auto thread_count    = std::thread::hardware_concurrency() / 2;
+		thread_count         = thread_count == 0 ? 1 : thread_count;
+		pipeline_thread_pool = std::make_unique<ctpl::thread_pool>(thread_count);
+	}
+
+	// The state is copied, as the caller keeps changing it while the pipeline compiles
+	auto compile = [this, hash, pipeline_state](size_t) mutable {
+		bool failed{false};
+
+		try
+		{
+			request_graphics_pipeline(pipeline_state);
+		}
+		catch (const std::exception &e)
+		{
+			LOGE("Background pipeline compilation failed: {}", e.what());
+			failed = true;
+		}
+
+		std::lock_guard<std::mutex> guard(pending_pipeline_mutex);
+		pending_graphics_pipelines.erase(hash);
+
+		if (failed)
+		{
+			failed_graphics_pipelines.insert(hash);
+		}
+	};
+
+	pending_graphics_pipelines.emplace(hash, pipeline_thread_pool->push(std::move(compile)));
+
+	return nullptr;
+}
+
+void ResourceCache::wait_for_pipelines()
+{
+	std::vector<std::future<void>> pending;
+
+	{
+		std::lock_guard<std::mutex> guard(pending_pipeline_mutex);
+
+		for (auto &it : pending_graphics_pipelines)
+		{
+			pending.push_back(std::move(it.second));
+		}
+
+		pending_graphics_pipelines.clear();
+	}
+
+	for (auto &compilation : pending)
+	{
+		compilation.wait();
+	}
 }
 
 ComputePipeline &ResourceCache::request_compute_pipeline(PipelineState &pipeline_state)
 {
-	return request_resource(device, recorder, compute_pipeline_mutex, state.compute_pipelines, pipeline_cache, pipeline_state);
+	return request_resource_concurrent(device, recorder, compute_pipeline_mutex, compute_pipeline_index, state.compute_pipelines, pipeline_cache, pipeline_state);
 }
 
 DescriptorSet &ResourceCache::request_descriptor_set(DescriptorSetLayout &descriptor_set_layout, const BindingMap<VkDescriptorBufferInfo> &buffer_infos, const BindingMap<VkDescriptorImageInfo> &image_infos)
 {
-	auto &descriptor_pool = request_resource(device, recorder, descriptor_set_mutex, state.descriptor_pools, descriptor_set_layout);
-	return request_resource(device, recorder, descriptor_set_mutex, state.descriptor_sets, descriptor_set_layout, descriptor_pool, buffer_infos, image_infos);
+	// Sets are freed one by one when evicted, so their pools must allow it
+	uint32_t                    pool_size  = DescriptorPool::MAX_SETS_PER_POOL;
+	VkDescriptorPoolCreateFlags pool_flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+
+	auto &descriptor_pool = request_resource(device, recorder, descriptor_set_mutex, descriptor_pool_index, state.descriptor_pools, descriptor_set_layout, pool_size, pool_flags);
+	return request_resource(device, recorder, descriptor_set_mutex, descriptor_set_index, state.descriptor_sets, descriptor_set_layout, descriptor_pool, buffer_infos, image_infos);
 }
 
 RenderPass &ResourceCache::request_render_pass(const std::vector<Attachment> &attachments, const std::vector<LoadStoreInfo> &load_store_infos, const std::vector<SubpassInfo> &subpasses)
 {
-	return request_resource(device, recorder, render_pass_mutex, state.render_passes, attachments, load_store_infos, subpasses);
+	return request_resource(device, recorder, render_pass_mutex, render_pass_index, state.render_passes, attachments, load_store_infos, subpasses);
 }
 
 Framebuffer &ResourceCache::request_framebuffer(const RenderTarget &render_target, const RenderPass &render_pass)
 {
-	return request_resource(device, recorder, framebuffer_mutex, state.framebuffers, render_target, render_pass);
+	return request_resource(device, recorder, framebuffer_mutex, framebuffer_index, state.framebuffers, render_target, render_pass);
 }
 
 void ResourceCache::clear_pipelines()
 {
+	wait_for_pipelines();
+
+	{
+		std::lock_guard<std::mutex> guard(pending_pipeline_mutex);
+		failed_graphics_pipelines.clear();
+	}
+
+	graphics_pipeline_index.reset();
+	compute_pipeline_index.reset();
 	state.graphics_pipelines.clear();
 	state.compute_pipelines.clear();
 }
 
 void ResourceCache::update_descriptor_sets(const std::vector<core::ImageView> &old_views, const std::vector<core::ImageView> &new_views)
 {
+	std::lock_guard<std::mutex> guard(descriptor_set_mutex);
+
 	// Find descriptor sets referring to the old image view
 	std::vector<VkWriteDescriptorSet> set_updates;
-	std::set<size_t>                  matches;
+	std::set<uint64_t>                matches;
 
 	for (size_t i = 0; i < old_views.size(); ++i)
 	{
@@ -184,30 +336,140 @@ void ResourceCache::update_descriptor_sets(const std::vector<core::ImageView> &o
 		state.descriptor_sets.erase(match);
 
 		// Generate new key
-		size_t new_key = 0U;
+		uint64_t new_key = fnv1a_64(nullptr, 0);
 		hash_param(new_key, descriptor_set.get_layout(), descriptor_set.get_buffer_infos(), descriptor_set.get_image_infos());
 
 		// Add (key, resource) to the cache
 		state.descriptor_sets.emplace(new_key, std::move(descriptor_set));
 	}
+
+	if (!matches.empty())
+	{
+		// Moved descriptor sets live at new addresses under new keys
+		descriptor_set_index.reset(state.descriptor_sets);
+	}
+}
+
+void ResourceCache::release_descriptor_sets(const std::unordered_set<VkImageView> &image_views)
+{
+	std::lock_guard<std::mutex> guard(descriptor_set_mutex);
+
+	std::vector<uint64_t> released;
+
+	for (auto &it : state.descriptor_sets)
+	{
+		if (refers_to_image_views(it.second, image_views))
+		{
+			released.push_back(it.first);
+		}
+	}
+
+	if (released.empty())
+	{
+		return;
+	}
+
+	for (auto hash : released)
+	{
+		auto &descriptor_set = state.descriptor_sets.at(hash);
+
+		descriptor_set.get_descriptor_pool().free(descriptor_set.get_handle());
+
+		state.descriptor_sets.erase(hash);
+	}
+
+	descriptor_set_index.erase(released);
 }
 
 void ResourceCache::clear_framebuffers()
 {
+	framebuffer_index.reset();
 	state.framebuffers.clear();
 }
 
 void ResourceCache::clear()
 {
+	wait_for_pipelines();
+
+	shader_module_index.reset();
+	pipeline_layout_index.reset();
+	descriptor_set_index.reset();
+	descriptor_pool_index.reset();
+	descriptor_set_layout_index.reset();
+	render_pass_index.reset();
 	state.shader_modules.clear();
 	state.pipeline_layouts.clear();
 	state.descriptor_sets.clear();
+	// Pools allocate from the layouts, so they go before them
+	state.descriptor_pools.clear();
 	state.descriptor_set_layouts.clear();
 	state.render_passes.clear();
 	clear_pipelines();
 	clear_framebuffers();
 }
 
+void ResourceCache::set_budget(const ResourceCacheBudget &new_budget)
+{
+	budget = new_budget;
+}
+
+void ResourceCache::begin_frame(uint32_t frames_in_flight)
+{
+	++frame_count;
+
+	descriptor_set_index.set_frame(frame_count);
+	framebuffer_index.set_frame(frame_count);
+
+	// Objects used during a frame the GPU may still be processing must stay alive
+	if (frame_count <= frames_in_flight)
+	{
+		return;
+	}
+
+	uint64_t last_retired_frame = frame_count - frames_in_flight;
+
+	if (budget.descriptor_sets != 0 && state.descriptor_sets.size() > budget.descriptor_sets)
+	{
+		std::lock_guard<std::mutex> guard(descriptor_set_mutex);
+
+		auto evicted = descriptor_set_index.least_recently_used(state.descriptor_sets.size() - budget.descriptor_sets, last_retired_frame);
+
+		for (auto hash : evicted)
+		{
+			auto &descriptor_set = state.descriptor_sets.at(hash);
+
+			descriptor_set.get_descriptor_pool().free(descriptor_set.get_handle());
+
+			state.descriptor_sets.erase(hash);
+		}
+
+		descriptor_set_index.erase(evicted);
+
+		stats.evicted_descriptor_sets += evicted.size();
+	}
+
+	if (budget.framebuffers != 0 && state.framebuffers.size() > budget.framebuffers)
+	{
+		std::lock_guard<std::mutex> guard(framebuffer_mutex);
+
+		auto evicted = framebuffer_index.least_recently_used(state.framebuffers.size() - budget.framebuffers, last_retired_frame);
+
+		for (auto hash : evicted)
+		{
+			state.framebuffers.erase(hash);
+		}
+
+		framebuffer_index.erase(evicted);
+
+		stats.evicted_framebuffers += evicted.size();
+	}
+}
+
+const ResourceCacheStats &ResourceCache::get_stats() const
+{
+	return stats;
+}
+
 const ResourceCacheState &ResourceCache::get_internal_state() const
 {
 	return state;
@@ -17,8 +17,14 @@
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <future>
+#include <memory>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "common/helpers.h"
@@ -30,6 +36,11 @@
 #include "resource_record.h"
 #include "resource_replay.h"
 
+namespace ctpl
+{
+class thread_pool;
+}
+
 namespace vkb
 {
 class Device;
@@ -39,29 +50,325 @@ namespace core
 class ImageView;
 }
 
+/**
+ * @brief Read-mostly index from hash to a resource stored in one of the
+ * ResourceCacheState maps. Lookups probe an open-addressed table without
+ * taking any lock, insertions must be serialized by the caller.
+ * When the table grows, the previous one is retired but kept alive until
+ * reset, so that concurrent readers never observe freed memory.
+ * Every lookup also stamps the entry with the current frame, so that the
+ * least recently used resources can be found for eviction.
+ */
+template <class T>
+class ResourceIndex
+{
+  public:
+	ResourceIndex()
+	{
+		reset();
+	}
+
+	ResourceIndex(const ResourceIndex &) = delete;
+
+	ResourceIndex(ResourceIndex &&) = delete;
+
+	ResourceIndex &operator=(const ResourceIndex &) = delete;
+
+	ResourceIndex &operator=(ResourceIndex &&) = delete;
+
+	/**
+	 * @brief Finds a resource by hash, safe to call concurrently with insert
+	 * @return Pointer to the resource, or nullptr if it is not indexed yet
+	 */
+	T *find(uint64_t hash) const
+	{
+		const Table &table = *current.load(std::memory_order_acquire);
+
+		for (std::size_t i = static_cast<std::size_t>(hash) & table.mask;; i = (i + 1) & table.mask)
+		{
+			Entry *entry = table.slots[i].entry.load(std::memory_order_acquire);
+
+			if (entry == nullptr)
+			{
+				return nullptr;
+			}
+
+			if (table.slots[i].hash == hash)
+			{
+				touch(*entry);
+				return entry->resource;
+			}
+		}
+	}
+
+	/**
+	 * @brief Adds a resource to the index, the caller must hold the resource mutex
+	 */
+	void insert(uint64_t hash, T &resource)
+	{
+		insert(hash, resource, frame.load(std::memory_order_relaxed));
+	}
+
+	/**
+	 * @brief Sets the frame that lookups stamp entries with
+	 */
+	void set_frame(uint64_t new_frame)
+	{
+		frame.store(new_frame, std::memory_order_relaxed);
+	}
+
+	std::size_t size() const
+	{
+		return entries.size();
+	}
+
+	/**
+	 * @brief Collects the least recently used entries, the caller must hold the resource mutex
+	 * @param max_count Maximum number of hashes to return
+	 * @param last_frame Entries used after this frame are never returned
+	 * @return Hashes of the selected entries, least recently used first
+	 */
+	std::vector<uint64_t> least_recently_used(std::size_t max_count, uint64_t last_frame) const
+	{
+		std::vector<std::pair<uint64_t, uint64_t>> candidates;
+
+		for (auto &it : entries)
+		{
+			uint64_t last_used = it.second.last_used.load(std::memory_order_relaxed);
+
+			if (last_used <= last_frame)
+			{
+				candidates.emplace_back(last_used, it.first);
+			}
+		}
+
+		max_count = std::min(max_count, candidates.size());
+
+		std::partial_sort(candidates.begin(), candidates.begin() + max_count, candidates.end());
+
+		std::vector<uint64_t> hashes(max_count);
+
+		for (std::size_t i = 0; i < max_count; ++i)
+		{
+			hashes[i] = candidates[i].second;
+		}
+
+		return hashes;
+	}
+
+	/**
+	 * @brief Removes entries from the index, must not run concurrently with find
+	 */
+	void erase(const std::vector<uint64_t> &hashes)
+	{
+		for (auto hash : hashes)
+		{
+			entries.erase(hash);
+		}
+
+		rebuild_tables();
+	}
+
+	/**
+	 * @brief Drops every entry and frees the retired tables, must not run concurrently with find
+	 */
+	void reset()
+	{
+		entries.clear();
+
+		rebuild_tables();
+	}
+
+	/**
+	 * @brief Rebuilds the index from its owning map, must not run concurrently with find.
+	 * Resources that keep their hash also keep the frame they were last used in.
+	 */
+	void reset(std::unordered_map<uint64_t, T> &resources)
+	{
+		std::unordered_map<uint64_t, uint64_t> last_used_frames;
+
+		for (auto &it : entries)
+		{
+			last_used_frames.emplace(it.first, it.second.last_used.load(std::memory_order_relaxed));
+		}
+
+		reset();
+
+		for (auto &it : resources)
+		{
+			auto last_used_it = last_used_frames.find(it.first);
+
+			insert(it.first, it.second, last_used_it != last_used_frames.end() ? last_used_it->second : frame.load(std::memory_order_relaxed));
+		}
+	}
+
+  private:
+	struct Entry
+	{
+		T *resource{nullptr};
+
+		std::atomic<uint64_t> last_used{0};
+	};
+
+	struct Slot
+	{
+		uint64_t hash{0};
+
+		std::atomic<Entry *> entry{nullptr};
+	};
+
+	struct Table
+	{
+		explicit Table(std::size_t capacity) :
+		    mask{capacity - 1},
+		    slots{std::make_unique<Slot[]>(capacity)}
+		{
+		}
+
+		std::size_t mask;
+
+		std::unique_ptr<Slot[]> slots;
+	};
+
+	void touch(Entry &entry) const
+	{
+		uint64_t current_frame = frame.load(std::memory_order_relaxed);
+
+		// Avoid writing to the shared cache line when the entry was already used this frame
+		if (entry.last_used.load(std::memory_order_relaxed) != current_frame)
+		{
+			entry.last_used.store(current_frame, std::memory_order_relaxed);
+		}
+	}
+
+	void insert(uint64_t hash, T &resource, uint64_t last_used)
+	{
+		auto entry_it = entries.find(hash);
+
+		if (entry_it != entries.end())
+		{
+			// Already indexed, entries are immutable once published
+			assert(entry_it->second.resource == &resource && "Resource moved without rebuilding the index");
+			touch(entry_it->second);
+			return;
+		}
+
+		Entry &entry = entries[hash];
+		entry.resource = &resource;
+		entry.last_used.store(last_used, std::memory_order_relaxed);
+
+		Table *table = tables.back().get();
+
+		// Keep the load factor under one half, so probe sequences stay short
+		if (entries.size() * 2 > table->mask + 1)
+		{
+			auto grown = std::make_unique<Table>((table->mask + 1) * 2);
+
+			for (std::size_t i = 0; i <= table->mask; ++i)
+			{
+				if (Entry *old_entry = table->slots[i].entry.load(std::memory_order_relaxed))
+				{
+					place(*grown, table->slots[i].hash, *old_entry);
+				}
+			}
+
+			table = grown.get();
+			tables.push_back(std::move(grown));
+			current.store(table, std::memory_order_release);
+		}
+
+		place(*table, hash, entry);
+	}
+
+	void rebuild_tables()
+	{
+		std::size_t capacity = 64;
+
+		while (entries.size() * 2 > capacity)
+		{
+			capacity *= 2;
+		}
+
+		tables.clear();
+		tables.push_back(std::make_unique<Table>(capacity));
+
+		for (auto &it : entries)
+		{
+			place(*tables.back(), it.first, it.second);
+		}
+
+		current.store(tables.back().get(), std::memory_order_release);
+	}
+
+	static void place(Table &table, uint64_t hash, Entry &entry)
+	{
+		for (std::size_t i = static_cast<std::size_t>(hash) & table.mask;; i = (i + 1) & table.mask)
+		{
+			Slot &slot = table.slots[i];
+
+			if (slot.entry.load(std::memory_order_relaxed) == nullptr)
+			{
+				// Publish the hash before the pointer readers check against
+				slot.hash = hash;
+				slot.entry.store(&entry, std::memory_order_release);
+				return;
+			}
+		}
+	}
+
+	std::atomic<const Table *> current{nullptr};
+
+	std::vector<std::unique_ptr<Table>> tables;
+
+	/// Node based, so entry addresses stay valid while the tables grow
+	std::unordered_map<uint64_t, Entry> entries;
+
+	std::atomic<uint64_t> frame{0};
+};
+
+/**
+ * @brief Maximum number of cached objects kept per type, zero means unbounded
+ */
+struct ResourceCacheBudget
+{
+	std::size_t descriptor_sets{0};
+
+	std::size_t framebuffers{0};
+};
+
+/**
+ * @brief Number of cached objects evicted per type since the cache was created
+ */
+struct ResourceCacheStats
+{
+	std::size_t evicted_descriptor_sets{0};
+
+	std::size_t evicted_framebuffers{0};
+};
+
 /**
  * @brief Struct to hold the internal state of the Resource Cache
  *
  */
 struct ResourceCacheState
 {
-	std::unordered_map<std::size_t, ShaderModule> shader_modules;
+	std::unordered_map<uint64_t, ShaderModule> shader_modules;
 
-	std::unordered_map<std::size_t, PipelineLayout> pipeline_layouts;
+	std::unordered_map<uint64_t, PipelineLayout> pipeline_layouts;
 
-	std::unordered_map<std::size_t, DescriptorSetLayout> descriptor_set_layouts;
+	std::unordered_map<uint64_t, DescriptorSetLayout> descriptor_set_layouts;
 
-	std::unordered_map<std::size_t, DescriptorPool> descriptor_pools;
+	std::unordered_map<uint64_t, DescriptorPool> descriptor_pools;
 
-	std::unordered_map<std::size_t, RenderPass> render_passes;
+	std::unordered_map<uint64_t, RenderPass> render_passes;
 
-	std::unordered_map<std::size_t, GraphicsPipeline> graphics_pipelines;
+	std::unordered_map<uint64_t, GraphicsPipeline> graphics_pipelines;
 
-	std::unordered_map<std::size_t, ComputePipeline> compute_pipelines;
+	std::unordered_map<uint64_t, ComputePipeline> compute_pipelines;
 
-	std::unordered_map<std::size_t, DescriptorSet> descriptor_sets;
+	std::unordered_map<uint64_t, DescriptorSet> descriptor_sets;
 
-	std::unordered_map<std::size_t, Framebuffer> framebuffers;
+	std::unordered_map<uint64_t, Framebuffer> framebuffers;
 };
 
 /**
@@ -74,13 +381,20 @@ struct ResourceCacheState
  * The resource cache is also linked with ResourceRecord and ResourceReplay. Replay can warm-up
  * the cache on app startup by creating all necessary objects.
  * The cache holds pointers to objects and has a mapping from such pointers to hashes.
- * It can only be destroyed in bulk, single elements cannot be removed.
+ * Most objects can only be destroyed in bulk. Descriptor sets and framebuffers are also
+ * evicted least recently used first when they exceed the ResourceCacheBudget, once the
+ * frames that may still reference them have retired.
+ *
+ * Requests that hit the cache are resolved through a lock-free ResourceIndex per type,
+ * only misses take the per-type mutex to create the object.
  */
 class ResourceCache
 {
   public:
 	ResourceCache(Device &device);
 
+	~ResourceCache();
+
 	ResourceCache(const ResourceCache &) = delete;
 
 	ResourceCache(ResourceCache &&) = delete;
@@ -91,6 +405,13 @@ class ResourceCache
 
 	void warmup(const std::vector<uint8_t> &data);
 
+	/**
+	 * @brief Creates the objects recorded by serialize in a previous run
+	 * @param data Serialized records, read in place so they can come from a memory-mapped file
+	 * @param size Size of the data in bytes
+	 */
+	void warmup(const uint8_t *data, size_t size);
+
 	std::vector<uint8_t> serialize();
 
 	void set_pipeline_cache(VkPipelineCache pipeline_cache);
@@ -105,6 +426,19 @@ class ResourceCache
 
 	GraphicsPipeline &request_graphics_pipeline(PipelineState &pipeline_state);
 
+	/**
+	 * @brief Non-blocking variant of request_graphics_pipeline. A pipeline that is not cached yet
+	 *        is queued for compilation on a background thread instead of being built in place.
+	 *        A pipeline whose compilation failed is not queued again until the pipelines are cleared.
+	 * @return The pipeline, or nullptr until its background compilation has finished
+	 */
+	GraphicsPipeline *request_graphics_pipeline_async(PipelineState &pipeline_state);
+
+	/**
+	 * @brief Blocks until the pipelines queued by request_graphics_pipeline_async are built
+	 */
+	void wait_for_pipelines();
+
 	ComputePipeline &request_compute_pipeline(PipelineState &pipeline_state);
 
 	DescriptorSet &request_descriptor_set(DescriptorSetLayout &                     descriptor_set_layout,
@@ -125,10 +459,26 @@ class ResourceCache
 	/// @param new_views New image views to be referred
 	void update_descriptor_sets(const std::vector<core::ImageView> &old_views, const std::vector<core::ImageView> &new_views);
 
+	/// @brief Free those descriptor sets referring to image views that are about to be destroyed
+	/// @param image_views Views no submitted work may use anymore
+	void release_descriptor_sets(const std::unordered_set<VkImageView> &image_views);
+
 	void clear_framebuffers();
 
 	void clear();
 
+	void set_budget(const ResourceCacheBudget &budget);
+
+	/**
+	 * @brief Starts a new frame, evicting the least recently used objects above budget.
+	 *        Must not run concurrently with requests to the cache.
+	 * @param frames_in_flight Number of frames the GPU may still be processing, objects
+	 *        used during any of them are kept alive
+	 */
+	void begin_frame(uint32_t frames_in_flight);
+
+	const ResourceCacheStats &get_stats() const;
+
 	const ResourceCacheState &get_internal_state() const;
 
   private:
@@ -142,6 +492,12 @@ class ResourceCache
 
 	ResourceCacheState state;
 
+	ResourceCacheBudget budget;
+
+	ResourceCacheStats stats;
+
+	uint64_t frame_count{0};
+
 	std::mutex descriptor_set_mutex;
 
 	std::mutex pipeline_layout_mutex;
@@ -157,5 +513,33 @@ class ResourceCache
 	std::mutex compute_pipeline_mutex;
 
 	std::mutex framebuffer_mutex;
+
+	ResourceIndex<ShaderModule> shader_module_index;
+
+	ResourceIndex<PipelineLayout> pipeline_layout_index;
+
+	ResourceIndex<DescriptorSetLayout> descriptor_set_layout_index;
+
+	ResourceIndex<DescriptorPool> descriptor_pool_index;
+
+	ResourceIndex<RenderPass> render_pass_index;
+
+	ResourceIndex<GraphicsPipeline> graphics_pipeline_index;
+
+	ResourceIndex<ComputePipeline> compute_pipeline_index;
+
+	ResourceIndex<DescriptorSet> descriptor_set_index;
+
+	ResourceIndex<Framebuffer> framebuffer_index;
+
+	std::mutex pending_pipeline_mutex;
+
+	/// Background compilations in progress, by pipeline hash
+	std::unordered_map<uint64_t, std::future<void>> pending_graphics_pipelines;
+
+	/// Pipelines whose background compilation failed, they are not queued again
+	std::unordered_set<uint64_t> failed_graphics_pipelines;
+
+	std::unique_ptr<ctpl::thread_pool> pipeline_thread_pool;
 };
 }        // namespace vkb
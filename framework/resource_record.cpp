@@ -17,6 +17,10 @@
 
 #include "resource_record.h"
 
+#include <cstring>
+
+#include "common/logging.h"
+#include "core/descriptor_set_layout.h"
 #include "core/pipeline.h"
 #include "core/pipeline_layout.h"
 #include "core/render_pass.h"
@@ -45,90 +49,248 @@ inline void write_processes(std::ostringstream &os, const std::vector<std::strin
 		write(os, item);
 	}
 }
-}        // namespace
 
-void ResourceRecord::set_data(const std::vector<uint8_t> &data)
+inline void write_shader_resources(std::ostringstream &os, const std::vector<ShaderResource> &value)
 {
-	stream.str(std::string{data.begin(), data.end()});
+	write(os, value.size());
+	for (const ShaderResource &item : value)
+	{
+		write(os,
+		      item.stages,
+		      item.type,
+		      item.mode,
+		      item.set,
+		      item.binding,
+		      item.location,
+		      item.input_attachment_index,
+		      item.vec_size,
+		      item.columns,
+		      item.array_size,
+		      item.offset,
+		      item.size,
+		      item.constant_id,
+		      item.qualifiers,
+		      item.name);
+	}
 }
 
-std::vector<uint8_t> ResourceRecord::get_data()
+inline void write_record(std::ostringstream &os, ResourceType type, const std::ostringstream &record)
+{
+	const std::string payload = record.str();
+
+	write(os, type, static_cast<uint64_t>(payload.size()));
+	os.write(payload.data(), payload.size());
+}
+}        // namespace
+
+constexpr uint32_t ResourceRecord::MAGIC;
+constexpr uint32_t ResourceRecord::VERSION;
+
+bool ResourceRecord::validate(const uint8_t *data, size_t size, const uint8_t *&records, size_t &records_size)
 {
-	std::string str = stream.str();
+	ResourceRecordHeader header{};
+
+	if (size < sizeof(header))
+	{
+		LOGW("Resource record data is too small, ignoring it");
+		return false;
+	}
+
+	std::memcpy(&header, data, sizeof(header));
+
+	if (header.magic != MAGIC)
+	{
+		LOGW("Data does not contain resource records, ignoring it");
+		return false;
+	}
+
+	if (header.version != VERSION || header.size_width != sizeof(size_t))
+	{
+		LOGW("Resource records were written by another build (version {}), ignoring them", header.version);
+		return false;
+	}
+
+	if (header.size != size - sizeof(header))
+	{
+		LOGW("Resource record data is truncated, ignoring it");
+		return false;
+	}
+
+	records      = data + sizeof(header);
+	records_size = static_cast<size_t>(header.size);
+
+	if (fnv1a_64(records, records_size) != header.checksum)
+	{
+		LOGW("Resource record data is corrupted, ignoring it");
+		return false;
+	}
 
-	return std::vector<uint8_t>{str.begin(), str.end()};
+	return true;
 }
 
-const std::ostringstream &ResourceRecord::get_stream()
+std::vector<uint8_t> ResourceRecord::get_data()
 {
-	return stream;
+	std::lock_guard<std::mutex> guard(stream_mutex);
+
+	std::string records = stream.str();
+
+	ResourceRecordHeader header{};
+	header.magic      = MAGIC;
+	header.version    = VERSION;
+	header.size_width = sizeof(size_t);
+	header.size       = records.size();
+	header.checksum   = fnv1a_64(records.data(), records.size());
+
+	std::vector<uint8_t> data(sizeof(header) + records.size());
+	std::memcpy(data.data(), &header, sizeof(header));
+	std::copy(records.begin(), records.end(), data.begin() + sizeof(header));
+
+	return data;
 }
 
 size_t ResourceRecord::register_shader_module(VkShaderStageFlagBits stage, const ShaderSource &glsl_source, const std::string &entry_point, const ShaderVariant &shader_variant)
 {
+	std::lock_guard<std::mutex> guard(stream_mutex);
+
 	shader_module_indices.push_back(shader_module_indices.size());
 
-	write(stream, ResourceType::ShaderModule, stage, glsl_source.get_source(), entry_point, shader_variant.get_preamble());
+	std::ostringstream record;
 
-	write_processes(stream, shader_variant.get_processes());
+	write(record, stage, glsl_source.get_source(), entry_point, shader_variant.get_preamble());
+
+	write_processes(record, shader_variant.get_processes());
+
+	write_record(stream, ResourceType::ShaderModule, record);
 
 	return shader_module_indices.back();
 }
 
 size_t ResourceRecord::register_pipeline_layout(const std::vector<ShaderModule *> &shader_modules)
 {
+	std::lock_guard<std::mutex> guard(stream_mutex);
+
 	pipeline_layout_indices.push_back(pipeline_layout_indices.size());
 
 	std::vector<size_t> shader_indices(shader_modules.size());
 	std::transform(shader_modules.begin(), shader_modules.end(), shader_indices.begin(),
 	               [this](ShaderModule *shader_module) { return shader_module_to_index.at(shader_module); });
 
-	write(stream,
-	      ResourceType::PipelineLayout,
+	std::ostringstream record;
+
+	write(record,
 	      shader_indices);
 
+	write_record(stream, ResourceType::PipelineLayout, record);
+
 	return pipeline_layout_indices.back();
 }
 
 size_t ResourceRecord::register_render_pass(const std::vector<Attachment> &attachments, const std::vector<LoadStoreInfo> &load_store_infos, const std::vector<SubpassInfo> &subpasses)
 {
+	std::lock_guard<std::mutex> guard(stream_mutex);
+
 	render_pass_indices.push_back(render_pass_indices.size());
 
-	write(stream,
-	      ResourceType::RenderPass,
+	std::ostringstream record;
+
+	write(record,
 	      attachments,
 	      load_store_infos);
 
-	write_subpass_info(stream, subpasses);
+	write_subpass_info(record, subpasses);
+
+	write_record(stream, ResourceType::RenderPass, record);
 
 	return render_pass_indices.back();
 }
 
+size_t ResourceRecord::register_descriptor_set_layout(const uint32_t set_index, const std::vector<ShaderModule *> &shader_modules, const std::vector<ShaderResource> &set_resources)
+{
+	std::lock_guard<std::mutex> guard(stream_mutex);
+
+	descriptor_set_layout_indices.push_back(descriptor_set_layout_indices.size());
+
+	std::vector<size_t> shader_indices(shader_modules.size());
+	std::transform(shader_modules.begin(), shader_modules.end(), shader_indices.begin(),
+	               [this](ShaderModule *shader_module) { return shader_module_to_index.at(shader_module); });
+
+	std::ostringstream record;
+
+	write(record,
+	      set_index,
+	      shader_indices);
+
+	write_shader_resources(record, set_resources);
+
+	write_record(stream, ResourceType::DescriptorSetLayout, record);
+
+	return descriptor_set_layout_indices.back();
+}
+
 size_t ResourceRecord::register_graphics_pipeline(VkPipelineCache /*pipeline_cache*/, PipelineState &pipeline_state)
 {
+	std::lock_guard<std::mutex> guard(stream_mutex);
+
 	graphics_pipeline_indices.push_back(graphics_pipeline_indices.size());
 
+	std::ostringstream record;
+
+	write_pipeline_state(record, pipeline_state);
+
+	write_record(stream, ResourceType::GraphicsPipeline, record);
+
+	return graphics_pipeline_indices.back();
+}
+
+size_t ResourceRecord::register_compute_pipeline(VkPipelineCache /*pipeline_cache*/, PipelineState &pipeline_state)
+{
+	std::lock_guard<std::mutex> guard(stream_mutex);
+
+	compute_pipeline_indices.push_back(compute_pipeline_indices.size());
+
+	std::ostringstream record;
+
+	// The whole state is recorded, as it is all part of the compute pipeline hash
+	write_pipeline_state(record, pipeline_state);
+
+	write_record(stream, ResourceType::ComputePipeline, record);
+
+	return compute_pipeline_indices.back();
+}
+
+void ResourceRecord::write_pipeline_state(std::ostringstream &record, PipelineState &pipeline_state)
+{
 	auto &pipeline_layout = pipeline_state.get_pipeline_layout();
 	auto  render_pass     = pipeline_state.get_render_pass();
 
-	write(stream,
-	      ResourceType::GraphicsPipeline,
+	// Compute pipelines may not have a render pass
+	bool has_render_pass = render_pass != nullptr;
+
+	write(record,
 	      pipeline_layout_to_index.at(&pipeline_layout),
-	      render_pass_to_index.at(render_pass),
+	      has_render_pass);
+
+	if (has_render_pass)
+	{
+		write(record,
+		      render_pass_to_index.at(render_pass));
+	}
+
+	write(record,
 	      pipeline_state.get_subpass_index());
 
 	auto &specialization_constant_state = pipeline_state.get_specialization_constant_state().get_specialization_constant_state();
 
-	write(stream,
+	write(record,
 	      specialization_constant_state);
 
 	auto &vertex_input_state = pipeline_state.get_vertex_input_state();
 
-	write(stream,
+	write(record,
 	      vertex_input_state.attributes,
 	      vertex_input_state.bindings);
 
-	write(stream,
+	write(record,
 	      pipeline_state.get_input_assembly_state(),
 	      pipeline_state.get_rasterization_state(),
 	      pipeline_state.get_viewport_state(),
@@ -137,32 +299,52 @@ size_t ResourceRecord::register_graphics_pipeline(VkPipelineCache /*pipeline_cac
 
 	auto &color_blend_state = pipeline_state.get_color_blend_state();
 
-	write(stream,
+	write(record,
 	      color_blend_state.logic_op,
 	      color_blend_state.logic_op_enable,
 	      color_blend_state.attachments);
-
-	return graphics_pipeline_indices.back();
 }
 
 void ResourceRecord::set_shader_module(size_t index, const ShaderModule &shader_module)
 {
+	std::lock_guard<std::mutex> guard(stream_mutex);
+
 	shader_module_to_index[&shader_module] = index;
 }
 
 void ResourceRecord::set_pipeline_layout(size_t index, const PipelineLayout &pipeline_layout)
 {
+	std::lock_guard<std::mutex> guard(stream_mutex);
+
 	pipeline_layout_to_index[&pipeline_layout] = index;
 }
 
 void ResourceRecord::set_render_pass(size_t index, const RenderPass &render_pass)
 {
+	std::lock_guard<std::mutex> guard(stream_mutex);
+
 	render_pass_to_index[&render_pass] = index;
 }
 
+void ResourceRecord::set_descriptor_set_layout(size_t index, const DescriptorSetLayout &descriptor_set_layout)
+{
+	std::lock_guard<std::mutex> guard(stream_mutex);
+
+	descriptor_set_layout_to_index[&descriptor_set_layout] = index;
+}
+
 void ResourceRecord::set_graphics_pipeline(size_t index, const GraphicsPipeline &graphics_pipeline)
 {
+	std::lock_guard<std::mutex> guard(stream_mutex);
+
 	graphics_pipeline_to_index[&graphics_pipeline] = index;
 }
 
+void ResourceRecord::set_compute_pipeline(size_t index, const ComputePipeline &compute_pipeline)
+{
+	std::lock_guard<std::mutex> guard(stream_mutex);
+
+	compute_pipeline_to_index[&compute_pipeline] = index;
+}
+
 }        // namespace vkb
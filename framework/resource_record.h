@@ -17,37 +17,81 @@
 
 #pragma once
 
+#include <mutex>
 #include <vector>
 
 #include "rendering/pipeline_state.h"
 
 namespace vkb
 {
+class ComputePipeline;
+class DescriptorSetLayout;
 class GraphicsPipeline;
 class PipelineLayout;
 class RenderPass;
 class ShaderModule;
 
-enum class ResourceType
+enum class ResourceType : uint32_t
 {
 	ShaderModule,
 	PipelineLayout,
 	RenderPass,
-	GraphicsPipeline
+	GraphicsPipeline,
+	DescriptorSetLayout,
+	ComputePipeline
+};
+
+/**
+ * @brief Header at the start of serialized resource records.
+ * The records that follow are each a ResourceType, a 64-bit payload size and the payload.
+ */
+struct ResourceRecordHeader
+{
+	/// Identifies the data as resource records
+	uint32_t magic;
+
+	/// Layout version of the records, data from other versions is rejected
+	uint32_t version;
+
+	/// Width of the size_t values inside the records
+	uint32_t size_width;
+
+	uint32_t reserved;
+
+	/// Size in bytes of the records following the header
+	uint64_t size;
+
+	/// FNV-1a hash of the records following the header
+	uint64_t checksum;
 };
 
 /**
  * @brief Writes Vulkan objects in a memory stream.
+ * Registration is thread-safe, so the resource cache can record objects of different types concurrently.
  */
 class ResourceRecord
 {
   public:
-	void set_data(const std::vector<uint8_t> &data);
-
+	static constexpr uint32_t MAGIC = 0x52424b56;        // "VKBR"
+
+	/// Bump when the layout of any record changes
+	static constexpr uint32_t VERSION = 2;
+
+	/**
+	 * @brief Checks the header and checksum of serialized records
+	 * @param data Serialized records, as returned by get_data
+	 * @param size Size of the data in bytes
+	 * @param[out] records Set to the first record following the header
+	 * @param[out] records_size Set to the size in bytes of the records
+	 * @return True if the records were written by this version and are intact
+	 */
+	static bool validate(const uint8_t *data, size_t size, const uint8_t *&records, size_t &records_size);
+
+	/**
+	 * @return The recorded objects, preceded by a ResourceRecordHeader
+	 */
 	std::vector<uint8_t> get_data();
 
-	const std::ostringstream &get_stream();
-
 	size_t register_shader_module(VkShaderStageFlagBits stage,
 	                              const ShaderSource &  glsl_source,
 	                              const std::string &   entry_point,
@@ -59,18 +103,34 @@ class ResourceRecord
 	                            const std::vector<LoadStoreInfo> &load_store_infos,
 	                            const std::vector<SubpassInfo> &  subpasses);
 
+	size_t register_descriptor_set_layout(const uint32_t                     set_index,
+	                                      const std::vector<ShaderModule *> &shader_modules,
+	                                      const std::vector<ShaderResource> &set_resources);
+
 	size_t register_graphics_pipeline(VkPipelineCache pipeline_cache,
 	                                  PipelineState & pipeline_state);
 
+	size_t register_compute_pipeline(VkPipelineCache pipeline_cache,
+	                                 PipelineState & pipeline_state);
+
 	void set_shader_module(size_t index, const ShaderModule &shader_module);
 
 	void set_pipeline_layout(size_t index, const PipelineLayout &pipeline_layout);
 
 	void set_render_pass(size_t index, const RenderPass &render_pass);
 
+	void set_descriptor_set_layout(size_t index, const DescriptorSetLayout &descriptor_set_layout);
+
 	void set_graphics_pipeline(size_t index, const GraphicsPipeline &graphics_pipeline);
 
+	void set_compute_pipeline(size_t index, const ComputePipeline &compute_pipeline);
+
   private:
+	/// Writes the state shared by graphics and compute pipeline records
+	void write_pipeline_state(std::ostringstream &record, PipelineState &pipeline_state);
+
+	std::mutex stream_mutex;
+
 	std::ostringstream stream;
 
 	std::vector<size_t> shader_module_indices;
@@ -79,14 +139,22 @@ class ResourceRecord
 
 	std::vector<size_t> render_pass_indices;
 
+	std::vector<size_t> descriptor_set_layout_indices;
+
 	std::vector<size_t> graphics_pipeline_indices;
 
+	std::vector<size_t> compute_pipeline_indices;
+
 	std::unordered_map<const ShaderModule *, size_t> shader_module_to_index;
 
 	std::unordered_map<const PipelineLayout *, size_t> pipeline_layout_to_index;
 
 	std::unordered_map<const RenderPass *, size_t> render_pass_to_index;
 
+	std::unordered_map<const DescriptorSetLayout *, size_t> descriptor_set_layout_to_index;
+
 	std::unordered_map<const GraphicsPipeline *, size_t> graphics_pipeline_to_index;
+
+	std::unordered_map<const ComputePipeline *, size_t> compute_pipeline_to_index;
 };
 }        // namespace vkb
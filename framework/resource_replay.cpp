@@ -17,6 +17,12 @@
 
 #include "resource_replay.h"
 
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+#include <ctpl_stl.h>
+
 #include "common/logging.h"
 #include "common/vk_common.h"
 #include "rendering/pipeline_state.h"
@@ -26,188 +32,524 @@ namespace vkb
 {
 namespace
 {
-inline void read_subpass_info(std::istringstream &is, std::vector<SubpassInfo> &value)
+/**
+ * @brief Read-only stream buffer over memory owned by the caller, so that records are parsed in place
+ */
+class MemoryStreamBuffer : public std::streambuf
 {
-	std::size_t size;
-	read(is, size);
-	value.resize(size);
-	for (SubpassInfo &subpass : value)
+  public:
+	void set(const uint8_t *data, size_t size)
 	{
-		read(is, subpass.input_attachments);
-		read(is, subpass.output_attachments);
+		auto begin = const_cast<char *>(reinterpret_cast<const char *>(data));
+		setg(begin, begin, begin + size);
 	}
+};
+
+/**
+ * @return Number of bytes left in the record being parsed
+ */
+inline size_t remaining(std::istream &is)
+{
+	auto available = is.rdbuf()->in_avail();
+
+	return available > 0 ? static_cast<size_t>(available) : 0;
 }
 
-inline void read_processes(std::istringstream &is, std::vector<std::string> &value)
+/**
+ * @brief Variant of read for values copied as bytes, which throws instead of reading past the end of the record
+ */
+template <class T>
+inline void read_checked(std::istream &is, T &value)
 {
-	std::size_t size;
-	read(is, size);
-	value.resize(size);
-	for (std::string &item : value)
+	static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be read as bytes");
+
+	if (remaining(is) < sizeof(T))
 	{
-		read(is, item);
+		throw std::runtime_error{"record is truncated"};
 	}
+
+	read(is, value);
 }
-}        // namespace
 
-ResourceReplay::ResourceReplay()
+inline void read_checked(std::istream &is, bool &value)
+{
+	uint8_t byte{};
+	read_checked(is, byte);
+
+	if (byte > 1)
+	{
+		throw std::runtime_error{"record holds an invalid boolean"};
+	}
+
+	value = byte != 0;
+}
+
+/**
+ * @brief Reads the number of elements of a container, which cannot be more than what is left of the record holds
+ * @param element_size Minimum size in bytes of an element
+ */
+inline size_t read_count(std::istream &is, size_t element_size)
+{
+	std::size_t count{};
+	read_checked(is, count);
+
+	if (count > remaining(is) / element_size)
+	{
+		throw std::runtime_error{"record holds a size larger than itself"};
+	}
+
+	return count;
+}
+
+inline void read_checked(std::istream &is, std::string &value)
+{
+	value.resize(read_count(is, 1));
+	is.read(&value[0], value.size());
+}
+
+template <class T>
+inline void read_checked(std::istream &is, std::vector<T> &value)
+{
+	static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be read as bytes");
+
+	value.resize(read_count(is, sizeof(T)));
+	is.read(reinterpret_cast<char *>(value.data()), value.size() * sizeof(T));
+}
+
+template <class T, class S>
+inline void read_checked(std::istream &is, std::map<T, S> &value)
+{
+	auto count = read_count(is, sizeof(T));
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		T key{};
+		S item{};
+		read_checked(is, key);
+		read_checked(is, item);
+
+		value.emplace(std::move(key), std::move(item));
+	}
+}
+
+template <class T, class... Args>
+inline void read_checked(std::istream &is, T &first_arg, Args &... args)
+{
+	read_checked(is, first_arg);
+
+	read_checked(is, args...);
+}
+
+/**
+ * @brief Checks that a record refers to an object recorded before it
+ */
+inline void check_index(size_t index, size_t count)
 {
-	stream_resources[ResourceType::ShaderModule]     = std::bind(&ResourceReplay::create_shader_module, this, std::placeholders::_1, std::placeholders::_2);
-	stream_resources[ResourceType::PipelineLayout]   = std::bind(&ResourceReplay::create_pipeline_layout, this, std::placeholders::_1, std::placeholders::_2);
-	stream_resources[ResourceType::RenderPass]       = std::bind(&ResourceReplay::create_render_pass, this, std::placeholders::_1, std::placeholders::_2);
-	stream_resources[ResourceType::GraphicsPipeline] = std::bind(&ResourceReplay::create_graphics_pipeline, this, std::placeholders::_1, std::placeholders::_2);
+	if (index >= count)
+	{
+		throw std::runtime_error{"record refers to an object that was not recorded before it"};
+	}
+}
+
+inline void check_indices(const std::vector<size_t> &indices, size_t count)
+{
+	for (auto index : indices)
+	{
+		check_index(index, count);
+	}
+}
+
+void read_record(std::istream &is, const ResourceRecords & /*records*/, ShaderModuleRecord &record)
+{
+	read_checked(is,
+	             record.stage,
+	             record.glsl_source,
+	             record.entry_point,
+	             record.preamble);
+
+	record.processes.resize(read_count(is, sizeof(std::size_t)));
+
+	for (std::string &process : record.processes)
+	{
+		read_checked(is, process);
+	}
+}
+
+void read_record(std::istream &is, const ResourceRecords &records, PipelineLayoutRecord &record)
+{
+	read_checked(is,
+	             record.shader_indices);
+
+	check_indices(record.shader_indices, records.shader_modules.size());
+}
+
+void read_record(std::istream &is, const ResourceRecords & /*records*/, RenderPassRecord &record)
+{
+	read_checked(is,
+	             record.attachments,
+	             record.load_store_infos);
+
+	// Every subpass holds at least the sizes of its two attachment lists
+	record.subpasses.resize(read_count(is, 2 * sizeof(std::size_t)));
+
+	for (SubpassInfo &subpass : record.subpasses)
+	{
+		read_checked(is,
+		             subpass.input_attachments,
+		             subpass.output_attachments);
+	}
+}
+
+void read_record(std::istream &is, const ResourceRecords &records, DescriptorSetLayoutRecord &record)
+{
+	read_checked(is,
+	             record.set_index,
+	             record.shader_indices);
+
+	check_indices(record.shader_indices, records.shader_modules.size());
+
+	record.set_resources.resize(read_count(is, sizeof(std::size_t)));
+
+	for (ShaderResource &item : record.set_resources)
+	{
+		read_checked(is,
+		             item.stages,
+		             item.type,
+		             item.mode,
+		             item.set,
+		             item.binding,
+		             item.location,
+		             item.input_attachment_index,
+		             item.vec_size,
+		             item.columns,
+		             item.array_size,
+		             item.offset,
+		             item.size,
+		             item.constant_id,
+		             item.qualifiers,
+		             item.name);
+	}
 }
 
-void ResourceReplay::play(ResourceCache &resource_cache, ResourceRecord &recorder)
+void read_record(std::istream &is, const ResourceRecords &records, PipelineRecord &record)
 {
-	std::istringstream stream{recorder.get_stream().str()};
+	read_checked(is,
+	             record.pipeline_layout_index,
+	             record.has_render_pass);
+
+	check_index(record.pipeline_layout_index, records.pipeline_layouts.size());
 
-	while (true)
+	if (record.has_render_pass)
 	{
-		// Read command id
-		ResourceType resource_type;
-		read(stream, resource_type);
+		read_checked(is,
+		             record.render_pass_index);
+
+		check_index(record.render_pass_index, records.render_passes.size());
+	}
+
+	read_checked(is,
+	             record.subpass_index,
+	             record.specialization_constant_state,
+	             record.vertex_input_state.attributes,
+	             record.vertex_input_state.bindings,
+	             record.input_assembly_state,
+	             record.rasterization_state,
+	             record.viewport_state,
+	             record.multisample_state,
+	             record.depth_stencil_state,
+	             record.color_blend_state.logic_op,
+	             record.color_blend_state.logic_op_enable,
+	             record.color_blend_state.attachments);
+}
+
+/**
+ * @brief Parses the payload of a record at the end of the records of its type
+ */
+template <class T>
+void read_record(std::istream &is, ResourceRecords &records, std::vector<T> &typed_records)
+{
+	T record{};
+	read_record(is, records, record);
+
+	typed_records.push_back(std::move(record));
+}
+}        // namespace
+
+ResourceReplay::ResourceReplay() = default;
+
+ResourceReplay::~ResourceReplay() = default;
+
+bool ResourceReplay::parse(const uint8_t *data, size_t size, ResourceRecords &records)
+{
+	records = {};
 
-		if (stream.eof())
+	MemoryStreamBuffer buffer;
+	std::istream       stream{&buffer};
+
+	const uint8_t *cursor = data;
+	const uint8_t *end    = data + size;
+
+	try
+	{
+		while (cursor != end)
 		{
-			break;
+			// Read command id and the size of its payload
+			ResourceType resource_type;
+			uint64_t     payload_size;
+
+			if (static_cast<size_t>(end - cursor) < sizeof(resource_type) + sizeof(payload_size))
+			{
+				throw std::runtime_error{"record is truncated"};
+			}
+
+			std::memcpy(&resource_type, cursor, sizeof(resource_type));
+			cursor += sizeof(resource_type);
+			std::memcpy(&payload_size, cursor, sizeof(payload_size));
+			cursor += sizeof(payload_size);
+
+			if (payload_size > static_cast<uint64_t>(end - cursor))
+			{
+				throw std::runtime_error{"record is truncated"};
+			}
+
+			buffer.set(cursor, static_cast<size_t>(payload_size));
+			stream.clear();
+
+			cursor += payload_size;
+
+			switch (resource_type)
+			{
+				case ResourceType::ShaderModule:
+					read_record(stream, records, records.shader_modules);
+					break;
+				case ResourceType::PipelineLayout:
+					read_record(stream, records, records.pipeline_layouts);
+					break;
+				case ResourceType::RenderPass:
+					read_record(stream, records, records.render_passes);
+					break;
+				case ResourceType::GraphicsPipeline:
+					read_record(stream, records, records.graphics_pipelines);
+					break;
+				case ResourceType::DescriptorSetLayout:
+					read_record(stream, records, records.descriptor_set_layouts);
+					break;
+				case ResourceType::ComputePipeline:
+					read_record(stream, records, records.compute_pipelines);
+					break;
+				default:
+					LOGW("Replay command not supported, skipping it.");
+					continue;
+			}
+
+			if (stream.fail() || remaining(stream) != 0)
+			{
+				throw std::runtime_error{"record does not match the size of its payload"};
+			}
+
+			records.order.push_back(resource_type);
 		}
+	}
+	catch (const std::exception &e)
+	{
+		LOGE("Replay record is malformed ({}), ignoring the resource cache data.", e.what());
+
+		records = {};
+
+		return false;
+	}
+
+	return true;
+}
+
+void ResourceReplay::play(ResourceCache &resource_cache, const uint8_t *data, size_t size)
+{
+	const uint8_t *records_data{nullptr};
+	size_t         records_size{0};
+
+	// Nothing was recorded yet on the first run
+	if (size == 0 || !ResourceRecord::validate(data, size, records_data, records_size))
+	{
+		return;
+	}
+
+	// Nothing is created unless every record can be replayed
+	ResourceRecords records;
+
+	if (!parse(records_data, records_size, records))
+	{
+		return;
+	}
+
+	shader_modules.clear();
+	pipeline_layouts.clear();
+	render_passes.clear();
+	descriptor_set_layouts.clear();
+	graphics_pipelines.clear();
+	compute_pipelines.clear();
+
+	auto thread_count = std::thread::hardware_concurrency();
+	thread_count      = thread_count == 0 ? 1 : thread_count;
+	thread_pool       = std::make_unique<ctpl::thread_pool>(thread_count);
 
-		// Find command function for the given command id
-		auto cmd_it = stream_resources.find(resource_type);
+	try
+	{
+		for (auto resource_type : records.order)
+		{
+			switch (resource_type)
+			{
+				case ResourceType::ShaderModule:
+					create_shader_module(resource_cache, records.shader_modules[shader_modules.size()]);
+					break;
+				case ResourceType::PipelineLayout:
+					create_pipeline_layout(resource_cache, records.pipeline_layouts[pipeline_layouts.size()]);
+					break;
+				case ResourceType::RenderPass:
+					create_render_pass(resource_cache, records.render_passes[render_passes.size()]);
+					break;
+				case ResourceType::GraphicsPipeline:
+					create_graphics_pipeline(resource_cache, records.graphics_pipelines[pending_graphics_pipelines.size()]);
+					break;
+				case ResourceType::DescriptorSetLayout:
+					create_descriptor_set_layout(resource_cache, records.descriptor_set_layouts[descriptor_set_layouts.size()]);
+					break;
+				case ResourceType::ComputePipeline:
+					create_compute_pipeline(resource_cache, records.compute_pipelines[pending_compute_pipelines.size()]);
+					break;
+			}
+		}
+	}
+	catch (const std::exception &e)
+	{
+		LOGE("Replay stopped ({}), the objects left are created when first requested.", e.what());
+	}
 
-		// Check if command replayer supports the given command
-		if (cmd_it != stream_resources.end())
+	// Wait for the pipelines still being built, a pipeline that failed is built again when first requested
+	for (auto &fut : pending_graphics_pipelines)
+	{
+		try
 		{
-			// Run command function
-			cmd_it->second(resource_cache, stream);
+			graphics_pipelines.push_back(fut.get());
 		}
-		else
+		catch (const std::exception &e)
 		{
-			LOGE("Replay command not supported.");
+			LOGE("Replay could not create a graphics pipeline ({}).", e.what());
 		}
 	}
-}
 
-void ResourceReplay::create_shader_module(ResourceCache &resource_cache, std::istringstream &stream)
-{
-	VkShaderStageFlagBits    stage{};
-	std::string              glsl_source;
-	std::string              entry_point;
-	std::string              preamble;
-	std::vector<std::string> processes;
+	for (auto &fut : pending_compute_pipelines)
+	{
+		try
+		{
+			compute_pipelines.push_back(fut.get());
+		}
+		catch (const std::exception &e)
+		{
+			LOGE("Replay could not create a compute pipeline ({}).", e.what());
+		}
+	}
 
-	read(stream,
-	     stage,
-	     glsl_source,
-	     entry_point,
-	     preamble);
+	pending_graphics_pipelines.clear();
+	pending_compute_pipelines.clear();
 
-	read_processes(stream, processes);
+	thread_pool.reset();
+}
 
+void ResourceReplay::create_shader_module(ResourceCache &resource_cache, const ShaderModuleRecord &record)
+{
 	ShaderSource shader_source{};
-	shader_source.set_source(std::move(glsl_source));
-	ShaderVariant shader_variant(std::move(preamble), std::move(processes));
+	shader_source.set_source(std::string{record.glsl_source});
+	ShaderVariant shader_variant(std::string{record.preamble}, std::vector<std::string>{record.processes});
+
+	auto stage = record.stage;
 
-	auto &shader_module = resource_cache.request_shader_module(stage, shader_source, shader_variant);
+	auto fut = thread_pool->push(
+	    [&resource_cache, stage, shader_source, shader_variant](size_t) {
+		    return &resource_cache.request_shader_module(stage, shader_source, shader_variant);
+	    });
 
-	shader_modules.push_back(&shader_module);
+	shader_modules.push_back(fut.share());
 }
 
-void ResourceReplay::create_pipeline_layout(ResourceCache &resource_cache, std::istringstream &stream)
+void ResourceReplay::create_pipeline_layout(ResourceCache &resource_cache, const PipelineLayoutRecord &record)
 {
-	std::vector<size_t> shader_indices;
-
-	read(stream,
-	     shader_indices);
-
-	std::vector<ShaderModule *> shader_stages(shader_indices.size());
-	std::transform(shader_indices.begin(), shader_indices.end(), shader_stages.begin(),
-	               [&](size_t shader_index) { return shader_modules.at(shader_index); });
+	std::vector<ShaderModule *> shader_stages(record.shader_indices.size());
+	std::transform(record.shader_indices.begin(), record.shader_indices.end(), shader_stages.begin(),
+	               [&](size_t shader_index) { return shader_modules[shader_index].get(); });
 
 	auto &pipeline_layout = resource_cache.request_pipeline_layout(shader_stages);
 
 	pipeline_layouts.push_back(&pipeline_layout);
 }
 
-void ResourceReplay::create_render_pass(ResourceCache &resource_cache, std::istringstream &stream)
+void ResourceReplay::create_render_pass(ResourceCache &resource_cache, const RenderPassRecord &record)
 {
-	std::vector<Attachment>    attachments;
-	std::vector<LoadStoreInfo> load_store_infos;
-	std::vector<SubpassInfo>   subpasses;
-
-	read(stream,
-	     attachments,
-	     load_store_infos);
-
-	read_subpass_info(stream, subpasses);
-
-	auto &render_pass = resource_cache.request_render_pass(attachments, load_store_infos, subpasses);
+	auto &render_pass = resource_cache.request_render_pass(record.attachments, record.load_store_infos, record.subpasses);
 
 	render_passes.push_back(&render_pass);
 }
 
-void ResourceReplay::create_graphics_pipeline(ResourceCache &resource_cache, std::istringstream &stream)
+void ResourceReplay::create_descriptor_set_layout(ResourceCache &resource_cache, const DescriptorSetLayoutRecord &record)
 {
-	size_t   pipeline_layout_index{};
-	size_t   render_pass_index{};
-	uint32_t subpass_index{};
+	std::vector<ShaderModule *> shader_stages(record.shader_indices.size());
+	std::transform(record.shader_indices.begin(), record.shader_indices.end(), shader_stages.begin(),
+	               [&](size_t shader_index) { return shader_modules[shader_index].get(); });
 
-	read(stream,
-	     pipeline_layout_index,
-	     render_pass_index,
-	     subpass_index);
+	auto &descriptor_set_layout = resource_cache.request_descriptor_set_layout(record.set_index, shader_stages, record.set_resources);
 
-	std::map<uint32_t, std::vector<uint8_t>> specialization_constant_state{};
-	read(stream,
-	     specialization_constant_state);
+	descriptor_set_layouts.push_back(&descriptor_set_layout);
+}
 
-	VertexInputState vertex_input_sate{};
+void ResourceReplay::create_graphics_pipeline(ResourceCache &resource_cache, const PipelineRecord &record)
+{
+	auto pipeline_state = create_pipeline_state(record);
 
-	read(stream,
-	     vertex_input_sate.attributes,
-	     vertex_input_sate.bindings);
+	auto fut = thread_pool->push(
+	    [&resource_cache, pipeline_state](size_t) mutable -> const GraphicsPipeline * {
+		    return &resource_cache.request_graphics_pipeline(pipeline_state);
+	    });
 
-	InputAssemblyState input_assembly_state{};
-	RasterizationState rasterization_state{};
-	ViewportState      viewport_state{};
-	MultisampleState   multisample_state{};
-	DepthStencilState  depth_stencil_state{};
+	pending_graphics_pipelines.push_back(std::move(fut));
+}
 
-	read(stream,
-	     input_assembly_state,
-	     rasterization_state,
-	     viewport_state,
-	     multisample_state,
-	     depth_stencil_state);
+void ResourceReplay::create_compute_pipeline(ResourceCache &resource_cache, const PipelineRecord &record)
+{
+	auto pipeline_state = create_pipeline_state(record);
 
-	ColorBlendState color_blend_state{};
+	auto fut = thread_pool->push(
+	    [&resource_cache, pipeline_state](size_t) mutable -> const ComputePipeline * {
+		    return &resource_cache.request_compute_pipeline(pipeline_state);
+	    });
 
-	read(stream,
-	     color_blend_state.logic_op,
-	     color_blend_state.logic_op_enable,
-	     color_blend_state.attachments);
+	pending_compute_pipelines.push_back(std::move(fut));
+}
 
+PipelineState ResourceReplay::create_pipeline_state(const PipelineRecord &record)
+{
 	PipelineState pipeline_state{};
-	pipeline_state.set_pipeline_layout(*pipeline_layouts.at(pipeline_layout_index));
-	pipeline_state.set_render_pass(*render_passes.at(render_pass_index));
 
-	for (auto &item : specialization_constant_state)
+	// Indices were checked against the records before this one when parsing
+	pipeline_state.set_pipeline_layout(*pipeline_layouts[record.pipeline_layout_index]);
+
+	if (record.has_render_pass)
 	{
-		pipeline_state.set_specialization_constant(item.first, item.second);
+		pipeline_state.set_render_pass(*render_passes[record.render_pass_index]);
 	}
 
-	pipeline_state.set_subpass_index(subpass_index);
-	pipeline_state.set_vertex_input_state(vertex_input_sate);
-	pipeline_state.set_input_assembly_state(input_assembly_state);
-	pipeline_state.set_rasterization_state(rasterization_state);
-	pipeline_state.set_viewport_state(viewport_state);
-	pipeline_state.set_multisample_state(multisample_state);
-	pipeline_state.set_depth_stencil_state(depth_stencil_state);
-	pipeline_state.set_color_blend_state(color_blend_state);
+	for (auto &item : record.specialization_constant_state)
+	{
+		pipeline_state.set_specialization_constant(item.first, item.second);
+	}
 
-	auto &graphics_pipeline = resource_cache.request_graphics_pipeline(pipeline_state);
+	pipeline_state.set_subpass_index(record.subpass_index);
+	pipeline_state.set_vertex_input_state(record.vertex_input_state);
+	pipeline_state.set_input_assembly_state(record.input_assembly_state);
+	pipeline_state.set_rasterization_state(record.rasterization_state);
+	pipeline_state.set_viewport_state(record.viewport_state);
+	pipeline_state.set_multisample_state(record.multisample_state);
+	pipeline_state.set_depth_stencil_state(record.depth_stencil_state);
+	pipeline_state.set_color_blend_state(record.color_blend_state);
 
-	graphics_pipelines.push_back(&graphics_pipeline);
+	return pipeline_state;
 }
 }        // namespace vkb
@@ -17,42 +17,177 @@
 
 #pragma once
 
+#include <future>
+
 #include "resource_record.h"
 
+namespace ctpl
+{
+class thread_pool;
+}
+
 namespace vkb
 {
 class ResourceCache;
 
+struct ShaderModuleRecord
+{
+	VkShaderStageFlagBits stage{};
+
+	std::string glsl_source;
+
+	std::string entry_point;
+
+	std::string preamble;
+
+	std::vector<std::string> processes;
+};
+
+struct PipelineLayoutRecord
+{
+	/// Shader modules, as indices of the shader module records before it
+	std::vector<size_t> shader_indices;
+};
+
+struct RenderPassRecord
+{
+	std::vector<Attachment> attachments;
+
+	std::vector<LoadStoreInfo> load_store_infos;
+
+	std::vector<SubpassInfo> subpasses;
+};
+
+struct DescriptorSetLayoutRecord
+{
+	uint32_t set_index{};
+
+	/// Shader modules, as indices of the shader module records before it
+	std::vector<size_t> shader_indices;
+
+	std::vector<ShaderResource> set_resources;
+};
+
+/**
+ * @brief State of a graphics or compute pipeline, which refers to the layout and render pass records before it
+ */
+struct PipelineRecord
+{
+	size_t pipeline_layout_index{};
+
+	bool has_render_pass{};
+
+	size_t render_pass_index{};
+
+	uint32_t subpass_index{};
+
+	std::map<uint32_t, std::vector<uint8_t>> specialization_constant_state;
+
+	VertexInputState vertex_input_state;
+
+	InputAssemblyState input_assembly_state;
+
+	RasterizationState rasterization_state;
+
+	ViewportState viewport_state;
+
+	MultisampleState multisample_state;
+
+	DepthStencilState depth_stencil_state;
+
+	ColorBlendState color_blend_state;
+};
+
+/**
+ * @brief Every record of serialized data, grouped by type
+ */
+struct ResourceRecords
+{
+	/// Type of every record in the order they were recorded, which is the order they are created in
+	std::vector<ResourceType> order;
+
+	std::vector<ShaderModuleRecord> shader_modules;
+
+	std::vector<PipelineLayoutRecord> pipeline_layouts;
+
+	std::vector<RenderPassRecord> render_passes;
+
+	std::vector<DescriptorSetLayoutRecord> descriptor_set_layouts;
+
+	std::vector<PipelineRecord> graphics_pipelines;
+
+	std::vector<PipelineRecord> compute_pipelines;
+};
+
 /**
  * @brief Reads Vulkan objects from a memory stream and creates them in the resource cache.
+ * Shader modules are compiled and pipelines are created on a thread pool. Each pipeline is
+ * queued as soon as the shader modules, pipeline layout and render pass it depends on exist.
+ *
+ * Every record is parsed and checked before any object is created, so that data that cannot
+ * be replayed is rejected as a whole and the cache starts cold instead.
  */
 class ResourceReplay
 {
   public:
 	ResourceReplay();
 
-	void play(ResourceCache &resource_cache, ResourceRecord &recorder);
+	~ResourceReplay();
+
+	/**
+	 * @brief Creates the recorded objects in the resource cache.
+	 *        Data written by another version of the framework, truncated or corrupted is ignored.
+	 *        If creating an object fails, the replay stops and the objects left are created when first requested.
+	 * @param resource_cache The cache to warm up
+	 * @param data Data returned by ResourceRecord::get_data, it is read in place and must outlive the call
+	 * @param size Size of the data in bytes
+	 */
+	void play(ResourceCache &resource_cache, const uint8_t *data, size_t size);
+
+	/**
+	 * @brief Parses serialized records without creating anything. Sizes are checked against the
+	 *        data left in their record and indices against the records before them.
+	 * @param data Records following a ResourceRecordHeader, as validated by ResourceRecord::validate
+	 * @param size Size of the records in bytes
+	 * @param[out] records The parsed records, left empty if any of them is malformed
+	 * @return True if every record could be parsed
+	 */
+	static bool parse(const uint8_t *data, size_t size, ResourceRecords &records);
 
   protected:
-	void create_shader_module(ResourceCache &resource_cache, std::istringstream &stream);
+	void create_shader_module(ResourceCache &resource_cache, const ShaderModuleRecord &record);
+
+	void create_pipeline_layout(ResourceCache &resource_cache, const PipelineLayoutRecord &record);
 
-	void create_pipeline_layout(ResourceCache &resource_cache, std::istringstream &stream);
+	void create_render_pass(ResourceCache &resource_cache, const RenderPassRecord &record);
 
-	void create_render_pass(ResourceCache &resource_cache, std::istringstream &stream);
+	void create_graphics_pipeline(ResourceCache &resource_cache, const PipelineRecord &record);
 
-	void create_graphics_pipeline(ResourceCache &resource_cache, std::istringstream &stream);
+	void create_descriptor_set_layout(ResourceCache &resource_cache, const DescriptorSetLayoutRecord &record);
+
+	void create_compute_pipeline(ResourceCache &resource_cache, const PipelineRecord &record);
 
   private:
-	using ResourceFunc = std::function<void(ResourceCache &, std::istringstream &)>;
+	/// Builds the state shared by graphics and compute pipelines
+	PipelineState create_pipeline_state(const PipelineRecord &record);
 
-	std::unordered_map<ResourceType, ResourceFunc> stream_resources;
+	/// Worker threads, only alive for the duration of play
+	std::unique_ptr<ctpl::thread_pool> thread_pool;
 
-	std::vector<ShaderModule *> shader_modules;
+	std::vector<std::shared_future<ShaderModule *>> shader_modules;
 
 	std::vector<PipelineLayout *> pipeline_layouts;
 
 	std::vector<const RenderPass *> render_passes;
 
+	std::vector<std::future<const GraphicsPipeline *>> pending_graphics_pipelines;
+
+	std::vector<const DescriptorSetLayout *> descriptor_set_layouts;
+
 	std::vector<const GraphicsPipeline *> graphics_pipelines;
+
+	std::vector<std::future<const ComputePipeline *>> pending_compute_pipelines;
+
+	std::vector<const ComputePipeline *> compute_pipelines;
 };
 }        // namespace vkb
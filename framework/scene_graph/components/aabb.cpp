@@ -17,6 +17,8 @@
 
 #include "aabb.h"
 
+#include <limits>
+
 #include "common/logging.h"
 
 namespace vkb
@@ -68,16 +70,20 @@ void AABB::update(const std::vector<glm::vec3> &vertex_data, const std::vector<u
 
 void AABB::transform(glm::mat4 &transform)
 {
-	min = max = glm::vec4(min, 1.0f) * transform;
-
-	// Update bounding box for the remaining 7 corners of the box
-	update(glm::vec4(min.x, min.y, max.z, 1.0f) * transform);
-	update(glm::vec4(min.x, max.y, min.z, 1.0f) * transform);
-	update(glm::vec4(min.x, max.y, max.z, 1.0f) * transform);
-	update(glm::vec4(max.x, min.y, min.z, 1.0f) * transform);
-	update(glm::vec4(max.x, min.y, max.z, 1.0f) * transform);
-	update(glm::vec4(max.x, max.y, min.z, 1.0f) * transform);
-	update(glm::vec4(max, 1.0f) * transform);
+	glm::vec3 old_min = min;
+	glm::vec3 old_max = max;
+
+	reset();
+
+	// Update bounding box with the 8 transformed corners of the previous box
+	update(transform * glm::vec4(old_min.x, old_min.y, old_min.z, 1.0f));
+	update(transform * glm::vec4(old_min.x, old_min.y, old_max.z, 1.0f));
+	update(transform * glm::vec4(old_min.x, old_max.y, old_min.z, 1.0f));
+	update(transform * glm::vec4(old_min.x, old_max.y, old_max.z, 1.0f));
+	update(transform * glm::vec4(old_max.x, old_min.y, old_min.z, 1.0f));
+	update(transform * glm::vec4(old_max.x, old_min.y, old_max.z, 1.0f));
+	update(transform * glm::vec4(old_max.x, old_max.y, old_min.z, 1.0f));
+	update(transform * glm::vec4(old_max.x, old_max.y, old_max.z, 1.0f));
 }
 
 glm::vec3 AABB::get_scale() const
@@ -102,9 +108,9 @@ glm::vec3 AABB::get_max() const
 
 void AABB::reset()
 {
-	min = std::numeric_limits<glm::vec3>::max();
+	min = glm::vec3{std::numeric_limits<float>::max()};
 
-	max = std::numeric_limits<glm::vec3>::min();
+	max = glm::vec3{std::numeric_limits<float>::lowest()};
 }
 
 }        // namespace sg
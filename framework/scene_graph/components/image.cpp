@@ -17,13 +17,26 @@
 
 #include "image.h"
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <future>
 #include <mutex>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	include <emmintrin.h>
+#	define MIPMAP_SSE
+#elif defined(__ARM_NEON)
+#	include <arm_neon.h>
+#	define MIPMAP_NEON
+#endif
+
 #include "common/error.h"
 
 VKBP_DISABLE_WARNINGS()
-#define STB_IMAGE_RESIZE_IMPLEMENTATION
-#include <stb_image_resize.h>
+#include "common/glm_common.h"
+#include <ctpl_stl.h>
 VKBP_ENABLE_WARNINGS()
 
 #include "common/utils.h"
@@ -36,6 +49,232 @@ namespace vkb
 {
 namespace sg
 {
+namespace
+{
+/// Texels a mipmap generation task filters at least, smaller levels are filtered on the calling thread
+constexpr size_t min_texels_per_task{64 * 1024};
+
+/// Scales 8-bit UNORM values to [0, 1]
+constexpr float unorm_scale{1.0f / 255.0f};
+
+/// Source texels covered by a destination texel along one axis, and how much each one contributes
+struct BoxFilterTaps
+{
+	uint32_t first{0};
+
+	uint32_t count{0};
+
+	std::array<float, 4> weights{};
+};
+
+/**
+ * @brief Computes the taps of a box filter that shrinks an axis, weighting every source texel by how much
+ *        of it the destination texel covers. Odd sizes give three or four taps instead of two.
+ */
+std::vector<BoxFilterTaps> compute_box_filter(uint32_t source_size, uint32_t destination_size)
+{
+	std::vector<BoxFilterTaps> filter(destination_size);
+
+	float ratio = static_cast<float>(source_size) / destination_size;
+
+	for (uint32_t i = 0; i < destination_size; ++i)
+	{
+		float begin = i * ratio;
+		float end   = (i + 1) * ratio;
+
+		auto &taps = filter[i];
+		taps.first = static_cast<uint32_t>(begin);
+
+		for (uint32_t texel = taps.first; texel < source_size && texel < end && taps.count < taps.weights.size(); ++texel)
+		{
+			float coverage = std::min(end, texel + 1.0f) - std::max(begin, static_cast<float>(texel));
+
+			taps.weights[taps.count++] = coverage / ratio;
+		}
+	}
+
+	return filter;
+}
+
+/// Linear values of the 8-bit sRGB values
+const std::array<float, 256> &get_srgb_to_linear_table()
+{
+	static const std::array<float, 256> table = [] {
+		std::array<float, 256> values;
+		for (size_t i = 0; i < values.size(); ++i)
+		{
+			float srgb = i / 255.0f;
+			values[i]  = srgb <= 0.04045f ? srgb / 12.92f : std::pow((srgb + 0.055f) / 1.055f, 2.4f);
+		}
+		return values;
+	}();
+
+	return table;
+}
+
+/// Linear values halfway between consecutive 8-bit sRGB values, which encoding rounds at
+const std::array<float, 255> &get_linear_to_srgb_thresholds()
+{
+	static const std::array<float, 255> table = [] {
+		std::array<float, 255> values;
+		for (size_t i = 0; i < values.size(); ++i)
+		{
+			float srgb = (i + 0.5f) / 255.0f;
+			values[i]  = srgb <= 0.04045f ? srgb / 12.92f : std::pow((srgb + 0.055f) / 1.055f, 2.4f);
+		}
+		return values;
+	}();
+
+	return table;
+}
+
+bool is_srgb(VkFormat format)
+{
+	return format == VK_FORMAT_R8G8B8A8_SRGB || format == VK_FORMAT_B8G8R8A8_SRGB;
+}
+
+#if defined(MIPMAP_SSE)
+/**
+ * @brief Loads an RGBA8 texel as four floats in [0, 1], with linear color channels if srgb
+ */
+inline __m128 load_texel(const uint8_t *texel, bool srgb, const std::array<float, 256> &srgb_to_linear)
+{
+	if (srgb)
+	{
+		return _mm_setr_ps(srgb_to_linear[texel[0]], srgb_to_linear[texel[1]], srgb_to_linear[texel[2]], texel[3] * unorm_scale);
+	}
+
+	int32_t packed;
+	std::memcpy(&packed, texel, sizeof(packed));
+
+	__m128i bytes = _mm_cvtsi32_si128(packed);
+	__m128i words = _mm_unpacklo_epi8(bytes, _mm_setzero_si128());
+
+	return _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(words, _mm_setzero_si128())), _mm_set1_ps(unorm_scale));
+}
+#elif defined(MIPMAP_NEON)
+/**
+ * @brief Loads an RGBA8 texel as four floats in [0, 1], with linear color channels if srgb
+ */
+inline float32x4_t load_texel(const uint8_t *texel, bool srgb, const std::array<float, 256> &srgb_to_linear)
+{
+	if (srgb)
+	{
+		float values[4] = {srgb_to_linear[texel[0]], srgb_to_linear[texel[1]], srgb_to_linear[texel[2]], texel[3] * unorm_scale};
+		return vld1q_f32(values);
+	}
+
+	uint32_t packed;
+	std::memcpy(&packed, texel, sizeof(packed));
+
+	uint16x8_t words = vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(packed)));
+
+	return vmulq_n_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(words))), unorm_scale);
+}
+#endif
+
+/**
+ * @brief Filters rows [first_row, last_row) of a mip level from the previous level. Texels are
+ *        accumulated as four float lanes, so each filter tap is a single vector multiply-add,
+ *        with SSE or NEON where available.
+ */
+void downsample_rows(const uint8_t *source, const VkExtent3D &source_extent, uint8_t *destination, const VkExtent3D &destination_extent,
+                     const std::vector<BoxFilterTaps> &filter_x, const std::vector<BoxFilterTaps> &filter_y, bool srgb,
+                     uint32_t first_row, uint32_t last_row)
+{
+	auto &srgb_to_linear = get_srgb_to_linear_table();
+	auto &thresholds     = get_linear_to_srgb_thresholds();
+
+#if !defined(MIPMAP_SSE) && !defined(MIPMAP_NEON)
+	auto decode = [&](const uint8_t *texel) {
+		if (srgb)
+		{
+			return glm::vec4{srgb_to_linear[texel[0]], srgb_to_linear[texel[1]], srgb_to_linear[texel[2]], texel[3] * unorm_scale};
+		}
+		return glm::vec4{texel[0], texel[1], texel[2], texel[3]} * unorm_scale;
+	};
+#endif
+
+	auto encode_srgb = [&](float value) {
+		return static_cast<uint8_t>(std::upper_bound(thresholds.begin(), thresholds.end(), value) - thresholds.begin());
+	};
+
+	auto encode_unorm = [](float value) {
+		return static_cast<uint8_t>(glm::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+	};
+
+	std::vector<glm::vec4> row(destination_extent.width);
+
+	for (uint32_t y = first_row; y < last_row; ++y)
+	{
+		std::fill(row.begin(), row.end(), glm::vec4{0.0f});
+
+		auto &taps_y = filter_y[y];
+
+		for (uint32_t tap_y = 0; tap_y < taps_y.count; ++tap_y)
+		{
+			const uint8_t *source_row = source + static_cast<size_t>(taps_y.first + tap_y) * source_extent.width * 4;
+
+			for (uint32_t x = 0; x < destination_extent.width; ++x)
+			{
+				auto &taps_x = filter_x[x];
+
+#if defined(MIPMAP_SSE)
+				__m128 sum = _mm_setzero_ps();
+				for (uint32_t tap_x = 0; tap_x < taps_x.count; ++tap_x)
+				{
+					__m128 texel = load_texel(source_row + (taps_x.first + tap_x) * 4, srgb, srgb_to_linear);
+					sum          = _mm_add_ps(sum, _mm_mul_ps(texel, _mm_set1_ps(taps_x.weights[tap_x])));
+				}
+
+				__m128 accumulated = _mm_loadu_ps(&row[x].x);
+				_mm_storeu_ps(&row[x].x, _mm_add_ps(accumulated, _mm_mul_ps(sum, _mm_set1_ps(taps_y.weights[tap_y]))));
+#elif defined(MIPMAP_NEON)
+				float32x4_t sum = vdupq_n_f32(0.0f);
+				for (uint32_t tap_x = 0; tap_x < taps_x.count; ++tap_x)
+				{
+					float32x4_t texel = load_texel(source_row + (taps_x.first + tap_x) * 4, srgb, srgb_to_linear);
+					sum               = vmlaq_n_f32(sum, texel, taps_x.weights[tap_x]);
+				}
+
+				vst1q_f32(&row[x].x, vmlaq_n_f32(vld1q_f32(&row[x].x), sum, taps_y.weights[tap_y]));
+#else
+				glm::vec4 sum{0.0f};
+				for (uint32_t tap_x = 0; tap_x < taps_x.count; ++tap_x)
+				{
+					sum += decode(source_row + (taps_x.first + tap_x) * 4) * taps_x.weights[tap_x];
+				}
+
+				row[x] += sum * taps_y.weights[tap_y];
+#endif
+			}
+		}
+
+		uint8_t *destination_row = destination + static_cast<size_t>(y) * destination_extent.width * 4;
+
+		for (uint32_t x = 0; x < destination_extent.width; ++x)
+		{
+			auto &texel = row[x];
+
+			if (srgb)
+			{
+				destination_row[x * 4]     = encode_srgb(texel.r);
+				destination_row[x * 4 + 1] = encode_srgb(texel.g);
+				destination_row[x * 4 + 2] = encode_srgb(texel.b);
+			}
+			else
+			{
+				destination_row[x * 4]     = encode_unorm(texel.r);
+				destination_row[x * 4 + 1] = encode_unorm(texel.g);
+				destination_row[x * 4 + 2] = encode_unorm(texel.b);
+			}
+
+			destination_row[x * 4 + 3] = encode_unorm(texel.a);
+		}
+	}
+}
+}        // namespace
+
 bool is_astc(const VkFormat format)
 {
 	return (format == VK_FORMAT_ASTC_4x4_UNORM_BLOCK ||
@@ -132,7 +371,8 @@ void Image::create_vk_image(Device &device, VkImageViewType image_view_type, VkI
 	                                         VK_IMAGE_TILING_OPTIMAL,
 	                                         flags);
 
-	vk_image_view = std::make_unique<core::ImageView>(*vk_image, image_view_type);
+	vk_image_view      = std::make_unique<core::ImageView>(*vk_image, image_view_type);
+	vk_image_view_type = image_view_type;
 }
 
 const core::Image &Image::get_vk_image() const
@@ -147,53 +387,105 @@ const core::ImageView &Image::get_vk_image_view() const
 	return *vk_image_view;
 }
 
+std::unique_ptr<core::ImageView> Image::set_base_mip_level(uint32_t base_mip_level)
+{
+	assert(vk_image && "Vulkan image was not created");
+	assert(base_mip_level < mipmaps.size() && "Mip level out of range");
+
+	// The level count must be explicit, as the view would otherwise cover as many levels as the image
+	auto image_view = std::make_unique<core::ImageView>(*vk_image, vk_image_view_type, VK_FORMAT_UNDEFINED,
+	                                                    base_mip_level, 0, to_u32(mipmaps.size()) - base_mip_level);
+
+	std::swap(vk_image_view, image_view);
+	this->base_mip_level = base_mip_level;
+
+	return image_view;
+}
+
+uint32_t Image::get_base_mip_level() const
+{
+	return base_mip_level;
+}
+
 Mipmap &Image::get_mipmap(const size_t index)
 {
 	return mipmaps.at(index);
 }
 
 void Image::generate_mipmaps()
+{
+	generate_mipmaps(is_srgb(format));
+}
+
+void Image::generate_mipmaps(bool srgb)
 {
 	assert(mipmaps.size() == 1 && "Mipmaps already generated");
 
-	if (mipmaps.size() > 1)
+	auto extent = get_extent();
+
+	if (mipmaps.size() > 1 || (extent.width == 1 && extent.height == 1))
 	{
 		return;        // Do not generate again
 	}
 
-	auto extent      = get_extent();
-	auto next_width  = std::max<uint32_t>(1u, extent.width / 2);
-	auto next_height = std::max<uint32_t>(1u, extent.height / 2);
-	auto channels    = 4;
-	auto next_size   = next_width * next_height * channels;
+	const uint32_t channels = 4;
 
-	while (true)
-	{
-		// Make space for next mipmap
-		auto old_size = to_u32(data.size());
-		data.resize(old_size + next_size);
+	// Lay out the whole chain first, so that the data is only allocated once
+	size_t size = data.size();
 
+	while (mipmaps.back().extent.width > 1 || mipmaps.back().extent.height > 1)
+	{
 		auto &prev_mipmap = mipmaps.back();
-		// Update mipmaps
+
 		Mipmap next_mipmap{};
 		next_mipmap.level  = prev_mipmap.level + 1;
-		next_mipmap.offset = old_size;
-		next_mipmap.extent = {next_width, next_height, 1u};
+		next_mipmap.offset = to_u32(size);
+		next_mipmap.extent = {std::max<uint32_t>(1u, prev_mipmap.extent.width / 2),
+		                      std::max<uint32_t>(1u, prev_mipmap.extent.height / 2),
+		                      1u};
+
+		size += static_cast<size_t>(next_mipmap.extent.width) * next_mipmap.extent.height * channels;
+
+		mipmaps.push_back(next_mipmap);
+	}
 
-		// Fill next mipmap memory
-		stbir_resize_uint8(data.data() + prev_mipmap.offset, prev_mipmap.extent.width, prev_mipmap.extent.height, 0,
-		                   data.data() + next_mipmap.offset, next_mipmap.extent.width, next_mipmap.extent.height, 0, channels);
+	data.resize(size);
+
+	auto &thread_pool = get_thread_pool();
+
+	for (size_t level = 1; level < mipmaps.size(); ++level)
+	{
+		auto &prev_mipmap = mipmaps[level - 1];
+		auto &mipmap      = mipmaps[level];
 
-		mipmaps.emplace_back(std::move(next_mipmap));
+		auto filter_x = compute_box_filter(prev_mipmap.extent.width, mipmap.extent.width);
+		auto filter_y = compute_box_filter(prev_mipmap.extent.height, mipmap.extent.height);
 
-		// Next mipmap values
-		next_width  = std::max<uint32_t>(1u, next_width / 2);
-		next_height = std::max<uint32_t>(1u, next_height / 2);
-		next_size   = next_width * next_height * channels;
+		const uint8_t *source      = data.data() + prev_mipmap.offset;
+		uint8_t *      destination = data.data() + mipmap.offset;
 
-		if (next_width == 1 && next_height == 1)
+		uint32_t rows_per_task = to_u32(std::max<size_t>(1, min_texels_per_task / mipmap.extent.width));
+
+		if (rows_per_task >= mipmap.extent.height)
 		{
-			break;
+			downsample_rows(source, prev_mipmap.extent, destination, mipmap.extent, filter_x, filter_y, srgb, 0, mipmap.extent.height);
+			continue;
+		}
+
+		std::vector<std::future<void>> row_futures;
+
+		for (uint32_t first_row = 0; first_row < mipmap.extent.height; first_row += rows_per_task)
+		{
+			uint32_t last_row = std::min(first_row + rows_per_task, mipmap.extent.height);
+
+			row_futures.push_back(thread_pool.push([&, first_row, last_row](size_t) {
+				downsample_rows(source, prev_mipmap.extent, destination, mipmap.extent, filter_x, filter_y, srgb, first_row, last_row);
+			}));
+		}
+
+		for (auto &fut : row_futures)
+		{
+			fut.get();
 		}
 	}
 }
@@ -203,6 +495,14 @@ std::vector<Mipmap> &Image::get_mut_mipmaps()
 	return mipmaps;
 }
 
+ctpl::thread_pool &Image::get_thread_pool()
+{
+	// Images are loaded from other thread pools, whose tasks may wait on this one
+	static ctpl::thread_pool thread_pool{static_cast<int>(std::max(1u, std::thread::hardware_concurrency()))};
+
+	return thread_pool;
+}
+
 std::vector<uint8_t> &Image::get_mut_data()
 {
 	return data;
@@ -248,26 +548,27 @@ std::unique_ptr<Image> Image::load(const std::string &name, const std::string &u
 {
 	std::unique_ptr<Image> image{nullptr};
 
-	auto data = fs::read_asset(uri);
+	// Decoders read the file in place, it is never copied into memory as a whole
+	auto file = fs::map_asset(uri);
 
 	// Get extension
 	auto extension = get_extension(uri);
 
 	if (extension == "png" || extension == "jpg")
 	{
-		image = std::make_unique<Stb>(name, data);
+		image = std::make_unique<Stb>(name, file.data(), file.size());
 	}
 	else if (extension == "astc")
 	{
-		image = std::make_unique<Astc>(name, data);
+		image = std::make_unique<Astc>(name, file.data(), file.size());
 	}
 	else if (extension == "ktx")
 	{
-		image = std::make_unique<Ktx>(name, data);
+		image = std::make_unique<Ktx>(name, file.data(), file.size());
 	}
 	else if (extension == "ktx2")
 	{
-		image = std::make_unique<Ktx>(name, data);
+		image = std::make_unique<Ktx>(name, file.data(), file.size());
 	}
 
 	return image;
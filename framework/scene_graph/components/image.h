@@ -28,6 +28,11 @@
 #include "core/image_view.h"
 #include "scene_graph/component.h"
 
+namespace ctpl
+{
+class thread_pool;
+}        // namespace ctpl
+
 namespace vkb
 {
 namespace sg
@@ -78,14 +83,35 @@ class Image : public Component
 
 	const std::vector<std::vector<VkDeviceSize>> &get_offsets() const;
 
+	/**
+	 * @brief Generates the full mip chain of an RGBA8 image with a box filter, splitting large levels
+	 *        across worker threads. Color channels of sRGB formats are filtered in linear space.
+	 */
 	void generate_mipmaps();
 
+	/**
+	 * @brief Generates the full mip chain of an RGBA8 image
+	 * @param srgb Whether the color channels are sRGB encoded and should be filtered in linear space,
+	 *        for images whose format doesn't say so
+	 */
+	void generate_mipmaps(bool srgb);
+
 	void create_vk_image(Device &device, VkImageViewType image_view_type = VK_IMAGE_VIEW_TYPE_2D, VkImageCreateFlags flags = 0);
 
 	const core::Image &get_vk_image() const;
 
 	const core::ImageView &get_vk_image_view() const;
 
+	/**
+	 * @brief Replaces the image view with one that starts at another mip level, so that levels
+	 *        that are not uploaded yet are never sampled
+	 * @param base_mip_level Finest mip level the new view covers
+	 * @return The previous view, which descriptor sets in flight may still refer to
+	 */
+	std::unique_ptr<core::ImageView> set_base_mip_level(uint32_t base_mip_level);
+
+	uint32_t get_base_mip_level() const;
+
   protected:
 	std::vector<uint8_t> &get_mut_data();
 
@@ -107,6 +133,11 @@ class Image : public Component
 
 	std::vector<Mipmap> &get_mut_mipmaps();
 
+	/**
+	 * @return Threads shared by all images, for splitting up work on a single image
+	 */
+	static ctpl::thread_pool &get_thread_pool();
+
   private:
 	std::vector<uint8_t> data;
 
@@ -122,6 +153,10 @@ class Image : public Component
 	std::unique_ptr<core::Image> vk_image;
 
 	std::unique_ptr<core::ImageView> vk_image_view;
+
+	VkImageViewType vk_image_view_type{VK_IMAGE_VIEW_TYPE_2D};
+
+	uint32_t base_mip_level{0};
 };
 
 }        // namespace sg
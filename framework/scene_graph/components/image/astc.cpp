@@ -17,7 +17,13 @@
 
 #include "scene_graph/components/image/astc.h"
 
+#include <cstdio>
+#include <fstream>
+#include <future>
+#include <iomanip>
 #include <mutex>
+#include <sstream>
+#include <thread>
 
 #include "common/error.h"
 
@@ -28,14 +34,31 @@ VKBP_DISABLE_WARNINGS()
 #	undef IGNORE
 #endif
 #include <astc_codec_internals.h>
+#include <ctpl_stl.h>
 VKBP_ENABLE_WARNINGS()
 
+#include "common/helpers.h"
+#include "common/logging.h"
+#include "platform/filesystem.h"
+
 #define MAGIC_FILE_CONSTANT 0x5CA1AB13
 
 namespace vkb
 {
 namespace sg
 {
+namespace
+{
+/// Identifies decoded image cache files, bump the version when the decoder output changes
+constexpr uint32_t decode_cache_magic{0x43435341};
+constexpr uint32_t decode_cache_version{1};
+
+/// Blocks a decoding task handles at least, smaller images are decoded on the calling thread
+constexpr int min_blocks_per_task{1024};
+}        // namespace
+
+std::atomic<bool> Astc::decode_cache_enabled{true};
+
 BlockDim to_blockdim(const VkFormat format)
 {
 	switch (format)
@@ -144,14 +167,38 @@ void Astc::decode(BlockDim blockdim, VkExtent3D extent, const uint8_t *data_)
 	int yblocks = (ysize + ydim - 1) / ydim;
 	int zblocks = (zsize + zdim - 1) / zdim;
 
+	// Cached images are keyed by their compressed data, so that renamed or duplicated files share an entry
+	std::string cache_filename;
+
+	if (decode_cache_enabled)
+	{
+		size_t data_size = static_cast<size_t>(xblocks) * yblocks * zblocks * 16;
+
+		uint64_t hash = fnv1a_64(&blockdim, sizeof(blockdim));
+		hash          = fnv1a_64(&extent, sizeof(extent), hash);
+		hash          = fnv1a_64(data_, data_size, hash);
+
+		std::stringstream filename;
+		filename << std::hex << std::setw(16) << std::setfill('0') << hash << ".rgba";
+		cache_filename = filename.str();
+
+		if (load_decode_cache(cache_filename))
+		{
+			return;
+		}
+	}
+
 	auto astc_image = allocate_image(bitness, xsize, ysize, zsize, 0);
 	initialize_image(astc_image);
 
-	imageblock pb;
-	for (int z = 0; z < zblocks; z++)
-	{
-		for (int y = 0; y < yblocks; y++)
+	// Blocks write disjoint texels, so rows of blocks can be decoded concurrently
+	auto decode_rows = [&](int first_row, int last_row) {
+		imageblock pb;
+		for (int row = first_row; row < last_row; row++)
 		{
+			int z = row / yblocks;
+			int y = row % yblocks;
+
 			for (int x = 0; x < xblocks; x++)
 			{
 				int            offset = (((z * yblocks + y) * xblocks) + x) * 16;
@@ -165,6 +212,37 @@ void Astc::decode(BlockDim blockdim, VkExtent3D extent, const uint8_t *data_)
 				write_imageblock(astc_image, &pb, xdim, ydim, zdim, x * xdim, y * ydim, z * zdim, swz_decode);
 			}
 		}
+	};
+
+	int row_count     = zblocks * yblocks;
+	int rows_per_task = std::max(1, min_blocks_per_task / xblocks);
+
+	if (rows_per_task >= row_count)
+	{
+		decode_rows(0, row_count);
+	}
+	else
+	{
+		// The codec builds its tables for a block size on first use, so the first rows are decoded here
+		decode_rows(0, rows_per_task);
+
+		auto &thread_pool = get_thread_pool();
+
+		std::vector<std::future<void>> row_futures;
+
+		for (int first_row = rows_per_task; first_row < row_count; first_row += rows_per_task)
+		{
+			int last_row = std::min(first_row + rows_per_task, row_count);
+
+			row_futures.push_back(thread_pool.push([&decode_rows, first_row, last_row](size_t) {
+				decode_rows(first_row, last_row);
+			}));
+		}
+
+		for (auto &fut : row_futures)
+		{
+			fut.get();
+		}
 	}
 
 	set_data(astc_image->imagedata8[0][0], astc_image->xsize * astc_image->ysize * astc_image->zsize * 4);
@@ -174,6 +252,95 @@ void Astc::decode(BlockDim blockdim, VkExtent3D extent, const uint8_t *data_)
 	set_depth(static_cast<uint32_t>(astc_image->zsize));
 
 	destroy_image(astc_image);
+
+	if (!cache_filename.empty())
+	{
+		store_decode_cache(cache_filename);
+	}
+}
+
+void Astc::set_decode_cache_enabled(bool enabled)
+{
+	decode_cache_enabled = enabled;
+}
+
+bool Astc::load_decode_cache(const std::string &filename)
+{
+	std::ifstream file{fs::path::get(fs::path::Type::TextureCache, filename), std::ios::in | std::ios::binary};
+
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	uint32_t   magic{0};
+	uint32_t   version{0};
+	VkExtent3D extent{};
+	uint64_t   size{0};
+
+	file.read(reinterpret_cast<char *>(&magic), sizeof(magic));
+	file.read(reinterpret_cast<char *>(&version), sizeof(version));
+	file.read(reinterpret_cast<char *>(&extent), sizeof(extent));
+	file.read(reinterpret_cast<char *>(&size), sizeof(size));
+
+	if (!file || magic != decode_cache_magic || version != decode_cache_version ||
+	    size != static_cast<uint64_t>(extent.width) * extent.height * extent.depth * 4)
+	{
+		return false;
+	}
+
+	std::vector<uint8_t> decoded(static_cast<size_t>(size));
+	file.read(reinterpret_cast<char *>(decoded.data()), decoded.size());
+
+	// Reject truncated files, for example from a run that was killed mid-write
+	if (!file)
+	{
+		LOGW("Ignoring invalid decoded image cache file {}", filename);
+		return false;
+	}
+
+	get_mut_data() = std::move(decoded);
+	set_format(VK_FORMAT_R8G8B8A8_SRGB);
+	set_width(extent.width);
+	set_height(extent.height);
+	set_depth(extent.depth);
+
+	return true;
+}
+
+void Astc::store_decode_cache(const std::string &filename) const
+{
+	auto path = fs::path::get(fs::path::Type::TextureCache, filename);
+
+	// Write to a per-thread file first, so that concurrent readers never see a partial image
+	std::stringstream temp_path;
+	temp_path << path << "." << std::this_thread::get_id() << ".tmp";
+
+	{
+		std::ofstream file{temp_path.str(), std::ios::out | std::ios::binary | std::ios::trunc};
+
+		if (!file.is_open())
+		{
+			LOGW("Failed to write decoded image cache file {}", filename);
+			return;
+		}
+
+		auto &decoded = get_data();
+
+		uint64_t size = decoded.size();
+
+		file.write(reinterpret_cast<const char *>(&decode_cache_magic), sizeof(decode_cache_magic));
+		file.write(reinterpret_cast<const char *>(&decode_cache_version), sizeof(decode_cache_version));
+		file.write(reinterpret_cast<const char *>(&get_extent()), sizeof(VkExtent3D));
+		file.write(reinterpret_cast<const char *>(&size), sizeof(size));
+		file.write(reinterpret_cast<const char *>(decoded.data()), decoded.size());
+	}
+
+	if (std::rename(temp_path.str().c_str(), path.c_str()) != 0)
+	{
+		// Another thread or process already cached the same image
+		std::remove(temp_path.str().c_str());
+	}
 }
 
 Astc::Astc(const Image &image) :
@@ -184,17 +351,22 @@ Astc::Astc(const Image &image) :
 }
 
 Astc::Astc(const std::string &name, const std::vector<uint8_t> &data) :
+    Astc{name, data.data(), data.size()}
+{
+}
+
+Astc::Astc(const std::string &name, const uint8_t *data, size_t size) :
     Image{name}
 {
 	init();
 
 	// Read header
-	if (data.size() < sizeof(AstcHeader))
+	if (size < sizeof(AstcHeader))
 	{
 		throw std::runtime_error{"Error reading astc: invalid memory"};
 	}
 	AstcHeader header{};
-	std::memcpy(&header, data.data(), sizeof(AstcHeader));
+	std::memcpy(&header, data, sizeof(AstcHeader));
 	uint32_t magicval = header.magic[0] + 256 * static_cast<uint32_t>(header.magic[1]) + 65536 * static_cast<uint32_t>(header.magic[2]) + 16777216 * static_cast<uint32_t>(header.magic[3]);
 	if (magicval != MAGIC_FILE_CONSTANT)
 	{
@@ -211,7 +383,21 @@ Astc::Astc(const std::string &name, const std::vector<uint8_t> &data) :
 	    /* height = */ static_cast<uint32_t>(header.ysize[0] + 256 * header.ysize[1] + 65536 * header.ysize[2]),
 	    /* depth  = */ static_cast<uint32_t>(header.zsize[0] + 256 * header.zsize[1] + 65536 * header.zsize[2])};
 
-	decode(blockdim, extent, data.data() + sizeof(AstcHeader));
+	if (blockdim.x == 0 || blockdim.y == 0 || blockdim.z == 0)
+	{
+		throw std::runtime_error{"Error reading astc: invalid block size"};
+	}
+
+	// Blocks are read in place, so a truncated file must not be read past its end
+	size_t block_count = static_cast<size_t>((extent.width + blockdim.x - 1) / blockdim.x) *
+	                     ((extent.height + blockdim.y - 1) / blockdim.y) *
+	                     ((extent.depth + blockdim.z - 1) / blockdim.z);
+	if (size - sizeof(AstcHeader) < block_count * 16)
+	{
+		throw std::runtime_error{"Error reading astc: truncated data"};
+	}
+
+	decode(blockdim, extent, data + sizeof(AstcHeader));
 }
 
 }        // namespace sg
@@ -17,6 +17,8 @@
 
 #pragma once
 
+#include <atomic>
+
 #include "common/vk_common.h"
 #include "scene_graph/components/image.h"
 
@@ -47,11 +49,38 @@ class Astc : public Image
 	 */
 	Astc(const std::string &name, const std::vector<uint8_t> &data);
 
+	/**
+	 * @brief Decodes ASTC data with an ASTC header, read in place so it can come from a memory-mapped file
+	 * @param name Name of the component
+	 * @param data ASTC data with header
+	 * @param size Size of the data in bytes
+	 */
+	Astc(const std::string &name, const uint8_t *data, size_t size);
+
 	virtual ~Astc() = default;
 
+	/**
+	 * @brief Enable or disable the on-disk cache of decoded images, it is enabled by default
+	 * @param enabled Whether decoded images are looked up and stored in the cache
+	 */
+	static void set_decode_cache_enabled(bool enabled);
+
   private:
+	static std::atomic<bool> decode_cache_enabled;
+
+	/**
+	 * @brief Reads a decoded image from the cache
+	 * @return False if the image is not cached or the cache file is invalid
+	 */
+	bool load_decode_cache(const std::string &filename);
+
+	/**
+	 * @brief Writes the decoded image to the cache
+	 */
+	void store_decode_cache(const std::string &filename) const;
+
 	/**
-	 * @brief Decodes ASTC data
+	 * @brief Decodes ASTC data, spreading rows of blocks across threads, or reads it from the cache
 	 * @param blockdim Dimensions of the block
 	 * @param extent Extent of the image
 	 * @param data Pointer to ASTC image data
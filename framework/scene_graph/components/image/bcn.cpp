@@ -0,0 +1,557 @@
+/* Copyright (c) 2021, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "scene_graph/components/image/bcn.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <thread>
+
+#include "common/error.h"
+
+VKBP_DISABLE_WARNINGS()
+#include "common/glm_common.h"
+#include <ctpl_stl.h>
+VKBP_ENABLE_WARNINGS()
+
+#include "common/helpers.h"
+#include "common/logging.h"
+#include "common/utils.h"
+#include "platform/filesystem.h"
+
+namespace vkb
+{
+namespace sg
+{
+namespace
+{
+/// Identifies transcoded image cache files, bump the version when the encoder output changes
+constexpr uint32_t transcode_cache_magic{0x4e434342};
+constexpr uint32_t transcode_cache_version{1};
+
+/// Blocks an encoding task handles at least, smaller levels are encoded on the calling thread
+constexpr uint32_t min_blocks_per_task{1024};
+
+inline uint16_t to_rgb565(const glm::vec3 &color)
+{
+	auto r = static_cast<uint16_t>(glm::clamp(color.r * 31.0f / 255.0f + 0.5f, 0.0f, 31.0f));
+	auto g = static_cast<uint16_t>(glm::clamp(color.g * 63.0f / 255.0f + 0.5f, 0.0f, 63.0f));
+	auto b = static_cast<uint16_t>(glm::clamp(color.b * 31.0f / 255.0f + 0.5f, 0.0f, 31.0f));
+
+	return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+inline glm::vec3 from_rgb565(uint16_t color)
+{
+	uint32_t r = (color >> 11) & 31;
+	uint32_t g = (color >> 5) & 63;
+	uint32_t b = color & 31;
+
+	return glm::vec3{(r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2)};
+}
+
+/**
+ * @brief Picks the nearest color of the four color palette of two endpoints for every texel
+ * @return The squared error of the block
+ */
+float assign_color_indices(const std::array<glm::vec3, 16> &texels, uint16_t color0, uint16_t color1, std::array<uint8_t, 16> &indices)
+{
+	std::array<glm::vec3, 4> palette;
+	palette[0] = from_rgb565(color0);
+	palette[1] = from_rgb565(color1);
+	palette[2] = (2.0f * palette[0] + palette[1]) / 3.0f;
+	palette[3] = (palette[0] + 2.0f * palette[1]) / 3.0f;
+
+	float error = 0.0f;
+
+	for (size_t i = 0; i < texels.size(); ++i)
+	{
+		float best_distance = std::numeric_limits<float>::max();
+
+		for (uint8_t index = 0; index < palette.size(); ++index)
+		{
+			glm::vec3 difference = texels[i] - palette[index];
+			float     distance   = glm::dot(difference, difference);
+
+			if (distance < best_distance)
+			{
+				best_distance = distance;
+				indices[i]    = index;
+			}
+		}
+
+		error += best_distance;
+	}
+
+	return error;
+}
+
+/**
+ * @brief Encodes the colors of a block as a BC1 color block in four color mode. The endpoints start at
+ *        the extremes of the principal axis of the colors and are refined once by least squares.
+ */
+void encode_color_block(const std::array<glm::vec3, 16> &texels, uint8_t *block)
+{
+	glm::vec3 mean{0.0f};
+	for (auto &texel : texels)
+	{
+		mean += texel;
+	}
+	mean /= static_cast<float>(texels.size());
+
+	glm::mat3 covariance{0.0f};
+	for (auto &texel : texels)
+	{
+		covariance += glm::outerProduct(texel - mean, texel - mean);
+	}
+
+	// Power iteration, starting from the luminance direction which is close for most blocks
+	glm::vec3 axis{0.299f, 0.587f, 0.114f};
+	for (uint32_t iteration = 0; iteration < 4; ++iteration)
+	{
+		axis = covariance * axis;
+
+		float scale = std::max(std::abs(axis.x), std::max(std::abs(axis.y), std::abs(axis.z)));
+		if (scale < 1e-6f)
+		{
+			axis = glm::vec3{0.0f};
+			break;
+		}
+		axis /= scale;
+	}
+
+	glm::vec3 min_color = texels[0];
+	glm::vec3 max_color = texels[0];
+	float     min_projection{std::numeric_limits<float>::max()};
+	float     max_projection{std::numeric_limits<float>::lowest()};
+
+	for (auto &texel : texels)
+	{
+		float projection = glm::dot(texel, axis);
+
+		if (projection < min_projection)
+		{
+			min_projection = projection;
+			min_color      = texel;
+		}
+		if (projection > max_projection)
+		{
+			max_projection = projection;
+			max_color      = texel;
+		}
+	}
+
+	uint16_t color0 = to_rgb565(max_color);
+	uint16_t color1 = to_rgb565(min_color);
+
+	std::array<uint8_t, 16> indices{};
+	float                   error = assign_color_indices(texels, color0, color1, indices);
+
+	// Solve for the endpoints that best fit the texels with the chosen palette weights
+	static const std::array<float, 4> weights{1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+
+	float     weight0_sum{0.0f};
+	float     weight1_sum{0.0f};
+	float     weight01_sum{0.0f};
+	glm::vec3 texel0_sum{0.0f};
+	glm::vec3 texel1_sum{0.0f};
+
+	for (size_t i = 0; i < texels.size(); ++i)
+	{
+		float weight0 = weights[indices[i]];
+		float weight1 = 1.0f - weight0;
+
+		weight0_sum += weight0 * weight0;
+		weight1_sum += weight1 * weight1;
+		weight01_sum += weight0 * weight1;
+		texel0_sum += weight0 * texels[i];
+		texel1_sum += weight1 * texels[i];
+	}
+
+	float determinant = weight0_sum * weight1_sum - weight01_sum * weight01_sum;
+
+	if (std::abs(determinant) > 1e-6f)
+	{
+		uint16_t refined_color0 = to_rgb565((texel0_sum * weight1_sum - texel1_sum * weight01_sum) / determinant);
+		uint16_t refined_color1 = to_rgb565((texel1_sum * weight0_sum - texel0_sum * weight01_sum) / determinant);
+
+		std::array<uint8_t, 16> refined_indices{};
+		float                   refined_error = assign_color_indices(texels, refined_color0, refined_color1, refined_indices);
+
+		if (refined_error < error)
+		{
+			color0  = refined_color0;
+			color1  = refined_color1;
+			indices = refined_indices;
+		}
+	}
+
+	// Four color mode needs the larger endpoint first, swapping them swaps indices 0 with 1 and 2 with 3
+	if (color0 < color1)
+	{
+		std::swap(color0, color1);
+		for (auto &index : indices)
+		{
+			index ^= 1;
+		}
+	}
+	else if (color0 == color1)
+	{
+		indices.fill(0);
+	}
+
+	uint32_t packed_indices{0};
+	for (size_t i = 0; i < indices.size(); ++i)
+	{
+		packed_indices |= static_cast<uint32_t>(indices[i]) << (i * 2);
+	}
+
+	std::memcpy(block, &color0, sizeof(color0));
+	std::memcpy(block + 2, &color1, sizeof(color1));
+	std::memcpy(block + 4, &packed_indices, sizeof(packed_indices));
+}
+
+/**
+ * @brief Encodes the alphas of a block as a BC3 alpha block in eight alpha mode
+ */
+void encode_alpha_block(const std::array<uint8_t, 16> &alphas, uint8_t *block)
+{
+	uint8_t min_alpha = *std::min_element(alphas.begin(), alphas.end());
+	uint8_t max_alpha = *std::max_element(alphas.begin(), alphas.end());
+
+	block[0] = max_alpha;
+	block[1] = min_alpha;
+
+	uint64_t packed_indices{0};
+
+	if (max_alpha > min_alpha)
+	{
+		std::array<int, 8> palette;
+		palette[0] = max_alpha;
+		palette[1] = min_alpha;
+		for (int index = 2; index < 8; ++index)
+		{
+			palette[index] = ((8 - index) * max_alpha + (index - 1) * min_alpha) / 7;
+		}
+
+		for (size_t i = 0; i < alphas.size(); ++i)
+		{
+			uint64_t best_index    = 0;
+			int      best_distance = std::numeric_limits<int>::max();
+
+			for (uint64_t index = 0; index < palette.size(); ++index)
+			{
+				int distance = std::abs(palette[index] - alphas[i]);
+
+				if (distance < best_distance)
+				{
+					best_distance = distance;
+					best_index    = index;
+				}
+			}
+
+			packed_indices |= best_index << (i * 3);
+		}
+	}
+
+	for (size_t byte = 0; byte < 6; ++byte)
+	{
+		block[2 + byte] = static_cast<uint8_t>(packed_indices >> (byte * 8));
+	}
+}
+
+/**
+ * @brief Encodes rows of blocks [first_row, last_row) of a mip level. Blocks past the edge of
+ *        the level repeat its last row and column.
+ */
+void encode_block_rows(const uint8_t *texels, const VkExtent3D &extent, uint8_t *blocks, bool has_alpha, uint32_t first_row, uint32_t last_row)
+{
+	uint32_t block_columns = (extent.width + 3) / 4;
+	size_t   block_size    = has_alpha ? 16 : 8;
+
+	std::array<glm::vec3, 16> colors;
+	std::array<uint8_t, 16>   alphas;
+
+	for (uint32_t block_y = first_row; block_y < last_row; ++block_y)
+	{
+		for (uint32_t block_x = 0; block_x < block_columns; ++block_x)
+		{
+			for (uint32_t y = 0; y < 4; ++y)
+			{
+				uint32_t texel_y = std::min(block_y * 4 + y, extent.height - 1);
+
+				for (uint32_t x = 0; x < 4; ++x)
+				{
+					uint32_t texel_x = std::min(block_x * 4 + x, extent.width - 1);
+
+					const uint8_t *texel = texels + (static_cast<size_t>(texel_y) * extent.width + texel_x) * 4;
+
+					colors[y * 4 + x] = glm::vec3{texel[0], texel[1], texel[2]};
+					alphas[y * 4 + x] = texel[3];
+				}
+			}
+
+			uint8_t *block = blocks + (static_cast<size_t>(block_y) * block_columns + block_x) * block_size;
+
+			if (has_alpha)
+			{
+				encode_alpha_block(alphas, block);
+				block += 8;
+			}
+
+			encode_color_block(colors, block);
+		}
+	}
+}
+}        // namespace
+
+std::atomic<bool> Bcn::transcode_cache_enabled{true};
+
+Bcn::Bcn(const Image &image) :
+    Image{image.get_name()}
+{
+	auto source_format = image.get_format();
+
+	if ((source_format != VK_FORMAT_R8G8B8A8_UNORM && source_format != VK_FORMAT_R8G8B8A8_SRGB) || image.get_extent().depth != 1)
+	{
+		throw std::runtime_error{"Error transcoding " + image.get_name() + ": only 2D RGBA8 images can be transcoded"};
+	}
+
+	auto &source_data = image.get_data();
+
+	bool has_alpha = false;
+	for (size_t i = 3; i < source_data.size() && !has_alpha; i += 4)
+	{
+		has_alpha = source_data[i] != 255;
+	}
+
+	bool srgb = source_format == VK_FORMAT_R8G8B8A8_SRGB;
+
+	VkFormat format = has_alpha ? (srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK) :
+	                              (srgb ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK);
+
+	// Cached images are keyed by their texels, which cover every mip level
+	std::string cache_filename;
+
+	if (transcode_cache_enabled)
+	{
+		uint64_t hash = fnv1a_64(&format, sizeof(format));
+
+		for (auto &mipmap : image.get_mipmaps())
+		{
+			hash = fnv1a_64(&mipmap.extent, sizeof(mipmap.extent), hash);
+		}
+
+		hash = fnv1a_64(source_data.data(), source_data.size(), hash);
+
+		std::stringstream filename;
+		filename << std::hex << std::setw(16) << std::setfill('0') << hash << ".bcn";
+		cache_filename = filename.str();
+
+		if (load_transcode_cache(cache_filename))
+		{
+			return;
+		}
+	}
+
+	encode(image, format);
+
+	if (!cache_filename.empty())
+	{
+		store_transcode_cache(cache_filename);
+	}
+}
+
+void Bcn::set_transcode_cache_enabled(bool enabled)
+{
+	transcode_cache_enabled = enabled;
+}
+
+void Bcn::encode(const Image &image, VkFormat format)
+{
+	bool   has_alpha  = format == VK_FORMAT_BC3_SRGB_BLOCK || format == VK_FORMAT_BC3_UNORM_BLOCK;
+	size_t block_size = has_alpha ? 16 : 8;
+
+	// Lay out every level first, so that the data is only allocated once
+	std::vector<Mipmap> mipmaps;
+	size_t              size{0};
+
+	for (auto &source_mipmap : image.get_mipmaps())
+	{
+		Mipmap mipmap = source_mipmap;
+		mipmap.offset = to_u32(size);
+
+		size += static_cast<size_t>((mipmap.extent.width + 3) / 4) * ((mipmap.extent.height + 3) / 4) * block_size;
+
+		mipmaps.push_back(mipmap);
+	}
+
+	std::vector<uint8_t> data(size);
+
+	auto &source_data = image.get_data();
+	auto &thread_pool = get_thread_pool();
+
+	std::vector<std::future<void>> row_futures;
+
+	for (size_t level = 0; level < mipmaps.size(); ++level)
+	{
+		const uint8_t *texels = source_data.data() + image.get_mipmaps()[level].offset;
+		uint8_t *      blocks = data.data() + mipmaps[level].offset;
+		auto &         extent = mipmaps[level].extent;
+
+		uint32_t block_columns = (extent.width + 3) / 4;
+		uint32_t block_rows    = (extent.height + 3) / 4;
+		uint32_t rows_per_task = std::max(1u, min_blocks_per_task / block_columns);
+
+		if (rows_per_task >= block_rows)
+		{
+			encode_block_rows(texels, extent, blocks, has_alpha, 0, block_rows);
+			continue;
+		}
+
+		for (uint32_t first_row = 0; first_row < block_rows; first_row += rows_per_task)
+		{
+			uint32_t last_row = std::min(first_row + rows_per_task, block_rows);
+
+			row_futures.push_back(thread_pool.push([texels, &extent, blocks, has_alpha, first_row, last_row](size_t) {
+				encode_block_rows(texels, extent, blocks, has_alpha, first_row, last_row);
+			}));
+		}
+	}
+
+	for (auto &fut : row_futures)
+	{
+		fut.get();
+	}
+
+	get_mut_data()    = std::move(data);
+	get_mut_mipmaps() = std::move(mipmaps);
+	set_format(format);
+}
+
+bool Bcn::load_transcode_cache(const std::string &filename)
+{
+	std::ifstream file{fs::path::get(fs::path::Type::TextureCache, filename), std::ios::in | std::ios::binary};
+
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	uint32_t magic{0};
+	uint32_t version{0};
+	VkFormat format{VK_FORMAT_UNDEFINED};
+	uint32_t mipmap_count{0};
+
+	file.read(reinterpret_cast<char *>(&magic), sizeof(magic));
+	file.read(reinterpret_cast<char *>(&version), sizeof(version));
+	file.read(reinterpret_cast<char *>(&format), sizeof(format));
+	file.read(reinterpret_cast<char *>(&mipmap_count), sizeof(mipmap_count));
+
+	if (!file || magic != transcode_cache_magic || version != transcode_cache_version || mipmap_count == 0)
+	{
+		return false;
+	}
+
+	std::vector<Mipmap> mipmaps(mipmap_count);
+	for (auto &mipmap : mipmaps)
+	{
+		file.read(reinterpret_cast<char *>(&mipmap.level), sizeof(mipmap.level));
+		file.read(reinterpret_cast<char *>(&mipmap.offset), sizeof(mipmap.offset));
+		file.read(reinterpret_cast<char *>(&mipmap.extent), sizeof(mipmap.extent));
+	}
+
+	uint64_t size{0};
+	file.read(reinterpret_cast<char *>(&size), sizeof(size));
+
+	if (!file || mipmaps.back().offset >= size)
+	{
+		return false;
+	}
+
+	std::vector<uint8_t> data(static_cast<size_t>(size));
+	file.read(reinterpret_cast<char *>(data.data()), data.size());
+
+	// Reject truncated files, for example from a run that was killed mid-write
+	if (!file)
+	{
+		LOGW("Ignoring invalid transcoded image cache file {}", filename);
+		return false;
+	}
+
+	get_mut_data()    = std::move(data);
+	get_mut_mipmaps() = std::move(mipmaps);
+	set_format(format);
+
+	return true;
+}
+
+void Bcn::store_transcode_cache(const std::string &filename) const
+{
+	auto path = fs::path::get(fs::path::Type::TextureCache, filename);
+
+	// Write to a per-thread file first, so that concurrent readers never see a partial image
+	std::stringstream temp_path;
+	temp_path << path << "." << std::this_thread::get_id() << ".tmp";
+
+	{
+		std::ofstream file{temp_path.str(), std::ios::out | std::ios::binary | std::ios::trunc};
+
+		if (!file.is_open())
+		{
+			LOGW("Failed to write transcoded image cache file {}", filename);
+			return;
+		}
+
+		auto format       = get_format();
+		auto mipmap_count = to_u32(get_mipmaps().size());
+
+		file.write(reinterpret_cast<const char *>(&transcode_cache_magic), sizeof(transcode_cache_magic));
+		file.write(reinterpret_cast<const char *>(&transcode_cache_version), sizeof(transcode_cache_version));
+		file.write(reinterpret_cast<const char *>(&format), sizeof(format));
+		file.write(reinterpret_cast<const char *>(&mipmap_count), sizeof(mipmap_count));
+
+		for (auto &mipmap : get_mipmaps())
+		{
+			file.write(reinterpret_cast<const char *>(&mipmap.level), sizeof(mipmap.level));
+			file.write(reinterpret_cast<const char *>(&mipmap.offset), sizeof(mipmap.offset));
+			file.write(reinterpret_cast<const char *>(&mipmap.extent), sizeof(mipmap.extent));
+		}
+
+		auto &data = get_data();
+
+		uint64_t size = data.size();
+
+		file.write(reinterpret_cast<const char *>(&size), sizeof(size));
+		file.write(reinterpret_cast<const char *>(data.data()), data.size());
+	}
+
+	if (std::rename(temp_path.str().c_str(), path.c_str()) != 0)
+	{
+		// Another thread or process already cached the same image
+		std::remove(temp_path.str().c_str());
+	}
+}
+}        // namespace sg
+}        // namespace vkb
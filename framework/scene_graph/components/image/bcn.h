@@ -0,0 +1,68 @@
+/* Copyright (c) 2021, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+
+#include "common/vk_common.h"
+#include "scene_graph/components/image.h"
+
+namespace vkb
+{
+namespace sg
+{
+class Bcn : public Image
+{
+  public:
+	/**
+	 * @brief Encodes every mip level of a 2D RGBA8 image as BC1, or as BC3 if it has transparent texels
+	 * @param image Image to transcode, in an sRGB or UNORM RGBA8 format
+	 */
+	Bcn(const Image &image);
+
+	virtual ~Bcn() = default;
+
+	/**
+	 * @brief Enable or disable the on-disk cache of transcoded images, it is enabled by default
+	 * @param enabled Whether transcoded images are looked up and stored in the cache
+	 */
+	static void set_transcode_cache_enabled(bool enabled);
+
+  private:
+	static std::atomic<bool> transcode_cache_enabled;
+
+	/**
+	 * @brief Encodes the blocks of every mip level, spreading rows of blocks across threads
+	 * @param image Image to transcode
+	 * @param format BC1 or BC3 format to encode to
+	 */
+	void encode(const Image &image, VkFormat format);
+
+	/**
+	 * @brief Reads a transcoded image from the cache
+	 * @return False if the image is not cached or the cache file is invalid
+	 */
+	bool load_transcode_cache(const std::string &filename);
+
+	/**
+	 * @brief Writes the transcoded image to the cache
+	 */
+	void store_transcode_cache(const std::string &filename) const;
+};
+}        // namespace sg
+}        // namespace vkb
@@ -29,6 +29,8 @@ class Ktx : public Image
   public:
 	Ktx(const std::string &name, const std::vector<uint8_t> &data);
 
+	Ktx(const std::string &name, const uint8_t *data, size_t size);
+
 	virtual ~Ktx() = default;
 };
 
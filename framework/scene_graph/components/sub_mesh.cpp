@@ -29,6 +29,30 @@ std::type_index SubMesh::get_type()
 	return typeid(SubMesh);
 }
 
+const core::Buffer *SubMesh::get_vertex_buffer(const std::string &name) const
+{
+	auto buffer_it = vertex_buffers.find(name);
+
+	if (buffer_it != vertex_buffers.end())
+	{
+		return &buffer_it->second;
+	}
+
+	auto shared_buffer_it = shared_vertex_buffers.find(name);
+
+	if (shared_buffer_it != shared_vertex_buffers.end())
+	{
+		return shared_buffer_it->second.get();
+	}
+
+	return nullptr;
+}
+
+const core::Buffer *SubMesh::get_index_buffer() const
+{
+	return index_buffer ? index_buffer.get() : shared_index_buffer.get();
+}
+
 void SubMesh::set_attribute(const std::string &attribute_name, const VertexAttribute &attribute)
 {
 	vertex_attributes[attribute_name] = attribute;
@@ -88,6 +112,19 @@ void SubMesh::compute_shader_variant()
 		std::transform(attrib_name.begin(), attrib_name.end(), attrib_name.begin(), ::toupper);
 		shader_variant.add_define("HAS_" + attrib_name);
 	}
+
+	// Quantized attributes need to be decoded by the vertex shader
+	auto position_it = vertex_attributes.find("position");
+	if (position_it != vertex_attributes.end() && position_it->second.format == VK_FORMAT_R16G16B16A16_UNORM)
+	{
+		shader_variant.add_define("QUANTIZED_POSITION");
+	}
+
+	auto normal_it = vertex_attributes.find("normal");
+	if (normal_it != vertex_attributes.end() && normal_it->second.format == VK_FORMAT_R16G16_SNORM)
+	{
+		shader_variant.add_define("OCTAHEDRAL_NORMAL");
+	}
 }
 
 ShaderVariant &SubMesh::get_mut_shader_variant()
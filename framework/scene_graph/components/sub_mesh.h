@@ -43,6 +43,20 @@ struct VertexAttribute
 	std::uint32_t offset = 0;
 };
 
+/**
+ * @brief A simplified version of a submesh, drawn with a range of its index buffer
+ */
+struct SubMeshLod
+{
+	/// Offset of the range from the first index of the submesh
+	std::uint32_t first_index = 0;
+
+	std::uint32_t index_count = 0;
+
+	/// Largest distance from the full detail surface, in the units of the vertex positions
+	float error = 0.0f;
+};
+
 class SubMesh : public Component
 {
   public:
@@ -62,6 +76,30 @@ class SubMesh : public Component
 
 	std::unique_ptr<core::Buffer> index_buffer;
 
+	/// Vertex buffers shared with other submeshes, holding the vertices of this one from base_vertex
+	std::unordered_map<std::string, std::shared_ptr<core::Buffer>> shared_vertex_buffers;
+
+	/// Index buffer shared with other submeshes, holding the indices of this one from first_index
+	std::shared_ptr<core::Buffer> shared_index_buffer;
+
+	std::uint32_t first_index = 0;
+
+	std::int32_t base_vertex = 0;
+
+	/// Simplified versions of the submesh from most to least detailed, stored after the full detail indices
+	std::vector<SubMeshLod> lods;
+
+	/**
+	 * @return The buffer holding the named attribute, whether owned or shared,
+	 *         or nullptr if the submesh does not have it
+	 */
+	const core::Buffer *get_vertex_buffer(const std::string &name) const;
+
+	/**
+	 * @return The index buffer, whether owned or shared, or nullptr if the submesh is not indexed
+	 */
+	const core::Buffer *get_index_buffer() const;
+
 	void set_attribute(const std::string &name, const VertexAttribute &attribute);
 
 	bool get_attribute(const std::string &name, VertexAttribute &attribute) const;
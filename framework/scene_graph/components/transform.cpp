@@ -23,6 +23,7 @@ VKBP_DISABLE_WARNINGS()
 VKBP_ENABLE_WARNINGS()
 
 #include "scene_graph/node.h"
+#include "scene_graph/transform_hierarchy.h"
 
 namespace vkb
 {
@@ -33,6 +34,14 @@ Transform::Transform(Node &n) :
 {
 }
 
+Transform::~Transform()
+{
+	if (hierarchy)
+	{
+		hierarchy->remove(hierarchy_index);
+	}
+}
+
 Node &Transform::get_node()
 {
 	return node;
@@ -45,59 +54,75 @@ std::type_index Transform::get_type()
 
 void Transform::set_translation(const glm::vec3 &new_translation)
 {
-	translation = new_translation;
+	(hierarchy ? hierarchy->translations[hierarchy_index] : translation) = new_translation;
 
 	invalidate_world_matrix();
 }
 
 void Transform::set_rotation(const glm::quat &new_rotation)
 {
-	rotation = new_rotation;
+	(hierarchy ? hierarchy->rotations[hierarchy_index] : rotation) = new_rotation;
 
 	invalidate_world_matrix();
 }
 
 void Transform::set_scale(const glm::vec3 &new_scale)
 {
-	scale = new_scale;
+	(hierarchy ? hierarchy->scales[hierarchy_index] : scale) = new_scale;
 
 	invalidate_world_matrix();
 }
 
 const glm::vec3 &Transform::get_translation() const
 {
-	return translation;
+	return hierarchy ? hierarchy->translations[hierarchy_index] : translation;
 }
 
 const glm::quat &Transform::get_rotation() const
 {
-	return rotation;
+	return hierarchy ? hierarchy->rotations[hierarchy_index] : rotation;
 }
 
 const glm::vec3 &Transform::get_scale() const
 {
-	return scale;
+	return hierarchy ? hierarchy->scales[hierarchy_index] : scale;
 }
 
 void Transform::set_matrix(const glm::mat4 &matrix)
 {
+	glm::vec3 new_scale;
+	glm::quat new_rotation;
+	glm::vec3 new_translation;
 	glm::vec3 skew;
 	glm::vec4 perspective;
-	glm::decompose(matrix, scale, rotation, translation, skew, perspective);
-	rotation = glm::conjugate(rotation);
+	glm::decompose(matrix, new_scale, new_rotation, new_translation, skew, perspective);
 
-	invalidate_world_matrix();
+	set_translation(new_translation);
+	set_rotation(glm::conjugate(new_rotation));
+	set_scale(new_scale);
 }
 
 glm::mat4 Transform::get_matrix() const
 {
-	return glm::translate(glm::mat4(1.0), translation) *
-	       glm::mat4_cast(rotation) *
-	       glm::scale(glm::mat4(1.0), scale);
+	return glm::translate(glm::mat4(1.0), get_translation()) *
+	       glm::mat4_cast(get_rotation()) *
+	       glm::scale(glm::mat4(1.0), get_scale());
 }
 
 glm::mat4 Transform::get_world_matrix()
 {
+	// The first query after a change updates the whole hierarchy in one pass
+	if (hierarchy)
+	{
+		hierarchy->update();
+	}
+
+	// The update may have dropped the node from the hierarchy
+	if (hierarchy)
+	{
+		return hierarchy->world_matrices[hierarchy_index];
+	}
+
 	update_world_transform();
 
 	return world_matrix;
@@ -105,7 +130,23 @@ glm::mat4 Transform::get_world_matrix()
 
 void Transform::invalidate_world_matrix()
 {
-	update_world_matrix = true;
+	if (hierarchy)
+	{
+		hierarchy->dirty[hierarchy_index] = 1;
+		hierarchy->changed                = true;
+	}
+	else
+	{
+		update_world_matrix = true;
+	}
+}
+
+void Transform::invalidate_hierarchy()
+{
+	if (hierarchy)
+	{
+		hierarchy->invalidate_structure();
+	}
 }
 
 void Transform::update_world_transform()
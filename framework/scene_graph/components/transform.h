@@ -36,13 +36,19 @@ namespace vkb
 namespace sg
 {
 class Node;
+class TransformHierarchy;
 
+/**
+ * @brief The local transform of a node, and its world transform. While the node is part of a
+ *        TransformHierarchy the properties live in the arrays of the hierarchy, otherwise in the
+ *        transform itself.
+ */
 class Transform : public Component
 {
   public:
 	Transform(Node &node);
 
-	virtual ~Transform() = default;
+	virtual ~Transform();
 
 	Node &get_node();
 
@@ -73,9 +79,21 @@ class Transform : public Component
 	 */
 	void invalidate_world_matrix();
 
+	/**
+	 * @brief Marks the tree structure around the node changed, after it gains a parent or a child
+	 */
+	void invalidate_hierarchy();
+
   private:
+	friend class TransformHierarchy;
+
 	Node &node;
 
+	/// Hierarchy holding the properties, if any
+	TransformHierarchy *hierarchy{nullptr};
+
+	uint32_t hierarchy_index{0};
+
 	glm::vec3 translation = glm::vec3(0.0, 0.0, 0.0);
 
 	glm::quat rotation = glm::quat(1.0, 0.0, 0.0, 0.0);
@@ -47,6 +47,7 @@ void Node::set_parent(Node &p)
 	parent = &p;
 
 	transform.invalidate_world_matrix();
+	transform.invalidate_hierarchy();
 }
 
 Node *Node::get_parent() const
@@ -57,6 +58,10 @@ Node *Node::get_parent() const
 void Node::add_child(Node &child)
 {
 	children.push_back(&child);
+
+	// Either side may already be part of a hierarchy
+	transform.invalidate_hierarchy();
+	child.transform.invalidate_hierarchy();
 }
 
 const std::vector<Node *> &Node::get_children() const
@@ -21,6 +21,7 @@
 
 #include "common/error.h"
 #include "component.h"
+#include "components/mesh.h"
 #include "components/sub_mesh.h"
 #include "node.h"
 
@@ -129,11 +130,40 @@ Node *Scene::find_node(const std::string &node_name)
 void Scene::set_root_node(Node &node)
 {
 	root = &node;
+
+	if (!transform_hierarchy)
+	{
+		transform_hierarchy = std::make_unique<TransformHierarchy>();
+	}
+
+	transform_hierarchy->build(node);
 }
 
 Node &Scene::get_root_node()
 {
 	return *root;
 }
+
+void Scene::update_transforms(ctpl::thread_pool *thread_pool)
+{
+	if (transform_hierarchy)
+	{
+		transform_hierarchy->update(thread_pool);
+	}
+}
+
+SceneBVH &Scene::get_bvh(ctpl::thread_pool *thread_pool)
+{
+	update_transforms(thread_pool);
+
+	if (!bvh)
+	{
+		bvh = std::make_unique<SceneBVH>();
+	}
+
+	bvh->update(get_components<Mesh>(), transform_hierarchy.get());
+
+	return *bvh;
+}
 }        // namespace sg
 }        // namespace vkb
\ No newline at end of file
@@ -26,6 +26,8 @@
 
 #include "scene_graph/components/light.h"
 #include "scene_graph/components/texture.h"
+#include "scene_graph/scene_bvh.h"
+#include "scene_graph/transform_hierarchy.h"
 
 namespace vkb
 {
@@ -130,6 +132,21 @@ class Scene
 
 	Node &get_root_node();
 
+	/**
+	 * @brief Recomputes the world matrices of the transforms that changed since the last update, in one pass
+	 *        over the whole tree. World matrices are otherwise updated the first time one of them is queried.
+	 * @param thread_pool If not null, large depths of the tree are split across its threads
+	 */
+	void update_transforms(ctpl::thread_pool *thread_pool = nullptr);
+
+	/**
+	 * @brief Updates the transforms, then refits the bounding volume hierarchy over the meshes of the scene
+	 *        to them. The hierarchy is built on the first call.
+	 * @param thread_pool If not null, large depths of the tree are split across its threads
+	 * @return The hierarchy, for frustum, sphere and ray queries
+	 */
+	SceneBVH &get_bvh(ctpl::thread_pool *thread_pool = nullptr);
+
   private:
 	std::string name;
 
@@ -138,6 +155,12 @@ class Scene
 
 	Node *root{nullptr};
 
+	/// Transforms of the tree under the root, declared after the nodes so it is destroyed before them
+	std::unique_ptr<TransformHierarchy> transform_hierarchy;
+
+	/// Bounds of the mesh instances, built on first use
+	std::unique_ptr<SceneBVH> bvh;
+
 	std::unordered_map<std::type_index, std::vector<std::unique_ptr<Component>>> components;
 };
 }        // namespace sg
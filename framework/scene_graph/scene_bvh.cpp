@@ -0,0 +1,515 @@
+/* Copyright (c) 2021, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "scene_bvh.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "common/helpers.h"
+#include "geometry/frustum.h"
+#include "scene_graph/components/aabb.h"
+#include "scene_graph/components/mesh.h"
+#include "scene_graph/components/transform.h"
+#include "scene_graph/node.h"
+#include "scene_graph/transform_hierarchy.h"
+
+namespace vkb
+{
+namespace sg
+{
+namespace
+{
+constexpr uint32_t no_index{std::numeric_limits<uint32_t>::max()};
+
+float get_surface(const glm::vec3 &min, const glm::vec3 &max)
+{
+	auto size = max - min;
+
+	return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+bool has_bounds(const Mesh &mesh)
+{
+	const AABB &bounds = mesh.get_bounds();
+
+	return !glm::any(glm::greaterThan(bounds.get_min(), bounds.get_max()));
+}
+}        // namespace
+
+void SceneBVH::update(const std::vector<Mesh *> &meshes, TransformHierarchy *hierarchy)
+{
+	size_t instance_count = 0;
+
+	for (auto mesh : meshes)
+	{
+		instance_count += mesh->get_nodes().size();
+	}
+
+	if (!built || instance_count != instances.size() ||
+	    (hierarchy && hierarchy->get_structure_version() != structure_version))
+	{
+		build(meshes, hierarchy);
+		return;
+	}
+
+	moved.clear();
+
+	if (hierarchy)
+	{
+		hierarchy->collect_moved(moved);
+	}
+
+	// Once a good part of the scene moved, one pass over the whole tree is cheaper than walking up from every leaf
+	bool refit_everything = (moved.size() + untracked_instances.size()) * 4 > instances.size();
+
+	for (auto index : moved)
+	{
+		auto instance = index < transform_instances.size() ? transform_instances[index] : no_index;
+
+		if (instance == no_index)
+		{
+			continue;
+		}
+
+		update_bounds(instance);
+
+		if (!refit_everything && instance_leaves[instance] != no_index)
+		{
+			refit(instance_leaves[instance]);
+		}
+	}
+
+	for (auto instance : untracked_instances)
+	{
+		update_bounds(instance);
+
+		if (!refit_everything && instance_leaves[instance] != no_index)
+		{
+			refit(instance_leaves[instance]);
+		}
+	}
+
+	if (refit_everything)
+	{
+		refit_all();
+	}
+
+	if (!nodes.empty() && get_surface(nodes[0].min, nodes[0].max) > built_surface * max_refit_growth)
+	{
+		build(meshes, hierarchy);
+	}
+}
+
+void SceneBVH::invalidate()
+{
+	built = false;
+}
+
+size_t SceneBVH::size() const
+{
+	return instances.size();
+}
+
+const std::pair<Node *, Mesh *> &SceneBVH::get_instance(uint32_t instance) const
+{
+	return instances[instance];
+}
+
+const glm::vec3 &SceneBVH::get_min(uint32_t instance) const
+{
+	return instance_min[instance];
+}
+
+const glm::vec3 &SceneBVH::get_max(uint32_t instance) const
+{
+	return instance_max[instance];
+}
+
+void SceneBVH::query_frustum(const Frustum &frustum, std::vector<uint32_t> &result) const
+{
+	result.insert(result.end(), unbounded_instances.begin(), unbounded_instances.end());
+
+	if (nodes.empty())
+	{
+		return;
+	}
+
+	std::vector<uint32_t> stack{0};
+
+	while (!stack.empty())
+	{
+		auto &node = nodes[stack.back()];
+		stack.pop_back();
+
+		if (!frustum.check_aabb(node.min, node.max))
+		{
+			continue;
+		}
+
+		if (node.count == 0)
+		{
+			stack.push_back(node.first);
+			stack.push_back(node.first + 1);
+			continue;
+		}
+
+		for (uint32_t i = node.first; i < node.first + node.count; ++i)
+		{
+			if (frustum.check_aabb(instance_min[items[i]], instance_max[items[i]]))
+			{
+				result.push_back(items[i]);
+			}
+		}
+	}
+}
+
+void SceneBVH::query_sphere(const glm::vec3 &center, float radius, std::vector<uint32_t> &result) const
+{
+	result.insert(result.end(), unbounded_instances.begin(), unbounded_instances.end());
+
+	if (nodes.empty())
+	{
+		return;
+	}
+
+	auto overlaps = [&center, radius](const glm::vec3 &min, const glm::vec3 &max) {
+		auto offset = glm::clamp(center, min, max) - center;
+		return glm::dot(offset, offset) <= radius * radius;
+	};
+
+	std::vector<uint32_t> stack{0};
+
+	while (!stack.empty())
+	{
+		auto &node = nodes[stack.back()];
+		stack.pop_back();
+
+		if (!overlaps(node.min, node.max))
+		{
+			continue;
+		}
+
+		if (node.count == 0)
+		{
+			stack.push_back(node.first);
+			stack.push_back(node.first + 1);
+			continue;
+		}
+
+		for (uint32_t i = node.first; i < node.first + node.count; ++i)
+		{
+			if (overlaps(instance_min[items[i]], instance_max[items[i]]))
+			{
+				result.push_back(items[i]);
+			}
+		}
+	}
+}
+
+void SceneBVH::query_ray(const glm::vec3 &origin, const glm::vec3 &direction, float max_distance, std::vector<RayHit> &result) const
+{
+	size_t first_hit = result.size();
+
+	// The ray may cross them anywhere, so they count as hit where it starts
+	for (auto instance : unbounded_instances)
+	{
+		result.push_back({instance, 0.0f});
+	}
+
+	if (nodes.empty())
+	{
+		return;
+	}
+
+	// Zero components give infinite slabs, which the comparisons below handle
+	auto inverse_direction = 1.0f / direction;
+
+	auto intersect = [&origin, &inverse_direction, max_distance](const glm::vec3 &min, const glm::vec3 &max, float &distance) {
+		auto t0 = (min - origin) * inverse_direction;
+		auto t1 = (max - origin) * inverse_direction;
+
+		auto t_near = glm::min(t0, t1);
+		auto t_far  = glm::max(t0, t1);
+
+		float enter = std::max(std::max(t_near.x, t_near.y), std::max(t_near.z, 0.0f));
+		float exit  = std::min(std::min(t_far.x, t_far.y), std::min(t_far.z, max_distance));
+
+		distance = enter;
+
+		return enter <= exit;
+	};
+
+	std::vector<uint32_t> stack{0};
+
+	float distance;
+
+	while (!stack.empty())
+	{
+		auto &node = nodes[stack.back()];
+		stack.pop_back();
+
+		if (!intersect(node.min, node.max, distance))
+		{
+			continue;
+		}
+
+		if (node.count == 0)
+		{
+			stack.push_back(node.first);
+			stack.push_back(node.first + 1);
+			continue;
+		}
+
+		for (uint32_t i = node.first; i < node.first + node.count; ++i)
+		{
+			if (intersect(instance_min[items[i]], instance_max[items[i]], distance))
+			{
+				result.push_back({items[i], distance});
+			}
+		}
+	}
+
+	std::sort(result.begin() + first_hit, result.end(), [](const RayHit &a, const RayHit &b) {
+		return a.distance < b.distance;
+	});
+}
+
+void SceneBVH::build(const std::vector<Mesh *> &meshes, TransformHierarchy *hierarchy)
+{
+	instances.clear();
+	untracked_instances.clear();
+	unbounded_instances.clear();
+	nodes.clear();
+	items.clear();
+
+	for (auto mesh : meshes)
+	{
+		for (auto node : mesh->get_nodes())
+		{
+			instances.emplace_back(node, mesh);
+		}
+	}
+
+	instance_min.resize(instances.size());
+	instance_max.resize(instances.size());
+	instance_leaves.assign(instances.size(), no_index);
+	transform_instances.assign(hierarchy ? hierarchy->size() : 0, no_index);
+
+	for (uint32_t i = 0; i < to_u32(instances.size()); ++i)
+	{
+		update_bounds(i);
+
+		if (has_bounds(*instances[i].second))
+		{
+			items.push_back(i);
+		}
+		else
+		{
+			unbounded_instances.push_back(i);
+		}
+
+		auto index = hierarchy ? hierarchy->find(instances[i].first->get_transform()) : -1;
+
+		if (index >= 0)
+		{
+			transform_instances[static_cast<size_t>(index)] = i;
+		}
+		else
+		{
+			untracked_instances.push_back(i);
+		}
+	}
+
+	if (hierarchy)
+	{
+		// Every bounds was just computed, so the moves so far are already accounted for
+		moved.clear();
+		hierarchy->collect_moved(moved);
+
+		structure_version = hierarchy->get_structure_version();
+	}
+
+	built = true;
+
+	if (items.empty())
+	{
+		built_surface = 0.0f;
+		return;
+	}
+
+	nodes.reserve(2 * items.size());
+	nodes.push_back({});
+	nodes[0].parent = no_index;
+
+	split(0, 0, to_u32(items.size()));
+
+	built_surface = get_surface(nodes[0].min, nodes[0].max);
+}
+
+void SceneBVH::split(uint32_t node_index, uint32_t first, uint32_t count)
+{
+	glm::vec3 min{std::numeric_limits<float>::max()};
+	glm::vec3 max{-std::numeric_limits<float>::max()};
+	glm::vec3 center_min{std::numeric_limits<float>::max()};
+	glm::vec3 center_max{-std::numeric_limits<float>::max()};
+
+	for (uint32_t i = first; i < first + count; ++i)
+	{
+		auto &item_min = instance_min[items[i]];
+		auto &item_max = instance_max[items[i]];
+
+		min = glm::min(min, item_min);
+		max = glm::max(max, item_max);
+
+		auto center = (item_min + item_max) * 0.5f;
+
+		center_min = glm::min(center_min, center);
+		center_max = glm::max(center_max, center);
+	}
+
+	auto &node = nodes[node_index];
+	node.min   = min;
+	node.max   = max;
+	node.first = first;
+	node.count = count;
+
+	auto size = center_max - center_min;
+	int  axis = size.x > size.y ? (size.x > size.z ? 0 : 2) : (size.y > size.z ? 1 : 2);
+
+	// Instances sharing one center cannot be told apart, so they stay in one leaf
+	if (count <= max_leaf_size || size[axis] <= 0.0f)
+	{
+		for (uint32_t i = first; i < first + count; ++i)
+		{
+			instance_leaves[items[i]] = node_index;
+		}
+		return;
+	}
+
+	auto half = count / 2;
+
+	std::nth_element(items.begin() + first, items.begin() + first + half, items.begin() + first + count,
+	                 [this, axis](uint32_t a, uint32_t b) {
+		                 return instance_min[a][axis] + instance_max[a][axis] < instance_min[b][axis] + instance_max[b][axis];
+	                 });
+
+	auto left = to_u32(nodes.size());
+
+	// The node reference is invalidated by the children being added
+	nodes[node_index].first = left;
+	nodes[node_index].count = 0;
+
+	nodes.push_back({});
+	nodes.push_back({});
+	nodes[left].parent     = node_index;
+	nodes[left + 1].parent = node_index;
+
+	split(left, first, half);
+	split(left + 1, first + half, count - half);
+}
+
+void SceneBVH::update_bounds(uint32_t instance)
+{
+	auto &node = *instances[instance].first;
+	auto &mesh = *instances[instance].second;
+
+	const AABB &mesh_bounds = mesh.get_bounds();
+
+	// Far enough to be in view of any camera, without overflowing when the bounds are tested
+	if (!has_bounds(mesh))
+	{
+		instance_min[instance] = glm::vec3{-std::numeric_limits<float>::max() / 4};
+		instance_max[instance] = glm::vec3{std::numeric_limits<float>::max() / 4};
+		return;
+	}
+
+	auto world_matrix = node.get_transform().get_world_matrix();
+
+	AABB world_bounds{mesh_bounds.get_min(), mesh_bounds.get_max()};
+	world_bounds.transform(world_matrix);
+
+	instance_min[instance] = world_bounds.get_min();
+	instance_max[instance] = world_bounds.get_max();
+}
+
+void SceneBVH::refit(uint32_t leaf)
+{
+	auto &leaf_node = nodes[leaf];
+
+	glm::vec3 min{std::numeric_limits<float>::max()};
+	glm::vec3 max{-std::numeric_limits<float>::max()};
+
+	for (uint32_t i = leaf_node.first; i < leaf_node.first + leaf_node.count; ++i)
+	{
+		min = glm::min(min, instance_min[items[i]]);
+		max = glm::max(max, instance_max[items[i]]);
+	}
+
+	if (min == leaf_node.min && max == leaf_node.max)
+	{
+		return;
+	}
+
+	leaf_node.min = min;
+	leaf_node.max = max;
+
+	for (auto index = leaf_node.parent; index != no_index; index = nodes[index].parent)
+	{
+		auto &node  = nodes[index];
+		auto &left  = nodes[node.first];
+		auto &right = nodes[node.first + 1];
+
+		min = glm::min(left.min, right.min);
+		max = glm::max(left.max, right.max);
+
+		if (min == node.min && max == node.max)
+		{
+			break;
+		}
+
+		node.min = min;
+		node.max = max;
+	}
+}
+
+void SceneBVH::refit_all()
+{
+	// Children are always added after their parent
+	for (size_t index = nodes.size(); index > 0; --index)
+	{
+		auto &node = nodes[index - 1];
+
+		if (node.count == 0)
+		{
+			node.min = glm::min(nodes[node.first].min, nodes[node.first + 1].min);
+			node.max = glm::max(nodes[node.first].max, nodes[node.first + 1].max);
+			continue;
+		}
+
+		node.min = glm::vec3{std::numeric_limits<float>::max()};
+		node.max = glm::vec3{-std::numeric_limits<float>::max()};
+
+		for (uint32_t i = node.first; i < node.first + node.count; ++i)
+		{
+			node.min = glm::min(node.min, instance_min[items[i]]);
+			node.max = glm::max(node.max, instance_max[items[i]]);
+		}
+	}
+}
+}        // namespace sg
+}        // namespace vkb
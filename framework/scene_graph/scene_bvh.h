@@ -0,0 +1,199 @@
+/* Copyright (c) 2021, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "common/error.h"
+
+VKBP_DISABLE_WARNINGS()
+#include "common/glm_common.h"
+VKBP_ENABLE_WARNINGS()
+
+namespace vkb
+{
+class Frustum;
+
+namespace sg
+{
+class Mesh;
+class Node;
+class TransformHierarchy;
+
+/**
+ * @brief Bounding volume hierarchy over the world bounds of every mesh instance of a scene,
+ *        for frustum, sphere and ray queries that only visit the parts of the scene they touch.
+ *
+ * The tree is built once and then refit every update from the transforms that moved, walking
+ * up from their leaves only as far as the bounds change. It is rebuilt when instances are added
+ * or removed, when the transform hierarchy is rebuilt, or when refitting has loosened the tree.
+ *
+ * Instances of meshes without bounds are kept out of the tree, so that they do not stretch it
+ * over all of space, and every query returns them.
+ */
+class SceneBVH
+{
+  public:
+	/**
+	 * @brief An instance whose bounds are crossed by a ray
+	 */
+	struct RayHit
+	{
+		uint32_t instance;
+
+		/// Distance along the ray at which it enters the bounds, 0 if it starts inside them
+		float distance;
+	};
+
+	SceneBVH() = default;
+
+	SceneBVH(const SceneBVH &) = delete;
+
+	SceneBVH(SceneBVH &&) = delete;
+
+	~SceneBVH() = default;
+
+	SceneBVH &operator=(const SceneBVH &) = delete;
+
+	SceneBVH &operator=(SceneBVH &&) = delete;
+
+	/**
+	 * @brief Brings the tree up to date with the world matrices of the scene, which must be up to date
+	 * @param meshes Meshes of the scene, every node of a mesh is an instance
+	 * @param hierarchy Transforms of the scene to take the moved ones from, or nullptr to refit every instance
+	 */
+	void update(const std::vector<Mesh *> &meshes, TransformHierarchy *hierarchy);
+
+	/**
+	 * @brief Drops the tree, so that it is rebuilt on the next update
+	 */
+	void invalidate();
+
+	/**
+	 * @return Number of instances in the tree
+	 */
+	size_t size() const;
+
+	const std::pair<Node *, Mesh *> &get_instance(uint32_t instance) const;
+
+	/**
+	 * @return Minimum corner of the world bounds of an instance, very far away for meshes without bounds
+	 */
+	const glm::vec3 &get_min(uint32_t instance) const;
+
+	/**
+	 * @return Maximum corner of the world bounds of an instance, very far away for meshes without bounds
+	 */
+	const glm::vec3 &get_max(uint32_t instance) const;
+
+	/**
+	 * @brief Appends the instances whose bounds are inside or cross a frustum
+	 */
+	void query_frustum(const Frustum &frustum, std::vector<uint32_t> &result) const;
+
+	/**
+	 * @brief Appends the instances whose bounds are inside or cross a sphere
+	 */
+	void query_sphere(const glm::vec3 &center, float radius, std::vector<uint32_t> &result) const;
+
+	/**
+	 * @brief Appends the instances whose bounds are crossed by a ray, sorted from the nearest
+	 * @param direction Direction of the ray, does not need to be normalized
+	 * @param max_distance Length of the ray, in multiples of the direction
+	 */
+	void query_ray(const glm::vec3 &origin, const glm::vec3 &direction, float max_distance, std::vector<RayHit> &result) const;
+
+  private:
+	struct BVHNode
+	{
+		glm::vec3 min;
+
+		/// First child for inner nodes, whose children are next to each other, or first item for leaves
+		uint32_t first;
+
+		glm::vec3 max;
+
+		/// Number of items in a leaf, 0 for inner nodes
+		uint32_t count;
+
+		uint32_t parent;
+	};
+
+	/// Leaves hold at most this many instances
+	static constexpr uint32_t max_leaf_size{4};
+
+	/// The tree is rebuilt once refitting has grown the surface of its root by this factor
+	static constexpr float max_refit_growth{2.0f};
+
+	void build(const std::vector<Mesh *> &meshes, TransformHierarchy *hierarchy);
+
+	/**
+	 * @brief Splits the items of a node in two along the longest axis of their centers, until leaves are small enough
+	 */
+	void split(uint32_t node_index, uint32_t first, uint32_t count);
+
+	/**
+	 * @brief Recomputes the world bounds of an instance from its node
+	 */
+	void update_bounds(uint32_t instance);
+
+	/**
+	 * @brief Recomputes the bounds of a leaf and of its ancestors, up to the first that does not change
+	 */
+	void refit(uint32_t leaf);
+
+	/**
+	 * @brief Recomputes the bounds of every node, children first
+	 */
+	void refit_all();
+
+	std::vector<std::pair<Node *, Mesh *>> instances;
+
+	std::vector<glm::vec3> instance_min;
+
+	std::vector<glm::vec3> instance_max;
+
+	/// Leaf that holds every instance, or ~0 for instances kept out of the tree
+	std::vector<uint32_t> instance_leaves;
+
+	/// Instances of meshes without bounds, returned by every query
+	std::vector<uint32_t> unbounded_instances;
+
+	/// Instance at every position of the transform hierarchy, or ~0 for transforms without one
+	std::vector<uint32_t> transform_instances;
+
+	/// Instances whose transform is not part of the hierarchy, refit on every update
+	std::vector<uint32_t> untracked_instances;
+
+	std::vector<BVHNode> nodes;
+
+	/// Instances in leaf order, leaves refer to ranges of it
+	std::vector<uint32_t> items;
+
+	std::vector<uint32_t> moved;
+
+	uint64_t structure_version{0};
+
+	float built_surface{0.0f};
+
+	bool built{false};
+};
+}        // namespace sg
+}        // namespace vkb
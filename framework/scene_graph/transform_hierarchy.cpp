@@ -0,0 +1,267 @@
+/* Copyright (c) 2021, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "transform_hierarchy.h"
+
+#include <algorithm>
+#include <future>
+
+VKBP_DISABLE_WARNINGS()
+#include <ctpl_stl.h>
+VKBP_ENABLE_WARNINGS()
+
+#include "common/helpers.h"
+#include "scene_graph/node.h"
+
+namespace vkb
+{
+namespace sg
+{
+TransformHierarchy::~TransformHierarchy()
+{
+	clear();
+}
+
+void TransformHierarchy::build(Node &root_node)
+{
+	clear();
+
+	root = &root_node;
+
+	// Walk the tree one depth at a time, which keeps parents ahead of their children
+	std::vector<Node *> level{&root_node};
+	std::vector<Node *> next_level;
+	std::vector<int32_t> level_parents{-1};
+	std::vector<int32_t> next_level_parents;
+
+	while (!level.empty())
+	{
+		level_offsets.push_back(transforms.size());
+
+		for (size_t i = 0; i < level.size(); ++i)
+		{
+			auto &transform = level[i]->get_transform();
+			auto  index     = static_cast<int32_t>(transforms.size());
+
+			transforms.push_back(&transform);
+			parents.push_back(level_parents[i]);
+			translations.push_back(transform.translation);
+			rotations.push_back(transform.rotation);
+			scales.push_back(transform.scale);
+
+			transform.hierarchy       = this;
+			transform.hierarchy_index = to_u32(index);
+
+			for (auto child : level[i]->get_children())
+			{
+				next_level.push_back(child);
+				next_level_parents.push_back(index);
+			}
+		}
+
+		std::swap(level, next_level);
+		std::swap(level_parents, next_level_parents);
+		next_level.clear();
+		next_level_parents.clear();
+	}
+
+	level_offsets.push_back(transforms.size());
+
+	local_matrices.resize(transforms.size());
+	world_matrices.resize(transforms.size());
+	dirty.assign(transforms.size(), 1);
+	moved.assign(transforms.size(), 0);
+
+	++structure_version;
+
+	changed           = true;
+	structure_changed = false;
+}
+
+void TransformHierarchy::clear()
+{
+	for (size_t i = 0; i < transforms.size(); ++i)
+	{
+		detach(i);
+	}
+
+	root = nullptr;
+
+	transforms.clear();
+	parents.clear();
+	translations.clear();
+	rotations.clear();
+	scales.clear();
+	local_matrices.clear();
+	world_matrices.clear();
+	dirty.clear();
+	moved.clear();
+	level_offsets.clear();
+
+	changed           = false;
+	structure_changed = false;
+}
+
+void TransformHierarchy::update(ctpl::thread_pool *thread_pool)
+{
+	if (structure_changed)
+	{
+		// The root is gone if its transform was removed
+		if (root && !transforms.empty() && transforms[0])
+		{
+			build(*root);
+		}
+		else
+		{
+			clear();
+		}
+	}
+
+	if (!changed)
+	{
+		return;
+	}
+
+	for (size_t level = 0; level + 1 < level_offsets.size(); ++level)
+	{
+		auto begin = level_offsets[level];
+		auto end   = level_offsets[level + 1];
+
+		if (!thread_pool || end - begin < parallel_level_size || thread_pool->size() < 2)
+		{
+			update_range(begin, end);
+			continue;
+		}
+
+		// Transforms at the same depth only read their parents, which are all up to date
+		auto chunk_count = static_cast<size_t>(thread_pool->size());
+		auto chunk_size  = (end - begin + chunk_count - 1) / chunk_count;
+
+		std::vector<std::future<void>> futures;
+
+		for (auto chunk_begin = begin; chunk_begin < end; chunk_begin += chunk_size)
+		{
+			auto chunk_end = std::min(chunk_begin + chunk_size, end);
+
+			futures.push_back(thread_pool->push([this, chunk_begin, chunk_end](size_t) {
+				update_range(chunk_begin, chunk_end);
+			}));
+		}
+
+		for (auto &future : futures)
+		{
+			future.get();
+		}
+	}
+
+	std::fill(dirty.begin(), dirty.end(), uint8_t{0});
+
+	changed = false;
+}
+
+void TransformHierarchy::invalidate_structure()
+{
+	structure_changed = true;
+}
+
+size_t TransformHierarchy::size() const
+{
+	return transforms.size();
+}
+
+int64_t TransformHierarchy::find(const Transform &transform) const
+{
+	return transform.hierarchy == this ? static_cast<int64_t>(transform.hierarchy_index) : -1;
+}
+
+uint64_t TransformHierarchy::get_structure_version() const
+{
+	return structure_version;
+}
+
+void TransformHierarchy::collect_moved(std::vector<uint32_t> &indices)
+{
+	for (size_t i = 0; i < moved.size(); ++i)
+	{
+		if (moved[i])
+		{
+			indices.push_back(to_u32(i));
+			moved[i] = 0;
+		}
+	}
+}
+
+void TransformHierarchy::update_range(size_t begin, size_t end)
+{
+	for (size_t i = begin; i < end; ++i)
+	{
+		auto parent = parents[i];
+
+		// Flags are cleared after the whole pass, so that children still see the flags of their parents
+		if (parent >= 0 && dirty[parent])
+		{
+			dirty[i] = 1;
+		}
+
+		if (!dirty[i])
+		{
+			continue;
+		}
+
+		auto &local = local_matrices[i];
+		auto &scale = scales[i];
+
+		local    = glm::mat4_cast(rotations[i]);
+		local[0] *= scale.x;
+		local[1] *= scale.y;
+		local[2] *= scale.z;
+		local[3] = glm::vec4{translations[i], 1.0f};
+
+		world_matrices[i] = parent >= 0 ? world_matrices[parent] * local : local;
+		moved[i]          = 1;
+	}
+}
+
+void TransformHierarchy::detach(size_t index)
+{
+	auto transform = transforms[index];
+
+	if (!transform)
+	{
+		return;
+	}
+
+	transform->translation         = translations[index];
+	transform->rotation            = rotations[index];
+	transform->scale               = scales[index];
+	transform->world_matrix        = world_matrices[index];
+	transform->update_world_matrix = true;
+
+	transform->hierarchy       = nullptr;
+	transform->hierarchy_index = 0;
+
+	transforms[index] = nullptr;
+}
+
+void TransformHierarchy::remove(size_t index)
+{
+	transforms[index] = nullptr;
+
+	structure_changed = true;
+}
+}        // namespace sg
+}        // namespace vkb
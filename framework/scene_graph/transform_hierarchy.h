@@ -0,0 +1,161 @@
+/* Copyright (c) 2021, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "common/error.h"
+
+VKBP_DISABLE_WARNINGS()
+#include "common/glm_common.h"
+#include <glm/gtx/quaternion.hpp>
+VKBP_ENABLE_WARNINGS()
+
+namespace ctpl
+{
+class thread_pool;
+}
+
+namespace vkb
+{
+namespace sg
+{
+class Node;
+class Transform;
+
+/**
+ * @brief Stores the transforms of a node tree as arrays, one per property, in breadth-first
+ *        order so that every parent comes before its children. World matrices of the changed
+ *        transforms and their descendants are then recomputed in one linear pass.
+ *
+ * Transforms in the tree become views onto their entry in the arrays, and get their own
+ * storage back when the hierarchy is cleared or destroyed. Changes to the tree structure are
+ * picked up by rebuilding the arrays on the next update.
+ */
+class TransformHierarchy
+{
+  public:
+	TransformHierarchy() = default;
+
+	TransformHierarchy(const TransformHierarchy &) = delete;
+
+	TransformHierarchy(TransformHierarchy &&) = delete;
+
+	~TransformHierarchy();
+
+	TransformHierarchy &operator=(const TransformHierarchy &) = delete;
+
+	TransformHierarchy &operator=(TransformHierarchy &&) = delete;
+
+	/**
+	 * @brief Gathers the transforms of a node and all its descendants
+	 * @param root The root of the tree
+	 */
+	void build(Node &root);
+
+	/**
+	 * @brief Hands the transforms their own storage back and empties the arrays
+	 */
+	void clear();
+
+	/**
+	 * @brief Recomputes the world matrices of changed transforms and their descendants,
+	 *        after rebuilding the arrays if the tree has changed
+	 * @param thread_pool If not null, depths of the tree with many transforms are split across its threads
+	 */
+	void update(ctpl::thread_pool *thread_pool = nullptr);
+
+	/**
+	 * @brief Marks the tree structure as changed, so that the arrays are rebuilt on the next update
+	 */
+	void invalidate_structure();
+
+	size_t size() const;
+
+	/**
+	 * @return Position of a transform in the arrays, or -1 if it is not part of this hierarchy
+	 */
+	int64_t find(const Transform &transform) const;
+
+	/**
+	 * @return Number of times the arrays were rebuilt, positions from find are only valid while it stays the same
+	 */
+	uint64_t get_structure_version() const;
+
+	/**
+	 * @brief Appends the positions of the transforms whose world matrix changed since the previous call,
+	 *        and forgets them. Meant for a single consumer, like the bounding volume hierarchy of a scene.
+	 */
+	void collect_moved(std::vector<uint32_t> &indices);
+
+  private:
+	friend class Transform;
+
+	/// Depths of the tree with fewer transforms than this are not worth splitting across threads
+	static constexpr size_t parallel_level_size{4096};
+
+	/**
+	 * @brief Recomputes the world matrices of a range of transforms, whose parents are all up to date
+	 */
+	void update_range(size_t begin, size_t end);
+
+	/**
+	 * @brief Copies the properties of a transform back into its own storage
+	 */
+	void detach(size_t index);
+
+	/**
+	 * @brief Forgets a transform that is being destroyed
+	 */
+	void remove(size_t index);
+
+	Node *root{nullptr};
+
+	std::vector<Transform *> transforms;
+
+	/// Index of the parent of every transform, or -1 for the root
+	std::vector<int32_t> parents;
+
+	std::vector<glm::vec3> translations;
+
+	std::vector<glm::quat> rotations;
+
+	std::vector<glm::vec3> scales;
+
+	std::vector<glm::mat4> local_matrices;
+
+	std::vector<glm::mat4> world_matrices;
+
+	/// Whether the world matrix of every transform is out of date
+	std::vector<uint8_t> dirty;
+
+	/// Whether the world matrix of every transform changed since the last collect_moved
+	std::vector<uint8_t> moved;
+
+	uint64_t structure_version{0};
+
+	/// Index of the first transform at every depth, followed by the number of transforms
+	std::vector<size_t> level_offsets;
+
+	bool changed{false};
+
+	bool structure_changed{false};
+};
+}        // namespace sg
+}        // namespace vkb
@@ -0,0 +1,52 @@
+/* Copyright (c) 2021, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "culling_stats_provider.h"
+
+namespace vkb
+{
+CullingStatsProvider::CullingStatsProvider(std::set<StatIndex> &requested_stats)
+{
+	// Culling results are counted by the renderer, so they are always available
+	requested_stats.erase(StatIndex::visible_objects);
+	requested_stats.erase(StatIndex::culled_objects);
+}
+
+bool CullingStatsProvider::is_available(StatIndex index) const
+{
+	return index == StatIndex::visible_objects || index == StatIndex::culled_objects;
+}
+
+StatsProvider::Counters CullingStatsProvider::sample(float delta_time)
+{
+	Counters res;
+	res[StatIndex::visible_objects].result = static_cast<double>(visible_count.exchange(0));
+	res[StatIndex::culled_objects].result  = static_cast<double>(culled_count.exchange(0));
+	return res;
+}
+
+StatsProvider::Counters CullingStatsProvider::continuous_sample(float delta_time)
+{
+	return sample(delta_time);
+}
+
+void CullingStatsProvider::record(uint64_t visible, uint64_t culled)
+{
+	visible_count += visible;
+	culled_count += culled;
+}
+}        // namespace vkb
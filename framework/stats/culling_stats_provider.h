@@ -0,0 +1,72 @@
+/* Copyright (c) 2021, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "stats_provider.h"
+
+namespace vkb
+{
+/**
+ * @brief Provides the number of objects that passed and failed visibility culling since the
+ *        previous sample, that is per frame when polling. Subpasses report to the provider of
+ *        the Stats of their sample, see GeometrySubpass::set_culling_stats.
+ */
+class CullingStatsProvider : public StatsProvider
+{
+  public:
+	/**
+	 * @brief Constructs a CullingStatsProvider
+	 * @param requested_stats Set of stats to be collected. Supported stats will be removed from the set.
+	 */
+	CullingStatsProvider(std::set<StatIndex> &requested_stats);
+
+	/**
+	 * @brief Checks if this provider can supply the given enabled stat
+	 * @param index The stat index
+	 * @return True if the stat is available, false otherwise
+	 */
+	bool is_available(StatIndex index) const override;
+
+	/**
+	 * @brief Retrieve a new sample set
+	 * @param delta_time Time since last sample
+	 */
+	Counters sample(float delta_time) override;
+
+	/**
+	 * @brief Retrieve a new sample set from continuous sampling
+	 * @param delta_time Time since last sample
+	 */
+	Counters continuous_sample(float delta_time) override;
+
+	/**
+	 * @brief Adds the results of a culling pass to the next sample, from any thread
+	 * @param visible Number of objects that are drawn
+	 * @param culled Number of objects that are skipped
+	 */
+	void record(uint64_t visible, uint64_t culled);
+
+  private:
+	std::atomic<uint64_t> visible_count{0};
+
+	std::atomic<uint64_t> culled_count{0};
+};
+}        // namespace vkb
@@ -20,6 +20,7 @@
 #include "common/error.h"
 #include "core/device.h"
 
+#include "culling_stats_provider.h"
 #include "frame_time_stats_provider.h"
 #include "hwcpipe_stats_provider.h"
 #include "vulkan_stats_provider.h"
@@ -63,7 +64,11 @@ void Stats::request_stats(const std::set<StatIndex> &wanted_stats,
 	// Initialize our list of providers (in priority order)
 	// All supported stats will be removed from the given 'stats' set by the provider's constructor
 	// so subsequent providers only see requests for stats that aren't already supported.
+	auto culling_provider = std::make_unique<CullingStatsProvider>(stats);
+	culling_stats_provider = culling_provider.get();
+
 	providers.emplace_back(std::make_unique<FrameTimeStatsProvider>(stats));
+	providers.emplace_back(std::move(culling_provider));
 	providers.emplace_back(std::make_unique<HWCPipeStatsProvider>(stats));
 	providers.emplace_back(std::make_unique<VulkanStatsProvider>(stats, sampling_config, render_context));
 
@@ -35,6 +35,7 @@ namespace vkb
 {
 class Device;
 class CommandBuffer;
+class CullingStatsProvider;
 class RenderContext;
 
 /*
@@ -101,6 +102,14 @@ class Stats
 		return requested_stats;
 	}
 
+	/**
+	 * @return The provider that culling results are reported to, or nullptr before stats are requested
+	 */
+	CullingStatsProvider *get_culling_stats_provider() const
+	{
+		return culling_stats_provider;
+	}
+
 	/**
 	 * @brief Update statistics, must be called after every frame
 	 * @param delta_time Time since last update
@@ -145,6 +154,9 @@ class Stats
 	/// Provider that tracks frame times
 	StatsProvider *frame_time_provider;
 
+	/// Provider that counts visible and culled objects
+	CullingStatsProvider *culling_stats_provider{nullptr};
+
 	/// A list of stats providers to use in priority order
 	std::vector<std::unique_ptr<StatsProvider>> providers;
 
@@ -59,6 +59,8 @@ enum class StatIndex
 	gpu_ext_read_bytes,
 	gpu_ext_write_bytes,
 	gpu_tex_cycles,
+	visible_objects,
+	culled_objects,
 };
 
 struct StatIndexHash
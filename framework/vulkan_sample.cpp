@@ -50,6 +50,8 @@ VulkanSample::~VulkanSample()
 		device->wait_idle();
 	}
 
+	texture_streamer.reset();
+	occlusion_culler.reset();
 	scene.reset();
 
 	stats.reset();
@@ -148,6 +150,9 @@ void VulkanSample::update_scene(float delta_time)
 				script->update(delta_time);
 			}
 		}
+
+		// Apply the changes of the scripts to all world matrices at once
+		scene->update_transforms();
 	}
 }
 
@@ -203,8 +208,31 @@ void VulkanSample::update(float delta_time)
 	command_buffer.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
 	stats->begin_sampling(command_buffer);
 
+	if (texture_streamer)
+	{
+		texture_streamer->update(command_buffer);
+	}
+
+	if (occlusion_culler)
+	{
+		occlusion_culler->cull(command_buffer);
+	}
+
 	draw(command_buffer, render_context->get_active_frame().get_render_target());
 
+	if (occlusion_culler)
+	{
+		// Without a render pipeline the sample draws its own render pass, which the culler cannot check
+		std::vector<LoadStoreInfo> load_store;
+
+		if (render_pipeline)
+		{
+			load_store = render_pipeline->get_load_store();
+		}
+
+		occlusion_culler->build_depth_pyramid(command_buffer, render_context->get_active_frame().get_render_target(), load_store);
+	}
+
 	stats->end_sampling(command_buffer);
 	command_buffer.end();
 
@@ -419,6 +447,11 @@ void VulkanSample::load_scene(const std::string &path)
 {
 	GLTFLoader loader{*device};
 
+	if (texture_streamer)
+	{
+		loader.set_texture_streaming(true);
+	}
+
 	scene = loader.read_scene_from_file(path);
 
 	if (!scene)
@@ -426,6 +459,27 @@ void VulkanSample::load_scene(const std::string &path)
 		LOGE("Cannot load scene: {}", path.c_str());
 		throw std::runtime_error("Cannot load scene: " + path);
 	}
+
+	if (texture_streamer)
+	{
+		texture_streamer->add_scene(*scene);
+	}
+}
+
+void VulkanSample::enable_texture_streaming(VkDeviceSize frame_budget)
+{
+	assert(render_context && "Render context is not valid");
+
+	texture_streamer = std::make_unique<TextureStreamer>(*render_context, frame_budget);
+}
+
+HiZOcclusionCuller &VulkanSample::enable_occlusion_culling(sg::Camera &camera, uint32_t depth_attachment)
+{
+	assert(render_context && scene && "Occlusion culling needs a render context and a scene");
+
+	occlusion_culler = std::make_unique<HiZOcclusionCuller>(*render_context, *scene, camera, depth_attachment);
+
+	return *occlusion_culler;
 }
 
 VkSurfaceKHR VulkanSample::get_surface()
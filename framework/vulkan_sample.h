@@ -23,8 +23,10 @@
 #include "core/instance.h"
 #include "gui.h"
 #include "platform/application.h"
+#include "rendering/hiz_occlusion_culler.h"
 #include "rendering/render_context.h"
 #include "rendering/render_pipeline.h"
+#include "rendering/texture_streamer.h"
 #include "scene_graph/node.h"
 #include "scene_graph/scene.h"
 #include "scene_graph/scripts/node_animation.h"
@@ -130,6 +132,24 @@ class VulkanSample : public Application
 	 */
 	void load_scene(const std::string &path);
 
+	/**
+	 * @brief Makes load_scene upload only the coarse mip levels of images, and streams the others
+	 *        in over the following frames. Call it before loading the scene.
+	 * @param frame_budget Number of bytes of image data to upload per frame
+	 */
+	void enable_texture_streaming(VkDeviceSize frame_budget = 8 * 1024 * 1024);
+
+	/**
+	 * @brief Tests the meshes of the scene against the depth of the previous frame before every frame,
+	 *        and builds the depth pyramid for the next one after it. Call it once the scene is loaded,
+	 *        and pass the culler to the geometry subpasses that should draw through it.
+	 * @param camera Camera the scene is drawn with
+	 * @param depth_attachment Index of the depth attachment in the render targets, which must be sampled and
+	 *        stored, see HiZOcclusionCuller::CREATE_RENDER_TARGET_FUNC
+	 * @return The occlusion culler
+	 */
+	HiZOcclusionCuller &enable_occlusion_culling(sg::Camera &camera, uint32_t depth_attachment = 1);
+
 	VkSurfaceKHR get_surface();
 
 	Device &get_device();
@@ -174,6 +194,16 @@ class VulkanSample : public Application
 
 	std::unique_ptr<Stats> stats{nullptr};
 
+	/**
+	 * @brief Uploads the remaining mip levels of the scene images, if texture streaming is enabled
+	 */
+	std::unique_ptr<TextureStreamer> texture_streamer{nullptr};
+
+	/**
+	 * @brief Skips the meshes hidden in the previous frame, if occlusion culling is enabled
+	 */
+	std::unique_ptr<HiZOcclusionCuller> occlusion_culler{nullptr};
+
 	/**
 	 * @brief Update scene
 	 * @param delta_time
@@ -287,26 +287,21 @@ vkb::CommandBuffer *CommandBufferUsage::ForwardSubpassSecondary::record_draw_sec
 
 void CommandBufferUsage::ForwardSubpassSecondary::draw(vkb::CommandBuffer &primary_command_buffer)
 {
-	std::multimap<float, std::pair<vkb::sg::Node *, vkb::sg::SubMesh *>> opaque_nodes;
-
-	std::multimap<float, std::pair<vkb::sg::Node *, vkb::sg::SubMesh *>> transparent_nodes;
-
-	get_sorted_nodes(opaque_nodes, transparent_nodes);
-
-	// Sort opaque objects in front-to-back order
+	// Opaque objects are grouped by state and sorted front-to-back, transparent ones follow back-to-front
 	// Note: sorting objects does not help on PowerVR, so it can be avoided to save CPU cycles
+	auto opaque_count = sort_draws();
+
 	std::vector<std::pair<vkb::sg::Node *, vkb::sg::SubMesh *>> sorted_opaque_nodes;
-	for (auto node_it = opaque_nodes.begin(); node_it != opaque_nodes.end(); node_it++)
+	for (size_t i = 0; i < opaque_count; i++)
 	{
-		sorted_opaque_nodes.push_back(node_it->second);
+		sorted_opaque_nodes.emplace_back(draws[i].node, draws[i].sub_mesh);
 	}
 	const auto opaque_submeshes = vkb::to_u32(sorted_opaque_nodes.size());
 
-	// Sort transparent objects in back-to-front order
 	std::vector<std::pair<vkb::sg::Node *, vkb::sg::SubMesh *>> sorted_transparent_nodes;
-	for (auto node_it = transparent_nodes.rbegin(); node_it != transparent_nodes.rend(); node_it++)
+	for (size_t i = opaque_count; i < draws.size(); i++)
 	{
-		sorted_transparent_nodes.push_back(node_it->second);
+		sorted_transparent_nodes.emplace_back(draws[i].node, draws[i].sub_mesh);
 	}
 	const auto transparent_submeshes = vkb::to_u32(sorted_transparent_nodes.size());
 
@@ -475,7 +475,7 @@ void ConstantData::BufferArraySubpass::prepare_push_constants(vkb::CommandBuffer
 	return;
 }
 
-void ConstantData::BufferArraySubpass::draw_submesh_command(vkb::CommandBuffer &command_buffer, vkb::sg::SubMesh &sub_mesh)
+void ConstantData::BufferArraySubpass::draw_submesh_command(vkb::CommandBuffer &command_buffer, vkb::sg::SubMesh &sub_mesh, const SubMeshDrawInfo & /*draw_info*/)
 {
 	/**
 	 * POI
@@ -490,12 +490,12 @@ void ConstantData::BufferArraySubpass::draw_submesh_command(vkb::CommandBuffer &
 	if (sub_mesh.vertex_indices != 0)
 	{
 		// Bind index buffer of submesh
-		command_buffer.bind_index_buffer(*sub_mesh.index_buffer, sub_mesh.index_offset, sub_mesh.index_type);
+		command_buffer.bind_index_buffer(*sub_mesh.get_index_buffer(), sub_mesh.index_offset, sub_mesh.index_type);
 
-		command_buffer.draw_indexed(sub_mesh.vertex_indices, 1, 0, 0, instance_index++);
+		command_buffer.draw_indexed(sub_mesh.vertex_indices, 1, sub_mesh.first_index, sub_mesh.base_vertex, instance_index++);
 	}
 	else
 	{
-		command_buffer.draw(sub_mesh.vertices_count, 1, 0, instance_index++);
+		command_buffer.draw(sub_mesh.vertices_count, 1, static_cast<uint32_t>(sub_mesh.base_vertex), instance_index++);
 	}
 }
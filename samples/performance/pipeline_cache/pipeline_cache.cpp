@@ -90,19 +90,22 @@ bool PipelineCache::prepare(vkb::Platform &platform)
 	// Use pipeline cache to store pipelines
 	resource_cache.set_pipeline_cache(pipeline_cache);
 
-	std::vector<uint8_t> data_cache;
+	std::unique_ptr<vkb::fs::MappedFile> data_cache;
 
 	try
 	{
-		data_cache = vkb::fs::read_temp("cache.data");
+		data_cache = std::make_unique<vkb::fs::MappedFile>(vkb::fs::map_temp("cache.data"));
 	}
 	catch (std::runtime_error &ex)
 	{
 		LOGW("No data cache found. {}", ex.what());
 	}
 
-	// Build all pipelines from a previous run
-	resource_cache.warmup(data_cache);
+	// Build all pipelines from a previous run, replaying the records straight from the mapped file
+	if (data_cache)
+	{
+		resource_cache.warmup(data_cache->data(), data_cache->size());
+	}
 
 	stats->request_stats({vkb::StatIndex::frame_times});
 
@@ -27,6 +27,8 @@ layout(set = 0, binding = 1) uniform GlobalUniform
 	mat4 model;
 	mat4 view_proj;
 	vec3 camera_position;
+	vec3 position_offset;
+	vec3 position_scale;
 }
 global_uniform;
 
@@ -47,13 +49,37 @@ layout(location = 0) out vec3 o_pos;
 layout(location = 1) out vec2 o_uv;
 layout(location = 2) out vec3 o_normal;
 
+#ifdef OCTAHEDRAL_NORMAL
+vec3 decode_octahedral(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	if (n.z < 0.0)
+	{
+		n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+	}
+	return normalize(n);
+}
+#endif
+
 void main(void)
 {
-	o_pos = vec3(global_uniform.model * vec4(position, 1.0));
+#ifdef QUANTIZED_POSITION
+	vec3 local_position = position * global_uniform.position_scale + global_uniform.position_offset;
+#else
+	vec3 local_position = position;
+#endif
+
+#ifdef OCTAHEDRAL_NORMAL
+	vec3 local_normal = decode_octahedral(normal.xy);
+#else
+	vec3 local_normal = normal;
+#endif
+
+	o_pos = vec3(global_uniform.model * vec4(local_position, 1.0));
 
 	o_uv = texcoord_0;
 
-	o_normal = mat3(global_uniform.model) * normal;
+	o_normal = mat3(global_uniform.model) * local_normal;
 
-	gl_Position = global_uniform.view_proj * global_uniform.model * vec4(position, 1.0);
+	gl_Position = global_uniform.view_proj * global_uniform.model * vec4(local_position, 1.0);
 }
@@ -0,0 +1,247 @@
+/* Copyright (c) 2021, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Measures how fast draws are recorded when consecutive draws change part of the pipeline state.
+ *
+ * Draws are recorded through a CommandBuffer the way a geometry subpass records them: every draw
+ * sets the rasterization, depth stencil and color blend states of its material, so that
+ * CommandBuffer::flush_pipeline_state hashes the pipeline state and looks its pipeline up with
+ * ResourceCache::request_graphics_pipeline. Materials alternate between opaque and blended, double
+ * and single sided, so most draws change some sub-states and keep the others. The pipelines of
+ * every material are built before timing starts, so only the hit path is measured.
+ *
+ * Recording is timed with the sub-state hashes of PipelineState cached, then with every sub-state
+ * rehashed whenever the state changes, as before sub-state hashes were cached. The command buffers
+ * are never submitted. Run it on a device with a Vulkan driver, no window is needed.
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include "common/logging.h"
+#include "core/command_buffer.h"
+#include "core/device.h"
+#include "core/instance.h"
+#include "rendering/pipeline_state.h"
+#include "rendering/render_frame.h"
+#include "resource_cache.h"
+
+namespace
+{
+constexpr uint32_t draws_per_command_buffer{10000};
+
+constexpr uint32_t command_buffer_count{500};
+
+const char *vertex_source = R"(#version 320 es
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec2 texcoord_0;
+layout(location = 2) in vec3 normal;
+
+layout(location = 0) out vec2 o_uv;
+
+void main(void)
+{
+    o_uv        = texcoord_0;
+    gl_Position = vec4(position + normal * 0.01, 1.0);
+}
+)";
+
+const char *fragment_source = R"(#version 320 es
+precision highp float;
+
+layout(location = 0) in vec2 in_uv;
+
+layout(location = 0) out vec4 o_color;
+
+void main(void)
+{
+    o_color = vec4(in_uv, 0.0, 0.5);
+}
+)";
+
+struct Material
+{
+	vkb::RasterizationState rasterization_state;
+
+	vkb::DepthStencilState depth_stencil_state;
+
+	vkb::ColorBlendState color_blend_state;
+};
+
+std::vector<Material> create_materials()
+{
+	std::vector<Material> materials(4);
+
+	for (size_t i = 0; i < materials.size(); ++i)
+	{
+		auto &material = materials[i];
+
+		bool double_sided = (i & 1) != 0;
+		bool blended      = (i & 2) != 0;
+
+		material.rasterization_state.cull_mode = double_sided ? VK_CULL_MODE_NONE : VK_CULL_MODE_BACK_BIT;
+
+		material.depth_stencil_state.depth_write_enable = blended ? VK_FALSE : VK_TRUE;
+
+		vkb::ColorBlendAttachmentState attachment;
+		attachment.blend_enable           = blended ? VK_TRUE : VK_FALSE;
+		attachment.src_color_blend_factor = blended ? VK_BLEND_FACTOR_SRC_ALPHA : VK_BLEND_FACTOR_ONE;
+		attachment.dst_color_blend_factor = blended ? VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA : VK_BLEND_FACTOR_ZERO;
+
+		material.color_blend_state.attachments = {attachment};
+	}
+
+	return materials;
+}
+
+/**
+ * @brief State shared by every command buffer the benchmark records
+ */
+struct Scene
+{
+	vkb::RenderFrame *render_frame;
+
+	const vkb::Queue *queue;
+
+	const vkb::RenderPass *render_pass;
+
+	const vkb::Framebuffer *framebuffer;
+
+	vkb::PipelineLayout *pipeline_layout;
+
+	vkb::VertexInputState vertex_input_state;
+
+	std::vector<Material> materials;
+};
+
+/**
+ * @brief Records a command buffer of draws that cycle through the materials, in a render pass over the render target of the frame
+ */
+void record(Scene &scene, uint32_t draw_count)
+{
+	scene.render_frame->reset();
+
+	auto &render_target  = scene.render_frame->get_render_target();
+	auto &command_buffer = scene.render_frame->request_command_buffer(*scene.queue);
+
+	const auto &extent = render_target.get_extent();
+
+	command_buffer.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+	command_buffer.begin_render_pass(render_target, *scene.render_pass, *scene.framebuffer, {VkClearValue{}});
+
+	command_buffer.set_viewport(0, {{0.0f, 0.0f, static_cast<float>(extent.width), static_cast<float>(extent.height), 0.0f, 1.0f}});
+	command_buffer.set_scissor(0, {{{0, 0}, extent}});
+
+	command_buffer.bind_pipeline_layout(*scene.pipeline_layout);
+	command_buffer.set_vertex_input_state(scene.vertex_input_state);
+
+	for (uint32_t i = 0; i < draw_count; ++i)
+	{
+		// Consecutive draws often share a material
+		const auto &material = scene.materials[(i / 3) % scene.materials.size()];
+
+		command_buffer.set_rasterization_state(material.rasterization_state);
+		command_buffer.set_depth_stencil_state(material.depth_stencil_state);
+		command_buffer.set_color_blend_state(material.color_blend_state);
+
+		command_buffer.draw(3, 1, 0, 0);
+	}
+
+	command_buffer.end_render_pass();
+	command_buffer.end();
+}
+
+/**
+ * @return Number of draws recorded per second
+ */
+double measure(Scene &scene, bool incremental_hashing)
+{
+	vkb::PipelineState::set_incremental_hashing(incremental_hashing);
+
+	// Builds the pipeline of every material, so that timed draws only hit the cache
+	record(scene, vkb::to_u32(scene.materials.size()) * 3);
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	for (uint32_t i = 0; i < command_buffer_count; ++i)
+	{
+		record(scene, draws_per_command_buffer);
+	}
+
+	std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+	return command_buffer_count * static_cast<double>(draws_per_command_buffer) / elapsed.count();
+}
+}        // namespace
+
+int main()
+{
+	vkb::Instance instance{"pipeline_state_benchmark", {}, {}, true};
+
+	vkb::Device device{instance.get_suitable_gpu(), VK_NULL_HANDLE};
+
+	auto &resource_cache = device.get_resource_cache();
+
+	std::vector<vkb::core::Image> images;
+	images.emplace_back(device, VkExtent3D{256, 256, 1}, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+
+	vkb::RenderFrame render_frame{device, std::make_unique<vkb::RenderTarget>(std::move(images))};
+
+	auto &render_target = render_frame.get_render_target();
+
+	std::vector<vkb::LoadStoreInfo> load_store{{VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_DONT_CARE}};
+
+	auto &render_pass = resource_cache.request_render_pass(render_target.get_attachments(), load_store, {});
+	auto &framebuffer = resource_cache.request_framebuffer(render_target, render_pass);
+
+	vkb::ShaderSource vertex_shader;
+	vertex_shader.set_source(vertex_source);
+
+	vkb::ShaderSource fragment_shader;
+	fragment_shader.set_source(fragment_source);
+
+	std::vector<vkb::ShaderModule *> shader_modules{&resource_cache.request_shader_module(VK_SHADER_STAGE_VERTEX_BIT, vertex_shader),
+	                                                &resource_cache.request_shader_module(VK_SHADER_STAGE_FRAGMENT_BIT, fragment_shader)};
+
+	Scene scene;
+	scene.render_frame    = &render_frame;
+	scene.queue           = &device.get_queue_by_flags(VK_QUEUE_GRAPHICS_BIT, 0);
+	scene.render_pass     = &render_pass;
+	scene.framebuffer     = &framebuffer;
+	scene.pipeline_layout = &resource_cache.request_pipeline_layout(shader_modules);
+	scene.materials       = create_materials();
+
+	scene.vertex_input_state.attributes = {{0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0},
+	                                       {1, 1, VK_FORMAT_R32G32_SFLOAT, 0},
+	                                       {2, 2, VK_FORMAT_R32G32B32_SFLOAT, 0}};
+	scene.vertex_input_state.bindings   = {{0, 12, VK_VERTEX_INPUT_RATE_VERTEX},
+	                                       {1, 8, VK_VERTEX_INPUT_RATE_VERTEX},
+	                                       {2, 12, VK_VERTEX_INPUT_RATE_VERTEX}};
+
+	double incremental = measure(scene, true);
+	double full        = measure(scene, false);
+
+	vkb::PipelineState::set_incremental_hashing(true);
+
+	LOGI("cached sub-state hashes: {:.0f} draws/s", incremental);
+	LOGI("full rehash:             {:.0f} draws/s", full);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,126 @@
+/* Copyright (c) 2021, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Measures how ResourceCache hits scale with the number of threads requesting them.
+ *
+ * Every thread requests the same descriptor set layouts, which are all cached before timing
+ * starts, so only the hit path is measured. The same requests are then timed again with every
+ * call serialized by a single mutex, as cache hits were before they went through the lock-free
+ * index. Run it on a device with a Vulkan driver, no window is needed.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "common/logging.h"
+#include "core/device.h"
+#include "core/instance.h"
+#include "resource_cache.h"
+
+namespace
+{
+constexpr uint32_t layout_count{16};
+
+constexpr uint32_t requests_per_thread{1000000};
+
+/**
+ * @return Number of requests per second served to all threads together
+ */
+double measure(vkb::ResourceCache &resource_cache, uint32_t thread_count, std::mutex *serialize)
+{
+	std::vector<std::thread> threads;
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	for (uint32_t t = 0; t < thread_count; ++t)
+	{
+		threads.emplace_back([&resource_cache, serialize, t]() {
+			std::vector<vkb::ShaderModule *> shader_modules;
+			std::vector<vkb::ShaderResource> set_resources;
+			const vkb::DescriptorSetLayout * last{nullptr};
+
+			for (uint32_t i = 0; i < requests_per_thread; ++i)
+			{
+				uint32_t set_index = (i + t) % layout_count;
+
+				if (serialize)
+				{
+					std::lock_guard<std::mutex> guard(*serialize);
+					last = &resource_cache.request_descriptor_set_layout(set_index, shader_modules, set_resources);
+				}
+				else
+				{
+					last = &resource_cache.request_descriptor_set_layout(set_index, shader_modules, set_resources);
+				}
+			}
+
+			// Keep the loop from being optimized away
+			if (last == nullptr)
+			{
+				std::abort();
+			}
+		});
+	}
+
+	for (auto &thread : threads)
+	{
+		thread.join();
+	}
+
+	std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+	return thread_count * static_cast<double>(requests_per_thread) / elapsed.count();
+}
+}        // namespace
+
+int main()
+{
+	vkb::Instance instance{"resource_cache_benchmark", {}, {}, true};
+
+	vkb::Device device{instance.get_suitable_gpu(), VK_NULL_HANDLE};
+
+	auto &resource_cache = device.get_resource_cache();
+
+	std::vector<vkb::ShaderModule *> shader_modules;
+	std::vector<vkb::ShaderResource> set_resources;
+
+	for (uint32_t set_index = 0; set_index < layout_count; ++set_index)
+	{
+		resource_cache.request_descriptor_set_layout(set_index, shader_modules, set_resources);
+	}
+
+	uint32_t max_threads = std::max(1U, std::thread::hardware_concurrency());
+
+	std::mutex serialize;
+
+	LOGI("threads | lock-free hits/s | serialized hits/s");
+
+	for (uint32_t thread_count = 1; thread_count <= max_threads; thread_count *= 2)
+	{
+		double lock_free  = measure(resource_cache, thread_count, nullptr);
+		double serialized = measure(resource_cache, thread_count, &serialize);
+
+		LOGI("{:7} | {:16.0f} | {:17.0f}", thread_count, lock_free, serialized);
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,81 @@
+/* Copyright (c) 2021, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "sponza_occlusion.h"
+
+#include "gltf_loader.h"
+#include "gui.h"
+#include "platform/platform.h"
+#include "rendering/hiz_occlusion_culler.h"
+#include "rendering/subpasses/geometry_subpass.h"
+#include "scene_graph/node.h"
+#include "scene_graph/scene.h"
+#include "stats/stats.h"
+#if defined(VK_USE_PLATFORM_ANDROID_KHR)
+#	include "platform/android/android_platform.h"
+#endif
+
+SponzaOcclusionTest::SponzaOcclusionTest() :
+    vkbtest::GLTFLoaderTest("scenes/sponza/Sponza01.gltf")
+{
+}
+
+bool SponzaOcclusionTest::prepare(vkb::Platform &platform)
+{
+	if (!GLTFLoaderTest::prepare(platform))
+	{
+		return false;
+	}
+
+	// The same camera GLTFLoaderTest draws the scene with
+	auto camera_node = get_scene().find_node("main_camera");
+
+	if (!camera_node)
+	{
+		camera_node = get_scene().find_node("default_camera");
+	}
+
+	auto &occlusion_culler = enable_occlusion_culling(camera_node->get_component<vkb::sg::Camera>());
+
+	auto &scene_subpass = static_cast<vkb::GeometrySubpass &>(*get_render_pipeline().get_subpasses().at(0));
+	scene_subpass.set_occlusion_culler(&occlusion_culler);
+
+	return true;
+}
+
+void SponzaOcclusionTest::update(float delta_time)
+{
+	if (!first_frame_drawn)
+	{
+		vkb::VulkanSample::update(delta_time);
+		first_frame_drawn = true;
+		return;
+	}
+
+	GLTFLoaderTest::update(delta_time);
+}
+
+void SponzaOcclusionTest::prepare_render_context()
+{
+	// The depth attachment is sampled to build the occlusion culling depth pyramid
+	get_render_context().prepare(1, vkb::HiZOcclusionCuller::CREATE_RENDER_TARGET_FUNC);
+}
+
+std::unique_ptr<vkb::VulkanSample> create_sponza_occlusion_test()
+{
+	return std::make_unique<SponzaOcclusionTest>();
+}
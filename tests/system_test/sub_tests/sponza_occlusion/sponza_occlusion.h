@@ -0,0 +1,47 @@
+/* Copyright (c) 2021, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "gltf_loader_test.h"
+#include "rendering/render_pipeline.h"
+#include "scene_graph/components/camera.h"
+
+/**
+ * @brief Draws Sponza with hierarchical-Z occlusion culling. A first frame is drawn before the one
+ *        captured, so that the captured frame is culled against the depth of the first one. Culling
+ *        must not change the image, which should match the one of the sponza test.
+ */
+class SponzaOcclusionTest : public vkbtest::GLTFLoaderTest
+{
+  public:
+	SponzaOcclusionTest();
+
+	virtual ~SponzaOcclusionTest() = default;
+
+	virtual bool prepare(vkb::Platform &platform) override;
+
+	virtual void update(float delta_time) override;
+
+  protected:
+	virtual void prepare_render_context() override;
+
+  private:
+	bool first_frame_drawn{false};
+};
+
+std::unique_ptr<vkb::VulkanSample> create_sponza_occlusion_test();
@@ -0,0 +1,396 @@
+/* Copyright (c) 2021, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "common/helpers.h"
+#include "scene_graph/components/image/bcn.h"
+#include "unit_test.h"
+
+namespace
+{
+using Texel = std::array<int, 4>;
+
+/**
+ * @brief Expands an RGB565 color to 8 bits per channel, replicating the high bits into the low ones
+ */
+Texel from_rgb565(uint16_t color)
+{
+	int r = (color >> 11) & 31;
+	int g = (color >> 5) & 63;
+	int b = color & 31;
+
+	return {(r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2), 255};
+}
+
+Texel interpolate(const Texel &a, const Texel &b, int weight_a, int weight_b)
+{
+	Texel texel;
+	for (size_t channel = 0; channel < texel.size(); ++channel)
+	{
+		texel[channel] = static_cast<int>(std::lround(static_cast<float>(weight_a * a[channel] + weight_b * b[channel]) / static_cast<float>(weight_a + weight_b)));
+	}
+	return texel;
+}
+
+/**
+ * @brief Decodes a BC1 color block as a GPU would, in three color mode when color0 is not greater than color1
+ */
+void decode_color_block(const uint8_t *block, std::array<Texel, 16> &texels)
+{
+	uint16_t color0;
+	uint16_t color1;
+	uint32_t indices;
+	std::memcpy(&color0, block, sizeof(color0));
+	std::memcpy(&color1, block + 2, sizeof(color1));
+	std::memcpy(&indices, block + 4, sizeof(indices));
+
+	// The encoder only writes four color blocks, or blocks of equal endpoints where every texel is color0
+	VKBTEST_CHECK(color0 > color1 || indices == 0);
+
+	std::array<Texel, 4> palette;
+	palette[0] = from_rgb565(color0);
+	palette[1] = from_rgb565(color1);
+
+	if (color0 > color1)
+	{
+		palette[2] = interpolate(palette[0], palette[1], 2, 1);
+		palette[3] = interpolate(palette[0], palette[1], 1, 2);
+	}
+	else
+	{
+		palette[2] = interpolate(palette[0], palette[1], 1, 1);
+		palette[3] = {0, 0, 0, 255};
+	}
+
+	for (size_t i = 0; i < texels.size(); ++i)
+	{
+		texels[i] = palette[(indices >> (i * 2)) & 3];
+	}
+}
+
+/**
+ * @brief Decodes the alphas of a BC3 alpha block into the texels, in six alpha mode when alpha0 is not greater than alpha1
+ */
+void decode_alpha_block(const uint8_t *block, std::array<Texel, 16> &texels)
+{
+	int alpha0 = block[0];
+	int alpha1 = block[1];
+
+	uint64_t indices{0};
+	for (size_t byte = 0; byte < 6; ++byte)
+	{
+		indices |= static_cast<uint64_t>(block[2 + byte]) << (byte * 8);
+	}
+
+	std::array<int, 8> palette;
+	palette[0] = alpha0;
+	palette[1] = alpha1;
+
+	if (alpha0 > alpha1)
+	{
+		for (int index = 2; index < 8; ++index)
+		{
+			palette[index] = ((8 - index) * alpha0 + (index - 1) * alpha1) / 7;
+		}
+	}
+	else
+	{
+		for (int index = 2; index < 6; ++index)
+		{
+			palette[index] = ((6 - index) * alpha0 + (index - 1) * alpha1) / 5;
+		}
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+
+	for (size_t i = 0; i < texels.size(); ++i)
+	{
+		texels[i][3] = palette[(indices >> (i * 3)) & 7];
+	}
+}
+
+/**
+ * @brief Decodes a mip level of a transcoded image, dropping the texels of edge blocks that lie past the level
+ */
+std::vector<Texel> decode(const vkb::sg::Image &image, size_t level)
+{
+	bool   has_alpha  = image.get_format() == VK_FORMAT_BC3_UNORM_BLOCK || image.get_format() == VK_FORMAT_BC3_SRGB_BLOCK;
+	size_t block_size = has_alpha ? 16 : 8;
+
+	auto &mipmap = image.get_mipmaps()[level];
+	auto &extent = mipmap.extent;
+
+	uint32_t block_columns = (extent.width + 3) / 4;
+	uint32_t block_rows    = (extent.height + 3) / 4;
+
+	std::vector<Texel> texels(static_cast<size_t>(extent.width) * extent.height);
+
+	for (uint32_t block_y = 0; block_y < block_rows; ++block_y)
+	{
+		for (uint32_t block_x = 0; block_x < block_columns; ++block_x)
+		{
+			const uint8_t *block = image.get_data().data() + mipmap.offset + (static_cast<size_t>(block_y) * block_columns + block_x) * block_size;
+
+			std::array<Texel, 16> block_texels;
+			decode_color_block(has_alpha ? block + 8 : block, block_texels);
+
+			if (has_alpha)
+			{
+				decode_alpha_block(block, block_texels);
+			}
+
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				uint32_t x = block_x * 4 + i % 4;
+				uint32_t y = block_y * 4 + i / 4;
+
+				if (x < extent.width && y < extent.height)
+				{
+					texels[static_cast<size_t>(y) * extent.width + x] = block_texels[i];
+				}
+			}
+		}
+	}
+
+	return texels;
+}
+
+/**
+ * @brief Builds an RGBA8 image with a single level from its texels
+ */
+std::unique_ptr<vkb::sg::Image> create_image(const std::vector<Texel> &texels, uint32_t width, uint32_t height)
+{
+	std::vector<uint8_t> data;
+	for (auto &texel : texels)
+	{
+		data.insert(data.end(), texel.begin(), texel.end());
+	}
+
+	vkb::sg::Mipmap mipmap;
+	mipmap.extent = {width, height, 1};
+
+	return std::make_unique<vkb::sg::Image>("test", std::move(data), std::vector<vkb::sg::Mipmap>{mipmap});
+}
+
+/**
+ * @return The largest difference of a channel between the texels, over the first channel_count channels
+ */
+int max_error(const std::vector<Texel> &a, const std::vector<Texel> &b, size_t channel_count)
+{
+	int error = 0;
+	for (size_t i = 0; i < a.size(); ++i)
+	{
+		for (size_t channel = 0; channel < channel_count; ++channel)
+		{
+			error = std::max(error, std::abs(a[i][channel] - b[i][channel]));
+		}
+	}
+	return error;
+}
+
+void test_solid_block()
+{
+	std::vector<Texel> texels(16, Texel{200, 100, 50, 255});
+
+	auto         image = create_image(texels, 4, 4);
+	vkb::sg::Bcn bcn{*image};
+
+	VKBTEST_CHECK(bcn.get_format() == VK_FORMAT_BC1_RGB_UNORM_BLOCK);
+	VKBTEST_CHECK(bcn.get_data().size() == 8);
+
+	// A single color gives equal endpoints, which decode in three color mode where index 3 is black
+	uint16_t color0;
+	uint16_t color1;
+	std::memcpy(&color0, bcn.get_data().data(), sizeof(color0));
+	std::memcpy(&color1, bcn.get_data().data() + 2, sizeof(color1));
+	VKBTEST_CHECK(color0 == color1);
+
+	auto decoded = decode(bcn, 0);
+
+	// Within the rounding of RGB565
+	VKBTEST_CHECK(max_error(decoded, texels, 4) <= 4);
+	VKBTEST_CHECK(std::all_of(decoded.begin(), decoded.end(), [&](const Texel &texel) {
+		return texel == decoded[0];
+	}));
+}
+
+void test_endpoint_swap()
+{
+	// Red and green project onto the principal axis in the opposite order of their RGB565 values,
+	// so the encoder has to swap the endpoints and their indices to stay in four color mode
+	std::vector<Texel> texels(16);
+	for (size_t i = 0; i < texels.size(); ++i)
+	{
+		texels[i] = (i % 4) < 2 ? Texel{255, 0, 0, 255} : Texel{0, 255, 0, 255};
+	}
+
+	auto         image = create_image(texels, 4, 4);
+	vkb::sg::Bcn bcn{*image};
+
+	uint16_t color0;
+	uint16_t color1;
+	std::memcpy(&color0, bcn.get_data().data(), sizeof(color0));
+	std::memcpy(&color1, bcn.get_data().data() + 2, sizeof(color1));
+	VKBTEST_CHECK(color0 > color1);
+
+	// Both colors are exact in RGB565
+	VKBTEST_CHECK(max_error(decode(bcn, 0), texels, 4) == 0);
+}
+
+void test_gradient()
+{
+	// Every block covers four evenly spaced colors along a line, which BC1 represents up to RGB565 rounding
+	uint32_t           width  = 16;
+	uint32_t           height = 8;
+	std::vector<Texel> texels;
+
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			int value = static_cast<int>(x) * 16;
+			texels.push_back({value, 64 + value / 2, 255 - value, 255});
+		}
+	}
+
+	auto         image = create_image(texels, width, height);
+	vkb::sg::Bcn bcn{*image};
+
+	VKBTEST_CHECK(bcn.get_format() == VK_FORMAT_BC1_RGB_UNORM_BLOCK);
+	VKBTEST_CHECK(bcn.get_data().size() == 4 * 2 * 8);
+	VKBTEST_CHECK(max_error(decode(bcn, 0), texels, 3) <= 8);
+}
+
+void test_alpha()
+{
+	uint32_t           width  = 8;
+	uint32_t           height = 4;
+	std::vector<Texel> texels;
+
+	// The left block has an alpha gradient, the right block a single translucent alpha
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			int alpha = x < 4 ? static_cast<int>(x + y) * 40 : 128;
+			texels.push_back({static_cast<int>(x) * 32, 128, 64, alpha});
+		}
+	}
+
+	auto         image = create_image(texels, width, height);
+	vkb::sg::Bcn bcn{*image};
+
+	VKBTEST_CHECK(bcn.get_format() == VK_FORMAT_BC3_UNORM_BLOCK);
+	VKBTEST_CHECK(bcn.get_data().size() == 2 * 16);
+
+	auto decoded = decode(bcn, 0);
+
+	// The gradient spans 240, eight evenly spaced alphas are at most 240 / 14 from a texel
+	VKBTEST_CHECK(max_error(decoded, texels, 3) <= 8);
+
+	for (size_t i = 0; i < texels.size(); ++i)
+	{
+		int error = std::abs(decoded[i][3] - texels[i][3]);
+		VKBTEST_CHECK(error <= (i % width < 4 ? 18 : 0));
+	}
+}
+
+void test_partial_blocks()
+{
+	// Levels that are not a multiple of 4 texels, down to a level smaller than a block
+	std::vector<VkExtent3D> extents{{6, 5, 1}, {3, 2, 1}, {1, 1, 1}};
+
+	std::vector<std::vector<Texel>> levels;
+	std::vector<uint8_t>            data;
+	std::vector<vkb::sg::Mipmap>    mipmaps;
+
+	for (uint32_t level = 0; level < extents.size(); ++level)
+	{
+		auto &extent = extents[level];
+
+		vkb::sg::Mipmap mipmap;
+		mipmap.level  = level;
+		mipmap.offset = vkb::to_u32(data.size());
+		mipmap.extent = extent;
+		mipmaps.push_back(mipmap);
+
+		std::vector<Texel> texels;
+		for (uint32_t y = 0; y < extent.height; ++y)
+		{
+			for (uint32_t x = 0; x < extent.width; ++x)
+			{
+				// Colors along a line, so that edge blocks are still representable
+				int value = static_cast<int>(x) * 30 + static_cast<int>(y + level) * 4;
+				texels.push_back({value, 255 - value, 128, 255});
+			}
+		}
+
+		for (auto &texel : texels)
+		{
+			data.insert(data.end(), texel.begin(), texel.end());
+		}
+		levels.push_back(texels);
+	}
+
+	vkb::sg::Image image{"test", std::move(data), std::move(mipmaps)};
+	vkb::sg::Bcn   bcn{image};
+
+	auto &bcn_mipmaps = bcn.get_mipmaps();
+
+	VKBTEST_CHECK(bcn_mipmaps.size() == extents.size());
+	VKBTEST_CHECK(bcn.get_data().size() == (4 + 1 + 1) * 8);
+
+	if (bcn_mipmaps.size() != extents.size())
+	{
+		return;
+	}
+
+	VKBTEST_CHECK(bcn_mipmaps[0].offset == 0);
+	VKBTEST_CHECK(bcn_mipmaps[1].offset == 4 * 8);
+	VKBTEST_CHECK(bcn_mipmaps[2].offset == 5 * 8);
+
+	for (size_t level = 0; level < extents.size(); ++level)
+	{
+		VKBTEST_CHECK(bcn_mipmaps[level].extent.width == extents[level].width);
+		VKBTEST_CHECK(bcn_mipmaps[level].extent.height == extents[level].height);
+
+		// Edge blocks repeat the last row and column, padding them with other colors would stretch their endpoints
+		VKBTEST_CHECK(max_error(decode(bcn, level), levels[level], 3) <= 12);
+	}
+}
+}        // namespace
+
+int main()
+{
+	// Every test transcodes its own images, which must not be read from or written to disk
+	vkb::sg::Bcn::set_transcode_cache_enabled(false);
+
+	test_solid_block();
+	test_endpoint_swap();
+	test_gradient();
+	test_alpha();
+	test_partial_blocks();
+
+	return vkbtest::get_result();
+}
@@ -0,0 +1,288 @@
+/* Copyright (c) 2021, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include "common/resource_caching.h"
+#include "unit_test.h"
+
+namespace
+{
+/**
+ * @brief Pool that only counts its sets, they are released by reset() only like the pools of a render frame
+ */
+struct FakePool
+{
+	size_t allocated{0};
+
+	size_t get_set_count() const
+	{
+		return allocated;
+	}
+
+	void reset()
+	{
+		allocated = 0;
+	}
+};
+
+struct FakeSet
+{
+	explicit FakeSet(FakePool &pool) :
+	    pool{&pool}
+	{
+		++pool.allocated;
+	}
+
+	FakePool &get_descriptor_pool() const
+	{
+		return *pool;
+	}
+
+	vkb::BindingMap<VkDescriptorImageInfo> &get_image_infos()
+	{
+		return image_infos;
+	}
+
+	FakePool *pool;
+
+	vkb::BindingMap<VkDescriptorImageInfo> image_infos;
+};
+
+/**
+ * @return A distinct image view handle, never passed to Vulkan
+ */
+VkImageView fake_image_view(uint8_t id)
+{
+	VkImageView image_view{VK_NULL_HANDLE};
+	std::memcpy(&image_view, &id, sizeof(id));
+	return image_view;
+}
+
+/**
+ * @brief Caches sets the way RenderFrame does for a single thread
+ */
+class FakeFrame
+{
+  public:
+	explicit FakeFrame(uint64_t max_age) :
+	    max_age{max_age}
+	{}
+
+	void reset()
+	{
+		++frame_count;
+
+		vkb::evict_descriptor_sets(sets, pools, last_used, frame_count, max_age);
+	}
+
+	void request(size_t layout, size_t set, VkImageView image_view = VK_NULL_HANDLE)
+	{
+		auto &pool = pools[layout];
+
+		auto set_it = sets.find(set);
+
+		if (set_it == sets.end())
+		{
+			set_it = sets.emplace(set, FakeSet{pool}).first;
+
+			set_it->second.image_infos[0][0].imageView = image_view;
+		}
+
+		last_used[&set_it->second] = frame_count;
+	}
+
+	size_t release(const std::unordered_set<VkImageView> &image_views)
+	{
+		return vkb::release_descriptor_sets(sets, last_used, image_views);
+	}
+
+	std::unordered_map<uint64_t, FakePool> pools;
+
+	std::unordered_map<uint64_t, FakeSet> sets;
+
+	std::unordered_map<const FakeSet *, uint64_t> last_used;
+
+  private:
+	uint64_t frame_count{0};
+
+	uint64_t max_age;
+};
+
+size_t allocated_sets(const FakeFrame &frame)
+{
+	size_t allocated{0};
+
+	for (auto &it : frame.pools)
+	{
+		allocated += it.second.allocated;
+	}
+
+	return allocated;
+}
+
+void test_sets_in_use_are_kept()
+{
+	FakeFrame frame{4};
+
+	for (size_t i = 0; i < 1000; ++i)
+	{
+		frame.reset();
+
+		for (size_t set = 0; set < 10; ++set)
+		{
+			frame.request(set % 2, set);
+		}
+	}
+
+	VKBTEST_CHECK(frame.sets.size() == 10);
+	VKBTEST_CHECK(frame.last_used.size() == 10);
+	VKBTEST_CHECK(allocated_sets(frame) == 10);
+}
+
+void test_max_age()
+{
+	const uint64_t max_age = 4;
+
+	FakeFrame frame{max_age};
+
+	frame.reset();
+	frame.request(0, 1);
+
+	for (uint64_t i = 1; i < max_age; ++i)
+	{
+		frame.reset();
+		frame.request(0, 0);
+	}
+
+	frame.reset();
+	VKBTEST_CHECK(frame.sets.count(1) == 1);
+
+	frame.request(0, 0);
+	frame.reset();
+	VKBTEST_CHECK(frame.sets.count(1) == 0);
+	VKBTEST_CHECK(frame.sets.count(0) == 1);
+}
+
+void test_unused_pools_are_destroyed()
+{
+	FakeFrame frame{2};
+
+	frame.reset();
+	frame.request(0, 0);
+	frame.request(1, 1);
+
+	for (size_t i = 0; i < 3; ++i)
+	{
+		frame.reset();
+		frame.request(0, 0);
+	}
+
+	VKBTEST_CHECK(frame.pools.size() == 1);
+	VKBTEST_CHECK(frame.pools.count(0) == 1);
+}
+
+void test_caches_stop_growing()
+{
+	const uint64_t max_age         = 8;
+	const size_t   persistent_sets = 5;
+	const size_t   new_sets        = 3;
+
+	FakeFrame frame{max_age};
+
+	size_t next_set{persistent_sets};
+	size_t max_cached_sets{0};
+	size_t max_allocated_sets{0};
+
+	// Every frame uses the same few sets, and some new ones that are never used again
+	for (size_t i = 0; i < 100000; ++i)
+	{
+		frame.reset();
+
+		for (size_t set = 0; set < persistent_sets; ++set)
+		{
+			frame.request(0, set);
+		}
+
+		for (size_t set = 0; set < new_sets; ++set)
+		{
+			frame.request(0, next_set++);
+		}
+
+		max_cached_sets    = std::max(max_cached_sets, frame.sets.size());
+		max_allocated_sets = std::max(max_allocated_sets, allocated_sets(frame));
+
+		VKBTEST_CHECK(frame.last_used.size() == frame.sets.size());
+	}
+
+	// Only the sets of the current frame and of the max_age frames before it stay cached
+	const size_t cached_bound = persistent_sets + new_sets * (max_age + 1);
+
+	VKBTEST_CHECK(max_cached_sets <= cached_bound);
+
+	// A pool is reset once more than half of its sets were dropped
+	VKBTEST_CHECK(max_allocated_sets <= 2 * cached_bound + new_sets);
+}
+
+void test_sets_of_released_views_are_dropped()
+{
+	auto old_view   = fake_image_view(1);
+	auto new_view   = fake_image_view(2);
+	auto other_view = fake_image_view(3);
+
+	FakeFrame frame{16};
+
+	frame.reset();
+
+	for (size_t set = 0; set < 3; ++set)
+	{
+		frame.request(0, set, old_view);
+	}
+
+	frame.request(0, 3, other_view);
+
+	VKBTEST_CHECK(frame.release({old_view, new_view}) == 3);
+	VKBTEST_CHECK(frame.sets.size() == 1);
+	VKBTEST_CHECK(frame.sets.count(3) == 1);
+	VKBTEST_CHECK(frame.last_used.size() == 1);
+
+	// Nothing left refers to the view
+	VKBTEST_CHECK(frame.release({old_view}) == 0);
+
+	// The released sets stay allocated until the pool is reset with the other evictions
+	VKBTEST_CHECK(allocated_sets(frame) == 4);
+
+	frame.reset();
+	frame.request(0, 3, other_view);
+	frame.request(0, 4, new_view);
+
+	VKBTEST_CHECK(frame.sets.size() == 2);
+	VKBTEST_CHECK(allocated_sets(frame) == 2);
+}
+}        // namespace
+
+int main()
+{
+	test_sets_in_use_are_kept();
+	test_max_age();
+	test_unused_pools_are_destroyed();
+	test_caches_stop_growing();
+	test_sets_of_released_views_are_dropped();
+
+	return vkbtest::get_result();
+}
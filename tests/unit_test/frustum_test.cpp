@@ -0,0 +1,164 @@
+/* Copyright (c) 2021, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "geometry/frustum.h"
+#include "unit_test.h"
+
+VKBP_DISABLE_WARNINGS()
+#include <glm/gtc/matrix_transform.hpp>
+VKBP_ENABLE_WARNINGS()
+
+namespace
+{
+vkb::Frustum create_frustum()
+{
+	auto proj = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+	auto view = glm::lookAt(glm::vec3{3.0f, 2.0f, 10.0f}, glm::vec3{0.0f}, glm::vec3{0.0f, 1.0f, 0.0f});
+
+	vkb::Frustum frustum;
+	frustum.update(proj * view);
+
+	return frustum;
+}
+
+/**
+ * @return Smallest signed distance of the furthest corners of a box over all planes of a frustum
+ */
+float min_plane_distance(const vkb::Frustum &frustum, const glm::vec3 &min, const glm::vec3 &max)
+{
+	auto center = (min + max) * 0.5f;
+	auto extent = (max - min) * 0.5f;
+
+	float distance = std::numeric_limits<float>::max();
+
+	for (auto &plane : frustum.get_planes())
+	{
+		distance = std::min(distance, glm::dot(glm::vec3(plane), center) + glm::dot(glm::abs(glm::vec3(plane)), extent) + plane.w);
+	}
+
+	return distance;
+}
+
+void test_batch_matches_single_checks()
+{
+	auto frustum = create_frustum();
+
+	std::mt19937                          generator{1234};
+	std::uniform_real_distribution<float> position_distribution{-120.0f, 120.0f};
+	std::uniform_real_distribution<float> size_distribution{0.0f, 20.0f};
+
+	// Odd count, so that the boxes after the last group of four go through the scalar tail
+	const size_t box_count = 10007;
+
+	std::vector<glm::vec3> mins(box_count);
+	std::vector<glm::vec3> maxs(box_count);
+
+	vkb::AABBBatch boxes;
+	boxes.resize(box_count);
+
+	for (size_t i = 0; i < box_count; ++i)
+	{
+		glm::vec3 min{position_distribution(generator), position_distribution(generator), position_distribution(generator)};
+		glm::vec3 size{size_distribution(generator), size_distribution(generator), size_distribution(generator)};
+
+		mins[i] = min;
+		maxs[i] = min + size;
+
+		boxes.set(i, mins[i], maxs[i]);
+	}
+
+	std::vector<uint8_t> visible(box_count, 2);
+	frustum.check_aabbs(boxes, 0, box_count, visible.data());
+
+	size_t visible_count{0};
+	size_t compared_count{0};
+
+	for (size_t i = 0; i < box_count; ++i)
+	{
+		VKBTEST_CHECK(visible[i] == 0 || visible[i] == 1);
+
+		// Boxes touching a plane may land on either side, depending on the order of the operations
+		if (std::abs(min_plane_distance(frustum, mins[i], maxs[i])) < 1e-3f)
+		{
+			continue;
+		}
+
+		VKBTEST_CHECK((visible[i] == 1) == frustum.check_aabb(mins[i], maxs[i]));
+
+		visible_count += visible[i];
+		++compared_count;
+	}
+
+	// Both outcomes must be covered for the comparison to mean anything
+	VKBTEST_CHECK(visible_count > 0);
+	VKBTEST_CHECK(visible_count < compared_count);
+}
+
+void test_ranges()
+{
+	auto frustum = create_frustum();
+
+	// Alternate boxes at the origin, which is in view, and behind the camera
+	const size_t box_count = 13;
+
+	vkb::AABBBatch boxes;
+	boxes.resize(box_count);
+
+	for (size_t i = 0; i < box_count; ++i)
+	{
+		glm::vec3 center = (i % 2 == 0) ? glm::vec3{0.0f} : glm::vec3{6.0f, 4.0f, 20.0f};
+
+		boxes.set(i, center - 0.5f, center + 0.5f);
+	}
+
+	// Every start and end, so that groups of four start at unaligned indices too
+	for (size_t begin = 0; begin <= box_count; ++begin)
+	{
+		for (size_t end = begin; end <= box_count; ++end)
+		{
+			std::vector<uint8_t> visible(box_count, 2);
+			frustum.check_aabbs(boxes, begin, end, visible.data());
+
+			for (size_t i = 0; i < box_count; ++i)
+			{
+				if (i < begin || i >= end)
+				{
+					// Boxes outside of the range are left untouched
+					VKBTEST_CHECK(visible[i] == 2);
+				}
+				else
+				{
+					VKBTEST_CHECK(visible[i] == (i % 2 == 0 ? 1 : 0));
+				}
+			}
+		}
+	}
+}
+}        // namespace
+
+int main()
+{
+	test_batch_matches_single_checks();
+	test_ranges();
+
+	return vkbtest::get_result();
+}
@@ -0,0 +1,573 @@
+/* Copyright (c) 2021, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "geometry/mesh_optimizer.h"
+#include "unit_test.h"
+
+namespace
+{
+using Triangle = std::array<uint32_t, 3>;
+
+/**
+ * @brief An indexed triangle list with one position stream
+ */
+struct Mesh
+{
+	std::vector<glm::vec3> positions;
+
+	std::vector<uint32_t> indices;
+
+	vkb::VertexStream get_position_stream() const
+	{
+		return {reinterpret_cast<const uint8_t *>(positions.data()), sizeof(glm::vec3)};
+	}
+};
+
+/**
+ * @return Height of the grid surface at x
+ */
+float get_height(float x, float amplitude)
+{
+	return std::sin(x * 0.3f) * amplitude;
+}
+
+/**
+ * @return Normal of the grid surface at x, which every triangle of the grid and of its simplifications faces
+ */
+glm::vec3 get_surface_normal(float x, float amplitude)
+{
+	return {-std::cos(x * 0.3f) * 0.3f * amplitude, 0.0f, 1.0f};
+}
+
+/**
+ * @brief A grid of size x size quads facing +z, waving along x, with its triangles in random order
+ */
+Mesh create_grid(uint32_t size, uint32_t seed, float amplitude = 2.0f)
+{
+	Mesh mesh;
+
+	for (uint32_t y = 0; y <= size; ++y)
+	{
+		for (uint32_t x = 0; x <= size; ++x)
+		{
+			mesh.positions.emplace_back(static_cast<float>(x), static_cast<float>(y), get_height(static_cast<float>(x), amplitude));
+		}
+	}
+
+	std::vector<Triangle> triangles;
+
+	for (uint32_t y = 0; y < size; ++y)
+	{
+		for (uint32_t x = 0; x < size; ++x)
+		{
+			uint32_t corner = y * (size + 1) + x;
+
+			triangles.push_back({corner, corner + 1, corner + size + 1});
+			triangles.push_back({corner + 1, corner + size + 2, corner + size + 1});
+		}
+	}
+
+	std::shuffle(triangles.begin(), triangles.end(), std::mt19937{seed});
+
+	for (auto &triangle : triangles)
+	{
+		mesh.indices.insert(mesh.indices.end(), triangle.begin(), triangle.end());
+	}
+
+	return mesh;
+}
+
+/**
+ * @return The triangles of a list in a canonical order, each rotated to start at its smallest index so
+ *         that winding is kept
+ */
+std::vector<Triangle> get_triangle_set(const std::vector<uint32_t> &indices)
+{
+	std::vector<Triangle> triangles;
+
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		Triangle triangle{indices[i], indices[i + 1], indices[i + 2]};
+		std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+		triangles.push_back(triangle);
+	}
+
+	std::sort(triangles.begin(), triangles.end());
+
+	return triangles;
+}
+
+/**
+ * @return The corner positions of every triangle, in draw order
+ */
+std::vector<glm::vec3> get_corners(const Mesh &mesh)
+{
+	std::vector<glm::vec3> corners;
+
+	for (auto index : mesh.indices)
+	{
+		corners.push_back(mesh.positions[index]);
+	}
+
+	return corners;
+}
+
+bool same_positions(const std::vector<glm::vec3> &a, const std::vector<glm::vec3> &b)
+{
+	return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(glm::vec3)) == 0;
+}
+
+/**
+ * @brief Applies a remap table to the indices and positions of a mesh
+ */
+void remap(Mesh &mesh, const std::vector<uint32_t> &remap_table, uint32_t vertex_count)
+{
+	std::vector<uint8_t> data(mesh.positions.size() * sizeof(glm::vec3));
+	std::memcpy(data.data(), mesh.positions.data(), data.size());
+
+	vkb::remap_vertices(data, sizeof(glm::vec3), remap_table, vertex_count);
+	vkb::remap_indices(mesh.indices, remap_table);
+
+	VKBTEST_CHECK(data.size() == vertex_count * sizeof(glm::vec3));
+
+	mesh.positions.resize(vertex_count);
+	std::memcpy(mesh.positions.data(), data.data(), std::min(data.size(), mesh.positions.size() * sizeof(glm::vec3)));
+}
+
+void test_vertex_cache()
+{
+	auto mesh = create_grid(64, 1);
+
+	auto vertex_count = mesh.positions.size();
+	auto triangles    = get_triangle_set(mesh.indices);
+	auto before       = vkb::analyze_vertex_cache(mesh.indices, vertex_count);
+
+	vkb::optimize_vertex_cache(mesh.indices, vertex_count);
+
+	auto after = vkb::analyze_vertex_cache(mesh.indices, vertex_count);
+
+	VKBTEST_CHECK(get_triangle_set(mesh.indices) == triangles);
+	VKBTEST_CHECK(after.triangle_count == before.triangle_count);
+
+	// Random order misses the cache on almost every vertex, a grid can get close to one miss per two triangles
+	VKBTEST_CHECK(after.get_acmr() < before.get_acmr());
+	VKBTEST_CHECK(after.get_acmr() < 1.0f);
+
+	// Optimizing an optimized list keeps it at least as good
+	vkb::optimize_vertex_cache(mesh.indices, vertex_count);
+
+	VKBTEST_CHECK(get_triangle_set(mesh.indices) == triangles);
+	VKBTEST_CHECK(vkb::analyze_vertex_cache(mesh.indices, vertex_count).get_acmr() <= after.get_acmr());
+}
+
+void test_overdraw()
+{
+	auto mesh = create_grid(64, 2);
+
+	auto vertex_count = mesh.positions.size();
+	auto triangles    = get_triangle_set(mesh.indices);
+
+	vkb::optimize_vertex_cache(mesh.indices, vertex_count);
+
+	auto before = vkb::analyze_vertex_cache(mesh.indices, vertex_count);
+
+	vkb::optimize_overdraw(mesh.indices, mesh.get_position_stream(), vertex_count);
+
+	VKBTEST_CHECK(get_triangle_set(mesh.indices) == triangles);
+
+	// Clusters start where the cache is cold, so moving them around does not cost extra misses
+	VKBTEST_CHECK(vkb::analyze_vertex_cache(mesh.indices, vertex_count).get_acmr() <= before.get_acmr());
+}
+
+void test_vertex_remap()
+{
+	auto grid = create_grid(16, 3);
+
+	// Unindexed copy of the grid, every triangle with its own vertices, and a second stream that
+	// tags the triangles of the first column of quads, splitting the vertices they share with the
+	// second column like a texture seam
+	Mesh                   mesh;
+	std::vector<glm::vec3> seams;
+
+	for (size_t i = 0; i < grid.indices.size(); ++i)
+	{
+		// Triangles of the first column of quads have a corner at x = 0
+		bool first_column = false;
+		for (size_t corner = i - i % 3; corner < i - i % 3 + 3; ++corner)
+		{
+			first_column = first_column || grid.positions[grid.indices[corner]].x < 0.5f;
+		}
+
+		mesh.positions.push_back(grid.positions[grid.indices[i]]);
+		mesh.indices.push_back(static_cast<uint32_t>(i));
+		seams.emplace_back(first_column ? 1.0f : 0.0f);
+	}
+
+	auto corners = get_corners(mesh);
+
+	std::vector<vkb::VertexStream> streams{mesh.get_position_stream(), {reinterpret_cast<const uint8_t *>(seams.data()), sizeof(glm::vec3)}};
+
+	std::vector<uint32_t> remap_table;
+	uint32_t              unique_count = vkb::generate_vertex_remap(remap_table, streams, mesh.positions.size());
+
+	VKBTEST_CHECK(remap_table.size() == mesh.positions.size());
+
+	// Every grid vertex, plus a copy of the column of vertices on the seam
+	VKBTEST_CHECK(unique_count == grid.positions.size() + 17);
+
+	for (size_t a = 0; a < remap_table.size(); ++a)
+	{
+		for (size_t b = a + 1; b < remap_table.size(); ++b)
+		{
+			bool identical = std::memcmp(&mesh.positions[a], &mesh.positions[b], sizeof(glm::vec3)) == 0 &&
+			                 std::memcmp(&seams[a], &seams[b], sizeof(glm::vec3)) == 0;
+
+			VKBTEST_CHECK(identical == (remap_table[a] == remap_table[b]));
+		}
+	}
+
+	remap(mesh, remap_table, unique_count);
+
+	VKBTEST_CHECK(same_positions(get_corners(mesh), corners));
+
+	// Without the seam stream, vertices merge back into the grid vertices
+	unique_count = vkb::generate_vertex_remap(remap_table, {streams[0]}, remap_table.size());
+
+	VKBTEST_CHECK(unique_count == grid.positions.size());
+}
+
+void test_vertex_fetch_remap()
+{
+	auto mesh = create_grid(32, 4);
+
+	vkb::optimize_vertex_cache(mesh.indices, mesh.positions.size());
+
+	// Vertices that no triangle references, at the start, in the middle and at the end
+	std::vector<glm::vec3> positions{glm::vec3{-1.0f}};
+	std::vector<uint32_t>  new_indices(mesh.positions.size());
+
+	for (size_t vertex = 0; vertex < mesh.positions.size(); ++vertex)
+	{
+		if (vertex == mesh.positions.size() / 2)
+		{
+			positions.emplace_back(-2.0f);
+		}
+
+		new_indices[vertex] = static_cast<uint32_t>(positions.size());
+		positions.push_back(mesh.positions[vertex]);
+	}
+
+	positions.emplace_back(-3.0f);
+
+	vkb::remap_indices(mesh.indices, new_indices);
+	mesh.positions = std::move(positions);
+
+	auto corners = get_corners(mesh);
+	auto stats   = vkb::analyze_vertex_cache(mesh.indices, mesh.positions.size());
+
+	std::vector<uint32_t> remap_table;
+	uint32_t              vertex_count = vkb::generate_vertex_fetch_remap(remap_table, mesh.indices, mesh.positions.size());
+
+	VKBTEST_CHECK(vertex_count == mesh.positions.size() - 3);
+	VKBTEST_CHECK(std::count(remap_table.begin(), remap_table.end(), vkb::unused_vertex) == 3);
+	VKBTEST_CHECK(remap_table.front() == vkb::unused_vertex);
+	VKBTEST_CHECK(remap_table.back() == vkb::unused_vertex);
+
+	remap(mesh, remap_table, vertex_count);
+
+	VKBTEST_CHECK(same_positions(get_corners(mesh), corners));
+
+	// Vertices are numbered in order of first use
+	uint32_t next_vertex = 0;
+	for (auto index : mesh.indices)
+	{
+		VKBTEST_CHECK(index <= next_vertex);
+		next_vertex = std::max(next_vertex, index + 1);
+	}
+	VKBTEST_CHECK(next_vertex == vertex_count);
+
+	// Reordering vertices does not change which ones hit the cache
+	VKBTEST_CHECK(vkb::analyze_vertex_cache(mesh.indices, vertex_count).transformed_vertex_count == stats.transformed_vertex_count);
+}
+
+/**
+ * @return The edges used by a single triangle, in the direction of that triangle
+ */
+std::vector<std::pair<uint32_t, uint32_t>> get_border_edges(const std::vector<uint32_t> &indices)
+{
+	std::map<std::pair<uint32_t, uint32_t>, uint32_t> edge_counts;
+
+	for (size_t i = 0; i < indices.size(); ++i)
+	{
+		auto a = indices[i];
+		auto b = indices[i - i % 3 + (i + 1) % 3];
+
+		edge_counts[std::make_pair(std::min(a, b), std::max(a, b))]++;
+	}
+
+	std::vector<std::pair<uint32_t, uint32_t>> border_edges;
+
+	for (size_t i = 0; i < indices.size(); ++i)
+	{
+		auto a = indices[i];
+		auto b = indices[i - i % 3 + (i + 1) % 3];
+
+		if (edge_counts[std::make_pair(std::min(a, b), std::max(a, b))] == 1)
+		{
+			border_edges.emplace_back(a, b);
+		}
+	}
+
+	return border_edges;
+}
+
+/**
+ * @brief Checks that no triangle of a simplified grid is degenerate or faces away from the surface of the grid
+ */
+void check_triangles(const Mesh &mesh, const std::vector<uint32_t> &indices, float amplitude = 2.0f)
+{
+	VKBTEST_CHECK(indices.size() % 3 == 0);
+
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		auto &p0 = mesh.positions[indices[i]];
+		auto &p1 = mesh.positions[indices[i + 1]];
+		auto &p2 = mesh.positions[indices[i + 2]];
+
+		auto normal = glm::cross(p1 - p0, p2 - p0);
+
+		VKBTEST_CHECK(indices[i] != indices[i + 1] && indices[i + 1] != indices[i + 2] && indices[i] != indices[i + 2]);
+		VKBTEST_CHECK(glm::length(normal) > 0.0f);
+		VKBTEST_CHECK(glm::dot(normal, get_surface_normal((p0.x + p1.x + p2.x) / 3.0f, amplitude)) > 0.0f);
+	}
+}
+
+float get_area(const Mesh &mesh, const std::vector<uint32_t> &indices)
+{
+	float area = 0.0f;
+
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		auto &p0 = mesh.positions[indices[i]];
+		auto &p1 = mesh.positions[indices[i + 1]];
+		auto &p2 = mesh.positions[indices[i + 2]];
+
+		area += glm::length(glm::cross(p1 - p0, p2 - p0)) * 0.5f;
+	}
+
+	return area;
+}
+
+void test_simplify_target()
+{
+	// A flat grid simplifies without error, so only the target stops it
+	auto mesh = create_grid(32, 5, 0.0f);
+
+	size_t target = mesh.indices.size() / 4;
+	float  error  = -1.0f;
+
+	auto indices = vkb::simplify(mesh.indices, mesh.get_position_stream(), mesh.positions.size(), target, 0.01f, &error);
+
+	VKBTEST_CHECK(indices.size() <= target);
+	VKBTEST_CHECK(indices.size() > 0);
+	VKBTEST_CHECK(error >= 0.0f && error < 1e-3f);
+
+	// The square keeps its corners and covers the same area
+	VKBTEST_CHECK(std::abs(get_area(mesh, indices) - 32.0f * 32.0f) < 1e-2f);
+
+	check_triangles(mesh, indices, 0.0f);
+
+	// A target above the index count returns the triangles untouched
+	VKBTEST_CHECK(vkb::simplify(mesh.indices, mesh.get_position_stream(), mesh.positions.size(), mesh.indices.size(), 0.01f) == mesh.indices);
+}
+
+void test_simplify_max_error()
+{
+	auto mesh = create_grid(32, 6);
+
+	// The grid is 32 units wide, so errors relative to it are 32 times larger in its units
+	float max_errors[] = {0.001f, 0.01f, 0.05f};
+	auto  index_count  = mesh.indices.size();
+
+	for (float max_error : max_errors)
+	{
+		float error = -1.0f;
+
+		auto indices = vkb::simplify(mesh.indices, mesh.get_position_stream(), mesh.positions.size(), 0, max_error, &error);
+
+		VKBTEST_CHECK(error >= 0.0f && error <= max_error * 32.0f);
+
+		// The error limit stops the simplification before the target, and a larger one goes further
+		VKBTEST_CHECK(indices.size() > 0);
+		VKBTEST_CHECK(indices.size() <= index_count);
+
+		check_triangles(mesh, indices);
+
+		index_count = indices.size();
+	}
+
+	VKBTEST_CHECK(index_count < mesh.indices.size());
+}
+
+void test_simplify_borders()
+{
+	const uint32_t size = 32;
+
+	auto mesh = create_grid(size, 7);
+
+	auto indices = vkb::simplify(mesh.indices, mesh.get_position_stream(), mesh.positions.size(), mesh.indices.size() / 8, 0.05f);
+
+	VKBTEST_CHECK(indices.size() < mesh.indices.size() / 2);
+
+	check_triangles(mesh, indices);
+
+	// Border edges only collapse along the border, so every one of them still runs along a side of the grid
+	auto border_edges = get_border_edges(indices);
+
+	VKBTEST_CHECK(!border_edges.empty());
+
+	float border_length = 0.0f;
+
+	for (auto &edge : border_edges)
+	{
+		auto &a = mesh.positions[edge.first];
+		auto &b = mesh.positions[edge.second];
+
+		bool same_side = (a.x == 0.0f && b.x == 0.0f) || (a.x == size && b.x == size) ||
+		                 (a.y == 0.0f && b.y == 0.0f) || (a.y == size && b.y == size);
+
+		VKBTEST_CHECK(same_side);
+
+		border_length += glm::length(glm::vec3{b.x - a.x, b.y - a.y, 0.0f});
+	}
+
+	// Without gaps
+	VKBTEST_CHECK(std::abs(border_length - 4.0f * size) < 1e-3f);
+}
+
+void test_simplify_seams()
+{
+	const uint32_t size = 16;
+
+	auto mesh = create_grid(size, 8);
+
+	// Give the triangles right of the middle column their own copies of the vertices on it, like a texture seam
+	std::vector<uint32_t> seam_copies(mesh.positions.size(), vkb::unused_vertex);
+
+	for (uint32_t vertex = 0; vertex < seam_copies.size(); ++vertex)
+	{
+		if (mesh.positions[vertex].x == size / 2)
+		{
+			seam_copies[vertex] = static_cast<uint32_t>(mesh.positions.size());
+			mesh.positions.push_back(mesh.positions[vertex]);
+		}
+	}
+
+	for (size_t i = 0; i < mesh.indices.size(); ++i)
+	{
+		size_t first_corner = i - i % 3;
+
+		bool right = mesh.positions[mesh.indices[first_corner]].x > size / 2 ||
+		             mesh.positions[mesh.indices[first_corner + 1]].x > size / 2 ||
+		             mesh.positions[mesh.indices[first_corner + 2]].x > size / 2;
+
+		if (right && seam_copies[mesh.indices[i]] != vkb::unused_vertex)
+		{
+			mesh.indices[i] = seam_copies[mesh.indices[i]];
+		}
+	}
+
+	auto indices = vkb::simplify(mesh.indices, mesh.get_position_stream(), mesh.positions.size(), mesh.indices.size() / 8, 0.05f);
+
+	VKBTEST_CHECK(indices.size() < mesh.indices.size() / 2);
+
+	check_triangles(mesh, indices);
+
+	// Both sides of the seam keep every vertex on it, and the same edges along it
+	std::vector<bool> referenced(mesh.positions.size(), false);
+	for (auto index : indices)
+	{
+		referenced[index] = true;
+	}
+
+	for (uint32_t vertex = 0; vertex < seam_copies.size(); ++vertex)
+	{
+		if (seam_copies[vertex] != vkb::unused_vertex)
+		{
+			VKBTEST_CHECK(referenced[vertex]);
+			VKBTEST_CHECK(referenced[seam_copies[vertex]]);
+		}
+	}
+
+	std::vector<std::pair<uint32_t, uint32_t>> left_edges;
+	std::vector<std::pair<uint32_t, uint32_t>> right_edges;
+
+	for (auto &edge : get_border_edges(indices))
+	{
+		if (mesh.positions[edge.first].x != size / 2 || mesh.positions[edge.second].x != size / 2)
+		{
+			continue;
+		}
+
+		if (edge.first < seam_copies.size())
+		{
+			left_edges.emplace_back(std::min(edge.first, edge.second), std::max(edge.first, edge.second));
+		}
+		else
+		{
+			// Map the copies back to the vertices they were copied from
+			auto original = [&](uint32_t copy) {
+				return static_cast<uint32_t>(std::find(seam_copies.begin(), seam_copies.end(), copy) - seam_copies.begin());
+			};
+
+			auto a = original(edge.first);
+			auto b = original(edge.second);
+
+			right_edges.emplace_back(std::min(a, b), std::max(a, b));
+		}
+	}
+
+	std::sort(left_edges.begin(), left_edges.end());
+	std::sort(right_edges.begin(), right_edges.end());
+
+	VKBTEST_CHECK(left_edges.size() == size);
+	VKBTEST_CHECK(left_edges == right_edges);
+}
+}        // namespace
+
+int main()
+{
+	test_vertex_cache();
+	test_overdraw();
+	test_vertex_remap();
+	test_vertex_fetch_remap();
+	test_simplify_target();
+	test_simplify_max_error();
+	test_simplify_borders();
+	test_simplify_seams();
+
+	return vkbtest::get_result();
+}
@@ -0,0 +1,141 @@
+/* Copyright (c) 2021, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "common/helpers.h"
+#include "unit_test.h"
+
+namespace
+{
+struct Item
+{
+	uint64_t key;
+
+	/// Position before sorting, to check that equal keys keep their order
+	size_t index;
+};
+
+bool same_order(const std::vector<Item> &a, const std::vector<Item> &b)
+{
+	return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const Item &x, const Item &y) {
+		return x.key == y.key && x.index == y.index;
+	});
+}
+
+/**
+ * @brief Sorts items both with radix_sort and std::stable_sort, which must agree
+ */
+void check_sort(std::vector<Item> items)
+{
+	auto expected = items;
+	std::stable_sort(expected.begin(), expected.end(), [](const Item &a, const Item &b) {
+		return a.key < b.key;
+	});
+
+	std::vector<Item> scratch;
+	vkb::radix_sort(items, scratch);
+
+	VKBTEST_CHECK(same_order(items, expected));
+}
+
+std::vector<Item> create_items(size_t count, uint64_t mask, std::mt19937_64 &generator)
+{
+	std::vector<Item> items(count);
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		items[i] = {generator() & mask, i};
+	}
+
+	return items;
+}
+
+void test_random_keys()
+{
+	std::mt19937_64 generator{7};
+
+	for (size_t count : {0, 1, 2, 3, 100, 10000})
+	{
+		check_sort(create_items(count, ~uint64_t{0}, generator));
+	}
+}
+
+void test_shared_bytes()
+{
+	std::mt19937_64 generator{11};
+
+	// Keys that only differ in their highest bits, or lowest bits, skip the passes over the other bytes
+	check_sort(create_items(5000, 0xff00000000000000ull, generator));
+	check_sort(create_items(5000, 0x00000000000000ffull, generator));
+
+	// Bits spread over every other byte, with few distinct keys so that many are equal
+	check_sort(create_items(5000, 0x0100010001000100ull, generator));
+
+	// Every key equal
+	check_sort(create_items(1000, 0, generator));
+}
+
+void test_sorted_input()
+{
+	std::mt19937_64 generator{13};
+
+	auto items = create_items(1000, ~uint64_t{0}, generator);
+
+	std::sort(items.begin(), items.end(), [](const Item &a, const Item &b) {
+		return a.key < b.key;
+	});
+	check_sort(items);
+
+	std::reverse(items.begin(), items.end());
+	check_sort(items);
+}
+
+void test_scratch_reuse()
+{
+	std::mt19937_64 generator{17};
+
+	// The scratch buffer may hold the items of a previous, larger sort
+	std::vector<Item> scratch;
+
+	for (size_t count : {1000, 10, 500})
+	{
+		auto items    = create_items(count, 0xffff0000ffff0000ull, generator);
+		auto expected = items;
+		std::stable_sort(expected.begin(), expected.end(), [](const Item &a, const Item &b) {
+			return a.key < b.key;
+		});
+
+		vkb::radix_sort(items, scratch);
+
+		VKBTEST_CHECK(items.size() == count);
+		VKBTEST_CHECK(same_order(items, expected));
+	}
+}
+}        // namespace
+
+int main()
+{
+	test_random_keys();
+	test_shared_bytes();
+	test_sorted_input();
+	test_scratch_reuse();
+
+	return vkbtest::get_result();
+}
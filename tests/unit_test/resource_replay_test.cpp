@@ -0,0 +1,346 @@
+/* Copyright (c) 2021, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstring>
+#include <limits>
+#include <random>
+
+#include "common/helpers.h"
+#include "resource_record.h"
+#include "resource_replay.h"
+#include "unit_test.h"
+
+namespace
+{
+using vkb::ResourceType;
+
+void write_record(std::ostringstream &os, ResourceType type, const std::ostringstream &record)
+{
+	const std::string payload = record.str();
+
+	vkb::write(os, type, static_cast<uint64_t>(payload.size()));
+	os.write(payload.data(), payload.size());
+}
+
+void write_shader_module(std::ostringstream &os)
+{
+	std::ostringstream record;
+	vkb::write(record, VK_SHADER_STAGE_VERTEX_BIT, std::string{"void main() {}"}, std::string{"main"}, std::string{});
+
+	// Processes
+	vkb::write(record, std::vector<std::string>{}.size());
+
+	write_record(os, ResourceType::ShaderModule, record);
+}
+
+void write_pipeline_layout(std::ostringstream &os, std::vector<size_t> shader_indices)
+{
+	std::ostringstream record;
+	vkb::write(record, shader_indices);
+
+	write_record(os, ResourceType::PipelineLayout, record);
+}
+
+void write_render_pass(std::ostringstream &os)
+{
+	std::ostringstream record;
+	vkb::write(record, std::vector<vkb::Attachment>{{}}, std::vector<vkb::LoadStoreInfo>{{}});
+
+	// One subpass, with its input and output attachments
+	vkb::write(record, size_t{1}, std::vector<uint32_t>{}, std::vector<uint32_t>{0});
+
+	write_record(os, ResourceType::RenderPass, record);
+}
+
+void write_graphics_pipeline(std::ostringstream &os, size_t pipeline_layout_index, size_t render_pass_index)
+{
+	std::ostringstream record;
+	vkb::write(record, pipeline_layout_index, true, render_pass_index, uint32_t{0});
+
+	std::map<uint32_t, std::vector<uint8_t>> specialization_constant_state{{0, {1, 0, 0, 0}}};
+	vkb::write(record, specialization_constant_state);
+
+	vkb::write(record,
+	           std::vector<VkVertexInputAttributeDescription>{},
+	           std::vector<VkVertexInputBindingDescription>{},
+	           vkb::InputAssemblyState{},
+	           vkb::RasterizationState{},
+	           vkb::ViewportState{},
+	           vkb::MultisampleState{},
+	           vkb::DepthStencilState{},
+	           VK_LOGIC_OP_CLEAR,
+	           VkBool32{VK_FALSE},
+	           std::vector<vkb::ColorBlendAttachmentState>{{}});
+
+	write_record(os, ResourceType::GraphicsPipeline, record);
+}
+
+std::vector<uint8_t> to_bytes(const std::ostringstream &os)
+{
+	auto str = os.str();
+	return {str.begin(), str.end()};
+}
+
+/**
+ * @brief A shader module, a pipeline layout, a render pass and a graphics pipeline that uses them
+ */
+std::vector<uint8_t> create_records()
+{
+	std::ostringstream os;
+	write_shader_module(os);
+	write_pipeline_layout(os, {0});
+	write_render_pass(os);
+	write_graphics_pipeline(os, 0, 0);
+
+	return to_bytes(os);
+}
+
+bool parse(const std::vector<uint8_t> &data, vkb::ResourceRecords &records)
+{
+	return vkb::ResourceReplay::parse(data.data(), data.size(), records);
+}
+
+bool parse(const std::vector<uint8_t> &data)
+{
+	vkb::ResourceRecords records;
+	return parse(data, records);
+}
+
+void test_valid_records()
+{
+	auto data = create_records();
+
+	vkb::ResourceRecords records;
+	VKBTEST_CHECK(parse(data, records));
+
+	VKBTEST_CHECK(records.order.size() == 4);
+	VKBTEST_CHECK(records.shader_modules.size() == 1);
+	VKBTEST_CHECK(records.pipeline_layouts.size() == 1);
+	VKBTEST_CHECK(records.render_passes.size() == 1);
+	VKBTEST_CHECK(records.graphics_pipelines.size() == 1);
+
+	VKBTEST_CHECK(records.shader_modules[0].glsl_source == "void main() {}");
+	VKBTEST_CHECK(records.render_passes[0].subpasses.size() == 1);
+	VKBTEST_CHECK(records.render_passes[0].subpasses[0].output_attachments == std::vector<uint32_t>{0});
+	VKBTEST_CHECK(records.graphics_pipelines[0].has_render_pass);
+	VKBTEST_CHECK(records.graphics_pipelines[0].specialization_constant_state.size() == 1);
+	VKBTEST_CHECK(records.graphics_pipelines[0].color_blend_state.attachments.size() == 1);
+}
+
+void test_truncated_records()
+{
+	auto data = create_records();
+
+	// Find where every record ends, cutting the data there leaves whole records
+	std::vector<size_t> record_ends;
+
+	for (size_t offset = 0; offset < data.size();)
+	{
+		uint64_t payload_size;
+		std::memcpy(&payload_size, data.data() + offset + sizeof(ResourceType), sizeof(payload_size));
+
+		offset += sizeof(ResourceType) + sizeof(payload_size) + payload_size;
+		record_ends.push_back(offset);
+	}
+
+	for (size_t size = 1; size < data.size(); ++size)
+	{
+		std::vector<uint8_t> truncated(data.begin(), data.begin() + size);
+
+		bool whole_records = std::find(record_ends.begin(), record_ends.end(), size) != record_ends.end();
+
+		vkb::ResourceRecords records;
+		VKBTEST_CHECK(parse(truncated, records) == whole_records);
+
+		if (!whole_records)
+		{
+			VKBTEST_CHECK(records.order.empty());
+		}
+	}
+}
+
+void test_oversized_count()
+{
+	// A source string claiming to be larger than the whole address space must not be allocated
+	std::ostringstream record;
+	vkb::write(record, VK_SHADER_STAGE_VERTEX_BIT, std::numeric_limits<size_t>::max() / 2);
+
+	std::ostringstream os;
+	write_record(os, ResourceType::ShaderModule, record);
+
+	VKBTEST_CHECK(!parse(to_bytes(os)));
+
+	// The same for the elements of a vector
+	std::ostringstream layout_record;
+	vkb::write(layout_record, size_t{1} << 40);
+
+	std::ostringstream layout_os;
+	write_shader_module(layout_os);
+	write_record(layout_os, ResourceType::PipelineLayout, layout_record);
+
+	VKBTEST_CHECK(!parse(to_bytes(layout_os)));
+}
+
+void test_invalid_indices()
+{
+	// Pipeline layout using a shader module that was not recorded
+	{
+		std::ostringstream os;
+		write_shader_module(os);
+		write_pipeline_layout(os, {1});
+
+		VKBTEST_CHECK(!parse(to_bytes(os)));
+	}
+
+	// Pipeline using a render pass recorded after it
+	{
+		std::ostringstream os;
+		write_shader_module(os);
+		write_pipeline_layout(os, {0});
+		write_graphics_pipeline(os, 0, 0);
+		write_render_pass(os);
+
+		VKBTEST_CHECK(!parse(to_bytes(os)));
+	}
+
+	// Pipeline using a pipeline layout that was not recorded
+	{
+		std::ostringstream os;
+		write_shader_module(os);
+		write_pipeline_layout(os, {0});
+		write_render_pass(os);
+		write_graphics_pipeline(os, 3, 0);
+
+		VKBTEST_CHECK(!parse(to_bytes(os)));
+	}
+}
+
+void test_payload_mismatch()
+{
+	// A payload with bytes left over once its fields are read
+	std::ostringstream record;
+	vkb::write(record, std::vector<size_t>{}, uint32_t{0});
+
+	std::ostringstream os;
+	write_record(os, ResourceType::PipelineLayout, record);
+
+	VKBTEST_CHECK(!parse(to_bytes(os)));
+
+	// A boolean that is neither true nor false
+	auto data = create_records();
+	auto bad  = create_records();
+
+	std::ostringstream prefix;
+	write_shader_module(prefix);
+	write_pipeline_layout(prefix, {0});
+	write_render_pass(prefix);
+
+	// The boolean follows the record header and the pipeline layout index
+	size_t has_render_pass_offset = prefix.str().size() + sizeof(ResourceType) + sizeof(uint64_t) + sizeof(size_t);
+	bad[has_render_pass_offset]   = 7;
+
+	VKBTEST_CHECK(parse(data));
+	VKBTEST_CHECK(!parse(bad));
+}
+
+void test_unknown_records_are_skipped()
+{
+	std::ostringstream unknown_record;
+	vkb::write(unknown_record, uint64_t{42});
+
+	std::ostringstream os;
+	write_shader_module(os);
+	write_record(os, static_cast<ResourceType>(1000), unknown_record);
+	write_pipeline_layout(os, {0});
+
+	vkb::ResourceRecords records;
+	VKBTEST_CHECK(parse(to_bytes(os), records));
+	VKBTEST_CHECK(records.order.size() == 2);
+}
+
+void test_corrupted_records()
+{
+	auto data = create_records();
+
+	std::mt19937                       generator{1234};
+	std::uniform_int_distribution<int> byte_distribution{0, 255};
+
+	// Parsing random corruptions must fail or succeed, but never read out of bounds or throw
+	for (size_t i = 0; i < 10000; ++i)
+	{
+		auto corrupted = data;
+
+		for (int flips = 0; flips < 4; ++flips)
+		{
+			corrupted[generator() % corrupted.size()] = static_cast<uint8_t>(byte_distribution(generator));
+		}
+
+		parse(corrupted);
+	}
+}
+
+void test_header_validation()
+{
+	auto records_data = create_records();
+
+	vkb::ResourceRecordHeader header{};
+	header.magic      = vkb::ResourceRecord::MAGIC;
+	header.version    = vkb::ResourceRecord::VERSION;
+	header.size_width = sizeof(size_t);
+	header.size       = records_data.size();
+	header.checksum   = vkb::fnv1a_64(records_data.data(), records_data.size());
+
+	std::vector<uint8_t> data(sizeof(header) + records_data.size());
+	std::memcpy(data.data(), &header, sizeof(header));
+	std::copy(records_data.begin(), records_data.end(), data.begin() + sizeof(header));
+
+	const uint8_t *records{nullptr};
+	size_t         records_size{0};
+
+	VKBTEST_CHECK(vkb::ResourceRecord::validate(data.data(), data.size(), records, records_size));
+	VKBTEST_CHECK(records == data.data() + sizeof(header));
+	VKBTEST_CHECK(records_size == records_data.size());
+
+	// Truncated
+	VKBTEST_CHECK(!vkb::ResourceRecord::validate(data.data(), data.size() - 1, records, records_size));
+	VKBTEST_CHECK(!vkb::ResourceRecord::validate(data.data(), sizeof(header) - 1, records, records_size));
+
+	// Corrupted
+	auto corrupted = data;
+	corrupted.back() ^= 1;
+	VKBTEST_CHECK(!vkb::ResourceRecord::validate(corrupted.data(), corrupted.size(), records, records_size));
+
+	// Written by another version
+	auto other_version = data;
+	++reinterpret_cast<vkb::ResourceRecordHeader *>(other_version.data())->version;
+	VKBTEST_CHECK(!vkb::ResourceRecord::validate(other_version.data(), other_version.size(), records, records_size));
+}
+}        // namespace
+
+int main()
+{
+	test_valid_records();
+	test_truncated_records();
+	test_oversized_count();
+	test_invalid_indices();
+	test_payload_mismatch();
+	test_unknown_records_are_skipped();
+	test_corrupted_records();
+	test_header_validation();
+
+	return vkbtest::get_result();
+}
@@ -0,0 +1,293 @@
+/* Copyright (c) 2021, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "geometry/frustum.h"
+#include "scene_graph/components/mesh.h"
+#include "scene_graph/components/transform.h"
+#include "scene_graph/node.h"
+#include "scene_graph/scene_bvh.h"
+#include "unit_test.h"
+
+namespace
+{
+using vkb::sg::SceneBVH;
+
+/**
+ * @brief Meshes of boxes of different sizes instanced across a grid, and a mesh without bounds
+ */
+class TestScene
+{
+  public:
+	TestScene()
+	{
+		for (size_t i = 0; i < 4; ++i)
+		{
+			float size = 0.5f + static_cast<float>(i);
+
+			mesh_storage.push_back(std::make_unique<vkb::sg::Mesh>("box"));
+			mesh_storage.back()->update_bounds({glm::vec3{-size}, glm::vec3{size}});
+		}
+
+		mesh_storage.push_back(std::make_unique<vkb::sg::Mesh>("unbounded"));
+
+		for (auto &mesh : mesh_storage)
+		{
+			meshes.push_back(mesh.get());
+		}
+
+		for (size_t i = 0; i < grid_size * grid_size; ++i)
+		{
+			add_instance(*meshes[i % 4], glm::vec3{static_cast<float>(i % grid_size) * 10.0f, 0.0f, static_cast<float>(i / grid_size) * 10.0f});
+		}
+
+		add_instance(*meshes[4], glm::vec3{0.0f});
+		add_instance(*meshes[4], glm::vec3{500.0f});
+	}
+
+	void add_instance(vkb::sg::Mesh &mesh, const glm::vec3 &translation)
+	{
+		nodes.push_back(std::make_unique<vkb::sg::Node>(nodes.size(), "node"));
+		nodes.back()->get_transform().set_translation(translation);
+
+		mesh.add_node(*nodes.back());
+	}
+
+	bool is_unbounded(const SceneBVH &bvh, uint32_t instance) const
+	{
+		return bvh.get_instance(instance).second == meshes[4];
+	}
+
+	static constexpr size_t grid_size{20};
+
+	std::vector<std::unique_ptr<vkb::sg::Mesh>> mesh_storage;
+
+	std::vector<vkb::sg::Mesh *> meshes;
+
+	std::vector<std::unique_ptr<vkb::sg::Node>> nodes;
+};
+
+std::vector<uint32_t> sorted(std::vector<uint32_t> instances)
+{
+	std::sort(instances.begin(), instances.end());
+	return instances;
+}
+
+bool sphere_overlaps(const glm::vec3 &center, float radius, const glm::vec3 &min, const glm::vec3 &max)
+{
+	auto offset = glm::clamp(center, min, max) - center;
+	return glm::dot(offset, offset) <= radius * radius;
+}
+
+bool ray_crosses(const glm::vec3 &origin, const glm::vec3 &direction, float max_distance, const glm::vec3 &min, const glm::vec3 &max)
+{
+	float enter = 0.0f;
+	float exit  = max_distance;
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		if (direction[axis] == 0.0f)
+		{
+			if (origin[axis] < min[axis] || origin[axis] > max[axis])
+			{
+				return false;
+			}
+			continue;
+		}
+
+		// Same operations as the tree, so that rays grazing a box give the same answer
+		float inverse_direction = 1.0f / direction[axis];
+
+		float t0 = (min[axis] - origin[axis]) * inverse_direction;
+		float t1 = (max[axis] - origin[axis]) * inverse_direction;
+
+		enter = std::max(enter, std::min(t0, t1));
+		exit  = std::min(exit, std::max(t0, t1));
+	}
+
+	return enter <= exit;
+}
+
+/**
+ * @brief Compares every query of the tree with testing every instance on its own
+ */
+void check_queries(const TestScene &scene, const SceneBVH &bvh)
+{
+	std::mt19937                          generator{42};
+	std::uniform_real_distribution<float> position_distribution{-50.0f, 250.0f};
+	std::uniform_real_distribution<float> direction_distribution{-1.0f, 1.0f};
+
+	for (size_t query = 0; query < 50; ++query)
+	{
+		glm::vec3 eye{position_distribution(generator), 20.0f, position_distribution(generator)};
+		glm::vec3 target{position_distribution(generator), 0.0f, position_distribution(generator)};
+
+		vkb::Frustum frustum;
+		frustum.update(glm::perspective(glm::radians(45.0f), 1.0f, 0.1f, 80.0f) * glm::lookAt(eye, target, glm::vec3{0.0f, 1.0f, 0.0f}));
+
+		glm::vec3 direction{direction_distribution(generator), direction_distribution(generator), direction_distribution(generator)};
+		float     radius = 30.0f;
+
+		std::vector<uint32_t> expected_frustum;
+		std::vector<uint32_t> expected_sphere;
+		std::vector<uint32_t> expected_ray;
+
+		for (uint32_t i = 0; i < static_cast<uint32_t>(bvh.size()); ++i)
+		{
+			bool unbounded = scene.is_unbounded(bvh, i);
+
+			auto &min = bvh.get_min(i);
+			auto &max = bvh.get_max(i);
+
+			if (unbounded || frustum.check_aabb(min, max))
+			{
+				expected_frustum.push_back(i);
+			}
+
+			if (unbounded || sphere_overlaps(target, radius, min, max))
+			{
+				expected_sphere.push_back(i);
+			}
+
+			if (unbounded || ray_crosses(eye, direction, 100.0f, min, max))
+			{
+				expected_ray.push_back(i);
+			}
+		}
+
+		std::vector<uint32_t> result;
+		bvh.query_frustum(frustum, result);
+		VKBTEST_CHECK(sorted(result) == expected_frustum);
+
+		result.clear();
+		bvh.query_sphere(target, radius, result);
+		VKBTEST_CHECK(sorted(result) == expected_sphere);
+
+		std::vector<SceneBVH::RayHit> hits;
+		bvh.query_ray(eye, direction, 100.0f, hits);
+
+		result.clear();
+		for (size_t i = 0; i < hits.size(); ++i)
+		{
+			result.push_back(hits[i].instance);
+
+			VKBTEST_CHECK(i == 0 || hits[i - 1].distance <= hits[i].distance);
+		}
+		VKBTEST_CHECK(sorted(result) == expected_ray);
+	}
+}
+
+void test_queries()
+{
+	TestScene scene;
+
+	SceneBVH bvh;
+	bvh.update(scene.meshes, nullptr);
+
+	VKBTEST_CHECK(bvh.size() == scene.nodes.size());
+
+	check_queries(scene, bvh);
+}
+
+void test_world_bounds()
+{
+	TestScene scene;
+
+	SceneBVH bvh;
+	bvh.update(scene.meshes, nullptr);
+
+	for (uint32_t i = 0; i < static_cast<uint32_t>(bvh.size()); ++i)
+	{
+		if (scene.is_unbounded(bvh, i))
+		{
+			continue;
+		}
+
+		auto &instance    = bvh.get_instance(i);
+		auto  translation = instance.first->get_transform().get_translation();
+		auto &bounds      = instance.second->get_bounds();
+
+		VKBTEST_CHECK(glm::all(glm::lessThan(glm::abs(bvh.get_min(i) - (bounds.get_min() + translation)), glm::vec3{1e-4f})));
+		VKBTEST_CHECK(glm::all(glm::lessThan(glm::abs(bvh.get_max(i) - (bounds.get_max() + translation)), glm::vec3{1e-4f})));
+	}
+}
+
+void test_unbounded_instances()
+{
+	TestScene scene;
+
+	SceneBVH bvh;
+	bvh.update(scene.meshes, nullptr);
+
+	// Far from every bounded instance, only those without bounds are found
+	std::vector<uint32_t> result;
+	bvh.query_sphere(glm::vec3{-1000.0f}, 1.0f, result);
+
+	VKBTEST_CHECK(result.size() == 2);
+
+	for (auto instance : result)
+	{
+		VKBTEST_CHECK(scene.is_unbounded(bvh, instance));
+	}
+
+	// A scene with no bounds at all has an empty tree, and still finds its instances
+	std::vector<vkb::sg::Mesh *> unbounded_meshes{scene.meshes[4]};
+
+	SceneBVH unbounded_bvh;
+	unbounded_bvh.update(unbounded_meshes, nullptr);
+
+	result.clear();
+	unbounded_bvh.query_sphere(glm::vec3{0.0f}, 1.0f, result);
+	VKBTEST_CHECK(result.size() == 2);
+}
+
+void test_moved_instances()
+{
+	TestScene scene;
+
+	SceneBVH bvh;
+	bvh.update(scene.meshes, nullptr);
+
+	// Small moves are refit, large ones loosen the tree until it is rebuilt
+	for (float offset : {1.0f, 5.0f, 1000.0f, 0.0f})
+	{
+		for (size_t i = 0; i < scene.nodes.size(); i += 3)
+		{
+			auto &transform = scene.nodes[i]->get_transform();
+			transform.set_translation(transform.get_translation() + glm::vec3{offset, offset * 0.5f, 0.0f});
+		}
+
+		bvh.update(scene.meshes, nullptr);
+
+		check_queries(scene, bvh);
+	}
+}
+}        // namespace
+
+int main()
+{
+	test_queries();
+	test_world_bounds();
+	test_unbounded_instances();
+	test_moved_instances();
+
+	return vkbtest::get_result();
+}
@@ -0,0 +1,59 @@
+/* Copyright (c) 2021, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdlib>
+#include <iostream>
+
+namespace vkbtest
+{
+/**
+ * @brief Counts the checks that failed in a unit test
+ */
+inline int &get_failure_count()
+{
+	static int failure_count{0};
+	return failure_count;
+}
+
+inline void check(bool condition, const char *expression, const char *file, int line)
+{
+	if (!condition)
+	{
+		std::cerr << file << ":" << line << ": check failed: " << expression << std::endl;
+		++get_failure_count();
+	}
+}
+
+/**
+ * @return The exit code of a unit test, which fails if any of its checks failed
+ */
+inline int get_result()
+{
+	if (get_failure_count() > 0)
+	{
+		std::cerr << get_failure_count() << " check(s) failed" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+}        // namespace vkbtest
+
+/// Reports a failure if an expression is false, and carries on with the test
+#define VKBTEST_CHECK(expression) vkbtest::check(static_cast<bool>(expression), #expression, __FILE__, __LINE__)